@@ -14,7 +14,7 @@ namespace XIAODB_NAMESPACE
         PutFixed32(dst, kMagicNumber);
         PutFixed32(dst, version);
         PutFixed32(dst, column_family_id);
-        unsigned char flags = (has_ttl ? 1 : 0);
+        unsigned char flags = (has_ttl ? 1 : 0) | (stream_compressed ? 2 : 0);
         dst->push_back(flags);
         dst->push_back(compression);
         PutFixed64(dst, expiration_range.first);
@@ -41,6 +41,7 @@ namespace XIAODB_NAMESPACE
         flags = src.data()[0];
         compression = static_cast<CompressionType>(src.data()[1]);
         has_ttl = (flags & 1) == 1;
+        stream_compressed = (flags & 2) == 2;
         src.remove_prefix(2);
         if (!GetFixed64(&src, &expiration_range.first) ||
             !GetFixed64(&src, &expiration_range.second))
@@ -28,6 +28,8 @@ namespace XIAODB_NAMESPACE
 //
 // List of flags:
 //   has_ttl: Whether the file contain TTL data.
+//   stream_compressed: Whether the values of the file are compressed as one
+//     stream (see RecordStreamCompressor) rather than each on its own.
 //
 // Expiration range in the header is a rough range based on
 // blob_db_options.ttl_range_secs.
@@ -50,6 +52,12 @@ namespace XIAODB_NAMESPACE
         uint32_t column_family_id = 0;
         CompressionType compression = kNoCompression;
         bool has_ttl = false;
+        // The values are compressed with `compression` as one stream, each
+        // with the values before it as context, which compresses small
+        // values much better. Such a file can only be read sequentially from
+        // its first record (e.g. by garbage collection or to re-ingest it),
+        // not at the offset of a BlobIndex.
+        bool stream_compressed = false;
         ExpirationRange expiration_range;
 
         void EncodeTo(std::string &dst);
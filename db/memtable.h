@@ -10,6 +10,7 @@
 
 #include "db/dbformat.h"
 #include "db/kv_checksum.h"
+#include "db/memtable_range_tombstone_index.h"
 #include "db/merge_helper.h"
 #include "db/range_tombstone_fragmenter.h"
 #include "db/read_callback.h"
@@ -42,6 +43,8 @@ namespace XIAODB_NAMESPACE
         size_t arena_block_size;
         uint32_t memtable_prefix_bloom_bits;
         size_t memtable_huge_page_size;
+        bool memtable_numa_aware;
+        bool memtable_transparent_huge_pages;
         bool memtable_whole_key_filtering;
         bool inplace_update_support;
         size_t inplace_update_num_locks;
@@ -539,6 +542,18 @@ namespace XIAODB_NAMESPACE
                    arena_.MemoryAllocatedBytes();
         }
 
+        // Bytes allocated by the memtable arena on each NUMA node, indexed by
+        // node. Has a single element unless memtable_numa_aware is in effect.
+        std::vector<size_t> MemoryAllocatedBytesByNumaNode() const
+        {
+            std::vector<size_t> usage(arena_.NumNodes());
+            for (size_t i = 0; i < usage.size(); ++i)
+            {
+                usage[i] = arena_.MemoryAllocatedBytesOnNode(i);
+            }
+            return usage;
+        }
+
         void UniqueRandomSample(const uint64_t &target_sample_size,
                                 std::unordered_set<const char *> *entries) override
         {
@@ -805,6 +820,23 @@ namespace XIAODB_NAMESPACE
         // SwitchMemtable() may fail.
         void ConstructFragmentedRangeTombstones();
 
+        // Returns the largest sequence number not greater than read_seq of a
+        // range tombstone in this memtable covering user_key, or 0. Served from
+        // range_tombstone_index_ without locking, so Get() and MultiGet() on the
+        // mutable memtable do not fragment range_del_table_ per reader.
+        // REQUIRES: ts_sz_ == 0; with user-defined timestamps, use
+        // NewRangeTombstoneIterator() instead.
+        SequenceNumber MaxCoveringTombstoneSeqnum(const Slice &user_key,
+                                                  SequenceNumber read_seq) const
+        {
+            if (is_range_del_table_empty_.load(std::memory_order_relaxed))
+            {
+                return 0;
+            }
+            return range_tombstone_index_.MaxCoveringTombstoneSeqnum(user_key,
+                                                                     read_seq);
+        }
+
         bool IsFragmentedRangeTombstonesConstructed() const override
         {
             return fragmented_range_tombstone_list_.get() != nullptr ||
@@ -829,6 +861,7 @@ namespace XIAODB_NAMESPACE
         friend class MemTableIterator;
         friend class MemTableBackwardIterator;
         friend class MemTableList;
+        friend class MemTableCompactor;
 
         KeyComparator comparator_;
         const ImmutableMemTableOptions moptions_;
@@ -865,7 +898,7 @@ namespace XIAODB_NAMESPACE
         std::vector<port::RWMutex> locks_;
 
         const SliceTransform *const prefix_extractor_;
-        std::unique_ptr<DynamicBloom> bloom_filter_;
+        std::unique_ptr<BlockedDynamicBloom> bloom_filter_;
 
         std::atomic<FlushStateEnum> flush_state_;
 
@@ -940,6 +973,11 @@ namespace XIAODB_NAMESPACE
         CoreLocalArray<std::shared_ptr<FragmentedRangeTombstoneListCache>>
             cached_range_tombstone_;
 
+        // Interval index of the tombstones in range_del_table_, updated by Add()
+        // under range_del_mutex_ and read lock-free by point lookups.
+        MemTableRangeTombstoneIndex range_tombstone_index_{
+            comparator_.comparator.user_comparator()};
+
         void UpdateEntryChecksum(const ProtectionInfoKVOS64 *kv_prot_info,
                                  const Slice &key, const Slice &value, ValueType type,
                                  SequenceNumber s, char *checksum_ptr);
@@ -0,0 +1,144 @@
+#include "db/memtable_compaction.h"
+
+#include <algorithm>
+#include <array>
+#include <unordered_set>
+
+#include "db/lookup_key.h"
+#include "db/memtable.h"
+#include "db/memtable_span_reader.h"
+#include "memory/arena.h"
+#include "util/coding.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        // The earliest snapshot that can see seq, or kMaxSequenceNumber.
+        SequenceNumber EarliestVisibleSnapshot(
+            const std::vector<SequenceNumber> &snapshots, SequenceNumber seq)
+        {
+            auto it = std::lower_bound(snapshots.begin(), snapshots.end(), seq);
+            return it == snapshots.end() ? kMaxSequenceNumber : *it;
+        }
+
+        bool CanCompact(MemTable *mem)
+        {
+            return !mem->IsEmpty() && mem->NumRangeDeletion() == 0 &&
+                   mem->IsSnapshotSupported();
+        }
+    }
+
+    double MemTableCompactor::EstimateGarbageRatio(MemTable *mem,
+                                                   uint64_t sample_size) const
+    {
+        if (!CanCompact(mem) || sample_size == 0)
+        {
+            return 0.0;
+        }
+
+        std::unordered_set<const char *> sample;
+        mem->UniqueRandomSample(sample_size, &sample);
+        if (sample.empty())
+        {
+            return 0.0;
+        }
+
+        const Comparator *ucmp = mem->GetInternalKeyComparator().user_comparator();
+        Arena arena;
+        std::unique_ptr<MemTableRep::Iterator, Destroyer<MemTableRep::Iterator>>
+            iter(mem->table_->GetIterator(&arena));
+
+        uint64_t garbage = 0;
+        for (const char *entry : sample)
+        {
+            Slice ikey = GetLengthPrefixedSlice(entry);
+            Slice user_key = ExtractUserKey(ikey);
+            SequenceNumber stripe = EarliestVisibleSnapshot(
+                snapshots_, ExtractInternalKeyFooter(ikey) >> 8);
+
+            // Versions of a user key are ordered newest first. The sampled entry
+            // is garbage iff the version right before it is in the same stripe.
+            LookupKey lkey(user_key, kMaxSequenceNumber);
+            iter->Seek(lkey.internal_key(), lkey.memtable_key().data());
+            SequenceNumber newer_stripe = 0;
+            bool has_newer = false;
+            for (; iter->Valid() && iter->key() != entry; iter->Next())
+            {
+                Slice cur = GetLengthPrefixedSlice(iter->key());
+                if (!ucmp->Equal(ExtractUserKey(cur), user_key))
+                {
+                    break;
+                }
+                has_newer = true;
+                newer_stripe = EarliestVisibleSnapshot(
+                    snapshots_, ExtractInternalKeyFooter(cur) >> 8);
+            }
+            if (has_newer && newer_stripe == stripe)
+            {
+                ++garbage;
+            }
+        }
+        return static_cast<double>(garbage) / static_cast<double>(sample.size());
+    }
+
+    Status MemTableCompactor::Compact(MemTable *src, MemTable *dst)
+    {
+        assert(dst->IsEmpty());
+        num_input_entries_ = src->NumEntries();
+        num_output_entries_ = 0;
+        if (!CanCompact(src))
+        {
+            return Status::NotSupported("Memtable not eligible for compaction");
+        }
+
+        Arena arena;
+        std::unique_ptr<MemTableRep::Iterator, Destroyer<MemTableRep::Iterator>>
+            iter(src->table_->GetIterator(&arena));
+        MemTableSpanReader reader(
+            iter.get(), src->GetInternalKeyComparator().user_comparator(),
+            snapshots_);
+
+        std::array<KeyValueSpan, 64> spans;
+        size_t num_spans = 0;
+        Status s;
+        while ((s = reader.NextBatch(spans.data(), spans.size(), &num_spans)).ok() &&
+               num_spans > 0)
+        {
+            for (size_t i = 0; i < num_spans && s.ok(); ++i)
+            {
+                uint64_t seq;
+                ValueType type;
+                UnPackSequenceAndType(ExtractInternalKeyFooter(spans[i].key), &seq,
+                                      &type);
+                // Entries are unique (seq, key) pairs already, so Add() cannot
+                // return TryAgain here.
+                s = dst->Add(seq, type, ExtractUserKey(spans[i].key),
+                             spans[i].value, nullptr /* kv_prot_info */);
+                ++num_output_entries_;
+            }
+            if (!s.ok())
+            {
+                break;
+            }
+        }
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        // Let dst stand in for src in the immutable memtable list.
+        dst->SetFirstSequenceNumber(src->GetFirstSequenceNumber());
+        dst->SetEarliestSequenceNumber(src->GetEarliestSequenceNumber());
+        dst->SetCreationSeq(src->GetCreationSeq());
+        dst->SetNextLogNumber(src->GetNextLogNumber());
+        uint64_t prep_log = src->GetMinLogContainingPrepSection();
+        if (prep_log != 0)
+        {
+            dst->RefLogContainingPrepSection(prep_log);
+        }
+        dst->ConstructFragmentedRangeTombstones();
+        dst->MarkImmutable();
+        return Status::OK();
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include "db/dbformat.h"
+#include "xiaodb/status.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class MemTable;
+
+    // In-memory compaction of a memtable that has just become immutable.
+    //
+    // With overwrite-heavy workloads a memtable fills write_buffer_size mostly
+    // with versions that no reader can see any more, and flushing it writes all
+    // of them to L0 only for compaction to drop them again. MemTableCompactor
+    // copies just the versions some live snapshot (or the latest read) can still
+    // see into a fresh memtable, whose arena is then dense, so that the old
+    // memtable and its arena can be freed before flush.
+    //
+    // Intended use, when switching memtables (after
+    // MemTable::ConstructFragmentedRangeTombstones() and before
+    // MemTableList::Add()):
+    //
+    //   MemTableCompactor compactor(snapshots);
+    //   if (compactor.EstimateGarbageRatio(old_mem, kSampleSize) >=
+    //       mutable_cf_options.memtable_compaction_garbage_ratio &&
+    //       compactor.Compact(old_mem, new_mem).ok()) {
+    //     // add new_mem to the immutable list in place of old_mem
+    //   }
+    //
+    // Compaction reuses the flush fast path (MemTableSpanReader), so it has the
+    // same restrictions: memtables with range deletions, merge operands or
+    // single deletes are left alone (Compact() returns NotSupported).
+    //
+    // Not thread safe; the source memtable must be immutable.
+    class MemTableCompactor
+    {
+    public:
+        // snapshots: live snapshots, sorted ascending. Must outlive this object.
+        explicit MemTableCompactor(const std::vector<SequenceNumber> &snapshots)
+            : snapshots_(snapshots) {}
+
+        // Estimates the fraction of entries of `mem` that Compact() would drop,
+        // from a random sample of about sample_size entries. Returns 0 if the
+        // memtable cannot be compacted.
+        double EstimateGarbageRatio(MemTable *mem, uint64_t sample_size) const;
+
+        // Inserts the visible versions of `src` into the empty memtable `dst` in
+        // order, and carries over the sequence number and log bookkeeping so
+        // that `dst` can stand in for `src`. On failure `dst` should be
+        // discarded.
+        Status Compact(MemTable *src, MemTable *dst);
+
+        uint64_t num_input_entries() const { return num_input_entries_; }
+        uint64_t num_output_entries() const { return num_output_entries_; }
+
+    private:
+        const std::vector<SequenceNumber> &snapshots_;
+        uint64_t num_input_entries_ = 0;
+        uint64_t num_output_entries_ = 0;
+    };
+}
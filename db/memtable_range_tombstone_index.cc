@@ -0,0 +1,220 @@
+#include "db/memtable_range_tombstone_index.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+namespace XIAODB_NAMESPACE
+{
+    // A fragment of a level: the interval [start_key, end_key) and the
+    // sequence numbers of the tombstones covering it, stored in
+    // seqs[seq_start_idx, seq_end_idx) in decreasing order.
+    struct MemTableRangeTombstoneIndex::Level
+    {
+        struct Fragment
+        {
+            Slice start_key;
+            Slice end_key;
+            size_t seq_start_idx;
+            size_t seq_end_idx;
+        };
+
+        // The unfragmented tombstones, kept to rebuild the level when it is
+        // merged into a larger one.
+        std::vector<Tombstone> tombstones;
+        std::vector<Fragment> fragments;
+        std::vector<SequenceNumber> seqs;
+
+        size_t ApproximateMemoryUsage() const
+        {
+            return sizeof(*this) + tombstones.capacity() * sizeof(Tombstone) +
+                   fragments.capacity() * sizeof(Fragment) +
+                   seqs.capacity() * sizeof(SequenceNumber);
+        }
+    };
+
+    // levels[i] is the level holding 2^i tombstones, or nullptr.
+    struct MemTableRangeTombstoneIndex::Version
+    {
+        uint64_t num_tombstones = 0;
+        std::vector<const Level *> levels;
+    };
+
+    MemTableRangeTombstoneIndex::MemTableRangeTombstoneIndex(
+        const Comparator *user_comparator)
+        : ucmp_(user_comparator), memory_usage_(0)
+    {
+        versions_.emplace_back(new Version());
+        memory_usage_ += sizeof(Version);
+        current_.store(versions_.back().get(), std::memory_order_release);
+    }
+
+    MemTableRangeTombstoneIndex::~MemTableRangeTombstoneIndex() = default;
+
+    void MemTableRangeTombstoneIndex::Add(const Slice &start_key,
+                                          const Slice &end_key,
+                                          SequenceNumber seq)
+    {
+        if (ucmp_->Compare(start_key, end_key) >= 0)
+        {
+            return;
+        }
+        const Version *cur = current_.load(std::memory_order_relaxed);
+        std::unique_ptr<Version> next(new Version());
+        next->num_tombstones = cur->num_tombstones + 1;
+        next->levels = cur->levels;
+
+        // Binary counter increment: fold the new tombstone and every occupied
+        // level below the first empty one into that slot.
+        std::vector<Tombstone> carry;
+        carry.push_back({start_key, end_key, seq});
+        size_t i = 0;
+        for (; i < next->levels.size() && next->levels[i] != nullptr; ++i)
+        {
+            const std::vector<Tombstone> &merged = next->levels[i]->tombstones;
+            carry.insert(carry.end(), merged.begin(), merged.end());
+            next->levels[i] = nullptr;
+        }
+        if (i == next->levels.size())
+        {
+            next->levels.push_back(nullptr);
+        }
+        next->levels[i] = BuildLevel(std::move(carry));
+
+        memory_usage_ += sizeof(Version) + next->levels.capacity() * sizeof(Level *);
+        versions_.push_back(std::move(next));
+        current_.store(versions_.back().get(), std::memory_order_release);
+    }
+
+    const MemTableRangeTombstoneIndex::Level *
+    MemTableRangeTombstoneIndex::BuildLevel(std::vector<Tombstone> &&tombstones)
+    {
+        const Comparator *ucmp = ucmp_;
+        auto less = [ucmp](const Slice &a, const Slice &b)
+        {
+            return ucmp->Compare(a, b) < 0;
+        };
+
+        std::unique_ptr<Level> level(new Level());
+        level->tombstones = std::move(tombstones);
+
+        // Every start and end key bounds an elementary interval; the tombstones
+        // covering an elementary interval all cover it entirely.
+        std::vector<Slice> bounds;
+        bounds.reserve(level->tombstones.size() * 2);
+        for (const Tombstone &t : level->tombstones)
+        {
+            bounds.push_back(t.start_key);
+            bounds.push_back(t.end_key);
+        }
+        std::sort(bounds.begin(), bounds.end(), less);
+        bounds.erase(std::unique(bounds.begin(), bounds.end(),
+                                 [ucmp](const Slice &a, const Slice &b)
+                                 {
+                                     return ucmp->Compare(a, b) == 0;
+                                 }),
+                     bounds.end());
+
+        // Elementary interval j is [bounds[j], bounds[j + 1]). Count the
+        // tombstones covering each one with a difference array.
+        const size_t num_intervals = bounds.size() - 1;
+        std::vector<std::pair<size_t, size_t>> spans;
+        spans.reserve(level->tombstones.size());
+        std::vector<int64_t> delta(num_intervals + 1, 0);
+        for (const Tombstone &t : level->tombstones)
+        {
+            size_t lo = std::lower_bound(bounds.begin(), bounds.end(), t.start_key,
+                                         less) -
+                        bounds.begin();
+            size_t hi = std::lower_bound(bounds.begin() + lo, bounds.end(),
+                                         t.end_key, less) -
+                        bounds.begin();
+            spans.emplace_back(lo, hi);
+            ++delta[lo];
+            --delta[hi];
+        }
+
+        // Lay out the non-empty intervals as fragments.
+        std::vector<size_t> fragment_of(num_intervals, SIZE_MAX);
+        int64_t coverage = 0;
+        size_t num_seqs = 0;
+        for (size_t j = 0; j < num_intervals; ++j)
+        {
+            coverage += delta[j];
+            if (coverage == 0)
+            {
+                continue;
+            }
+            fragment_of[j] = level->fragments.size();
+            level->fragments.push_back({bounds[j], bounds[j + 1], num_seqs,
+                                        num_seqs});
+            num_seqs += static_cast<size_t>(coverage);
+        }
+
+        level->seqs.resize(num_seqs);
+        for (size_t k = 0; k < spans.size(); ++k)
+        {
+            for (size_t j = spans[k].first; j < spans[k].second; ++j)
+            {
+                Level::Fragment &f = level->fragments[fragment_of[j]];
+                level->seqs[f.seq_end_idx++] = level->tombstones[k].seq;
+            }
+        }
+        for (const Level::Fragment &f : level->fragments)
+        {
+            std::sort(level->seqs.begin() + f.seq_start_idx,
+                      level->seqs.begin() + f.seq_end_idx,
+                      std::greater<SequenceNumber>());
+        }
+
+        memory_usage_ += level->ApproximateMemoryUsage();
+        levels_.push_back(std::move(level));
+        return levels_.back().get();
+    }
+
+    SequenceNumber MemTableRangeTombstoneIndex::LevelMaxCoveringSeqnum(
+        const Comparator *ucmp, const Level &level, const Slice &user_key,
+        SequenceNumber read_seq)
+    {
+        auto it = std::upper_bound(
+            level.fragments.begin(), level.fragments.end(), user_key,
+            [ucmp](const Slice &key, const Level::Fragment &f)
+            {
+                return ucmp->Compare(key, f.start_key) < 0;
+            });
+        if (it == level.fragments.begin())
+        {
+            return 0;
+        }
+        --it;
+        if (ucmp->Compare(user_key, it->end_key) >= 0)
+        {
+            return 0;
+        }
+        auto seq_end = level.seqs.begin() + it->seq_end_idx;
+        auto pos = std::lower_bound(level.seqs.begin() + it->seq_start_idx, seq_end,
+                                    read_seq, std::greater<SequenceNumber>());
+        return pos == seq_end ? 0 : *pos;
+    }
+
+    SequenceNumber MemTableRangeTombstoneIndex::MaxCoveringTombstoneSeqnum(
+        const Slice &user_key, SequenceNumber read_seq) const
+    {
+        const Version *v = current_.load(std::memory_order_acquire);
+        SequenceNumber max_seq = 0;
+        for (const Level *level : v->levels)
+        {
+            if (level != nullptr)
+            {
+                max_seq = std::max(
+                    max_seq, LevelMaxCoveringSeqnum(ucmp_, *level, user_key, read_seq));
+            }
+        }
+        return max_seq;
+    }
+
+    uint64_t MemTableRangeTombstoneIndex::NumTombstones() const
+    {
+        return current_.load(std::memory_order_acquire)->num_tombstones;
+    }
+}
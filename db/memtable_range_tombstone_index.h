@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "xiaodb/comparator.h"
+#include "xiaodb/slice.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // An interval index over the range tombstones of a mutable memtable, kept
+    // up to date as tombstones are added so that point lookups never have to
+    // fragment range_del_table_ on the read path.
+    //
+    // Tombstones are kept in a logarithmic set of levels. Level i, when
+    // present, holds 2^i tombstones already fragmented into sorted,
+    // non-overlapping intervals, each carrying the sequence numbers of the
+    // tombstones covering it in decreasing order. Adding a tombstone merges
+    // levels like a binary counter increment, so an Add() refragments
+    // O(log n) tombstones amortized, and a lookup is a binary search in each
+    // of at most O(log n) levels.
+    //
+    // Levels and the versions listing them are immutable once published.
+    // Readers load the current version with a single acquire load and take no
+    // lock and no reference count. Superseded levels and versions stay alive
+    // until the index is destroyed, which is safe because readers of a
+    // memtable hold a reference to it for the duration of the lookup. The
+    // retained memory is O(n log n) tombstone entries; the number of range
+    // deletions in a memtable is bounded by memtable_max_range_deletions or by
+    // the write buffer size.
+    //
+    // Keys are not copied: start and end keys must point to memory that
+    // outlives the index, such as the memtable arena.
+    //
+    // User-defined timestamps are not supported; with a timestamp-aware
+    // comparator the memtable keeps using fragmented tombstone iterators.
+    class MemTableRangeTombstoneIndex
+    {
+    public:
+        explicit MemTableRangeTombstoneIndex(const Comparator *user_comparator);
+
+        // No copying allowed
+        MemTableRangeTombstoneIndex(const MemTableRangeTombstoneIndex &) = delete;
+        MemTableRangeTombstoneIndex &operator=(
+            const MemTableRangeTombstoneIndex &) = delete;
+
+        ~MemTableRangeTombstoneIndex();
+
+        // Add the tombstone [start_key, end_key) at sequence number seq. Empty
+        // ranges are ignored.
+        // REQUIRES: external synchronization among writers
+        // (MemTable::range_del_mutex_). Readers may run concurrently.
+        void Add(const Slice &start_key, const Slice &end_key, SequenceNumber seq);
+
+        // Returns the largest sequence number not greater than read_seq of a
+        // tombstone covering user_key, or 0 if there is none.
+        // Thread-safe without external synchronization.
+        SequenceNumber MaxCoveringTombstoneSeqnum(const Slice &user_key,
+                                                  SequenceNumber read_seq) const;
+
+        // Number of tombstones visible to readers.
+        // Thread-safe without external synchronization.
+        uint64_t NumTombstones() const;
+
+        // Heap memory held by the index, including superseded levels.
+        // REQUIRES: external synchronization among writers.
+        size_t ApproximateMemoryUsage() const { return memory_usage_; }
+
+    private:
+        struct Tombstone
+        {
+            Slice start_key;
+            Slice end_key;
+            SequenceNumber seq;
+        };
+
+        struct Level;
+        struct Version;
+
+        // Fragments `tombstones` into a new level owned by levels_.
+        const Level *BuildLevel(std::vector<Tombstone> &&tombstones);
+
+        static SequenceNumber LevelMaxCoveringSeqnum(const Comparator *ucmp,
+                                                     const Level &level,
+                                                     const Slice &user_key,
+                                                     SequenceNumber read_seq);
+
+        const Comparator *const ucmp_;
+        std::atomic<const Version *> current_;
+
+        // Owns every level and version ever published.
+        std::vector<std::unique_ptr<const Level>> levels_;
+        std::vector<std::unique_ptr<const Version>> versions_;
+        size_t memory_usage_;
+    };
+}
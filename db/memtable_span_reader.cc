@@ -0,0 +1,81 @@
+#include "db/memtable_span_reader.h"
+
+#include <algorithm>
+
+#include "util/coding.h"
+
+namespace XIAODB_NAMESPACE
+{
+    MemTableSpanReader::MemTableSpanReader(
+        MemTableRep::Iterator *iter, const Comparator *user_comparator,
+        const std::vector<SequenceNumber> &snapshots)
+        : iter_(iter), user_comparator_(user_comparator), snapshots_(snapshots)
+    {
+        assert(std::is_sorted(snapshots_.begin(), snapshots_.end()));
+        iter_->SeekToFirst();
+    }
+
+    SequenceNumber MemTableSpanReader::EarliestVisibleSnapshot(
+        SequenceNumber seq) const
+    {
+        auto it = std::lower_bound(snapshots_.begin(), snapshots_.end(), seq);
+        return it == snapshots_.end() ? kMaxSequenceNumber : *it;
+    }
+
+    Status MemTableSpanReader::NextBatch(KeyValueSpan *spans, size_t max_spans,
+                                         size_t *num_spans)
+    {
+        size_t n = 0;
+        for (; n < max_spans && iter_->Valid(); iter_->Next())
+        {
+            // Entry format (see MemTable::Add):
+            //  key_size     : varint32 of internal_key.size()
+            //  key bytes    : char[internal_key.size()]
+            //  value_size   : varint32 of value.size()
+            //  value bytes  : char[value.size()]
+            //  checksum     : char[moptions_.protection_bytes_per_key]
+            const char *entry = iter_->key();
+            uint32_t key_length = 0;
+            const char *key_ptr = GetVarint32Ptr(entry, entry + 5, &key_length);
+            if (key_ptr == nullptr || key_length < kNumInternalBytes)
+            {
+                *num_spans = n;
+                return Status::Corruption("Bad memtable entry in flush");
+            }
+            Slice ikey(key_ptr, key_length);
+
+            uint64_t seq;
+            ValueType type;
+            UnPackSequenceAndType(ExtractInternalKeyFooter(ikey), &seq, &type);
+            if (type != kTypeValue && type != kTypeDeletion &&
+                type != kTypeDeletionWithTimestamp && type != kTypeBlobIndex &&
+                type != kTypeWideColumnEntity)
+            {
+                *num_spans = n;
+                return Status::NotSupported("Entry type needs regular flush");
+            }
+
+            SequenceNumber snapshot = EarliestVisibleSnapshot(seq);
+            if (has_prev_ && snapshot == prev_snapshot_ &&
+                user_comparator_->Equal(ExtractUserKey(ikey),
+                                        ExtractUserKey(prev_key_)))
+            {
+                // Older version in the same stripe as the newer one we kept
+                ++num_dropped_;
+                continue;
+            }
+
+            KeyValueSpan &span = spans[n++];
+            span.key = ikey;
+            span.value = GetLengthPrefixedSlice(key_ptr + key_length);
+            span.shared_prefix =
+                has_prev_ ? static_cast<uint32_t>(ikey.difference_offset(prev_key_))
+                          : 0;
+            prev_key_ = ikey;
+            prev_snapshot_ = snapshot;
+            has_prev_ = true;
+        }
+        *num_spans = n;
+        return Status::OK();
+    }
+}
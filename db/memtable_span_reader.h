@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+
+#include "db/dbformat.h"
+#include "xiaodb/comparator.h"
+#include "xiaodb/memtablerep.h"
+#include "xiaodb/status.h"
+#include "table/table_builder.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Walks the entries of an immutable memtable in sorted order and produces
+    // KeyValueSpans that point directly into the memtable arena. Flush hands
+    // them to TableBuilder::AddSpans(), skipping the decode into an
+    // InternalIterator and the copy of every key and value on the way to the
+    // table builder. The shared prefix of consecutive keys is computed here,
+    // while both keys are still in cache.
+    //
+    // This is a fast path: it only applies when flush would pass the entries
+    // through unchanged apart from dropping versions hidden within a snapshot
+    // stripe, i.e. with no compaction filter, no range deletions and no
+    // user-defined timestamp stripping. NextBatch() returns NotSupported at the
+    // first entry it cannot pass through (merge operands, single deletes), in
+    // which case the caller abandons the builder and takes the regular flush
+    // path.
+    //
+    // The memtable must stay alive, and immutable, while spans are in use.
+    class MemTableSpanReader
+    {
+    public:
+        // iter: iterator over the memtable rep, not owned. The reader seeks it to
+        // the first entry.
+        // user_comparator: detects consecutive versions of the same user key.
+        // snapshots: live snapshots at flush time, sorted ascending.
+        MemTableSpanReader(MemTableRep::Iterator *iter,
+                           const Comparator *user_comparator,
+                           const std::vector<SequenceNumber> &snapshots);
+
+        // Fills spans[0..*num_spans) with the next entries to write, at most
+        // max_spans of them. *num_spans is 0 once the memtable is exhausted.
+        Status NextBatch(KeyValueSpan *spans, size_t max_spans, size_t *num_spans);
+
+        // Number of hidden versions dropped so far
+        uint64_t num_dropped() const { return num_dropped_; }
+
+    private:
+        // The earliest snapshot that can see seq, or kMaxSequenceNumber. Two
+        // versions of a key in the same stripe are indistinguishable to every
+        // reader, so only the newer one needs to be written.
+        SequenceNumber EarliestVisibleSnapshot(SequenceNumber seq) const;
+
+        MemTableRep::Iterator *iter_;
+        const Comparator *user_comparator_;
+        const std::vector<SequenceNumber> &snapshots_;
+        // Last key handed out, pointing into the arena
+        Slice prev_key_;
+        SequenceNumber prev_snapshot_ = 0;
+        bool has_prev_ = false;
+        uint64_t num_dropped_ = 0;
+    };
+}
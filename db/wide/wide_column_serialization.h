@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "xiaodb/slice.h"
+#include "xiaodb/status.h"
+#include "xiaodb/wide_columns.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Wide-column serialization/deserialization primitives.
+    //
+    // The two main parts of the layout are 1) a sorted index containing the
+    // column names and column value sizes and 2) the column values themselves.
+    // Keeping the index and the values separate will enable selectively reading
+    // column values down the line. Note that currently the index has to be
+    // fully parsed in order to find out the offset of each column value.
+    //
+    // Legend: cn = column name, cv = column value, cns = column name size, cvs =
+    // column value size.
+    //
+    //      +----------+--------------+----------+-------+----------+---...
+    //      | version  | # of columns |  cns 1   | cn 1  |  cvs 1   |
+    //      +----------+--------------+------------------+--------- +---...
+    //      | varint32 |   varint32   | varint32 | bytes | varint32 |
+    //      +----------+--------------+----------+-------+----------+---...
+    //
+    //      ... continued ...
+    //
+    //          ...---+----------+-------+----------+-------+---...---+-------+
+    //                |  cns N   | cn N  |  cvs N   | cv 1  |         | cv N  |
+    //          ...---+----------+-------+----------+-------+---...---+-------+
+    //                | varint32 | bytes | varint32 | bytes |         | bytes |
+    //          ...---+----------+-------+----------+-------+---...---+-------+
+    class WideColumnSerialization
+    {
+    public:
+        // The columns must be sorted by name, without duplicates.
+        static Status Serialize(const WideColumns &columns, std::string &output);
+
+        // The columns point into input, which must outlive them. Advances
+        // input past the entity.
+        static Status Deserialize(Slice &input, WideColumns &columns);
+
+        // Sets value to the value of the default column, or to empty if the
+        // entity has none.
+        static Status GetValueOfDefaultColumn(Slice &input, Slice &value);
+
+        static constexpr uint32_t kVersion1 = 1;
+        static constexpr uint32_t kCurrentVersion = kVersion1;
+    };
+}
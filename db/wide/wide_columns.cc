@@ -0,0 +1,8 @@
+#include "xiaodb/wide_columns.h"
+
+namespace XIAODB_NAMESPACE
+{
+    const Slice kDefaultWideColumnName;
+
+    const WideColumns kNoWideColumns;
+}
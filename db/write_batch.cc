@@ -13,6 +13,7 @@
 #include "util/autovector.h"
 #include "db/write_batch_internal.h"
 #include "db/column_family.h"
+#include "db/wide/wide_column_serialization.h"
 
 namespace XIAODB_NAMESPACE
 {
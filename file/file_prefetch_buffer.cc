@@ -0,0 +1,366 @@
+#include "file/file_prefetch_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "monitoring/statistics_impl.h"
+#include "util/stop_watch.h"
+
+namespace XIAODB_NAMESPACE
+{
+    FilePrefetchBuffer::FilePrefetchBuffer(const ReadaheadParams &readahead_params,
+                                           FileSystem *fs, Statistics *stats)
+        : readahead_size_(std::min(readahead_params.initial_readahead_size,
+                                   readahead_params.max_readahead_size)),
+          initial_readahead_size_(readahead_size_),
+          max_readahead_size_(readahead_params.max_readahead_size),
+          num_buffers_(fs == nullptr ? 1 : std::min<size_t>(readahead_params.num_buffers, 2)),
+          implicit_auto_readahead_(readahead_params.implicit_auto_readahead),
+          num_file_reads_(0),
+          num_file_reads_for_auto_readahead_(
+              readahead_params.num_file_reads_for_auto_readahead),
+          fs_(fs),
+          stats_(stats)
+    {
+        for (BufferInfo &buf : bufs_)
+        {
+            buf.buffer_.Alignment(kDefaultPageSize);
+        }
+    }
+
+    FilePrefetchBuffer::~FilePrefetchBuffer()
+    {
+        // The callback of a read in flight must not run once the buffers are
+        // gone.
+        for (BufferInfo &buf : bufs_)
+        {
+            if (buf.async_read_in_progress_)
+            {
+                RecordTick(stats_, PREFETCHED_BYTES_DISCARDED, buf.async_req_.len);
+            }
+            AbortAndClear(&buf);
+        }
+    }
+
+    bool FilePrefetchBuffer::TryReadFromCache(const IOOptions &opts,
+                                              RandomAccessFileReader *reader,
+                                              uint64_t offset, size_t n,
+                                              Slice *result, Status *status)
+    {
+        if (max_readahead_size_ == 0 || initial_readahead_size_ == 0)
+        {
+            return false;
+        }
+        if (implicit_auto_readahead_ && !IsEligibleForPrefetch(offset, n))
+        {
+            return false;
+        }
+
+        BufferInfo *curr = CurrentBuffer();
+        if (curr->IsDataInBuffer(offset, n))
+        {
+            *result = Slice(curr->buffer_.BufferStart() + (offset - curr->offset_), n);
+            RecordTick(stats_, PREFETCH_HITS);
+            RecordTick(stats_, PREFETCH_BYTES_USEFUL, n);
+        }
+        else
+        {
+            Status s = PrefetchInternal(opts, reader, offset, n, result);
+            if (!s.ok())
+            {
+                *status = s;
+                return false;
+            }
+        }
+        UpdateReadPattern(offset, n);
+        return true;
+    }
+
+    bool FilePrefetchBuffer::IsEligibleForPrefetch(uint64_t offset, size_t n)
+    {
+        if (!IsBlockSequential(offset) && !CurrentBuffer()->IsOffsetInBuffer(offset))
+        {
+            UpdateReadPattern(offset, n);
+            ResetValues();
+            return false;
+        }
+        num_file_reads_++;
+        if (num_file_reads_ <= num_file_reads_for_auto_readahead_)
+        {
+            UpdateReadPattern(offset, n);
+            return false;
+        }
+        return true;
+    }
+
+    Status FilePrefetchBuffer::PrefetchInternal(const IOOptions &opts,
+                                                RandomAccessFileReader *reader,
+                                                uint64_t offset, size_t n,
+                                                Slice *result)
+    {
+        BufferInfo *curr = CurrentBuffer();
+        BufferInfo *next = NextBuffer();
+
+        if (curr->IsOffsetInBuffer(offset) &&
+            next->IsOffsetInBufferOrAsyncRead(curr->EndOffset()))
+        {
+            // The data starts at the end of the current buffer and continues
+            // into the next one: stitch it together, after which the current
+            // buffer has been consumed.
+            Status s = PollAndUpdateBuffer(next);
+            if (s.ok() && next->IsDataInBuffer(curr->EndOffset(),
+                                               offset + n - curr->EndOffset()))
+            {
+                const size_t head = static_cast<size_t>(curr->EndOffset() - offset);
+                overlap_buf_.assign(
+                    curr->buffer_.BufferStart() + (offset - curr->offset_), head);
+                overlap_buf_.append(next->buffer_.BufferStart(), n - head);
+                curr->buffer_.Clear();
+                curr_ ^= 1;
+                ScheduleNextRead(opts, reader, CurrentBuffer()->async_req_.len);
+                RecordTick(stats_, PREFETCH_BYTES_USEFUL, n);
+                *result = Slice(overlap_buf_);
+                return Status::OK();
+            }
+            // Read it synchronously below.
+            s.PermitUncheckedError();
+        }
+        else if (next->IsOffsetInBufferOrAsyncRead(offset))
+        {
+            // The reader moved on to the chunk read ahead into the next buffer.
+            Status s = PollAndUpdateBuffer(next);
+            DiscardCurrentBuffer(prev_offset_ + prev_len_);
+            curr_ ^= 1;
+            curr = CurrentBuffer();
+            if (s.ok() && curr->IsDataInBuffer(offset, n))
+            {
+                ScheduleNextRead(opts, reader, curr->async_req_.len);
+                RecordTick(stats_, PREFETCH_HITS);
+                RecordTick(stats_, PREFETCH_BYTES_USEFUL, n);
+                *result =
+                    Slice(curr->buffer_.BufferStart() + (offset - curr->offset_), n);
+                return Status::OK();
+            }
+            s.PermitUncheckedError();
+        }
+
+        // A miss: read the data and the readahead after it synchronously,
+        // dropping whatever the buffers hold.
+        DiscardCurrentBuffer(prev_offset_ + prev_len_);
+        AbortAndClear(NextBuffer());
+        const size_t len = n + readahead_size_;
+        Status s = ReadSync(opts, reader, offset, len);
+        if (!s.ok())
+        {
+            return s;
+        }
+        RecordTick(stats_, PREFETCH_BYTES, len);
+        curr = CurrentBuffer();
+        if (num_buffers_ < 2 || reader->use_direct_io())
+        {
+            // Without a read in flight to measure against, every prefetch of
+            // a sequential reader grows the readahead.
+            readahead_size_ = std::min(max_readahead_size_, readahead_size_ * 2);
+        }
+        else
+        {
+            ScheduleNextRead(opts, reader, len);
+        }
+        // Past the end of the file, the result is short and the caller tells
+        // the truncation.
+        *result = Slice(curr->buffer_.BufferStart(),
+                        std::min(n, curr->buffer_.CurrentSize()));
+        return Status::OK();
+    }
+
+    Status FilePrefetchBuffer::ReadSync(const IOOptions &opts,
+                                        RandomAccessFileReader *reader,
+                                        uint64_t offset, size_t len)
+    {
+        BufferInfo *buf = CurrentBuffer();
+        if (buf->buffer_.Capacity() < len)
+        {
+            buf->buffer_.AllocateNewBuffer(len);
+        }
+        buf->buffer_.Clear();
+
+        Slice result;
+        AlignedBuf direct_io_buf;
+        const bool direct_io = reader->use_direct_io();
+        Status s = reader->Read(opts, offset, len, &result,
+                                direct_io ? nullptr : buf->buffer_.BufferStart(),
+                                direct_io ? &direct_io_buf : nullptr);
+        if (!s.ok())
+        {
+            return s;
+        }
+        // With direct IO or mmap reads, the result is not in our buffer.
+        if (result.data() != buf->buffer_.BufferStart())
+        {
+            memcpy(buf->buffer_.BufferStart(), result.data(), result.size());
+        }
+        buf->offset_ = offset;
+        buf->buffer_.Size(result.size());
+        return Status::OK();
+    }
+
+    void FilePrefetchBuffer::ScheduleNextRead(const IOOptions &opts,
+                                              RandomAccessFileReader *reader,
+                                              size_t requested_len)
+    {
+        BufferInfo *curr = CurrentBuffer();
+        BufferInfo *next = NextBuffer();
+        if (num_buffers_ < 2 || reader->use_direct_io() || readahead_size_ == 0 ||
+            curr->buffer_.CurrentSize() < requested_len)
+        {
+            // A short read means the current buffer reaches the end of the
+            // file.
+            return;
+        }
+        if (next->IsOffsetInBufferOrAsyncRead(curr->EndOffset()))
+        {
+            return;
+        }
+        AbortAndClear(next);
+
+        const size_t len = readahead_size_;
+        if (next->buffer_.Capacity() < len)
+        {
+            next->buffer_.AllocateNewBuffer(len);
+        }
+        next->async_req_ = FSReadRequest();
+        next->async_req_.offset = curr->EndOffset();
+        next->async_req_.len = len;
+        next->async_req_.scratch = next->buffer_.BufferStart();
+        next->async_read_in_progress_ = true;
+        next->async_read_done_ = false;
+
+        // A file system without asynchronous reads completes the read, and
+        // runs the callback, before ReadAsync returns.
+        auto callback = [](FSReadRequest &req, void *cb_arg)
+        {
+            BufferInfo *buf = static_cast<BufferInfo *>(cb_arg);
+            buf->async_req_.status = req.status;
+            buf->async_req_.result = req.result;
+            if (req.fs_scratch != nullptr)
+            {
+                buf->async_req_.fs_scratch = std::move(req.fs_scratch);
+            }
+            buf->async_read_done_ = true;
+        };
+        IOStatus s = reader->ReadAsync(next->async_req_, opts, callback, next,
+                                       &next->io_handle_, &next->del_fn_, nullptr);
+        if (!s.ok())
+        {
+            // Not worth failing the read for: the chunk is read synchronously
+            // when it is needed.
+            RecordTick(stats_, ASYNC_READ_ERROR_COUNT);
+            next->async_read_in_progress_ = false;
+            next->async_read_done_ = false;
+            if (next->io_handle_ != nullptr && next->del_fn_)
+            {
+                next->del_fn_(next->io_handle_);
+            }
+            next->io_handle_ = nullptr;
+            next->del_fn_ = nullptr;
+            next->buffer_.Clear();
+        }
+    }
+
+    Status FilePrefetchBuffer::PollAndUpdateBuffer(BufferInfo *buf)
+    {
+        if (!buf->async_read_in_progress_)
+        {
+            return Status::OK();
+        }
+        if (!buf->async_read_done_)
+        {
+            // The reader caught up with the read in flight: it consumes the
+            // data faster than it is read, so read further ahead.
+            readahead_size_ = std::min(max_readahead_size_, readahead_size_ * 2);
+            if (buf->io_handle_ != nullptr)
+            {
+                std::vector<void *> handles{buf->io_handle_};
+                StopWatch sw(SystemClock::Default().get(), stats_, POLL_WAIT_MICROS);
+                fs_->Poll(handles, 1).PermitUncheckedError();
+            }
+        }
+        if (buf->io_handle_ != nullptr && buf->del_fn_)
+        {
+            buf->del_fn_(buf->io_handle_);
+        }
+        buf->io_handle_ = nullptr;
+        buf->del_fn_ = nullptr;
+        buf->async_read_in_progress_ = false;
+        buf->buffer_.Clear();
+
+        if (!buf->async_read_done_)
+        {
+            return Status::IOError("asynchronous read not completed by Poll");
+        }
+        buf->async_read_done_ = false;
+        Status s = buf->async_req_.status;
+        if (!s.ok())
+        {
+            RecordTick(stats_, ASYNC_READ_ERROR_COUNT);
+            return s;
+        }
+        const Slice &result = buf->async_req_.result;
+        if (result.data() != buf->buffer_.BufferStart())
+        {
+            memcpy(buf->buffer_.BufferStart(), result.data(), result.size());
+        }
+        buf->async_req_.fs_scratch.reset();
+        buf->offset_ = buf->async_req_.offset;
+        buf->buffer_.Size(result.size());
+        RecordTick(stats_, ASYNC_READ_BYTES, result.size());
+        return Status::OK();
+    }
+
+    void FilePrefetchBuffer::AbortAndClear(BufferInfo *buf)
+    {
+        if (buf->async_read_in_progress_ && !buf->async_read_done_ &&
+            buf->io_handle_ != nullptr)
+        {
+            std::vector<void *> handles{buf->io_handle_};
+            StopWatch sw(SystemClock::Default().get(), stats_,
+                         ASYNC_PREFETCH_ABORT_MICROS);
+            fs_->AbortIO(handles).PermitUncheckedError();
+        }
+        if (buf->io_handle_ != nullptr && buf->del_fn_)
+        {
+            buf->del_fn_(buf->io_handle_);
+        }
+        buf->io_handle_ = nullptr;
+        buf->del_fn_ = nullptr;
+        buf->async_read_in_progress_ = false;
+        buf->async_read_done_ = false;
+        buf->async_req_.fs_scratch.reset();
+        buf->buffer_.Clear();
+    }
+
+    void FilePrefetchBuffer::DiscardCurrentBuffer(uint64_t consumed_up_to)
+    {
+        BufferInfo *curr = CurrentBuffer();
+        const size_t size = curr->buffer_.CurrentSize();
+        if (size > 0 && consumed_up_to < curr->EndOffset())
+        {
+            const size_t unread = static_cast<size_t>(
+                curr->EndOffset() - std::max(consumed_up_to, curr->offset_));
+            RecordTick(stats_, PREFETCHED_BYTES_DISCARDED, unread);
+            if (unread * 2 > size)
+            {
+                // Most of the chunk went unread: the reader does not go as far
+                // as the readahead.
+                readahead_size_ = std::max(initial_readahead_size_, readahead_size_ / 2);
+            }
+        }
+        curr->buffer_.Clear();
+    }
+
+    void FilePrefetchBuffer::ResetValues()
+    {
+        num_file_reads_ = 1;
+        readahead_size_ = initial_readahead_size_;
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "file/random_access_file_reader.h"
+#include "file/readahead_file_info.h"
+#include "util/aligned_buffer.h"
+#include "xiaodb/file_system.h"
+#include "xiaodb/statistics.h"
+
+namespace XIAODB_NAMESPACE
+{
+    struct ReadaheadParams
+    {
+        ReadaheadParams() {}
+
+        // The readahead to start with.
+        size_t initial_readahead_size = 0;
+
+        // The readahead grows up to this size. With a fixed readahead, it is
+        // the same as initial_readahead_size.
+        size_t max_readahead_size = 0;
+
+        // If true, readahead is enabled implicitly by the iterators after
+        // num_file_reads_for_auto_readahead sequential reads, and reset to
+        // initial_readahead_size on a non-sequential one.
+        bool implicit_auto_readahead = false;
+
+        uint64_t num_file_reads_for_auto_readahead = 0;
+
+        // With 2 buffers, the chunk after the one being consumed is read
+        // asynchronously in the meantime.
+        size_t num_buffers = 1;
+    };
+
+    // FilePrefetchBuffer is a smart buffer to store and read data from a file.
+    //
+    // It serves reads out of a buffer filled by reading ahead of them. With
+    // two buffers, as soon as a chunk is read into the current buffer, the
+    // following chunk is read asynchronously into the other, so that a
+    // sequential reader consuming the current chunk finds the next one ready
+    // (or in flight) instead of waiting for a synchronous read at every chunk
+    // boundary.
+    //
+    // The readahead adapts to the rate at which the data is consumed. With a
+    // single buffer, it doubles on every prefetch up to max_readahead_size, as
+    // the reads have proven sequential. With two buffers, it doubles when the
+    // reader catches up with an asynchronous read that has not completed yet,
+    // i.e. the reader consumes a chunk faster than the next one is read, and
+    // halves (down to initial_readahead_size) when a prefetched chunk is
+    // dropped mostly unread.
+    //
+    // Not thread safe.
+    class FilePrefetchBuffer
+    {
+    public:
+        // fs is used to poll asynchronous reads; without it, or with direct IO,
+        // all reads are synchronous and a single buffer is used.
+        explicit FilePrefetchBuffer(const ReadaheadParams &readahead_params = {},
+                                    FileSystem *fs = nullptr,
+                                    Statistics *stats = nullptr);
+
+        ~FilePrefetchBuffer();
+
+        FilePrefetchBuffer(const FilePrefetchBuffer &) = delete;
+        FilePrefetchBuffer &operator=(const FilePrefetchBuffer &) = delete;
+
+        // Tries returning the data for [offset, offset + n) out of the
+        // buffers, reading ahead of it as needed. Returns false if the caller
+        // is to read the data itself: before implicit auto readahead kicks in,
+        // and on errors, in which case *status is set.
+        // The result is valid until the next call.
+        bool TryReadFromCache(const IOOptions &opts, RandomAccessFileReader *reader,
+                              uint64_t offset, size_t n, Slice *result,
+                              Status *status);
+
+        size_t GetReadaheadSize() const { return readahead_size_; }
+
+        // Fills readahead_info with the state to carry over to the next file
+        // of the same level.
+        void GetReadaheadState(ReadaheadFileInfo::ReadaheadInfo *readahead_info) const
+        {
+            readahead_info->readahead_size = readahead_size_;
+            readahead_info->num_file_reads = static_cast<int64_t>(num_file_reads_);
+        }
+
+        // Resumes from the state of the previous file of the same level, so
+        // that a scan crossing files does not start over with the initial
+        // readahead at every file.
+        void SetReadaheadState(const ReadaheadFileInfo::ReadaheadInfo &readahead_info)
+        {
+            if (readahead_info.readahead_size > 0)
+            {
+                readahead_size_ =
+                    std::min(max_readahead_size_, readahead_info.readahead_size);
+                num_file_reads_ = static_cast<uint64_t>(readahead_info.num_file_reads);
+            }
+        }
+
+    private:
+        struct BufferInfo
+        {
+            AlignedBuffer buffer_;
+
+            // File offset of the data in buffer_.
+            uint64_t offset_ = 0;
+
+            // An asynchronous read into buffer_, of async_req_, is in flight.
+            bool async_read_in_progress_ = false;
+            // Set by the callback of the asynchronous read.
+            bool async_read_done_ = false;
+            FSReadRequest async_req_;
+            void *io_handle_ = nullptr;
+            IOHandleDeleter del_fn_ = nullptr;
+
+            uint64_t EndOffset() const { return offset_ + buffer_.CurrentSize(); }
+
+            bool IsDataInBuffer(uint64_t offset, size_t n) const
+            {
+                return !async_read_in_progress_ && offset >= offset_ &&
+                       offset + n <= EndOffset();
+            }
+
+            bool IsOffsetInBuffer(uint64_t offset) const
+            {
+                return !async_read_in_progress_ && offset >= offset_ &&
+                       offset < EndOffset();
+            }
+
+            // Whether buffer_ holds, or will hold once the read in flight
+            // completes, the data at offset.
+            bool IsOffsetInBufferOrAsyncRead(uint64_t offset) const
+            {
+                if (async_read_in_progress_)
+                {
+                    return offset >= async_req_.offset &&
+                           offset < async_req_.offset + async_req_.len;
+                }
+                return IsOffsetInBuffer(offset);
+            }
+        };
+
+        BufferInfo *CurrentBuffer() { return &bufs_[curr_]; }
+        BufferInfo *NextBuffer() { return &bufs_[curr_ ^ 1]; }
+
+        // For implicit auto readahead: counts the read, resetting the
+        // readahead on a non-sequential one, and returns whether readahead is
+        // in effect for it.
+        bool IsEligibleForPrefetch(uint64_t offset, size_t n);
+
+        bool IsBlockSequential(uint64_t offset) const
+        {
+            return prev_len_ == 0 || prev_offset_ + prev_len_ == offset;
+        }
+
+        void UpdateReadPattern(uint64_t offset, size_t len)
+        {
+            prev_offset_ = offset;
+            prev_len_ = len;
+        }
+
+        // Makes [offset, offset + n) available, in the current buffer or in
+        // overlap_buf_, and sets *result to it.
+        Status PrefetchInternal(const IOOptions &opts, RandomAccessFileReader *reader,
+                                uint64_t offset, size_t n, Slice *result);
+
+        // Reads [offset, offset + len) into the current buffer synchronously.
+        Status ReadSync(const IOOptions &opts, RandomAccessFileReader *reader,
+                        uint64_t offset, size_t len);
+
+        // Starts reading the chunk following the current buffer into the next
+        // one, if there are two buffers and the current one is not at the end
+        // of the file.
+        void ScheduleNextRead(const IOOptions &opts, RandomAccessFileReader *reader,
+                              size_t requested_len);
+
+        // Waits for the read in flight into buf, if any, growing the readahead
+        // if the reader had to wait for it.
+        Status PollAndUpdateBuffer(BufferInfo *buf);
+
+        // Aborts the read in flight into buf, if any, and empties it.
+        void AbortAndClear(BufferInfo *buf);
+
+        // Empties the current buffer, halving the readahead if most of it was
+        // never read.
+        void DiscardCurrentBuffer(uint64_t consumed_up_to);
+
+        void ResetValues();
+
+        BufferInfo bufs_[2];
+        size_t curr_ = 0;
+        // Holds the data of a read spanning both buffers.
+        std::string overlap_buf_;
+
+        size_t readahead_size_;
+        size_t initial_readahead_size_;
+        size_t max_readahead_size_;
+        size_t num_buffers_;
+
+        // The last read, to tell sequential reads apart.
+        uint64_t prev_offset_ = 0;
+        size_t prev_len_ = 0;
+
+        bool implicit_auto_readahead_;
+        uint64_t num_file_reads_;
+        uint64_t num_file_reads_for_auto_readahead_;
+
+        FileSystem *fs_;
+        Statistics *stats_;
+    };
+}
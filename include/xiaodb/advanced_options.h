@@ -264,6 +264,20 @@ namespace XIAODB_NAMESPACE
         // [experimental]
         double experimental_mempurge_threshold = 0.0;
 
+        // [experimental]
+        // When a memtable becomes immutable, the fraction of its entries that are
+        // hidden by a newer version of the same key (and not needed by any live
+        // snapshot) is estimated from a sample. If it is at least this ratio, the
+        // memtable is compacted in memory into a fresh arena before it is queued
+        // for flush, so overwrite-heavy workloads do not carry dead versions into
+        // flush and L0 compaction. Memtables with range deletions, merge operands
+        // or single deletes are never compacted this way.
+        //   0.0: disabled (default).
+        //   0 < ratio <= 1.0: minimum estimated garbage ratio to compact.
+        //
+        // Dynamically changeable through SetOptions() API
+        double memtable_compaction_garbage_ratio = 0.0;
+
         // existing_value - pointer to previous value (from both memtable and sst).
         //                  nullptr if key doesn't exist
         // existing_value_size - pointer to size of existing_value).
@@ -347,6 +361,29 @@ namespace XIAODB_NAMESPACE
         // Dynamically changeable through SetOptions() API
         size_t memtable_huge_page_size = 0;
 
+        // If true, and the library is built with NUMA support, the memtable arena
+        // keeps one backing arena per NUMA node, binds each one's blocks to its
+        // node and serves every writer from the arena of the node it runs on.
+        // This avoids remote memory accesses on multi-socket hosts at the cost
+        // of a small fixed overhead per memtable and node.
+        //
+        // Default: false
+        //
+        // Dynamically changeable through SetOptions() API (takes effect for the
+        // next memtable)
+        bool memtable_numa_aware = false;
+
+        // If true, regular memtable arena blocks are mmap'ed and advised to be
+        // backed by transparent huge pages. Unlike memtable_huge_page_size this
+        // needs no reserved hugetlb pool, and it is ignored where THP is
+        // unsupported. Has no effect on blocks served by memtable_huge_page_size.
+        //
+        // Default: false
+        //
+        // Dynamically changeable through SetOptions() API (takes effect for the
+        // next memtable)
+        bool memtable_transparent_huge_pages = false;
+
         // If non-nullptr, memtable will use the specified function to extract
         // prefixes for keys, and for each prefix maintain a hint of insert location
         // to reduce CPU usage for inserting keys with the prefix. Keys out of
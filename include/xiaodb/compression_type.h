@@ -12,6 +12,7 @@ namespace XIAODB_NAMESPACE
         kZlibCompression = 0x2,
         kBZip2Compression = 0x3,
         kLZ4Compression = 0x4,
+        kLZ4HCCompression = 0x5,
         kXpressCompression = 0x6,
         kZSTD = 0x7,
 
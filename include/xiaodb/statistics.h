@@ -520,6 +520,19 @@ namespace XIAODB_NAMESPACE
         FILE_READ_CORRUPTION_RETRY_COUNT,
         FILE_READ_CORRUPTION_RETRY_SUCCESS_COUNT,
 
+        // Decisions of adaptive block compression (see AdaptiveCompressor).
+        // Number of blocks stored uncompressed without trying to compress
+        // them, as the compressibility probe found them incompressible.
+        ADAPTIVE_COMPRESSION_PROBE_SKIPPED,
+        // Number of blocks compressed (and kept) with each candidate: LZ4,
+        // ZSTD at its fastest level, and the configured compression.
+        ADAPTIVE_COMPRESSION_LZ4,
+        ADAPTIVE_COMPRESSION_ZSTD_FAST,
+        ADAPTIVE_COMPRESSION_CONFIGURED,
+        // Number of blocks compressed with a candidate other than the one
+        // the cost model picks, to keep its estimates current.
+        ADAPTIVE_COMPRESSION_EXPLORED,
+
         TICKER_ENUM_MAX
     };
 
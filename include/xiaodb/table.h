@@ -42,29 +42,29 @@ namespace XIAODB_NAMESPACE
         kXXH3 = 0x4, // Supported since RocksDB 6.27
     };
 
-    / `PinningTier` is used to specify which tier of block - based tables should
-        // be affected by a block cache pinning setting (see
-        // `MetadataCacheOptions` below).
-        enum class PinningTier {
-            // For compatibility, this value specifies to fallback to the behavior
-            // indicated by the deprecated options,
-            // `pin_l0_filter_and_index_blocks_in_cache` and
-            // `pin_top_level_index_and_filter`.
-            kFallback,
-
-            // This tier contains no block-based tables.
-            kNone,
-
-            // This tier contains block-based tables that may have originated from a
-            // memtable flush. In particular, it includes tables from L0 that are smaller
-            // than 1.5 times the current `write_buffer_size`. Note these criteria imply
-            // it can include intra-L0 compaction outputs and ingested files, as long as
-            // they are not abnormally large compared to flushed files in L0.
-            kFlushedAndSimilar,
-
-            // This tier contains all block-based tables.
-            kAll,
-        };
+    // `PinningTier` is used to specify which tier of block - based tables should
+    // be affected by a block cache pinning setting (see
+    // `MetadataCacheOptions` below).
+    enum class PinningTier {
+        // For compatibility, this value specifies to fallback to the behavior
+        // indicated by the deprecated options,
+        // `pin_l0_filter_and_index_blocks_in_cache` and
+        // `pin_top_level_index_and_filter`.
+        kFallback,
+
+        // This tier contains no block-based tables.
+        kNone,
+
+        // This tier contains block-based tables that may have originated from a
+        // memtable flush. In particular, it includes tables from L0 that are smaller
+        // than 1.5 times the current `write_buffer_size`. Note these criteria imply
+        // it can include intra-L0 compaction outputs and ingested files, as long as
+        // they are not abnormally large compared to flushed files in L0.
+        kFlushedAndSimilar,
+
+        // This tier contains all block-based tables.
+        kAll,
+    };
 
     // `MetadataCacheOptions` contains members indicating the desired caching
     // behavior for the different categories of metadata blocks.
@@ -257,6 +257,15 @@ namespace XIAODB_NAMESPACE
         // kDataBlockBinaryAndHash.
         double data_block_hash_table_util_ratio = 0.75;
 
+        // If true, data blocks also store a fixed-width prefix of the user key
+        // of every restart point next to the restart array, which lets a seek
+        // within a block narrow down the restart interval by comparing
+        // integers instead of decoding and comparing keys. Costs 8 bytes per
+        // restart point plus 4 bytes per block. Only takes effect with the
+        // default bytewise user comparator; blocks written with it can be read
+        // by readers of this version and later.
+        bool data_block_restart_key_prefixes = false;
+
         // Option hash_index_allow_collision is now deleted.
         // It will behave as if hash_index_allow_collision=true.
 
@@ -678,6 +687,48 @@ namespace XIAODB_NAMESPACE
         //
         // Default: 2
         uint64_t num_file_reads_for_auto_readahead = 2;
+
+        // If true, the table reader maps the whole file read-only at open and
+        // serves reads out of the mapping: uncompressed blocks are used in
+        // place, and the values returned by Get() reference the mapped pages
+        // instead of being copied. Point lookups advise the kernel that the
+        // accesses are random; iterators scanning the file ask for the pages
+        // ahead of them (readahead_size, or max_auto_readahead_size) instead
+        // of prefetching into a buffer.
+        //
+        // Meant for read-mostly workloads whose files fit in memory: a read
+        // of a page that is not resident blocks on a page fault. Falls back to
+        // regular reads if the file cannot be mapped.
+        //
+        // Default: false
+        bool use_mmap_reads = false;
+
+        // If > 0, the checksums of the blocks of a multi-block read (the
+        // data blocks of a MultiGet() batch, index and filter partitions)
+        // are verified on a pool of this many threads, along with the
+        // reading thread, when the read is large enough to be worth it.
+        // Tables with the same setting share the pool. Helps when reads are
+        // faster than one core can checksum, e.g. from fast NVMe devices.
+        //
+        // Default: 0 (verify on the reading thread)
+        uint32_t checksum_verification_threads = 0;
+
+        // If true, the data blocks read are kept in block_cache as they are
+        // stored in the file: compressed blocks stay compressed, charged at
+        // their compressed size, so that the cache holds several times as
+        // many of them. A hit on a compressed block uncompresses it again,
+        // for a point lookup into a buffer of the thread reused across calls.
+        // A block hit compressed_block_promotion_hits times is cached
+        // uncompressed instead, trading capacity for CPU on the blocks in
+        // demand. Ignored without block_cache and with use_mmap_reads.
+        //
+        // Default: false (data blocks are not cached)
+        bool cache_compressed_blocks = false;
+
+        // See cache_compressed_blocks. 0 never promotes.
+        //
+        // Default: 3
+        uint32_t compressed_block_promotion_hits = 3;
     };
 
     // Table Properties that are specific to block-based table properties.
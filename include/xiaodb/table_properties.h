@@ -293,6 +293,11 @@ namespace XIAODB_NAMESPACE
         // table is empty).
         uint64_t key_largest_seqno = UINT64_MAX;
 
+        // The version of the compression dictionary the data blocks are
+        // compressed with: its ZSTD dictionary ID, or 0 without a dictionary
+        // (see CompressionDictTrainer).
+        uint64_t compression_dict_version = 0;
+
         // DB identity
         // db_id is an identifier generated the first time the DB is created
         // If DB identity is unset or unassigned, `db_id` will be an empty string.
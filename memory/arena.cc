@@ -25,8 +25,12 @@ namespace XIAODB_NAMESPACE
         return block_size;
     }
 
-    Arena::Arena(size_t block_size, AllocTracker *tracker, size_t huge_page_size)
-        : kBlockSize(OptimizeBlockSize(block_size)), tracker_(tracker)
+    Arena::Arena(size_t block_size, AllocTracker *tracker, size_t huge_page_size,
+                 int numa_node, bool transparent_huge_pages)
+        : kBlockSize(OptimizeBlockSize(block_size)),
+          numa_node_(numa_node),
+          transparent_huge_pages_(transparent_huge_pages),
+          tracker_(tracker)
     {
         assert(kBlockSize >= kMinBlockSize && kBlockSize <= kMaxBlockSize &&
                kBlockSize % kAlignUnit == 0);
@@ -100,7 +104,12 @@ namespace XIAODB_NAMESPACE
         auto addr = static_cast<char *>(mm.Get());
         if (addr)
         {
-            huge_blocks_.push_back(std::move(mm));
+            if (numa_node_ >= 0)
+            {
+                // Pages are not faulted in yet, so binding still takes effect
+                mm.BindToNumaNode(numa_node_);
+            }
+            mapped_blocks_.push_back(std::move(mm));
             blocks_memory_ += bytes;
             if (tracker_ != nullptr)
             {
@@ -154,8 +163,43 @@ namespace XIAODB_NAMESPACE
         return result;
     }
 
+    char *Arena::AllocateMappedBlock(size_t block_bytes)
+    {
+        MemMapping mm = MemMapping::AllocateLazyZeroed(block_bytes);
+        auto addr = static_cast<char *>(mm.Get());
+        if (addr)
+        {
+            // Both hints must precede the first touch of the pages.
+            if (transparent_huge_pages_)
+            {
+                mm.AdviseHugePages();
+            }
+            if (numa_node_ >= 0)
+            {
+                mm.BindToNumaNode(numa_node_);
+            }
+            mapped_blocks_.push_back(std::move(mm));
+            blocks_memory_ += block_bytes;
+            if (tracker_ != nullptr)
+            {
+                tracker_->Allocate(block_bytes);
+            }
+        }
+        return addr;
+    }
+
     char *Arena::AllocateNewBlcok(size_t block_bytes)
     {
+        if (numa_node_ >= 0 || transparent_huge_pages_)
+        {
+            char *mapped = AllocateMappedBlock(block_bytes);
+            if (mapped != nullptr)
+            {
+                return mapped;
+            }
+            // Fall back to the heap; placement is best effort.
+        }
+
         // NOTE: std::make_unique zero-initializes the block so is not appropriate here
         char *block = new char[block_bytes];
         blocks_.push_back(std::unique_ptr<char[]>(block));
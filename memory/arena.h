@@ -27,8 +27,14 @@ namespace XIAODB_NAMESPACE
         // huge_page_size: if 0, don't use huge page TLB. If > 0 (should set to the
         // supported hugepage size of the system), block allocation will try huge
         // page TLB first. If allocation fails, will fall back to normal case.
+        // numa_node: if >= 0, blocks are mmap'ed and their pages preferably placed
+        // on this NUMA node (requires a build with NUMA support).
+        // transparent_huge_pages: if true, regular blocks are mmap'ed and advised
+        // to be backed by transparent huge pages. This is the fallback-free
+        // alternative to huge_page_size, which needs a reserved hugetlb pool.
         explicit Arena(size_t block_size = kMinBlockSize,
-                       AllocTracker *tracker = nullptr, size_t huge_page_size = 0);
+                       AllocTracker *tracker = nullptr, size_t huge_page_size = 0,
+                       int numa_node = -1, bool transparent_huge_pages = false);
         ~Arena();
 
         char *Allocate(size_t bytes) override;
@@ -54,9 +60,12 @@ namespace XIAODB_NAMESPACE
 
         bool IsInInlineBlock() const
         {
-            return blocks_.empty() && huge_blocks_.empty();
+            return blocks_.empty() && mapped_blocks_.empty();
         }
 
+        // The NUMA node blocks are placed on, or -1 if placement is left to the OS
+        int numa_node() const { return numa_node_; }
+
         // check and adjust the block_size so that the return value is
         // 1. in the range of [kMinBlockSize, kMaxBlockSize].
         // 2. the multiple of align unit.
@@ -68,8 +77,9 @@ namespace XIAODB_NAMESPACE
         const size_t kBlockSize;
         // Allocated memory blocks
         std::deque<std::unique_ptr<char[]>> blocks_;
-        // Huge page allocations
-        std::deque<MemMapping> huge_blocks_;
+        // Huge page allocations, and regular blocks mmap'ed for NUMA placement or
+        // transparent huge pages
+        std::deque<MemMapping> mapped_blocks_;
         size_t irregular_block_num = 0;
 
         // Stats for current active block.
@@ -84,7 +94,13 @@ namespace XIAODB_NAMESPACE
 
         size_t hugetlb_size_ = 0;
 
+        const int numa_node_;
+        const bool transparent_huge_pages_;
+
         char *AllocateFromHugePage(size_t bytes);
+        // Allocates a regular block with mmap so it can be NUMA bound and THP
+        // advised. Returns nullptr on failure.
+        char *AllocateMappedBlock(size_t block_bytes);
         char *AllocateFallback(size_t bytes, bool aligned);
         char *AllocateNewBlcok(size_t block_bytes);
 
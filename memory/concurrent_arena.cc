@@ -0,0 +1,89 @@
+#include "memory/concurrent_arena.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef NUMA
+#include <numa.h>
+#endif
+#ifdef ROCKSDB_SCHED_GETCPU_PRESENT
+#include <sched.h>
+#endif
+
+#include "port/port.h"
+#include "util/random.h"
+
+namespace XIAODB_NAMESPACE
+{
+    thread_local size_t ConcurrentArena::tls_cpuid = 0;
+
+    thread_local int ConcurrentArena::tls_numa_node = -1;
+
+    namespace
+    {
+        // If the shard block size is too large, in the worst case, every core
+        // allocates a block without populate it. If the shared block size is
+        // 1MB, 64 cores will quickly allocate 64MB, and may quickly trigger a
+        // flush. Cap the size instead.
+        const size_t kMaxShardBlockSize = size_t{128 * 1024};
+
+        // Number of NUMA nodes to keep arenas for, 1 if NUMA is unsupported or
+        // unavailable on this host.
+        int NumNumaNodes()
+        {
+#ifdef NUMA
+            if (numa_available() >= 0)
+            {
+                return std::max(1, numa_max_node() + 1);
+            }
+#endif
+            return 1;
+        }
+    }
+
+    ConcurrentArena::ConcurrentArena(size_t block_size, AllocTracker *tracker,
+                                     size_t huge_page_size, bool numa_aware,
+                                     bool transparent_huge_pages)
+        : shard_block_size_(std::min(kMaxShardBlockSize, block_size / 8)),
+          shards_()
+    {
+        int num_nodes = numa_aware ? NumNumaNodes() : 1;
+        nodes_.reserve(num_nodes);
+        for (int i = 0; i < num_nodes; ++i)
+        {
+            // All node arenas share the tracker, so the write buffer manager sees
+            // the sum. With a single node there is nothing to bind to.
+            nodes_.emplace_back(new NodeArena(block_size, tracker, huge_page_size,
+                                              num_nodes > 1 ? i : -1,
+                                              transparent_huge_pages));
+            Fixup(nodes_.back().get());
+        }
+    }
+
+    ConcurrentArena::Shard *ConcurrentArena::Repick()
+    {
+        auto shard_and_index = shards_.AccessElementAndIndex();
+        // even if we are cpu 0, use a non-zero tls_cpuid so we can tell we
+        // have repicked
+        tls_cpuid = shard_and_index.second | shards_.Size();
+        if (nodes_.size() > 1)
+        {
+            RefreshNumaNode();
+        }
+        return shard_and_index.first;
+    }
+
+    int ConcurrentArena::RefreshNumaNode()
+    {
+        int numa_node = 0;
+#if defined(NUMA) && defined(ROCKSDB_SCHED_GETCPU_PRESENT)
+        int cpu = sched_getcpu();
+        if (cpu >= 0)
+        {
+            numa_node = std::max(0, numa_node_of_cpu(cpu));
+        }
+#endif
+        tls_numa_node = numa_node;
+        return numa_node;
+    }
+}
@@ -3,6 +3,7 @@
 #include <atomic>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "memory/allocator.h"
 #include "memory/arena.h"
@@ -32,22 +33,31 @@ namespace XIAODB_NAMESPACE
     // only if ConcurrentArena actually notices concurrent use, and they
     // adjust their size so that there is no fragmentation waste when the
     // shard blocks are allocated from the underlying main arena.
+    //
+    // When NUMA aware, there is one underlying arena per NUMA node, each with
+    // its own spinlock, and a thread (and the core-local shard it uses) is
+    // always refilled from the arena of the node it runs on, whose blocks are
+    // bound to that node. Without NUMA support in the build, or on a single
+    // node host, this degenerates to the single arena described above.
     class ConcurrentArena : public Allocator
     {
     public:
         // block_size and huge_page_size are the same as for Arena (and are
-        // in fact just passed to the constructor of arena_.  The core-local
-        // shards compute their shard_block_size as a fraction of block_size
-        // that varies according to the hardware concurrency level.
+        // in fact just passed to the constructor of the node arenas.  The
+        // core-local shards compute their shard_block_size as a fraction of
+        // block_size that varies according to the hardware concurrency level.
+        // numa_aware: keep one node-bound arena per NUMA node (see above).
+        // transparent_huge_pages: same as for Arena.
         explicit ConcurrentArena(size_t block_size = Arena::kMinBlockSize,
                                  AllocTracker *tracker = nullptr,
-                                 size_t huge_page_size = 0);
+                                 size_t huge_page_size = 0, bool numa_aware = false,
+                                 bool transparent_huge_pages = false);
 
         char *Allocate(size_t bytes) override
         {
             return AllocateImpl(bytes, false /*force_arena*/,
-                                [this, bytes]()
-                                { return arena_.Allocate(bytes); });
+                                [bytes](Arena *arena)
+                                { return arena->Allocate(bytes); });
         }
 
         char *AllocateAligned(size_t bytes, size_t huge_page_size = 0,
@@ -58,42 +68,75 @@ namespace XIAODB_NAMESPACE
                    (rounded_up % sizeof(void *)) == 0);
 
             return AllocateImpl(rounded_up, huge_page_size != 0 /*force_arena*/,
-                                [this, rounded_up, huge_page_size, logger]()
+                                [rounded_up, huge_page_size, logger](Arena *arena)
                                 {
-                                    return arena_.AllocateAligned(rounded_up,
+                                    return arena->AllocateAligned(rounded_up,
                                                                   huge_page_size, logger);
                                 });
         }
 
         size_t ApproximateMemoryUsage() const
         {
-            std::unique_lock<SpinMutex> lock(arena_mutex_, std::defer_lock);
-            lock.lock();
-            return arena_.ApproximateMemoryUsage() - ShardAllocatedAndUnused();
+            size_t total = 0;
+            for (const auto &node : nodes_)
+            {
+                std::unique_lock<SpinMutex> lock(node->mutex, std::defer_lock);
+                lock.lock();
+                total += node->arena.ApproximateMemoryUsage();
+            }
+            return total - ShardAllocatedAndUnused();
         }
 
         size_t MemoryAllocatedBytes() const
         {
-            return memory_allocated_bytes_.load(std::memory_order_relaxed);
+            size_t total = 0;
+            for (const auto &node : nodes_)
+            {
+                total += node->memory_allocated_bytes.load(std::memory_order_relaxed);
+            }
+            return total;
         }
 
         size_t AllocatedAndUnused() const
         {
-            return arena_allocated_and_unused_.load(std::memory_order_relaxed) +
-                   ShardAllocatedAndUnused();
+            size_t total = 0;
+            for (const auto &node : nodes_)
+            {
+                total += node->allocated_and_unused.load(std::memory_order_relaxed);
+            }
+            return total + ShardAllocatedAndUnused();
         }
 
         size_t IrregularBlockNum() const
         {
-            return irregular_block_num_.load(std::memory_order_relaxed);
+            size_t total = 0;
+            for (const auto &node : nodes_)
+            {
+                total += node->irregular_block_num.load(std::memory_order_relaxed);
+            }
+            return total;
         }
 
-        size_t BlockSize() const override { return arena_.BlockSize(); }
+        size_t BlockSize() const override { return nodes_[0]->arena.BlockSize(); }
+
+        // Number of underlying arenas: the number of NUMA nodes when NUMA aware
+        // and supported, otherwise 1.
+        size_t NumNodes() const { return nodes_.size(); }
+
+        // Bytes allocated by the arena of the given node (as indexed up to
+        // NumNodes()), including memory handed out to core-local shards.
+        // Reports how memtable memory is spread across NUMA nodes.
+        size_t MemoryAllocatedBytesOnNode(size_t node) const
+        {
+            assert(node < nodes_.size());
+            return nodes_[node]->memory_allocated_bytes.load(
+                std::memory_order_relaxed);
+        }
 
     private:
         struct Shard
         {
-            char padding[40] ROCKSDB_FIELD_UNUSED;
+            char padding[40] XIAODB_FIELD_UNUSED;
             mutable SpinMutex mutex;
             char *free_begin_;
             std::atomic<size_t> allocated_and_unused_;
@@ -101,24 +144,62 @@ namespace XIAODB_NAMESPACE
             Shard() : free_begin_(nullptr), allocated_and_unused_(0) {}
         };
 
+        // An arena together with its lock and the stats mirrored from it so they
+        // can be read without the lock. Each lives in its own allocation, so
+        // nodes do not false share.
+        struct NodeArena
+        {
+            NodeArena(size_t block_size, AllocTracker *tracker,
+                      size_t huge_page_size, int numa_node,
+                      bool transparent_huge_pages)
+                : arena(block_size, tracker, huge_page_size, numa_node,
+                        transparent_huge_pages),
+                  allocated_and_unused(0),
+                  memory_allocated_bytes(0),
+                  irregular_block_num(0) {}
+
+            Arena arena;
+            mutable SpinMutex mutex;
+            std::atomic<size_t> allocated_and_unused;
+            std::atomic<size_t> memory_allocated_bytes;
+            std::atomic<size_t> irregular_block_num;
+        };
+
         static thread_local size_t tls_cpuid;
 
-        char padding0[56] ROCKSDB_FIELD_UNUSED;
+        // NUMA node the thread was last seen running on, or -1 if not yet
+        // looked up. Refreshed on Repick(), i.e. when the thread hits
+        // contention, which is also when a migrated thread is likely to notice.
+        static thread_local int tls_numa_node;
+
+        char padding0[56] XIAODB_FIELD_UNUSED;
 
         size_t shard_block_size_;
 
         CoreLocalArray<Shard> shards_;
 
-        Arena arena_;
-        mutable SpinMutex arena_mutex_;
-        std::atomic<size_t> arena_allocated_and_unused_;
-        std::atomic<size_t> memory_allocated_bytes_;
-        std::atomic<size_t> irregular_block_num_;
+        std::vector<std::unique_ptr<NodeArena>> nodes_;
 
-        char padding1[56] ROCKSDB_FIELD_UNUSED;
+        char padding1[56] XIAODB_FIELD_UNUSED;
 
         Shard *Repick();
 
+        NodeArena *LocalNode()
+        {
+            if (nodes_.size() == 1)
+            {
+                return nodes_[0].get();
+            }
+            int numa_node = tls_numa_node;
+            if (UNLIKELY(numa_node < 0))
+            {
+                numa_node = RefreshNumaNode();
+            }
+            return nodes_[static_cast<size_t>(numa_node) % nodes_.size()].get();
+        }
+
+        static int RefreshNumaNode();
+
         size_t ShardAllocatedAndUnused() const
         {
             size_t total = 0;
@@ -134,12 +215,13 @@ namespace XIAODB_NAMESPACE
         char *AllocateImpl(size_t bytes, bool force_arena, const Func &func)
         {
             size_t cpu;
+            NodeArena *node = LocalNode();
 
             // Go directly to the arena if the allocation is too large, or if
             // we've never needed to Repick() and the arena mutex is available
             // with no waiting.  This keeps the fragmentation penalty of
             // concurrency zero unless it might actually confer an advantage.
-            std::unique_lock<SpinMutex> arena_lock(arena_mutex_, std::defer_lock);
+            std::unique_lock<SpinMutex> arena_lock(node->mutex, std::defer_lock);
             if (bytes > shard_block_size_ / 4 || force_arena ||
                 ((cpu = tls_cpuid) == 0 &&
                  !shards_.AccessAtCore(0)->allocated_and_unused_.load(
@@ -150,8 +232,8 @@ namespace XIAODB_NAMESPACE
                 {
                     arena_lock.lock();
                 }
-                auto rv = func();
-                Fixup();
+                auto rv = func(&node->arena);
+                Fixup(node);
                 return rv;
             }
 
@@ -160,6 +242,7 @@ namespace XIAODB_NAMESPACE
             if (!s->mutex.try_lock())
             {
                 s = Repick();
+                node = LocalNode();
                 s->mutex.lock();
             }
             std::unique_lock<SpinMutex> lock(s->mutex, std::adopt_lock);
@@ -168,14 +251,14 @@ namespace XIAODB_NAMESPACE
             if (avail < bytes)
             {
                 // reload
-                std::lock_guard<SpinMutex> reload_lock(arena_mutex_);
+                std::lock_guard<SpinMutex> reload_lock(node->mutex);
 
                 // If the arena's current block is within a factor of 2 of the right
                 // size, we adjust our request to avoid arena waste.
-                auto exact = arena_allocated_and_unused_.load(std::memory_order_relaxed);
-                assert(exact == arena_.AllocatedAndUnused());
+                auto exact = node->allocated_and_unused.load(std::memory_order_relaxed);
+                assert(exact == node->arena.AllocatedAndUnused());
 
-                if (exact >= bytes && arena_.IsInInlineBlock())
+                if (exact >= bytes && node->arena.IsInInlineBlock())
                 {
                     // If we haven't exhausted arena's inline block yet, allocate from arena
                     // directly. This ensures that we'll do the first few small allocations
@@ -185,16 +268,16 @@ namespace XIAODB_NAMESPACE
                     // the order of 1 KB of memory when created; we wouldn't want to
                     // allocate a full arena block (typically a few megabytes) for that,
                     // especially if there are thousands of empty memtables.
-                    auto rv = func();
-                    Fixup();
+                    auto rv = func(&node->arena);
+                    Fixup(node);
                     return rv;
                 }
 
                 avail = exact >= shard_block_size_ / 2 && exact < shard_block_size_ * 2
                             ? exact
                             : shard_block_size_;
-                s->free_begin_ = arena_.AllocateAligned(avail);
-                Fixup();
+                s->free_begin_ = node->arena.AllocateAligned(avail);
+                Fixup(node);
             }
             s->allocated_and_unused_.store(avail - bytes, std::memory_order_relaxed);
 
@@ -213,14 +296,14 @@ namespace XIAODB_NAMESPACE
             return rv;
         }
 
-        void Fixup()
+        static void Fixup(NodeArena *node)
         {
-            arena_allocated_and_unused_.store(arena_.AllocatedAndUnused(),
-                                              std::memory_order_relaxed);
-            memory_allocated_bytes_.store(arena_.MemoryAllocatedBytes(),
-                                          std::memory_order_relaxed);
-            irregular_block_num_.store(arena_.IrregularBlockNum(),
-                                       std::memory_order_relaxed);
+            node->allocated_and_unused.store(node->arena.AllocatedAndUnused(),
+                                             std::memory_order_relaxed);
+            node->memory_allocated_bytes.store(node->arena.MemoryAllocatedBytes(),
+                                               std::memory_order_relaxed);
+            node->irregular_block_num.store(node->arena.IrregularBlockNum(),
+                                            std::memory_order_relaxed);
         }
 
         ConcurrentArena(const ConcurrentArena &) = delete;
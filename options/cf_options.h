@@ -110,12 +110,17 @@ namespace XIAODB_NAMESPACE
                   options.memtable_prefix_bloom_size_ratio),
               memtable_whole_key_filtering(options.memtable_whole_key_filtering),
               memtable_huge_page_size(options.memtable_huge_page_size),
+              memtable_numa_aware(options.memtable_numa_aware),
+              memtable_transparent_huge_pages(
+                  options.memtable_transparent_huge_pages),
               max_successive_merges(options.max_successive_merges),
               strict_max_successive_merges(options.strict_max_successive_merges),
               inplace_update_num_locks(options.inplace_update_num_locks),
               prefix_extractor(options.prefix_extractor),
               experimental_mempurge_threshold(
                   options.experimental_mempurge_threshold),
+              memtable_compaction_garbage_ratio(
+                  options.memtable_compaction_garbage_ratio),
               disable_auto_compactions(options.disable_auto_compactions),
               table_factory(options.table_factory),
               soft_pending_compaction_bytes_limit(
@@ -184,11 +189,14 @@ namespace XIAODB_NAMESPACE
               memtable_prefix_bloom_size_ratio(0),
               memtable_whole_key_filtering(false),
               memtable_huge_page_size(0),
+              memtable_numa_aware(false),
+              memtable_transparent_huge_pages(false),
               max_successive_merges(0),
               strict_max_successive_merges(false),
               inplace_update_num_locks(0),
               prefix_extractor(nullptr),
               experimental_mempurge_threshold(0.0),
+              memtable_compaction_garbage_ratio(0.0),
               disable_auto_compactions(false),
               soft_pending_compaction_bytes_limit(0),
               hard_pending_compaction_bytes_limit(0),
@@ -259,6 +267,8 @@ namespace XIAODB_NAMESPACE
         double memtable_prefix_bloom_size_ratio;
         bool memtable_whole_key_filtering;
         size_t memtable_huge_page_size;
+        bool memtable_numa_aware;
+        bool memtable_transparent_huge_pages;
         size_t max_successive_merges;
         bool strict_max_successive_merges;
         size_t inplace_update_num_locks;
@@ -282,6 +292,8 @@ namespace XIAODB_NAMESPACE
         //   ratios.
         // [experimental]
         double experimental_mempurge_threshold;
+        // See AdvancedColumnFamilyOptions::memtable_compaction_garbage_ratio
+        double memtable_compaction_garbage_ratio;
 
         // Compaction related options
         bool disable_auto_compactions;
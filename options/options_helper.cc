@@ -226,12 +226,17 @@ namespace XIAODB_NAMESPACE
             moptions.memtable_prefix_bloom_size_ratio;
         cf_opts->memtable_whole_key_filtering = moptions.memtable_whole_key_filtering;
         cf_opts->memtable_huge_page_size = moptions.memtable_huge_page_size;
+        cf_opts->memtable_numa_aware = moptions.memtable_numa_aware;
+        cf_opts->memtable_transparent_huge_pages =
+            moptions.memtable_transparent_huge_pages;
         cf_opts->max_successive_merges = moptions.max_successive_merges;
         cf_opts->strict_max_successive_merges = moptions.strict_max_successive_merges;
         cf_opts->inplace_update_num_locks = moptions.inplace_update_num_locks;
         cf_opts->prefix_extractor = moptions.prefix_extractor;
         cf_opts->experimental_mempurge_threshold =
             moptions.experimental_mempurge_threshold;
+        cf_opts->memtable_compaction_garbage_ratio =
+            moptions.memtable_compaction_garbage_ratio;
         cf_opts->memtable_protection_bytes_per_key =
             moptions.memtable_protection_bytes_per_key;
         cf_opts->block_protection_bytes_per_key =
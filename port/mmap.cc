@@ -1,11 +1,22 @@
 #include "port/mmap.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstring>
 #include <new>
 #include <utility>
 
+#ifdef NUMA
+#include <numaif.h>
+#endif
+
+#ifndef OS_WIN
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "util/hash.h"
 
 namespace XIAODB_NAMESPACE
@@ -93,6 +104,38 @@ namespace XIAODB_NAMESPACE
         return mm;
     }
 
+    bool MemMapping::AdviseHugePages()
+    {
+#if !defined(OS_WIN) && defined(MADV_HUGEPAGE)
+        if (addr_ == nullptr)
+        {
+            return false;
+        }
+        return madvise(addr_, length_, MADV_HUGEPAGE) == 0;
+#else
+        return false;
+#endif
+    }
+
+    bool MemMapping::BindToNumaNode(int numa_node)
+    {
+#if defined(NUMA) && !defined(OS_WIN)
+        if (addr_ == nullptr || numa_node < 0 ||
+            numa_node >= static_cast<int>(sizeof(unsigned long) * 8))
+        {
+            return false;
+        }
+        unsigned long nodemask = 1UL << numa_node;
+        // MPOL_PREFERRED rather than MPOL_BIND, so that a full node spills to
+        // its neighbours instead of failing the allocation.
+        return mbind(addr_, length_, MPOL_PREFERRED, &nodemask,
+                     sizeof(nodemask) * 8, 0) == 0;
+#else
+        (void)numa_node;
+        return false;
+#endif
+    }
+
     MemMapping MemMapping::AllocateHuge(size_t length)
     {
         return AllocateAnonymous(length, true);
@@ -102,4 +145,93 @@ namespace XIAODB_NAMESPACE
     {
         return AllocateAnonymous(length, false);
     }
+
+    MemMapping MemMapping::MapFileReadOnly(const std::string &fname)
+    {
+        MemMapping mm;
+#ifdef OS_WIN
+        HANDLE file = ::CreateFileA(fname.c_str(), GENERIC_READ,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                                    nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return mm;
+        }
+        LARGE_INTEGER size;
+        if (::GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        {
+            mm.page_file_handle_ =
+                ::CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mm.page_file_handle_ != NULL)
+            {
+                mm.addr_ = ::MapViewOfFile(mm.page_file_handle_, FILE_MAP_READ, 0, 0, 0);
+                if (mm.addr_ != nullptr)
+                {
+                    mm.length_ = static_cast<size_t>(size.QuadPart);
+                }
+            }
+        }
+        (void)::CloseHandle(file);
+#else
+        int fd = open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return mm;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                              MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                mm.addr_ = addr;
+                mm.length_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+#endif
+        return mm;
+    }
+
+    bool MemMapping::Advise(Advice advice, size_t offset, size_t length) const
+    {
+#ifdef OS_WIN
+        (void)advice;
+        (void)offset;
+        (void)length;
+        return false;
+#else
+        if (addr_ == nullptr || offset >= length_)
+        {
+            return false;
+        }
+        length = std::min(length, length_ - offset);
+        // madvise() wants a page aligned address.
+        static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t aligned_offset = offset - offset % page_size;
+        length += offset - aligned_offset;
+        int flag = MADV_NORMAL;
+        switch (advice)
+        {
+        case Advice::kNormal:
+            flag = MADV_NORMAL;
+            break;
+        case Advice::kRandom:
+            flag = MADV_RANDOM;
+            break;
+        case Advice::kSequential:
+            flag = MADV_SEQUENTIAL;
+            break;
+        case Advice::kWillNeed:
+            flag = MADV_WILLNEED;
+            break;
+        case Advice::kDontNeed:
+            flag = MADV_DONTNEED;
+            break;
+        }
+        return madvise(static_cast<char *>(addr_) + aligned_offset, length, flag) == 0;
+#endif
+    }
 }
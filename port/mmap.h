@@ -8,6 +8,7 @@
 #endif
 
 #include <cstdint>
+#include <string>
 #include <utility>
 
 #include "xiaodb/xiaodb_namespace.h"
@@ -35,6 +36,31 @@ namespace XIAODB_NAMESPACE
         // back the full mapping.
         static MemMapping AllocateLazyZeroed(size_t length);
 
+        // Map the whole of an existing file read-only and shared, so that the
+        // mapping is backed by the page cache. The mapping stays valid after
+        // the file is closed, but the file must not be truncated meanwhile.
+        // Get() is nullptr on failure and for an empty file.
+        static MemMapping MapFileReadOnly(const std::string &fname);
+
+        // Access pattern hints for Advise(), after madvise().
+        enum class Advice
+        {
+            kNormal,
+            // Pages are accessed in random order: read ahead little or not at
+            // all around a fault.
+            kRandom,
+            kSequential,
+            // The range is about to be accessed: start reading it in.
+            kWillNeed,
+            // The range will not be accessed soon.
+            kDontNeed,
+        };
+
+        // Hint the kernel about the accesses to [offset, offset + length) of
+        // the mapping, clamped to it. offset need not be page aligned. Returns
+        // false if the hint is not supported on this platform or was rejected.
+        bool Advise(Advice advice, size_t offset = 0, size_t length = SIZE_MAX) const;
+
         MemMapping(const MemMapping &) = delete;
         MemMapping &operator=(const MemMapping &) = delete;
 
@@ -46,6 +72,17 @@ namespace XIAODB_NAMESPACE
         inline void *Get() const { return addr_; }
         inline size_t Length() const { return length_; }
 
+        // Hint that this mapping should be backed by transparent huge pages.
+        // Unlike AllocateHuge(), this needs no reserved hugetlb pool and quietly
+        // degrades to regular pages. Returns false if the hint is not supported
+        // on this platform or was rejected.
+        bool AdviseHugePages();
+
+        // Prefer physical placement of this mapping on the given NUMA node. Only
+        // affects pages not yet touched, so call it right after allocation.
+        // Returns false if the build lacks NUMA support or the binding failed.
+        bool BindToNumaNode(int numa_node);
+
     private:
         MemMapping()
         {
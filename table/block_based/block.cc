@@ -0,0 +1,548 @@
+#include "table/block_based/block.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "table/block_based/data_block_footer.h"
+#include "table/block_based/restart_key_prefixes.h"
+#include "util/coding.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        // Helper routine: decode the next block entry starting at "p",
+        // storing the number of shared key bytes, non_shared key bytes,
+        // and the length of the value in "*shared", "*non_shared", and
+        // "*value_length", respectively.  Will not dereference past "limit".
+        //
+        // If any errors are detected, returns nullptr.  Otherwise, returns a
+        // pointer to the key delta (just past the three decoded values).
+        inline const char *DecodeEntry(const char *p, const char *limit,
+                                       uint32_t *shared, uint32_t *non_shared,
+                                       uint32_t *value_length)
+        {
+            if (limit - p < 3)
+            {
+                return nullptr;
+            }
+            *shared = reinterpret_cast<const unsigned char *>(p)[0];
+            *non_shared = reinterpret_cast<const unsigned char *>(p)[1];
+            *value_length = reinterpret_cast<const unsigned char *>(p)[2];
+            if ((*shared | *non_shared | *value_length) < 128)
+            {
+                // Fast path: all three values are encoded in one byte each
+                p += 3;
+            }
+            else
+            {
+                // Typically a value of 128 bytes or more: the three lengths
+                // mostly end in one word, and are decoded together.
+                uint32_t lengths[3];
+                if ((p = GetVarint32Array(p, limit, lengths, 3)) == nullptr)
+                {
+                    return nullptr;
+                }
+                *shared = lengths[0];
+                *non_shared = lengths[1];
+                *value_length = lengths[2];
+            }
+
+            if (static_cast<uint32_t>(limit - p) < (*non_shared + *value_length))
+            {
+                return nullptr;
+            }
+            return p;
+        }
+    }
+
+    Block::Block(BlockContents &&contents)
+        : contents_(std::move(contents)),
+          data_(contents_.data.data()),
+          size_(contents_.data.size()),
+          restart_offset_(0),
+          num_restarts_(0),
+          key_prefixes_(nullptr),
+          key_prefix_offset_(0)
+    {
+        if (size_ < sizeof(uint32_t))
+        {
+            size_ = 0; // Error marker
+            return;
+        }
+        BlockBasedTableOptions::DataBlockIndexType index_type;
+        bool has_key_prefixes;
+        UnPackIndexTypeAndNumRestarts(DecodeFixed32(data_ + size_ - sizeof(uint32_t)),
+                                      &index_type, &has_key_prefixes,
+                                      &num_restarts_);
+        // end is the offset in data_ of the end of what is left to parse,
+        // working backwards from the footer.
+        size_t end = size_ - sizeof(uint32_t);
+        if (has_key_prefixes)
+        {
+            const size_t prefixes_size =
+                num_restarts_ * kRestartKeyPrefixSize + sizeof(uint32_t);
+            if (end < prefixes_size)
+            {
+                size_ = 0;
+                num_restarts_ = 0;
+                return;
+            }
+            end -= prefixes_size;
+            key_prefixes_ = data_ + end;
+            key_prefix_offset_ = DecodeFixed32(
+                key_prefixes_ + num_restarts_ * kRestartKeyPrefixSize);
+        }
+        if (index_type == BlockBasedTableOptions::kDataBlockBinaryAndHash)
+        {
+            // The hash index ends with its number of buckets, which must be
+            // non-zero and leave room for the buckets.
+            if (end > kMaxBlockSizeSupportedByHashIndex || end < sizeof(uint16_t) ||
+                DecodeFixed16(data_ + end - sizeof(uint16_t)) == 0 ||
+                DecodeFixed16(data_ + end - sizeof(uint16_t)) >=
+                    end - sizeof(uint16_t))
+            {
+                size_ = 0;
+                num_restarts_ = 0;
+                key_prefixes_ = nullptr;
+                return;
+            }
+            uint16_t map_offset;
+            data_block_hash_index_.Initialize(data_, static_cast<uint16_t>(end),
+                                              &map_offset);
+            end = map_offset;
+        }
+        const size_t max_restarts_allowed = end / sizeof(uint32_t);
+        if (num_restarts_ == 0 || num_restarts_ > max_restarts_allowed)
+        {
+            // The size is too small for NumRestarts(), or a block without
+            // restart points, which BlockBuilder never writes.
+            size_ = 0;
+            num_restarts_ = 0;
+            key_prefixes_ = nullptr;
+            return;
+        }
+        restart_offset_ = static_cast<uint32_t>(end) -
+                          num_restarts_ * static_cast<uint32_t>(sizeof(uint32_t));
+    }
+
+    size_t Block::ApproximateMemoryUsage() const
+    {
+        return contents_.ApproximateMemoryUsage() + sizeof(*this) -
+               sizeof(contents_);
+    }
+
+    void Block::InitIter(const InternalKeyComparator *icmp, BlockIter *iter) const
+    {
+        if (size_ == 0)
+        {
+            iter->Invalidate(Status::Corruption("bad block contents"));
+            return;
+        }
+        // The hash index finds a user key by its bytes, and the prefixes
+        // order user keys by their bytes.
+        const DataBlockHashIndex *data_block_hash_index = nullptr;
+        const char *key_prefixes = nullptr;
+        if (icmp != nullptr)
+        {
+            const Comparator *ucmp = icmp->user_comparator();
+            if (data_block_hash_index_.Valid() &&
+                !ucmp->CanKeysWithDifferentByteContentsBeEqual())
+            {
+                data_block_hash_index = &data_block_hash_index_;
+            }
+            if (ucmp == BytewiseComparator())
+            {
+                key_prefixes = key_prefixes_;
+            }
+        }
+        iter->Initialize(icmp, data_, restart_offset_, num_restarts_,
+                         data_block_hash_index, key_prefixes, key_prefix_offset_);
+    }
+
+    void BlockIter::Initialize(const InternalKeyComparator *icmp, const char *data,
+                               uint32_t restarts, uint32_t num_restarts,
+                               const DataBlockHashIndex *data_block_hash_index,
+                               const char *key_prefixes,
+                               uint32_t key_prefix_offset)
+    {
+        assert(num_restarts > 0);
+        assert(icmp != nullptr ||
+               (data_block_hash_index == nullptr && key_prefixes == nullptr));
+        icmp_ = icmp;
+        data_ = data;
+        restarts_ = restarts;
+        num_restarts_ = num_restarts;
+        current_ = restarts_;
+        restart_index_ = num_restarts_;
+        key_buf_.clear();
+        key_ = Slice();
+        key_pinned_ = false;
+        value_ = Slice();
+        status_ = Status::OK();
+        data_block_hash_index_ = data_block_hash_index;
+        key_prefixes_ = key_prefixes;
+        key_prefix_offset_ = key_prefix_offset;
+    }
+
+    void BlockIter::Invalidate(const Status &s)
+    {
+        data_ = nullptr;
+        restarts_ = 0;
+        num_restarts_ = 0;
+        current_ = 0;
+        restart_index_ = 0;
+        key_ = Slice();
+        value_ = Slice();
+        key_pinned_ = false;
+        status_ = s;
+        data_block_hash_index_ = nullptr;
+        key_prefixes_ = nullptr;
+        key_prefix_offset_ = 0;
+    }
+
+    void BlockIter::CorruptionError()
+    {
+        current_ = restarts_;
+        restart_index_ = num_restarts_;
+        status_ = Status::Corruption("bad entry in block");
+        key_buf_.clear();
+        key_ = Slice();
+        value_ = Slice();
+        key_pinned_ = false;
+    }
+
+    bool BlockIter::ParseNextKey()
+    {
+        current_ = NextEntryOffset();
+        const char *p = data_ + current_;
+        const char *limit = data_ + restarts_; // Restarts come right after data
+
+        if (p >= limit)
+        {
+            // No more entries to return.  Mark as invalid.
+            current_ = restarts_;
+            restart_index_ = num_restarts_;
+            return false;
+        }
+
+        // Decode next entry
+        uint32_t shared, non_shared, value_length;
+        p = DecodeEntry(p, limit, &shared, &non_shared, &value_length);
+        if (p == nullptr || key_.size() < shared)
+        {
+            CorruptionError();
+            return false;
+        }
+        if (shared == 0)
+        {
+            // If this key doesn't share any bytes with prev key then we don't need
+            // to decode it and can use its address in the block directly.
+            key_ = Slice(p, non_shared);
+            key_pinned_ = true;
+        }
+        else
+        {
+            // This key shares `shared` bytes with prev key, we need to decode it
+            if (key_pinned_)
+            {
+                key_buf_.assign(key_.data(), shared);
+            }
+            else
+            {
+                key_buf_.resize(shared);
+            }
+            key_buf_.append(p, non_shared);
+            key_ = Slice(key_buf_);
+            key_pinned_ = false;
+        }
+        value_ = Slice(p + non_shared, value_length);
+        if (shared == 0)
+        {
+            while (restart_index_ + 1 < num_restarts_ &&
+                   GetRestartPoint(restart_index_ + 1) < current_)
+            {
+                ++restart_index_;
+            }
+        }
+        return true;
+    }
+
+    uint32_t BlockIter::BinarySeekIndex(const Slice &target)
+    {
+        // Loop invariants: the restart key at `left` is < target (or left is
+        // the first restart point), and the restart key past `right` is
+        // >= target.
+        uint32_t left = 0;
+        uint32_t right = num_restarts_ - 1;
+        if (key_prefixes_ != nullptr)
+        {
+            NarrowByKeyPrefixes(target, &left, &right);
+        }
+        while (left < right)
+        {
+            uint32_t mid = left + (right - left + 1) / 2;
+            uint32_t region_offset = GetRestartPoint(mid);
+            uint32_t shared, non_shared, value_length;
+            const char *key_ptr = DecodeEntry(data_ + region_offset, data_ + restarts_,
+                                              &shared, &non_shared, &value_length);
+            if (key_ptr == nullptr || (shared != 0))
+            {
+                CorruptionError();
+                return num_restarts_;
+            }
+            Slice mid_key(key_ptr, non_shared);
+            if (Compare(mid_key, target) < 0)
+            {
+                // Key at "mid" is smaller than "target". Therefore all
+                // blocks before "mid" are uninteresting.
+                left = mid;
+            }
+            else
+            {
+                // Key at "mid" is >= "target". Therefore all blocks at or
+                // after "mid" are uninteresting.
+                right = mid - 1;
+            }
+        }
+        return left;
+    }
+
+    void BlockIter::NarrowByKeyPrefixes(const Slice &target, uint32_t *left,
+                                        uint32_t *right)
+    {
+        // The bytes all restart user keys share are those of the first one.
+        uint32_t shared, non_shared, value_length;
+        const char *key_ptr = DecodeEntry(data_ + GetRestartPoint(0),
+                                          data_ + restarts_, &shared,
+                                          &non_shared, &value_length);
+        if (key_ptr == nullptr || shared != 0 ||
+            non_shared < kNumInternalBytes + key_prefix_offset_ ||
+            target.size() < kNumInternalBytes)
+        {
+            // Leave corruption to the binary search to report.
+            return;
+        }
+        const Slice user_key = ExtractUserKey(target);
+        const size_t n = std::min(user_key.size(), size_t{key_prefix_offset_});
+        int r = memcmp(user_key.data(), key_ptr, n);
+        if (r == 0 && user_key.size() < key_prefix_offset_)
+        {
+            r = -1;
+        }
+        if (r < 0)
+        {
+            // target is before all the restart keys
+            *right = 0;
+            return;
+        }
+        if (r > 0)
+        {
+            // target is after all the restart keys
+            *left = num_restarts_ - 1;
+            return;
+        }
+
+        // A restart key whose prefix is < (>) that of target has a user key
+        // < (>) that of target; equal prefixes decide nothing. So the last
+        // restart key < target is among those with a prefix <= that of
+        // target, and at or after the last one with a smaller prefix.
+        uint32_t num_lt, num_le;
+        CountRestartKeyPrefixes(key_prefixes_, num_restarts_,
+                                EncodeRestartKeyPrefix(user_key, key_prefix_offset_),
+                                &num_lt, &num_le);
+        *left = num_lt > 0 ? num_lt - 1 : 0;
+        *right = num_le > 0 ? num_le - 1 : 0;
+    }
+
+    void BlockIter::SeekToFirst()
+    {
+        if (data_ == nullptr)
+        { // Not init yet
+            return;
+        }
+        SeekToRestartPoint(0);
+        ParseNextKey();
+    }
+
+    void BlockIter::SeekToLast()
+    {
+        if (data_ == nullptr)
+        { // Not init yet
+            return;
+        }
+        SeekToRestartPoint(num_restarts_ - 1);
+        while (ParseNextKey() && NextEntryOffset() < restarts_)
+        {
+            // Keep skipping
+        }
+    }
+
+    void BlockIter::Seek(const Slice &target)
+    {
+        if (data_ == nullptr)
+        { // Not init yet
+            return;
+        }
+        uint32_t index = BinarySeekIndex(target);
+        if (index >= num_restarts_)
+        {
+            return;
+        }
+        SeekToRestartPoint(index);
+        // Linear search (within restart block) for first key >= target
+        while (ParseNextKey() && Compare(key_, target) < 0)
+        {
+        }
+    }
+
+    void BlockIter::SeekForPrev(const Slice &target)
+    {
+        if (data_ == nullptr)
+        { // Not init yet
+            return;
+        }
+        Seek(target);
+        if (!Valid())
+        {
+            if (status_.ok())
+            {
+                // All keys are < target
+                SeekToLast();
+            }
+            return;
+        }
+        // Seek() stopped at the first key >= target; back up if it is past it.
+        if (Compare(key_, target) > 0)
+        {
+            Prev();
+        }
+    }
+
+    bool BlockIter::SeekForGet(const Slice &target)
+    {
+        if (data_block_hash_index_ == nullptr)
+        {
+            Seek(target);
+            return true;
+        }
+        Slice target_user_key = ExtractUserKey(target);
+        uint32_t map_offset = restarts_ + num_restarts_ * sizeof(uint32_t);
+        uint8_t entry =
+            data_block_hash_index_->Lookup(data_, map_offset, target_user_key);
+
+        if (entry == kCollision)
+        {
+            // HashSeek not effective, falling back
+            Seek(target);
+            return true;
+        }
+
+        if (entry == kNoEntry)
+        {
+            // Even if we cannot find the user_key in this block, the result may
+            // exist in the next block. Consider this example:
+            //
+            // Block N:    [aab@100, ... , app@120]
+            // boundary key: axy@50 (we make minimal assumption about a boundary key)
+            // Block N+1:  [axy@10, ...   ]
+            //
+            // If seek_key = axy@60, the search will start from Block N.
+            // Even if the user_key is not found in the hash map, the caller still
+            // have to continue searching the next block.
+            //
+            // In this case, we pretend the key is in the last restart interval.
+            // The while-loop below will search the last restart interval for the
+            // key. It will stop at the first key that is larger than the seek_key,
+            // or to the end of the block if no one is larger.
+            entry = static_cast<uint8_t>(num_restarts_ - 1);
+        }
+
+        uint32_t restart_index = entry;
+
+        // check if the key is in the restart_interval
+        assert(restart_index < num_restarts_);
+        SeekToRestartPoint(restart_index);
+        const uint32_t limit = restart_index + 1 < num_restarts_
+                                   ? GetRestartPoint(restart_index + 1)
+                                   : restarts_;
+
+        // Here we only linear seek the target key inside the restart interval.
+        // If a key does not exist inside a restart interval, we avoid
+        // further searching the block content across restart interval boundary.
+        while (true)
+        {
+            if (NextEntryOffset() >= limit)
+            {
+                current_ = restarts_;
+                restart_index_ = num_restarts_;
+                break;
+            }
+            if (!ParseNextKey() || Compare(key_, target) >= 0)
+            {
+                // we stop at the first potential matching user key.
+                break;
+            }
+        }
+
+        if (current_ == restarts_)
+        {
+            // Search reaches to the end of the block, or of the restart
+            // interval. There are three possibilities:
+            // 1) there is only one user_key match in the block (otherwise
+            //    collision). The matching user_key resides in the restart
+            //    interval, and it is the last key of the restart interval.
+            //    ParseNextKey() skipped it as its [ type | seqno ] is smaller.
+            //
+            // 2) The seek_key is not found in the HashIndex Lookup(), i.e.
+            //    kNoEntry, AND all existing user_keys in the restart interval
+            //    are smaller than seek_user_key.
+            //
+            // 3) The seek_key is a false positive and happens to be hashed to
+            //    the restart interval, AND all existing user_keys in the
+            //    restart interval are smaller than seek_user_key.
+            //
+            // The result may exist in the next block each case, so we return
+            // true.
+            return status_.ok();
+        }
+
+        if (!icmp_->user_comparator()->Equal(ExtractUserKey(key_),
+                                             target_user_key))
+        {
+            // the key is not in this block and cannot be at the next block either.
+            return false;
+        }
+        return true;
+    }
+
+    void BlockIter::Next()
+    {
+        assert(Valid());
+        ParseNextKey();
+    }
+
+    void BlockIter::Prev()
+    {
+        assert(Valid());
+        // Scan backwards to a restart point before current_
+        const uint32_t original = current_;
+        while (GetRestartPoint(restart_index_) >= original)
+        {
+            if (restart_index_ == 0)
+            {
+                // No more entries
+                current_ = restarts_;
+                restart_index_ = num_restarts_;
+                return;
+            }
+            restart_index_--;
+        }
+
+        SeekToRestartPoint(restart_index_);
+        // Loop until end of current entry hits the start of original entry
+        while (ParseNextKey() && NextEntryOffset() < original)
+        {
+        }
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "db/dbformat.h"
+#include "table/block_based/data_block_hash_index.h"
+#include "table/format.h"
+#include "xiaodb/cleanable.h"
+#include "xiaodb/slice.h"
+#include "xiaodb/status.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class BlockIter;
+
+    // Block is a read-only view of one uncompressed block in the format
+    // written by BlockBuilder. It owns the block contents it was created with,
+    // unless they refer to memory that outlives it, e.g. an mmap'ed file or a
+    // block cache entry released by a cleanup (see RegisterCleanup()).
+    //
+    // The hash index and the restart key prefixes of a data block are used by
+    // the iterators of blocks of internal keys only, and only when the user
+    // comparator allows them (see InitIter()).
+    class Block
+    {
+    public:
+        // Initialize the block with the specified contents.
+        explicit Block(BlockContents &&contents);
+
+        Block(const Block &) = delete;
+        void operator=(const Block &) = delete;
+
+        size_t size() const { return size_; }
+        const char *data() const { return data_; }
+        bool own_bytes() const { return contents_.own_bytes(); }
+        uint32_t NumRestarts() const { return num_restarts_; }
+
+        // Report an approximation of how much memory has been used.
+        size_t ApproximateMemoryUsage() const;
+
+        // Points iter at this block; iter must not outlive it. Keys are
+        // compared with icmp, or bytewise when icmp is nullptr (as in the
+        // metaindex block). If the block is malformed, iter is left invalid
+        // with a Corruption status.
+        void InitIter(const InternalKeyComparator *icmp, BlockIter *iter) const;
+
+        // Has function(arg1, arg2) called when the block is destroyed, e.g. to
+        // release the block cache entry holding contents it does not own.
+        void RegisterCleanup(Cleanable::CleanupFunction function, void *arg1,
+                             void *arg2)
+        {
+            cleanup_.RegisterCleanup(function, arg1, arg2);
+        }
+
+    private:
+        // Runs after contents_ is gone.
+        Cleanable cleanup_;
+        BlockContents contents_;
+        const char *data_;        // contents_.data.data()
+        size_t size_;             // contents_.data.size(), 0 if malformed
+        uint32_t restart_offset_; // Offset in data_ of restart array
+        uint32_t num_restarts_;
+        DataBlockHashIndex data_block_hash_index_;
+        // Restart key prefix array and the user key offset the prefixes start
+        // at, or nullptr if the block has none.
+        const char *key_prefixes_;
+        uint32_t key_prefix_offset_;
+    };
+
+    // An iterator over the entries of a Block. BlockIter is usually
+    // stack-allocated and re-pointed at different blocks, so it is not an
+    // InternalIterator itself; the table iterators wrap it.
+    class BlockIter
+    {
+    public:
+        BlockIter() = default;
+
+        BlockIter(const BlockIter &) = delete;
+        void operator=(const BlockIter &) = delete;
+
+        // data_block_hash_index and key_prefixes, when not nullptr, require
+        // icmp (see Block::InitIter()).
+        void Initialize(const InternalKeyComparator *icmp, const char *data,
+                        uint32_t restarts, uint32_t num_restarts,
+                        const DataBlockHashIndex *data_block_hash_index = nullptr,
+                        const char *key_prefixes = nullptr,
+                        uint32_t key_prefix_offset = 0);
+
+        // Makes Valid() return false, status() return `s`.
+        void Invalidate(const Status &s);
+
+        bool Valid() const { return current_ < restarts_; }
+        Status status() const { return status_; }
+
+        Slice key() const
+        {
+            assert(Valid());
+            return key_;
+        }
+        Slice value() const
+        {
+            assert(Valid());
+            return value_;
+        }
+
+        // True if key() points into the block rather than into the
+        // iterator's own buffer, which happens for keys at restart points.
+        bool IsKeyPinned() const { return key_pinned_; }
+
+        void SeekToFirst();
+        void SeekToLast();
+        // Positions at the first entry with key >= target.
+        void Seek(const Slice &target);
+        // Positions at the last entry with key <= target.
+        void SeekForPrev(const Slice &target);
+        // Point lookup version of Seek(), which uses the hash index of the
+        // block, if any, to go straight to the restart interval of the user
+        // key of target. Returns false if the user key is in neither this
+        // block nor the following ones, leaving the iterator unspecified.
+        // Otherwise the iterator is positioned as by Seek(), except that it
+        // may be invalid where Seek() would be at an entry of another user
+        // key, in which case the lookup continues in the next block.
+        bool SeekForGet(const Slice &target);
+        void Next();
+        void Prev();
+
+    private:
+        int Compare(const Slice &a, const Slice &b) const
+        {
+            return icmp_ != nullptr ? icmp_->Compare(a, b) : a.compare(b);
+        }
+
+        // Return the offset in data_ just past the end of the current entry.
+        inline uint32_t NextEntryOffset() const
+        {
+            return static_cast<uint32_t>((value_.data() + value_.size()) - data_);
+        }
+
+        uint32_t GetRestartPoint(uint32_t index) const
+        {
+            assert(index < num_restarts_);
+            return DecodeFixed32(data_ + restarts_ + index * sizeof(uint32_t));
+        }
+
+        void SeekToRestartPoint(uint32_t index)
+        {
+            key_buf_.clear();
+            key_ = Slice();
+            key_pinned_ = false;
+            restart_index_ = index;
+            // current_ will be fixed by ParseNextKey();
+
+            // ParseNextKey() starts at the end of value_, so set value_
+            // accordingly
+            uint32_t offset = GetRestartPoint(index);
+            value_ = Slice(data_ + offset, 0);
+        }
+
+        // Decodes the entry after the current one. Returns false at the end
+        // of the block, or on corruption.
+        bool ParseNextKey();
+
+        // Finds the last restart point whose key is < target, or the first
+        // one if there is none, for a linear scan to start from.
+        uint32_t BinarySeekIndex(const Slice &target);
+
+        // Narrows down [*left, *right], the range BinarySeekIndex() searches,
+        // by comparing the fixed-width restart key prefixes with those of
+        // target, without decoding any entry.
+        void NarrowByKeyPrefixes(const Slice &target, uint32_t *left,
+                                 uint32_t *right);
+
+        void CorruptionError();
+
+        const InternalKeyComparator *icmp_ = nullptr;
+        const char *data_ = nullptr; // underlying block contents
+        uint32_t restarts_ = 0;      // Offset of restart array (list of fixed32)
+        uint32_t num_restarts_ = 0;  // Number of uint32_t entries in restart array
+        // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
+        uint32_t current_ = 0;
+        // Index of restart block in which current_ or current_-1 falls
+        uint32_t restart_index_ = 0;
+        std::string key_buf_;
+        Slice key_;
+        bool key_pinned_ = false;
+        Slice value_;
+        Status status_;
+        const DataBlockHashIndex *data_block_hash_index_ = nullptr;
+        const char *key_prefixes_ = nullptr;
+        uint32_t key_prefix_offset_ = 0;
+    };
+}
@@ -0,0 +1,184 @@
+#include "table/block_based/block_based_table_iterator.h"
+
+namespace XIAODB_NAMESPACE
+{
+    BlockBasedTableIterator::BlockBasedTableIterator(
+        const BlockBasedTable *table, const ReadOptions &read_options)
+        : table_(table), read_options_(read_options)
+    {
+        index_iter_.Initialize(table_, &read_options_);
+    }
+
+    void BlockBasedTableIterator::InitDataBlock()
+    {
+        if (!index_iter_.Valid())
+        {
+            block_iter_.Invalidate(index_iter_.status());
+            return;
+        }
+        BlockHandle handle;
+        Status s = BlockBasedTable::DecodeIndexValue(index_iter_.value(), &handle);
+        if (s.ok() && (block_ == nullptr || handle != block_handle_))
+        {
+            if (table_->mmap_reads())
+            {
+                AdviseMappedReadahead(handle);
+            }
+            else if (prefetch_buffer_ == nullptr)
+            {
+                CreatePrefetchBuffer();
+            }
+            block_.reset();
+            s = table_->ReadBlock(read_options_, handle, &block_,
+                                  prefetch_buffer_.get());
+        }
+        if (!s.ok())
+        {
+            block_.reset();
+            block_iter_.Invalidate(s);
+            return;
+        }
+        block_handle_ = handle;
+        block_->InitIter(&table_->internal_comparator(), &block_iter_);
+    }
+
+    void BlockBasedTableIterator::CreatePrefetchBuffer()
+    {
+        ReadaheadParams params;
+        if (read_options_.readahead_size > 0)
+        {
+            params.initial_readahead_size = read_options_.readahead_size;
+            params.max_readahead_size = read_options_.readahead_size;
+        }
+        else
+        {
+            const BlockBasedTableOptions &table_options = table_->table_options();
+            params.initial_readahead_size = table_options.initial_auto_readahead_size;
+            params.max_readahead_size = table_options.max_auto_readahead_size;
+            params.implicit_auto_readahead = true;
+            params.num_file_reads_for_auto_readahead =
+                table_options.num_file_reads_for_auto_readahead;
+        }
+        params.num_buffers = read_options_.async_io ? 2 : 1;
+        prefetch_buffer_.reset(new FilePrefetchBuffer(params, table_->file_system()));
+    }
+
+    void BlockBasedTableIterator::AdviseMappedReadahead(const BlockHandle &handle)
+    {
+        const uint64_t offset = handle.offset();
+        const bool sequential =
+            block_ != nullptr &&
+            offset == block_handle_.offset() + BlockSizeWithTrailer(block_handle_);
+        if (!sequential || offset + BlockSizeWithTrailer(handle) <= mmap_advised_end_)
+        {
+            return;
+        }
+        const size_t readahead = read_options_.readahead_size > 0
+                                     ? read_options_.readahead_size
+                                     : table_->table_options().max_auto_readahead_size;
+        if (readahead > 0)
+        {
+            table_->AdviseMapped(MemMapping::Advice::kWillNeed, offset, readahead);
+            mmap_advised_end_ = offset + readahead;
+        }
+    }
+
+    void BlockBasedTableIterator::GetReadaheadState(
+        ReadaheadFileInfo *readahead_file_info)
+    {
+        if (read_options_.adaptive_readahead && prefetch_buffer_ != nullptr)
+        {
+            prefetch_buffer_->GetReadaheadState(
+                &readahead_file_info->data_block_readahead_info);
+        }
+    }
+
+    void BlockBasedTableIterator::SetReadaheadState(
+        ReadaheadFileInfo *readahead_file_info)
+    {
+        if (read_options_.adaptive_readahead && read_options_.readahead_size == 0 &&
+            !table_->mmap_reads())
+        {
+            if (prefetch_buffer_ == nullptr)
+            {
+                CreatePrefetchBuffer();
+            }
+            prefetch_buffer_->SetReadaheadState(
+                readahead_file_info->data_block_readahead_info);
+        }
+    }
+
+    void BlockBasedTableIterator::FindKeyForward()
+    {
+        while (!block_iter_.Valid() && block_iter_.status().ok() &&
+               index_iter_.Valid())
+        {
+            index_iter_.Next();
+            InitDataBlock();
+            block_iter_.SeekToFirst();
+        }
+    }
+
+    void BlockBasedTableIterator::FindKeyBackward()
+    {
+        while (!block_iter_.Valid() && block_iter_.status().ok() &&
+               index_iter_.Valid())
+        {
+            index_iter_.Prev();
+            InitDataBlock();
+            block_iter_.SeekToLast();
+        }
+    }
+
+    void BlockBasedTableIterator::Seek(const Slice &target)
+    {
+        index_iter_.Seek(target);
+        InitDataBlock();
+        block_iter_.Seek(target);
+        FindKeyForward();
+    }
+
+    void BlockBasedTableIterator::SeekForPrev(const Slice &target)
+    {
+        // The first data block whose separator is >= target holds the last
+        // key <= target, unless all its keys are > target.
+        index_iter_.Seek(target);
+        if (!index_iter_.Valid() && index_iter_.status().ok())
+        {
+            index_iter_.SeekToLast();
+        }
+        InitDataBlock();
+        block_iter_.SeekForPrev(target);
+        FindKeyBackward();
+    }
+
+    void BlockBasedTableIterator::SeekToFirst()
+    {
+        index_iter_.SeekToFirst();
+        InitDataBlock();
+        block_iter_.SeekToFirst();
+        FindKeyForward();
+    }
+
+    void BlockBasedTableIterator::SeekToLast()
+    {
+        index_iter_.SeekToLast();
+        InitDataBlock();
+        block_iter_.SeekToLast();
+        FindKeyBackward();
+    }
+
+    void BlockBasedTableIterator::Next()
+    {
+        assert(Valid());
+        block_iter_.Next();
+        FindKeyForward();
+    }
+
+    void BlockBasedTableIterator::Prev()
+    {
+        assert(Valid());
+        block_iter_.Prev();
+        FindKeyBackward();
+    }
+}
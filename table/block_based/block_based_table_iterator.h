@@ -0,0 +1,86 @@
+#pragma once
+
+#include <memory>
+
+#include "file/file_prefetch_buffer.h"
+#include "table/block_based/block.h"
+#include "table/block_based/block_based_table_reader.h"
+#include "table/block_based/index_iterator.h"
+#include "table/internal_iterator.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Iterates over the contents of BlockBasedTable: a two-level iterator
+    // whose first level walks the index (see IndexIterator) and whose second
+    // level walks the data block the index points at, which it reads on
+    // demand.
+    class BlockBasedTableIterator : public InternalIterator
+    {
+    public:
+        BlockBasedTableIterator(const BlockBasedTable *table,
+                                const ReadOptions &read_options);
+
+        void Seek(const Slice &target) override;
+        void SeekForPrev(const Slice &target) override;
+        void SeekToFirst() override;
+        void SeekToLast() override;
+        void Next() override;
+        void Prev() override;
+
+        bool Valid() const override { return block_iter_.Valid(); }
+        Slice key() const override
+        {
+            assert(Valid());
+            return block_iter_.key();
+        }
+        Slice value() const override
+        {
+            assert(Valid());
+            return block_iter_.value();
+        }
+        Status status() const override
+        {
+            if (!index_iter_.status().ok())
+            {
+                return index_iter_.status();
+            }
+            return block_iter_.status();
+        }
+
+        // With ReadOptions::adaptive_readahead, the readahead reached in this
+        // file is carried over to the next file of the same level.
+        void GetReadaheadState(ReadaheadFileInfo *readahead_file_info) override;
+        void SetReadaheadState(ReadaheadFileInfo *readahead_file_info) override;
+
+    private:
+        // Points block_iter_ at the data block index_iter_ points at, reading
+        // it unless it is the current block. Leaves block_iter_ invalid, with
+        // the error if any, when index_iter_ is invalid or the read fails.
+        void InitDataBlock();
+
+        // Creates prefetch_buffer_: with a fixed readahead if
+        // ReadOptions::readahead_size is set, with the auto readahead of the
+        // table options otherwise.
+        void CreatePrefetchBuffer();
+
+        // With a mapped file, asks for the pages ahead of a sequential scan
+        // reaching the block at handle, in place of prefetch_buffer_.
+        void AdviseMappedReadahead(const BlockHandle &handle);
+
+        // Moves to the next (previous) data block while block_iter_ is
+        // exhausted without error.
+        void FindKeyForward();
+        void FindKeyBackward();
+
+        const BlockBasedTable *table_;
+        const ReadOptions &read_options_;
+        IndexIterator index_iter_;
+        std::unique_ptr<Block> block_;
+        BlockHandle block_handle_;
+        BlockIter block_iter_;
+        // The data blocks are read through it; created on the first read.
+        std::unique_ptr<FilePrefetchBuffer> prefetch_buffer_;
+        // End of the range of the mapped file last advised as needed.
+        uint64_t mmap_advised_end_ = 0;
+    };
+}
@@ -0,0 +1,980 @@
+#include "table/block_based/block_based_table_reader.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "file/file_prefetch_buffer.h"
+#include "memory/arena.h"
+#include "table/block_based/block_based_table_iterator.h"
+#include "table/block_based/cached_data_block.h"
+#include "table/block_based/index_iterator.h"
+#include "table/block_based/parallel_checksum.h"
+#include "table/block_based/partitioned_filter_block.h"
+#include "table/block_based/partitioned_index_reader.h"
+#include "table/block_based/reader_common.h"
+#include "table/get_context.h"
+#include "util/compression.h"
+#include "xiaodb/cleanable.h"
+#include "xiaodb/filter_policy.h"
+
+namespace XIAODB_NAMESPACE
+{
+    const std::string BlockBasedTable::kFullFilterBlockPrefix = "fullfilter.";
+    const std::string BlockBasedTable::kPartitionedFilterBlockPrefix =
+        "partitionedfilter.";
+    const std::string BlockBasedTable::kCompressionDictBlockName =
+        "xiaodb.compression_dict";
+
+    namespace
+    {
+        // Whether to pin the index and filter partitions in the reader. There
+        // is no block cache to keep them in otherwise, so they are read on
+        // demand unless pinned. The top-level index and filter index are
+        // always held by the reader.
+        //
+        // Open() knows neither the level nor the origin of the file, so
+        // PinningTier::kFlushedAndSimilar does not pin.
+        bool PinPartitions(const BlockBasedTableOptions &table_options)
+        {
+            PinningTier tier = table_options.metadata_cache_options.partition_pinning;
+            if (tier == PinningTier::kFallback)
+            {
+                tier = table_options.pin_l0_filter_and_index_blocks_in_cache
+                           ? PinningTier::kFlushedAndSimilar
+                           : PinningTier::kNone;
+            }
+            return tier == PinningTier::kAll;
+        }
+
+        // Cleanup of a value pinned in the mapping of a file.
+        void ReleaseMapping(void *arg1, void * /*arg2*/)
+        {
+            delete static_cast<std::shared_ptr<const MemMapping> *>(arg1);
+        }
+
+        // Cleanup of a block pinning its block cache entry.
+        void ReleaseCacheHandle(void *arg1, void *arg2)
+        {
+            static_cast<Cache *>(arg1)->Release(static_cast<Cache::Handle *>(arg2));
+        }
+
+        // The files carry no unique id to derive the cache keys of their
+        // blocks from, so every reader gets keys of its own: the blocks a
+        // reader of the same file cached before are not found again, and age
+        // out.
+        OffsetableCacheKey NewBaseCacheKey(Cache *cache)
+        {
+            const CacheKey unique = CacheKey::CreateUniqueForCacheLifetime(cache);
+            UniqueId64x2 id;
+            static_assert(sizeof(id) == kCacheKeySize, "key as an id");
+            memcpy(id.data(), unique.AsSlice().data(), sizeof(id));
+            return OffsetableCacheKey::FromInternalUniqueId(&id);
+        }
+
+        Status TruncatedBlockRead(const std::string &file_name,
+                                  const BlockHandle &handle, size_t expected,
+                                  size_t got)
+        {
+            return Status::Corruption("truncated block read from " + file_name +
+                                      " offset " + std::to_string(handle.offset()) +
+                                      ", expected " + std::to_string(expected) +
+                                      " bytes, got " + std::to_string(got));
+        }
+    }
+
+    BlockBasedTable::BlockBasedTable(
+        const BlockBasedTableOptions &table_options,
+        const InternalKeyComparator &internal_comparator,
+        std::unique_ptr<RandomAccessFileReader> &&file, FileSystem *fs)
+        : table_options_(table_options),
+          internal_comparator_(internal_comparator),
+          file_(std::move(file)),
+          fs_(fs)
+    {
+        if (table_options.checksum_verification_threads > 0)
+        {
+            checksum_verifier_ = ParallelChecksumVerifier::Shared(
+                table_options.checksum_verification_threads);
+        }
+    }
+
+    BlockBasedTable::~BlockBasedTable() = default;
+
+    Status BlockBasedTable::Open(const ReadOptions &ro,
+                                 const BlockBasedTableOptions &table_options,
+                                 const InternalKeyComparator &internal_comparator,
+                                 std::unique_ptr<RandomAccessFileReader> &&file,
+                                 uint64_t file_size,
+                                 std::unique_ptr<TableReader> *table_reader,
+                                 FileSystem *fs)
+    {
+        table_reader->reset();
+
+        IOOptions opts;
+        Status s = file->PrepareIOOptions(ro, opts);
+        if (!s.ok())
+        {
+            return s;
+        }
+        std::unique_ptr<BlockBasedTable> new_table(
+            new BlockBasedTable(table_options, internal_comparator, std::move(file),
+                                fs));
+        BlockBasedTable *rep = new_table.get();
+        MemoryAllocator *allocator = GetMemoryAllocator(table_options);
+
+        if (table_options.use_mmap_reads)
+        {
+            MemMapping mapping = MemMapping::MapFileReadOnly(rep->file_->file_name());
+            if (mapping.Get() != nullptr && mapping.Length() >= file_size)
+            {
+                // Point lookups touch one block here and there; the iterators
+                // advise the ranges they scan.
+                mapping.Advise(MemMapping::Advice::kRandom);
+                rep->mmap_ = std::make_shared<const MemMapping>(std::move(mapping));
+            }
+        }
+
+        // Blocks used in place out of the mapping have nothing to gain from
+        // the block cache.
+        if (table_options.cache_compressed_blocks && !table_options.no_block_cache &&
+            table_options.block_cache != nullptr && rep->mmap_ == nullptr)
+        {
+            rep->block_cache_ = rep->table_options_.block_cache.get();
+            rep->base_cache_key_ = NewBaseCacheKey(rep->block_cache_);
+        }
+
+        s = ReadFooterFromFile(opts, rep->file_.get(), file_size, &rep->footer_,
+                               kBlockBasedTableMagicNumber);
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        // Find the filter and compression dictionary, if any, in the
+        // metaindex block. The metaindex block maps meta block names, in
+        // bytewise order, to their handles.
+        BlockContents metaindex_contents;
+        s = ReadBlockContents(opts, rep->file_.get(), rep->footer_,
+                              rep->footer_.metaindex_handle(), ro.verify_checksums,
+                              &metaindex_contents, allocator);
+        if (!s.ok())
+        {
+            return s;
+        }
+        Block metaindex(std::move(metaindex_contents));
+        BlockIter meta_iter;
+        metaindex.InitIter(nullptr /* bytewise */, &meta_iter);
+
+        BlockHandle dict_handle = BlockHandle::NullBlockHandle();
+        meta_iter.Seek(kCompressionDictBlockName);
+        if (meta_iter.Valid() && meta_iter.key() == Slice(kCompressionDictBlockName))
+        {
+            s = DecodeIndexValue(meta_iter.value(), &dict_handle);
+        }
+        else
+        {
+            s = meta_iter.status();
+        }
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        BlockHandle filter_handle = BlockHandle::NullBlockHandle();
+        bool partitioned_filter = false;
+        const FilterPolicy *policy = table_options.filter_policy.get();
+        if (policy != nullptr)
+        {
+            for (const std::string *prefix :
+                 {&kFullFilterBlockPrefix, &kPartitionedFilterBlockPrefix})
+            {
+                const std::string filter_key = *prefix + policy->CompatibilityName();
+                meta_iter.Seek(filter_key);
+                if (meta_iter.Valid() && meta_iter.key() == Slice(filter_key))
+                {
+                    s = DecodeIndexValue(meta_iter.value(), &filter_handle);
+                    partitioned_filter = prefix == &kPartitionedFilterBlockPrefix;
+                    break;
+                }
+                s = meta_iter.status();
+                if (!s.ok())
+                {
+                    break;
+                }
+            }
+            if (!s.ok())
+            {
+                return s;
+            }
+        }
+
+        BlockContents index_contents;
+        s = ReadBlockContents(opts, rep->file_.get(), rep->footer_,
+                              rep->footer_.index_handle(), ro.verify_checksums,
+                              &index_contents, allocator);
+        if (!s.ok())
+        {
+            return s;
+        }
+        rep->index_block_.reset(new Block(std::move(index_contents)));
+        if (rep->index_block_->size() == 0)
+        {
+            return Status::Corruption("bad index block in " + rep->file_->file_name());
+        }
+
+        // With a two-level index, the index block is the top-level index. The
+        // index type is not recorded in the file, so it is taken from the
+        // options the file was written with.
+        const bool pin_partitions = PinPartitions(table_options);
+        if (table_options.index_type == BlockBasedTableOptions::kTwoLevelIndexSearch)
+        {
+            s = PartitionIndexReader::Create(rep, ro, pin_partitions,
+                                             &rep->partition_index_);
+            if (!s.ok())
+            {
+                return s;
+            }
+        }
+
+        if (partitioned_filter)
+        {
+            s = PartitionedFilterBlockReader::Create(rep, ro, policy, filter_handle,
+                                                     pin_partitions,
+                                                     &rep->partitioned_filter_);
+            if (!s.ok())
+            {
+                return s;
+            }
+        }
+        else if (!filter_handle.IsNull())
+        {
+            s = ReadBlockContents(opts, rep->file_.get(), rep->footer_, filter_handle,
+                                  ro.verify_checksums, &rep->filter_contents_,
+                                  allocator);
+            if (!s.ok())
+            {
+                return s;
+            }
+            rep->filter_.reset(
+                policy->GetFilterBitsReader(rep->filter_contents_.data));
+        }
+
+        uint64_t dict_version = 0;
+        if (!dict_handle.IsNull())
+        {
+            // The dictionary block itself is stored uncompressed. Digesting it
+            // is only worthwhile for ZSTD, which is what dictionaries are
+            // trained for, and is shared by the tables of the same dictionary.
+            BlockContents dict_contents;
+            s = ReadBlockContents(opts, rep->file_.get(), rep->footer_, dict_handle,
+                                  ro.verify_checksums, &dict_contents, allocator);
+            if (!s.ok())
+            {
+                return s;
+            }
+            dict_version = ZSTD_GetDictID(dict_contents.data);
+            rep->uncompression_dict_.reset(new UncompressionDict(
+                dict_contents.data.ToString(), true /* using_zstd */));
+        }
+
+        auto props = std::make_shared<TableProperties>();
+        props->format_version = rep->footer_.format_version();
+        props->data_size = rep->footer_.metaindex_handle().offset();
+        props->index_size = rep->footer_.index_handle().size();
+        props->filter_size = filter_handle.IsNull() ? 0 : filter_handle.size();
+        props->compression_dict_version = dict_version;
+        rep->table_properties_ = std::move(props);
+
+        *table_reader = std::move(new_table);
+        return Status::OK();
+    }
+
+    InternalIterator *BlockBasedTable::NewIterator(
+        const ReadOptions &read_options, const SliceTransform * /*prefix_extractor*/,
+        Arena *arena, bool /*skip_filters*/, TableReaderCaller /*caller*/,
+        size_t /*compaction_readahead_size*/, bool /*allow_unprepared_value*/)
+    {
+        if (arena == nullptr)
+        {
+            return new BlockBasedTableIterator(this, read_options);
+        }
+        auto *mem = arena->AllocateAligned(sizeof(BlockBasedTableIterator));
+        return new (mem) BlockBasedTableIterator(this, read_options);
+    }
+
+    Status BlockBasedTable::ReadBlock(const ReadOptions &read_options,
+                                      const BlockHandle &handle,
+                                      std::unique_ptr<Block> *block,
+                                      FilePrefetchBuffer *prefetch_buffer,
+                                      BlockType block_type, bool transient) const
+    {
+        const UncompressionDict *dict = DictFor(block_type);
+        const bool cached = block_cache_ != nullptr && block_type == BlockType::kData;
+        if (cached)
+        {
+            Status s;
+            if (LookupCachedDataBlock(handle, transient, block, &s))
+            {
+                return s;
+            }
+        }
+        if (read_options.read_tier == kBlockCacheTier)
+        {
+            // There is no block cache to serve the block from, or it does
+            // not have it.
+            return Status::Incomplete("no blocking io");
+        }
+        if (mmap_ != nullptr)
+        {
+            BlockContents contents;
+            Status s = ReadMappedBlock(read_options, handle, &contents, dict);
+            if (s.ok())
+            {
+                block->reset(new Block(std::move(contents)));
+            }
+            return s;
+        }
+        IOOptions opts;
+        Status s = file_->PrepareIOOptions(read_options, opts);
+        if (s.ok() && cached && read_options.fill_cache)
+        {
+            return ReadAndCacheDataBlock(read_options, opts, handle, prefetch_buffer,
+                                         transient, block);
+        }
+        BlockContents contents;
+        bool read_from_prefetch_buffer = false;
+        if (s.ok() && prefetch_buffer != nullptr)
+        {
+            const size_t n = static_cast<size_t>(BlockSizeWithTrailer(handle));
+            Slice data;
+            Status prefetch_status;
+            if (prefetch_buffer->TryReadFromCache(opts, file_.get(), handle.offset(),
+                                                  n, &data, &prefetch_status))
+            {
+                read_from_prefetch_buffer = true;
+                if (data.size() != n)
+                {
+                    s = TruncatedBlockRead(file_->file_name(), handle, n, data.size());
+                }
+                else
+                {
+                    // The prefetch buffer is reused, so the block is copied
+                    // out of it.
+                    s = DecodeSerializedBlock(footer_, CacheAllocationPtr(), data.data(),
+                                              handle, read_options.verify_checksums,
+                                              file_->file_name(), &contents,
+                                              GetMemoryAllocator(table_options_),
+                                              false /* data_is_pinned */, dict);
+                }
+            }
+            // A failed prefetch falls back to reading the block alone.
+            prefetch_status.PermitUncheckedError();
+        }
+        if (s.ok() && !read_from_prefetch_buffer)
+        {
+            s = ReadBlockContents(opts, file_.get(), footer_, handle,
+                                  read_options.verify_checksums, &contents,
+                                  GetMemoryAllocator(table_options_), dict);
+        }
+        if (s.ok())
+        {
+            block->reset(new Block(std::move(contents)));
+        }
+        return s;
+    }
+
+    bool BlockBasedTable::LookupCachedDataBlock(const BlockHandle &handle,
+                                                bool transient,
+                                                std::unique_ptr<Block> *block,
+                                                Status *s) const
+    {
+        const CacheKey key = base_cache_key_.WithOffset(handle.offset());
+        Cache::Handle *cache_handle =
+            block_cache_->BasicLookup(key.AsSlice(), nullptr /* stats */);
+        if (cache_handle == nullptr)
+        {
+            return false;
+        }
+        *s = BlockFromCacheHandle(key, cache_handle, true /* count_hit */, transient,
+                                  block);
+        return true;
+    }
+
+    Status BlockBasedTable::ReadAndCacheDataBlock(const ReadOptions &read_options,
+                                                  const IOOptions &opts,
+                                                  const BlockHandle &handle,
+                                                  FilePrefetchBuffer *prefetch_buffer,
+                                                  bool transient,
+                                                  std::unique_ptr<Block> *block) const
+    {
+        const size_t n = static_cast<size_t>(BlockSizeWithTrailer(handle));
+        MemoryAllocator *allocator = GetMemoryAllocator(table_options_);
+        CacheAllocationPtr buf;
+        Slice data;
+        if (prefetch_buffer != nullptr)
+        {
+            Status prefetch_status;
+            if (prefetch_buffer->TryReadFromCache(opts, file_.get(), handle.offset(),
+                                                  n, &data, &prefetch_status))
+            {
+                if (data.size() != n)
+                {
+                    return TruncatedBlockRead(file_->file_name(), handle, n,
+                                              data.size());
+                }
+                // The prefetch buffer is reused, so the block is copied out
+                // of it.
+                buf = AllocateAndCopyBlock(data, allocator);
+            }
+            // A failed prefetch falls back to reading the block alone.
+            prefetch_status.PermitUncheckedError();
+        }
+        if (!buf)
+        {
+            buf = AllocateBlock(n, allocator);
+            IOStatus io_s = file_->Read(opts, handle.offset(), n, &data, buf.get(),
+                                        nullptr /* aligned_buf */);
+            if (!io_s.ok())
+            {
+                return io_s;
+            }
+            if (data.size() != n)
+            {
+                return TruncatedBlockRead(file_->file_name(), handle, n, data.size());
+            }
+            if (data.data() != buf.get())
+            {
+                // A file system supplied buffer
+                memcpy(buf.get(), data.data(), n);
+            }
+        }
+        if (read_options.verify_checksums)
+        {
+            Status s = VerifyBlockCheckSum(footer_, buf.get(),
+                                           static_cast<size_t>(handle.size()),
+                                           file_->file_name(), handle.offset());
+            if (!s.ok())
+            {
+                return s;
+            }
+        }
+        return InsertCachedDataBlock(handle, std::move(buf), transient, block);
+    }
+
+    Status BlockBasedTable::InsertCachedDataBlock(const BlockHandle &handle,
+                                                  CacheAllocationPtr &&serialized,
+                                                  bool transient,
+                                                  std::unique_ptr<Block> *block) const
+    {
+        const size_t block_size = static_cast<size_t>(handle.size());
+        const CompressionType type = GetBlockCompressionType(serialized.get(), block_size);
+        // The trailer stays behind the payload; it is not worth a copy.
+        std::unique_ptr<CachedDataBlock> entry(
+            new CachedDataBlock(BlockContents(std::move(serialized), block_size), type));
+        const CacheKey key = base_cache_key_.WithOffset(handle.offset());
+        Cache::Handle *cache_handle = nullptr;
+        Status s = block_cache_->Insert(key.AsSlice(), entry.get(),
+                                        &CachedDataBlock::kHelper,
+                                        entry->ApproximateMemoryUsage(), &cache_handle);
+        if (s.ok())
+        {
+            entry.release();
+            return BlockFromCacheHandle(key, cache_handle, false /* count_hit */,
+                                        transient, block);
+        }
+
+        // The cache is full of blocks in use, and has a strict capacity
+        // limit: the block is used uncached.
+        s.PermitUncheckedError();
+        BlockContents contents = entry->TakeContents();
+        if (type != kNoCompression)
+        {
+            BlockContents uncompressed;
+            s = UncompressSerializedBlock(contents.data.data(), contents.data.size(),
+                                          type, &uncompressed, footer_.format_version(),
+                                          GetMemoryAllocator(table_options_),
+                                          DictFor(BlockType::kData));
+            if (!s.ok())
+            {
+                return s;
+            }
+            contents = std::move(uncompressed);
+        }
+        block->reset(new Block(std::move(contents)));
+        return Status::OK();
+    }
+
+    Status BlockBasedTable::BlockFromCacheHandle(const CacheKey &key,
+                                                 Cache::Handle *cache_handle,
+                                                 bool count_hit, bool transient,
+                                                 std::unique_ptr<Block> *block) const
+    {
+        auto *entry = static_cast<CachedDataBlock *>(block_cache_->Value(cache_handle));
+        if (entry->compression_type() == kNoCompression)
+        {
+            block->reset(new Block(BlockContents(entry->data())));
+            (*block)->RegisterCleanup(&ReleaseCacheHandle, block_cache_, cache_handle);
+            return Status::OK();
+        }
+
+        const bool promote =
+            count_hit && entry->CountHit(table_options_.compressed_block_promotion_hits);
+        // A block to promote is uncompressed into memory the cache can keep.
+        MemoryAllocator *allocator = transient && !promote
+                                         ? ScratchAllocator::ThisThread()
+                                         : GetMemoryAllocator(table_options_);
+        BlockContents contents;
+        Status s = UncompressSerializedBlock(
+            entry->data().data(), entry->data().size(), entry->compression_type(),
+            &contents, footer_.format_version(), allocator, DictFor(BlockType::kData));
+        block_cache_->Release(cache_handle);
+        if (!s.ok())
+        {
+            return s;
+        }
+        if (promote)
+        {
+            // Replaces the compressed entry, under the same key.
+            std::unique_ptr<CachedDataBlock> promoted(
+                new CachedDataBlock(std::move(contents), kNoCompression));
+            Cache::Handle *promoted_handle = nullptr;
+            s = block_cache_->Insert(key.AsSlice(), promoted.get(),
+                                     &CachedDataBlock::kHelper,
+                                     promoted->ApproximateMemoryUsage(), &promoted_handle);
+            if (s.ok())
+            {
+                promoted.release();
+                return BlockFromCacheHandle(key, promoted_handle, false /* count_hit */,
+                                            transient, block);
+            }
+            // The block is used uncached, as by InsertCachedDataBlock().
+            s.PermitUncheckedError();
+            contents = promoted->TakeContents();
+        }
+        block->reset(new Block(std::move(contents)));
+        return Status::OK();
+    }
+
+    Status BlockBasedTable::ReadMappedBlock(const ReadOptions &read_options,
+                                            const BlockHandle &handle,
+                                            BlockContents *contents,
+                                            const UncompressionDict *dict) const
+    {
+        const uint64_t end = handle.offset() + BlockSizeWithTrailer(handle);
+        if (end > mmap_->Length() || end < handle.offset())
+        {
+            return Status::Corruption("block handle past the end of " +
+                                      file_->file_name() + ", offset " +
+                                      std::to_string(handle.offset()));
+        }
+        const char *data = static_cast<const char *>(mmap_->Get()) + handle.offset();
+        return DecodeSerializedBlock(footer_, CacheAllocationPtr(), data, handle,
+                                     read_options.verify_checksums,
+                                     file_->file_name(), contents,
+                                     GetMemoryAllocator(table_options_),
+                                     true /* data_is_pinned */, dict);
+    }
+
+    Status BlockBasedTable::RetrieveBlocks(const ReadOptions &read_options,
+                                           const BlockHandle *handles, size_t n,
+                                           BlockContents *contents) const
+    {
+        if (read_options.read_tier == kBlockCacheTier)
+        {
+            // There is no block cache to serve the blocks from.
+            return Status::Incomplete("no blocking io");
+        }
+        if (mmap_ != nullptr)
+        {
+            Status s;
+            for (size_t i = 0; s.ok() && i < n; ++i)
+            {
+                s = ReadMappedBlock(read_options, handles[i], &contents[i],
+                                    nullptr /* dict */);
+            }
+            return s;
+        }
+        IOOptions opts;
+        Status s = file_->PrepareIOOptions(read_options, opts);
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        // Merge the reads of adjacent blocks, and remember which read every
+        // block is in.
+        std::vector<FSReadRequest> read_reqs;
+        std::vector<size_t> block_req(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            assert(i == 0 || handles[i].offset() >= handles[i - 1].offset());
+            FSReadRequest req;
+            req.offset = handles[i].offset();
+            req.len = static_cast<size_t>(BlockSizeWithTrailer(handles[i]));
+            if (read_reqs.empty() || !TryMerge(&read_reqs.back(), req))
+            {
+                read_reqs.emplace_back(std::move(req));
+            }
+            block_req[i] = read_reqs.size() - 1;
+        }
+
+        MemoryAllocator *allocator = GetMemoryAllocator(table_options_);
+        std::vector<CacheAllocationPtr> bufs(read_reqs.size());
+        for (size_t j = 0; j < read_reqs.size(); ++j)
+        {
+            bufs[j] = AllocateBlock(read_reqs[j].len, allocator);
+            read_reqs[j].scratch = bufs[j].get();
+        }
+        AlignedBuf direct_io_buf;
+        s = file_->MultiRead(opts, read_reqs.data(), read_reqs.size(),
+                             file_->use_direct_io() ? &direct_io_buf : nullptr);
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        // Check that every block was read whole before verifying any.
+        std::vector<const char *> block_data(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const FSReadRequest &req = read_reqs[block_req[i]];
+            if (!req.status.ok())
+            {
+                return req.status;
+            }
+            const size_t block_offset = static_cast<size_t>(handles[i].offset() - req.offset);
+            const size_t block_size = static_cast<size_t>(BlockSizeWithTrailer(handles[i]));
+            if (req.result.size() < block_offset + block_size)
+            {
+                return Status::Corruption(
+                    "truncated block read from " + file_->file_name() + " offset " +
+                    std::to_string(handles[i].offset()) + ", expected " +
+                    std::to_string(block_size) + " bytes, got " +
+                    std::to_string(req.result.size() - std::min(req.result.size(), block_offset)));
+            }
+            block_data[i] = req.result.data() + block_offset;
+        }
+        std::vector<Status> statuses(n);
+        const bool verified =
+            VerifyBlocksInParallel(read_options, n, block_data.data(), handles,
+                                   statuses.data());
+
+        for (size_t i = 0; s.ok() && i < n; ++i)
+        {
+            if (verified && !statuses[i].ok())
+            {
+                s = statuses[i];
+                break;
+            }
+            const size_t j = block_req[i];
+            const FSReadRequest &req = read_reqs[j];
+            const size_t block_size = static_cast<size_t>(BlockSizeWithTrailer(handles[i]));
+            // A block read on its own into its own buffer keeps the buffer;
+            // blocks merged with others are copied out of the shared one.
+            CacheAllocationPtr buf;
+            if (block_size == req.len && req.result.data() == bufs[j].get())
+            {
+                buf = std::move(bufs[j]);
+            }
+            s = DecodeSerializedBlock(footer_, std::move(buf), block_data[i],
+                                      handles[i],
+                                      read_options.verify_checksums && !verified,
+                                      file_->file_name(), &contents[i], allocator);
+        }
+        return s;
+    }
+
+    bool BlockBasedTable::VerifyBlocksInParallel(const ReadOptions &read_options,
+                                                 size_t n, const char *const *data,
+                                                 const BlockHandle *handles,
+                                                 Status *statuses) const
+    {
+        if (checksum_verifier_ == nullptr || !read_options.verify_checksums ||
+            n < 2)
+        {
+            return false;
+        }
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            bytes += BlockSizeWithTrailer(handles[i]);
+        }
+        if (bytes < ParallelChecksumVerifier::kMinParallelBytes)
+        {
+            return false;
+        }
+        checksum_verifier_->VerifyBlocks(footer_, file_->file_name(), n, data,
+                                         handles, statuses);
+        return true;
+    }
+
+    bool BlockBasedTable::FullFilterKeyMayMatch(const ReadOptions &read_options,
+                                                const Slice &internal_key) const
+    {
+        if (!table_options_.whole_key_filtering)
+        {
+            return true;
+        }
+        if (partitioned_filter_ != nullptr)
+        {
+            return partitioned_filter_->KeyMayMatch(read_options, internal_key);
+        }
+        if (filter_ == nullptr)
+        {
+            return true;
+        }
+        return filter_->MayMatch(ExtractUserKey(internal_key));
+    }
+
+    Status BlockBasedTable::MultiGetFilter(const ReadOptions &read_options,
+                                           const SliceTransform * /*prefix_extractor*/,
+                                           MultiGetContext::Range *mget_range)
+    {
+        if (!table_options_.whole_key_filtering)
+        {
+            return Status::OK();
+        }
+        if (partitioned_filter_ != nullptr)
+        {
+            partitioned_filter_->KeysMayMatch(read_options, mget_range);
+        }
+        else if (filter_ != nullptr)
+        {
+            filter_->MayMatch(mget_range);
+        }
+        return Status::OK();
+    }
+
+    bool BlockBasedTable::SearchDataBlock(const Block &block, const Slice &key,
+                                          GetContext *get_context, Status *s) const
+    {
+        // A value in a block used in place out of the mapping is returned
+        // without a copy, pinning the mapping.
+        const bool pin_values = mmap_ != nullptr && !block.own_bytes();
+        BlockIter biter;
+        block.InitIter(&internal_comparator_, &biter);
+        if (!biter.SeekForGet(key))
+        {
+            // Not found, or corrupted
+            *s = biter.status();
+            return false;
+        }
+        for (; biter.Valid(); biter.Next())
+        {
+            ParsedInternalKey parsed_key;
+            Status pik_status =
+                ParseInternalKey(biter.key(), &parsed_key, false /* log_err_key */);
+            if (!pik_status.ok())
+            {
+                *s = pik_status;
+                return false;
+            }
+            bool matched = false;
+            Cleanable value_pinner;
+            if (pin_values)
+            {
+                value_pinner.RegisterCleanup(
+                    &ReleaseMapping, new std::shared_ptr<const MemMapping>(mmap_),
+                    nullptr);
+            }
+            if (!get_context->SaveValue(parsed_key, biter.value(), &matched, s,
+                                        pin_values ? &value_pinner : nullptr))
+            {
+                // Either the value is complete, or the user key changed.
+                return false;
+            }
+            if (!s->ok())
+            {
+                return false;
+            }
+        }
+        if (!biter.status().ok())
+        {
+            *s = biter.status();
+            return false;
+        }
+        return true;
+    }
+
+    Status BlockBasedTable::LookupFromIndex(const ReadOptions &read_options,
+                                            const Slice &key,
+                                            GetContext *get_context,
+                                            IndexIterator *iiter) const
+    {
+        Status s;
+        bool may_continue = true;
+        for (; may_continue && iiter->Valid(); iiter->Next())
+        {
+            BlockHandle handle;
+            s = DecodeIndexValue(iiter->value(), &handle);
+            std::unique_ptr<Block> block;
+            if (s.ok())
+            {
+                // The block is gone by the next read.
+                s = ReadBlock(read_options, handle, &block, nullptr /* prefetch_buffer */,
+                              BlockType::kData, true /* transient */);
+            }
+            if (s.IsIncomplete())
+            {
+                // Only a read from the block cache was allowed.
+                get_context->MarkKeyMayExist();
+            }
+            if (!s.ok())
+            {
+                return s;
+            }
+            may_continue = SearchDataBlock(*block, key, get_context, &s);
+            if (!s.ok())
+            {
+                return s;
+            }
+        }
+        return iiter->status();
+    }
+
+    Status BlockBasedTable::Get(const ReadOptions &read_options, const Slice &key,
+                                GetContext *get_context,
+                                const SliceTransform * /*prefix_extractor*/,
+                                bool skip_filters)
+    {
+        if (!skip_filters && !FullFilterKeyMayMatch(read_options, key))
+        {
+            return Status::OK();
+        }
+        IndexIterator iiter;
+        iiter.Initialize(this, &read_options);
+        iiter.Seek(key);
+        if (iiter.status().IsIncomplete())
+        {
+            // Only a read from the block cache was allowed.
+            get_context->MarkKeyMayExist();
+        }
+        return LookupFromIndex(read_options, key, get_context, &iiter);
+    }
+
+    void BlockBasedTable::LocateIndexBlocks(
+        const ReadOptions &read_options, MultiGetContext::Range *range,
+        const Block **index_blocks,
+        std::array<std::unique_ptr<Block>, MultiGetContext::MAX_BATCH_SIZE>
+            *partitions) const
+    {
+        if (partition_index_ == nullptr)
+        {
+            for (auto miter = range->begin(); miter != range->end(); ++miter)
+            {
+                index_blocks[miter.index()] = index_block_.get();
+            }
+            return;
+        }
+
+        // Find the partition of every key in the top-level index. The keys are
+        // sorted, so the keys sharing a partition are adjacent.
+        autovector<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> handles;
+        std::array<size_t, MultiGetContext::MAX_BATCH_SIZE> key_partition;
+        BlockIter iiter;
+        index_block_->InitIter(&internal_comparator_, &iiter);
+        for (auto miter = range->begin(); miter != range->end(); ++miter)
+        {
+            iiter.Seek(miter->ikey);
+            BlockHandle handle;
+            Status s = iiter.status();
+            if (iiter.Valid())
+            {
+                s = DecodeIndexValue(iiter.value(), &handle);
+            }
+            else if (s.ok())
+            {
+                // Past the last key of the file
+                range->SkipKey(miter);
+                continue;
+            }
+            if (!s.ok())
+            {
+                *(miter->s) = s;
+                range->SkipKey(miter);
+                continue;
+            }
+            if (handles.empty() || handles.back() != handle)
+            {
+                handles.push_back(handle);
+            }
+            key_partition[miter.index()] = handles.size() - 1;
+        }
+        if (handles.empty())
+        {
+            return;
+        }
+
+        std::array<const Block *, MultiGetContext::MAX_BATCH_SIZE> partition_blocks;
+        Status s = partition_index_->GetPartitions(read_options, &handles[0],
+                                                   handles.size(), partitions->data(),
+                                                   partition_blocks.data());
+        for (auto miter = range->begin(); miter != range->end(); ++miter)
+        {
+            if (!s.ok())
+            {
+                if (s.IsIncomplete())
+                {
+                    // Only a read from the block cache was allowed.
+                    miter->get_context->MarkKeyMayExist();
+                }
+                *(miter->s) = s;
+                range->SkipKey(miter);
+                continue;
+            }
+            index_blocks[miter.index()] = partition_blocks[key_partition[miter.index()]];
+        }
+    }
+
+    uint64_t BlockBasedTable::ApproximateOffsetOf(const ReadOptions &read_options,
+                                                  const Slice &key,
+                                                  TableReaderCaller /*caller*/)
+    {
+        IndexIterator iiter;
+        iiter.Initialize(this, &read_options);
+        iiter.Seek(key);
+        BlockHandle handle;
+        if (iiter.Valid() && DecodeIndexValue(iiter.value(), &handle).ok())
+        {
+            return handle.offset();
+        }
+        // The key is past the last key in the file (or the index is
+        // corrupted). Approximate the offset by returning the offset of the
+        // metaindex block, which is right near the end of the file.
+        return footer_.metaindex_handle().offset();
+    }
+
+    uint64_t BlockBasedTable::ApproximateSize(const ReadOptions &read_options,
+                                              const Slice &start, const Slice &end,
+                                              TableReaderCaller caller)
+    {
+        assert(internal_comparator_.Compare(start, end) <= 0);
+        uint64_t start_offset = ApproximateOffsetOf(read_options, start, caller);
+        uint64_t end_offset = ApproximateOffsetOf(read_options, end, caller);
+        return end_offset >= start_offset ? end_offset - start_offset : 0;
+    }
+
+    size_t BlockBasedTable::ApproximateMemoryUsage() const
+    {
+        size_t usage = sizeof(*this) + index_block_->ApproximateMemoryUsage();
+        usage += filter_contents_.ApproximateMemoryUsage();
+        if (partition_index_ != nullptr)
+        {
+            usage += partition_index_->ApproximateMemoryUsage();
+        }
+        if (partitioned_filter_ != nullptr)
+        {
+            usage += partitioned_filter_->ApproximateMemoryUsage();
+        }
+        return usage;
+    }
+}
+
+// Generate the regular and coroutine versions of the MultiGet functions
+#define WITHOUT_COROUTINES
+#include "table/block_based/block_based_table_reader_sync_and_async.h"
+#undef WITHOUT_COROUTINES
+#define WITH_COROUTINES
+#include "table/block_based/block_based_table_reader_sync_and_async.h"
+#undef WITH_COROUTINES
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "cache/cache_key.h"
+#include "file/random_access_file_reader.h"
+#include "port/mmap.h"
+#include "table/block_based/block.h"
+#include "table/block_based/block_type.h"
+#include "table/block_based/filter_policy_internal.h"
+#include "table/format.h"
+#include "table/multiget_context.h"
+#include "table/table_reader.h"
+#include "util/autovector.h"
+#include "util/coro_utils.h"
+#include "xiaodb/advanced_cache.h"
+#include "xiaodb/table.h"
+#include "xiaodb/table_properties.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class BlockBasedTableIterator;
+    class FilePrefetchBuffer;
+    class IndexIterator;
+    class ParallelChecksumVerifier;
+    class PartitionIndexReader;
+    class PartitionedFilterBlockReader;
+
+    // Reader class for BlockBasedTable format.
+    // For the format of BlockBasedTable refer to
+    // https://github.com/facebook/rocksdb/wiki/Rocksdb-BlockBasedTable-Format.
+    // This is the default table type. Data is chucked into fixed size blocks and
+    // each block in-turn stores entries. When storing data, we can compress and/or
+    // encode data efficiently within a block, which often results in a much
+    // smaller data size compared with the raw data size. As for the record
+    // retrieval, we'll first locate the block where target record may reside,
+    // then read the block to memory, and finally search that record within the
+    // block.
+    //
+    // The index block (one entry per data block, keyed by an internal key
+    // separating it from the next block, with the encoded BlockHandle as value)
+    // and the whole-key filter, if any, are read at Open() and pinned for the
+    // lifetime of the reader. Data blocks are read on demand.
+    //
+    // With kTwoLevelIndexSearch, the index block is the top-level index over
+    // index partitions (see PartitionIndexReader), and the filter may likewise
+    // be partitioned (see PartitionedFilterBlockReader). Only the top levels
+    // are read at Open(), unless the partitions are to be pinned, so that
+    // large files open quickly; the partitions a MultiGet() batch needs are
+    // read together.
+    //
+    // With use_mmap_reads, the blocks are decoded in place out of a mapping
+    // of the file, and the values Get() returns keep the mapping alive.
+    //
+    // The data blocks of a table compressed with a dictionary (see
+    // CompressionDictTrainer) are uncompressed with the dictionary stored in
+    // its kCompressionDictBlockName meta block, which is read at Open(). The
+    // digested dictionary is shared with the other tables of the same
+    // dictionary version.
+    //
+    // MultiGet() locates the data blocks of all the keys of a batch up front,
+    // then fetches them with one MultiRead, so the reads of a batch are in
+    // flight together. The coroutine version (MultiGetCoroutine) issues the
+    // same requests through the batch's AsyncFileReader and suspends until
+    // they complete, letting the executor run the lookups of other files in
+    // the meantime. The checksums of the blocks of such multi-block reads
+    // may be verified on a pool of threads (see ParallelChecksumVerifier).
+    //
+    // With cache_compressed_blocks, the data blocks read are kept in the
+    // block cache as they are stored in the file (see CachedDataBlock), and
+    // looked up there before any read.
+    class BlockBasedTable : public TableReader
+    {
+    public:
+        static const std::string kFullFilterBlockPrefix;
+        static const std::string kPartitionedFilterBlockPrefix;
+        static const std::string kCompressionDictBlockName;
+
+        // Attempt to open the table that is stored in bytes [0..file_size)
+        // of "file", and read the metadata entries necessary to allow
+        // retrieving data from the table.
+        //
+        // If successful, returns ok and sets "*table_reader" to the newly opened
+        // table.  The client should delete "*table_reader" when no longer needed.
+        // If there was an error while initializing the table, sets "*table_reader"
+        // to nullptr and returns a non-ok status.
+        //
+        // internal_comparator must outlive the reader. fs, if given, is the
+        // file system of file; the iterators need it to read ahead
+        // asynchronously (ReadOptions::async_io).
+        static Status Open(const ReadOptions &ro,
+                           const BlockBasedTableOptions &table_options,
+                           const InternalKeyComparator &internal_comparator,
+                           std::unique_ptr<RandomAccessFileReader> &&file,
+                           uint64_t file_size,
+                           std::unique_ptr<TableReader> *table_reader,
+                           FileSystem *fs = nullptr);
+
+        ~BlockBasedTable() override;
+
+        // Returns a new iterator over the table contents.
+        // The result of NewIterator() is initially invalid (caller must
+        // call one of the Seek methods on the iterator before using it).
+        // @param read_options Must outlive the returned iterator.
+        // @param skip_filters Disables loading/accessing the filter block
+        // compaction_readahead_size: its value will only be used if caller =
+        // kCompaction.
+        InternalIterator *NewIterator(const ReadOptions &,
+                                      const SliceTransform *prefix_extractor,
+                                      Arena *arena, bool skip_filters,
+                                      TableReaderCaller caller,
+                                      size_t compaction_readahead_size = 0,
+                                      bool allow_unprepared_value = false) override;
+
+        Status Get(const ReadOptions &readOptions, const Slice &key,
+                   GetContext *get_context, const SliceTransform *prefix_extractor,
+                   bool skip_filters = false) override;
+
+        Status MultiGetFilter(const ReadOptions &read_options,
+                              const SliceTransform *prefix_extractor,
+                              MultiGetContext::Range *mget_range) override;
+
+        DECLARE_SYNC_AND_ASYNC_OVERRIDE(void, MultiGet,
+                                        const ReadOptions &readOptions,
+                                        const MultiGetContext::Range *mget_range,
+                                        const SliceTransform *prefix_extractor,
+                                        bool skip_filters = false);
+
+        // Given a key, return an approximate byte offset in the file where
+        // the data for that key begins (or would begin if the key were
+        // present in the file).  The returned value is in terms of file
+        // bytes, and so includes effects like compression of the underlying data.
+        // E.g., the approximate offset of the last key in the table will
+        // be close to the file length.
+        uint64_t ApproximateOffsetOf(const ReadOptions &read_options,
+                                     const Slice &key,
+                                     TableReaderCaller caller) override;
+
+        // Given start and end keys, return the approximate data size in the file
+        // between the keys. The returned value is in terms of file bytes, and so
+        // includes effects like compression of the underlying data.
+        // The start key must not be greater than the end key.
+        uint64_t ApproximateSize(const ReadOptions &read_options, const Slice &start,
+                                 const Slice &end, TableReaderCaller caller) override;
+
+        void SetupForCompaction() override {}
+
+        std::shared_ptr<const TableProperties> GetTableProperties() const override
+        {
+            return table_properties_;
+        }
+
+        size_t ApproximateMemoryUsage() const override;
+
+        // Reads the block at handle synchronously, out of prefetch_buffer if
+        // given. Only data blocks are compressed with the dictionary of the
+        // table, if any, and kept in the block cache. If transient, the caller
+        // drops the block before reading another on the same thread, so that
+        // a block uncompressed out of the block cache may use the scratch
+        // buffer of the thread (see ScratchAllocator).
+        Status ReadBlock(const ReadOptions &read_options, const BlockHandle &handle,
+                         std::unique_ptr<Block> *block,
+                         FilePrefetchBuffer *prefetch_buffer = nullptr,
+                         BlockType block_type = BlockType::kData,
+                         bool transient = false) const;
+
+        // Reads the n blocks at handles, which must be in file order, with a
+        // single MultiRead in which adjacent blocks are merged into one
+        // request (see TryMerge()), and sets contents[i] for handles[i]. Fails
+        // as a whole if any of the blocks cannot be read.
+        Status RetrieveBlocks(const ReadOptions &read_options,
+                              const BlockHandle *handles, size_t n,
+                              BlockContents *contents) const;
+
+        const InternalKeyComparator &internal_comparator() const
+        {
+            return internal_comparator_;
+        }
+
+        const BlockBasedTableOptions &table_options() const { return table_options_; }
+
+        // nullptr if not given to Open().
+        FileSystem *file_system() const { return fs_; }
+
+        // Whether the reads are served out of a mapping of the file (see
+        // BlockBasedTableOptions::use_mmap_reads).
+        bool mmap_reads() const { return mmap_ != nullptr; }
+
+        // Hints the kernel about the accesses to a range of the mapped file.
+        void AdviseMapped(MemMapping::Advice advice, uint64_t offset,
+                          size_t length) const
+        {
+            assert(mmap_ != nullptr);
+            mmap_->Advise(advice, static_cast<size_t>(offset), length);
+        }
+
+        // The index block, or the top-level index with a two-level index.
+        const Block &index_block() const { return *index_block_; }
+
+        // nullptr unless the table has a two-level index.
+        const PartitionIndexReader *partition_index() const
+        {
+            return partition_index_.get();
+        }
+
+        // The index block value for a data block is its encoded BlockHandle.
+        static Status DecodeIndexValue(const Slice &value, BlockHandle *handle)
+        {
+            Slice input = value;
+            return handle->DecodeFrom(&input);
+        }
+
+    private:
+        BlockBasedTable(const BlockBasedTableOptions &table_options,
+                        const InternalKeyComparator &internal_comparator,
+                        std::unique_ptr<RandomAccessFileReader> &&file,
+                        FileSystem *fs);
+
+        // Decodes the block at handle in place out of the mapping of the
+        // file, uncompressing it with dict if given.
+        Status ReadMappedBlock(const ReadOptions &read_options,
+                               const BlockHandle &handle, BlockContents *contents,
+                               const UncompressionDict *dict) const;
+
+        // The dictionary to uncompress the blocks of block_type with, or
+        // nullptr.
+        const UncompressionDict *DictFor(BlockType block_type) const
+        {
+            return block_type == BlockType::kData ? uncompression_dict_.get()
+                                                  : nullptr;
+        }
+
+        // Looks up the data block at handle in the block cache. Returns true
+        // on a hit, with *block set, or *s if it cannot be uncompressed.
+        bool LookupCachedDataBlock(const BlockHandle &handle, bool transient,
+                                   std::unique_ptr<Block> *block, Status *s) const;
+
+        // Reads the data block at handle, out of prefetch_buffer if given,
+        // and turns it into *block through the block cache.
+        Status ReadAndCacheDataBlock(const ReadOptions &read_options,
+                                     const IOOptions &opts, const BlockHandle &handle,
+                                     FilePrefetchBuffer *prefetch_buffer,
+                                     bool transient,
+                                     std::unique_ptr<Block> *block) const;
+
+        // Inserts the data block at handle, serialized (payload and trailer,
+        // with the checksum verified as needed) into the block cache as it
+        // is, and sets *block to its uncompressed contents.
+        Status InsertCachedDataBlock(const BlockHandle &handle,
+                                     CacheAllocationPtr &&serialized, bool transient,
+                                     std::unique_ptr<Block> *block) const;
+
+        // Sets *block to the contents of the cache entry of cache_handle,
+        // which it takes over: an uncompressed block pins the entry, a
+        // compressed one is uncompressed, and promoted if the hit is counted
+        // and the one to promote it.
+        Status BlockFromCacheHandle(const CacheKey &key, Cache::Handle *cache_handle,
+                                    bool count_hit, bool transient,
+                                    std::unique_ptr<Block> *block) const;
+
+        // Whole-key filter check for Get(). Returns true if the key may be in
+        // the table.
+        bool FullFilterKeyMayMatch(const ReadOptions &read_options,
+                                   const Slice &internal_key) const;
+
+        // Searches the data blocks starting with the one iiter points at for
+        // key, feeding entries to get_context until it has its answer.
+        Status LookupFromIndex(const ReadOptions &read_options, const Slice &key,
+                               GetContext *get_context, IndexIterator *iiter) const;
+
+        // Sets index_blocks[i] to the index block to look up the ith key of
+        // range in: the index block itself, or the key's index partition,
+        // reading all the partitions the keys need and do not have pinned
+        // together into partitions. Keys that cannot be looked up are skipped,
+        // with their status set unless they are past the end of the table.
+        void LocateIndexBlocks(
+            const ReadOptions &read_options, MultiGetContext::Range *range,
+            const Block **index_blocks,
+            std::array<std::unique_ptr<Block>, MultiGetContext::MAX_BATCH_SIZE>
+                *partitions) const;
+
+        // Feeds the entries of block at and past key to get_context. Returns
+        // true if the entries for the user key may continue in the next
+        // block, false when the lookup is complete (or *s is not ok).
+        bool SearchDataBlock(const Block &block, const Slice &key,
+                             GetContext *get_context, Status *s) const;
+
+        // Verifies the checksums of the n blocks read at data[i] for handles[i]
+        // on the checksum verification threads, setting statuses[i], if the
+        // read verifies checksums and is worth it. Returns false, with
+        // statuses untouched, if the blocks are to be verified inline.
+        bool VerifyBlocksInParallel(const ReadOptions &read_options, size_t n,
+                                    const char *const *data,
+                                    const BlockHandle *handles,
+                                    Status *statuses) const;
+
+        // Reads the data blocks at handles, issuing all the reads at once, and
+        // sets blocks[i] or statuses[i] for handles[i].
+        DECLARE_SYNC_AND_ASYNC_CONST(
+            void, RetrieveMultipleBlocks, const ReadOptions &options,
+            const MultiGetContext::Range *batch,
+            const autovector<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> *handles,
+            Status *statuses, std::unique_ptr<Block> *blocks);
+
+        const BlockBasedTableOptions table_options_;
+        const InternalKeyComparator &internal_comparator_;
+        std::unique_ptr<RandomAccessFileReader> file_;
+        FileSystem *fs_;
+        // The whole file, mapped read-only, with use_mmap_reads. Shared with
+        // the values Get() pins in it.
+        std::shared_ptr<const MemMapping> mmap_;
+        Footer footer_;
+        std::unique_ptr<Block> index_block_;
+        std::unique_ptr<PartitionIndexReader> partition_index_;
+        // The filter bits reader points into filter_contents_.
+        BlockContents filter_contents_;
+        std::unique_ptr<FilterBitsReader> filter_;
+        std::unique_ptr<PartitionedFilterBlockReader> partitioned_filter_;
+        // The dictionary of the data blocks, if any.
+        std::unique_ptr<UncompressionDict> uncompression_dict_;
+        std::shared_ptr<const TableProperties> table_properties_;
+        // With checksum_verification_threads, the shared pool.
+        ParallelChecksumVerifier *checksum_verifier_ = nullptr;
+        // With cache_compressed_blocks, the cache of the data blocks, and the
+        // key their offsets make theirs from.
+        Cache *block_cache_ = nullptr;
+        OffsetableCacheKey base_cache_key_;
+    };
+}
@@ -0,0 +1,315 @@
+#include "table/block_based/index_iterator.h"
+#include "util/async_file_reader.h"
+#include "util/coro_utils.h"
+
+#if defined(WITHOUT_COROUTINES) || \
+    (defined(USE_COROUTINES) && defined(WITH_COROUTINES))
+
+namespace XIAODB_NAMESPACE
+{
+    // This function reads multiple data blocks from disk using Env::MultiRead()
+    // and stores them in blocks. The coroutine version goes through the
+    // batch's AsyncFileReader instead, which issues a ReadAsync() per block and
+    // resumes this coroutine once they have all completed.
+    DEFINE_SYNC_AND_ASYNC(void, BlockBasedTable::RetrieveMultipleBlocks)
+    (const ReadOptions &options, const MultiGetContext::Range *batch,
+     const autovector<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> *handles,
+     Status *statuses, std::unique_ptr<Block> *blocks) const
+    {
+        (void)batch;
+        const size_t num_blocks = handles->size();
+        if (mmap_ != nullptr)
+        {
+            // The blocks are used in place: there is no IO to batch.
+            for (size_t i = 0; i < num_blocks; ++i)
+            {
+                statuses[i] = ReadBlock(options, (*handles)[i], &blocks[i]);
+            }
+            CO_RETURN;
+        }
+
+        // Only the blocks the block cache does not have are read, with
+        // read_reqs[j] for the block to_read[j].
+        std::array<size_t, MultiGetContext::MAX_BATCH_SIZE> to_read;
+        size_t num_to_read = 0;
+        for (size_t i = 0; i < num_blocks; ++i)
+        {
+            if (block_cache_ != nullptr &&
+                LookupCachedDataBlock((*handles)[i], false /* transient */, &blocks[i],
+                                      &statuses[i]))
+            {
+                continue;
+            }
+            if (options.read_tier == kBlockCacheTier)
+            {
+                statuses[i] = Status::Incomplete("no blocking io");
+                continue;
+            }
+            to_read[num_to_read++] = i;
+        }
+        if (num_to_read == 0)
+        {
+            CO_RETURN;
+        }
+
+        MemoryAllocator *allocator = GetMemoryAllocator(table_options_);
+        IOOptions opts;
+        IOStatus s = file_->PrepareIOOptions(options, opts);
+        if (!s.ok())
+        {
+            for (size_t j = 0; j < num_to_read; ++j)
+            {
+                statuses[to_read[j]] = s;
+            }
+            CO_RETURN;
+        }
+
+        // Every block gets a buffer of its own, so that an uncompressed block
+        // can keep it without a copy.
+        std::array<CacheAllocationPtr, MultiGetContext::MAX_BATCH_SIZE> bufs;
+        autovector<FSReadRequest, MultiGetContext::MAX_BATCH_SIZE> read_reqs;
+        for (size_t j = 0; j < num_to_read; ++j)
+        {
+            const BlockHandle &handle = (*handles)[to_read[j]];
+            FSReadRequest req;
+            req.offset = handle.offset();
+            req.len = static_cast<size_t>(BlockSizeWithTrailer(handle));
+            bufs[j] = AllocateBlock(req.len, allocator);
+            req.scratch = bufs[j].get();
+            read_reqs.emplace_back(std::move(req));
+        }
+
+        AlignedBuf direct_io_buf;
+        {
+#if defined(WITH_COROUTINES)
+            if (file_->use_direct_io())
+            {
+#endif // WITH_COROUTINES
+                s = file_->MultiRead(opts, &read_reqs[0], read_reqs.size(),
+                                     file_->use_direct_io() ? &direct_io_buf
+                                                            : nullptr);
+#if defined(WITH_COROUTINES)
+            }
+            else
+            {
+                co_await batch->context()->reader().MultiReadAsync(
+                    file_.get(), opts, &read_reqs[0], read_reqs.size(), nullptr);
+            }
+#endif // WITH_COROUTINES
+        }
+
+        // Check the reads first, so that the checksums of the blocks read
+        // whole can be verified together.
+        std::array<const char *, MultiGetContext::MAX_BATCH_SIZE> block_data;
+        std::array<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> block_handles;
+        std::array<size_t, MultiGetContext::MAX_BATCH_SIZE> block_index;
+        size_t num_read = 0;
+        for (size_t j = 0; j < num_to_read; ++j)
+        {
+            const size_t i = to_read[j];
+            FSReadRequest &req = read_reqs[j];
+            if (!s.ok())
+            {
+                statuses[i] = s;
+                continue;
+            }
+            if (!req.status.ok())
+            {
+                statuses[i] = req.status;
+                continue;
+            }
+            if (req.result.size() != req.len)
+            {
+                statuses[i] = Status::Corruption(
+                    "truncated block read from " + file_->file_name() + " offset " +
+                    std::to_string(req.offset) + ", expected " +
+                    std::to_string(req.len) + " bytes, got " +
+                    std::to_string(req.result.size()));
+                continue;
+            }
+            block_data[num_read] = req.result.data();
+            block_handles[num_read] = (*handles)[i];
+            block_index[num_read] = j;
+            ++num_read;
+        }
+        std::array<Status, MultiGetContext::MAX_BATCH_SIZE> checksum_statuses;
+        const bool verified =
+            VerifyBlocksInParallel(options, num_read, block_data.data(),
+                                   block_handles.data(), checksum_statuses.data());
+
+        for (size_t k = 0; k < num_read; ++k)
+        {
+            const size_t j = block_index[k];
+            const size_t i = to_read[j];
+            FSReadRequest &req = read_reqs[j];
+            if (verified && !checksum_statuses[k].ok())
+            {
+                statuses[i] = checksum_statuses[k];
+                continue;
+            }
+            // With direct IO or a file system supplied buffer, the result is
+            // not in our buffer, and the block gets copied out.
+            CacheAllocationPtr buf;
+            if (req.result.data() == bufs[j].get())
+            {
+                buf = std::move(bufs[j]);
+            }
+            if (block_cache_ != nullptr && options.fill_cache)
+            {
+                if (options.verify_checksums && !verified)
+                {
+                    statuses[i] = VerifyBlockCheckSum(
+                        footer_, req.result.data(), static_cast<size_t>((*handles)[i].size()),
+                        file_->file_name(), req.offset);
+                    if (!statuses[i].ok())
+                    {
+                        continue;
+                    }
+                }
+                if (!buf)
+                {
+                    buf = AllocateAndCopyBlock(req.result, allocator);
+                }
+                statuses[i] = InsertCachedDataBlock((*handles)[i], std::move(buf),
+                                                    false /* transient */, &blocks[i]);
+                continue;
+            }
+            BlockContents contents;
+            statuses[i] = DecodeSerializedBlock(
+                footer_, std::move(buf), req.result.data(), (*handles)[i],
+                options.verify_checksums && !verified, file_->file_name(), &contents,
+                allocator, false /* data_is_pinned */, DictFor(BlockType::kData));
+            if (statuses[i].ok())
+            {
+                blocks[i].reset(new Block(std::move(contents)));
+            }
+        }
+    }
+
+    // Batched version of TableReader::MultiGet.
+    DEFINE_SYNC_AND_ASYNC(void, BlockBasedTable::MultiGet)
+    (const ReadOptions &read_options, const MultiGetContext::Range *mget_range,
+     const SliceTransform *prefix_extractor, bool skip_filters)
+    {
+        if (mget_range->empty())
+        {
+            // Caller should ensure non-empty (performance bug)
+            assert(false);
+            CO_RETURN; // Nothing to do
+        }
+
+        MultiGetContext::Range sst_file_range(*mget_range, mget_range->begin(),
+                                              mget_range->end());
+        if (!skip_filters)
+        {
+            MultiGetFilter(read_options, prefix_extractor, &sst_file_range)
+                .PermitUncheckedError();
+        }
+        if (sst_file_range.empty())
+        {
+            CO_RETURN;
+        }
+
+        // Find the data block of every key. The keys are sorted, so the keys
+        // sharing a block are adjacent and the block is read only once.
+        autovector<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> block_handles;
+        std::array<size_t, MultiGetContext::MAX_BATCH_SIZE> key_block;
+        {
+            // With a two-level index, the index partitions of all the keys are
+            // read first, together.
+            std::array<const Block *, MultiGetContext::MAX_BATCH_SIZE> index_blocks;
+            std::array<std::unique_ptr<Block>, MultiGetContext::MAX_BATCH_SIZE>
+                partitions;
+            LocateIndexBlocks(read_options, &sst_file_range, index_blocks.data(),
+                              &partitions);
+            BlockIter iiter;
+            const Block *index_block = nullptr;
+            for (auto miter = sst_file_range.begin(); miter != sst_file_range.end();
+                 ++miter)
+            {
+                if (index_blocks[miter.index()] != index_block)
+                {
+                    index_block = index_blocks[miter.index()];
+                    index_block->InitIter(&internal_comparator_, &iiter);
+                }
+                iiter.Seek(miter->ikey);
+                BlockHandle handle;
+                Status s = iiter.status();
+                if (iiter.Valid())
+                {
+                    s = DecodeIndexValue(iiter.value(), &handle);
+                }
+                else if (s.ok())
+                {
+                    // Past the last key of the file
+                    sst_file_range.SkipKey(miter);
+                    continue;
+                }
+                if (!s.ok())
+                {
+                    *(miter->s) = s;
+                    sst_file_range.SkipKey(miter);
+                    continue;
+                }
+                if (read_options.read_tier == kBlockCacheTier && block_cache_ == nullptr)
+                {
+                    // There is no block cache to serve the block from.
+                    miter->get_context->MarkKeyMayExist();
+                    *(miter->s) = Status::Incomplete("no blocking io");
+                    sst_file_range.SkipKey(miter);
+                    continue;
+                }
+                if (block_handles.empty() || block_handles.back() != handle)
+                {
+                    block_handles.push_back(handle);
+                }
+                key_block[miter.index()] = block_handles.size() - 1;
+            }
+        }
+        if (block_handles.empty())
+        {
+            CO_RETURN;
+        }
+
+        std::array<Status, MultiGetContext::MAX_BATCH_SIZE> statuses;
+        std::array<std::unique_ptr<Block>, MultiGetContext::MAX_BATCH_SIZE> blocks;
+        CO_AWAIT(RetrieveMultipleBlocks)
+        (read_options, &sst_file_range, &block_handles, statuses.data(),
+         blocks.data());
+
+        for (auto miter = sst_file_range.begin(); miter != sst_file_range.end();
+             ++miter)
+        {
+            const size_t idx = key_block[miter.index()];
+            Status s = statuses[idx];
+            if (s.IsIncomplete())
+            {
+                // The block cache does not have the block.
+                miter->get_context->MarkKeyMayExist();
+            }
+            if (s.ok() &&
+                SearchDataBlock(*blocks[idx], miter->ikey, miter->get_context, &s) &&
+                s.ok())
+            {
+                // The entries of the user key run past the end of the block, so
+                // the lookup continues in the following blocks. This is rare
+                // enough that it is done synchronously, one block at a time.
+                IndexIterator iiter;
+                iiter.Initialize(this, &read_options);
+                iiter.Seek(miter->ikey);
+                if (iiter.Valid())
+                {
+                    iiter.Next();
+                    s = LookupFromIndex(read_options, miter->ikey, miter->get_context,
+                                        &iiter);
+                }
+                else
+                {
+                    s = iiter.status();
+                }
+            }
+            *(miter->s) = s;
+        }
+    }
+}
+#endif
@@ -0,0 +1,209 @@
+#include "table/block_based/block_builder.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "db/dbformat.h"
+#include "table/block_based/data_block_footer.h"
+#include "table/block_based/restart_key_prefixes.h"
+#include "util/coding.h"
+
+namespace XIAODB_NAMESPACE
+{
+    BlockBuilder::BlockBuilder(
+        int block_restart_interval, bool use_delta_encoding,
+        BlockBasedTableOptions::DataBlockIndexType index_type,
+        double data_block_hash_table_util_ratio, bool restart_key_prefixes)
+        : block_restart_interval_(block_restart_interval),
+          use_delta_encoding_(use_delta_encoding),
+          restart_key_prefixes_(restart_key_prefixes),
+          restarts_(1, 0), // First restart point is at offset 0
+          counter_(0),
+          finished_(false)
+    {
+        switch (index_type)
+        {
+        case BlockBasedTableOptions::kDataBlockBinarySearch:
+            break;
+        case BlockBasedTableOptions::kDataBlockBinaryAndHash:
+            data_block_hash_index_builder_.Initialize(
+                data_block_hash_table_util_ratio);
+            break;
+        default:
+            assert(0);
+        }
+        assert(block_restart_interval_ >= 1);
+        estimate_ = sizeof(uint32_t) + sizeof(uint32_t);
+        if (restart_key_prefixes_)
+        {
+            estimate_ += kRestartKeyPrefixSize + sizeof(uint32_t);
+        }
+    }
+
+    void BlockBuilder::Reset()
+    {
+        buffer_.clear();
+        restarts_.resize(1); // First restart point is at offset 0
+        assert(restarts_[0] == 0);
+        estimate_ = sizeof(uint32_t) + sizeof(uint32_t);
+        if (restart_key_prefixes_)
+        {
+            estimate_ += kRestartKeyPrefixSize + sizeof(uint32_t);
+        }
+        counter_ = 0;
+        finished_ = false;
+        last_key_.clear();
+        if (data_block_hash_index_builder_.Valid())
+        {
+            data_block_hash_index_builder_.Reset();
+        }
+    }
+
+    size_t BlockBuilder::EstimateSizeAfterKV(const Slice &key,
+                                             const Slice &value) const
+    {
+        size_t estimate = CurrentSizeEstimate();
+        // Note: this is an imprecise estimate as it accounts for the whole key size
+        // instead of non-shared key size.
+        estimate += key.size() + value.size();
+        if (counter_ >= block_restart_interval_)
+        {
+            estimate += sizeof(uint32_t); // a new restart entry.
+            if (restart_key_prefixes_)
+            {
+                estimate += kRestartKeyPrefixSize;
+            }
+        }
+
+        estimate += sizeof(int32_t); // varint for shared prefix length.
+        // Note: this is an imprecise estimate as we will have to encoded size, one
+        // for shared key and one for non-shared key.
+        estimate += VarintLength(key.size()); // varint for key length.
+        estimate += VarintLength(value.size()); // varint for value length.
+
+        return estimate;
+    }
+
+    bool BlockBuilder::AppendRestartKeyPrefixes()
+    {
+        if (buffer_.empty())
+        {
+            return false;
+        }
+        // Restart entries store their whole key, so the restart keys are read
+        // back from the block rather than kept aside while building it.
+        const char *limit = buffer_.data() + buffer_.size();
+        auto restart_user_key = [&](uint32_t offset)
+        {
+            uint32_t shared, non_shared, value_length;
+            const char *p = buffer_.data() + offset;
+            p = GetVarint32Ptr(p, limit, &shared);
+            p = GetVarint32Ptr(p, limit, &non_shared);
+            p = GetVarint32Ptr(p, limit, &value_length);
+            assert(p != nullptr && shared == 0);
+            return ExtractUserKey(Slice(p, non_shared));
+        };
+
+        const Slice first = restart_user_key(restarts_.front());
+        const Slice last = restart_user_key(restarts_.back());
+        const size_t min_length = std::min(first.size(), last.size());
+        size_t prefix_offset = 0;
+        while (prefix_offset < min_length &&
+               first[prefix_offset] == last[prefix_offset])
+        {
+            prefix_offset++;
+        }
+        for (uint32_t restart : restarts_)
+        {
+            PutFixed64(&buffer_, EncodeRestartKeyPrefix(restart_user_key(restart),
+                                                        prefix_offset));
+            // buffer_ may have been reallocated
+            limit = buffer_.data() + buffer_.size();
+        }
+        PutFixed32(&buffer_, static_cast<uint32_t>(prefix_offset));
+        return true;
+    }
+
+    Slice BlockBuilder::Finish()
+    {
+        // Append restart array
+        for (size_t i = 0; i < restarts_.size(); i++)
+        {
+            PutFixed32(&buffer_, restarts_[i]);
+        }
+
+        uint32_t num_restarts = static_cast<uint32_t>(restarts_.size());
+        BlockBasedTableOptions::DataBlockIndexType index_type =
+            BlockBasedTableOptions::kDataBlockBinarySearch;
+        if (data_block_hash_index_builder_.Valid() &&
+            CurrentSizeEstimate() <= kMaxBlockSizeSupportedByHashIndex)
+        {
+            data_block_hash_index_builder_.Finish(buffer_);
+            index_type = BlockBasedTableOptions::kDataBlockBinaryAndHash;
+        }
+        const bool restart_key_prefixes =
+            restart_key_prefixes_ && AppendRestartKeyPrefixes();
+
+        // footer is a packed format of data_block_index_type, the restart key
+        // prefix flag and num_restarts
+        uint32_t block_footer = PackIndexTypeAndNumRestarts(
+            index_type, restart_key_prefixes, num_restarts);
+
+        PutFixed32(&buffer_, block_footer);
+        finished_ = true;
+        return Slice(buffer_);
+    }
+
+    void BlockBuilder::Add(const Slice &key, const Slice &value)
+    {
+        assert(!finished_);
+        assert(counter_ <= block_restart_interval_);
+        const size_t buffer_size = buffer_.size();
+
+        size_t shared = 0; // number of bytes shared with prev key
+        if (counter_ >= block_restart_interval_)
+        {
+            // Restart compression
+            restarts_.push_back(static_cast<uint32_t>(buffer_size));
+            estimate_ += sizeof(uint32_t);
+            if (restart_key_prefixes_)
+            {
+                estimate_ += kRestartKeyPrefixSize;
+            }
+            counter_ = 0;
+        }
+        else if (use_delta_encoding_)
+        {
+            // See how much sharing to do with previous string
+            const Slice last_key(last_key_);
+            const size_t min_length = std::min(last_key.size(), key.size());
+            while (shared < min_length && last_key[shared] == key[shared])
+            {
+                shared++;
+            }
+        }
+        const size_t non_shared = key.size() - shared;
+
+        // Add "<shared><non_shared><value_size>" to buffer_
+        PutVarint32Varint32Varint32(&buffer_, static_cast<uint32_t>(shared),
+                                    static_cast<uint32_t>(non_shared),
+                                    static_cast<uint32_t>(value.size()));
+
+        // Add string delta to buffer_ followed by value
+        buffer_.append(key.data() + shared, non_shared);
+        buffer_.append(value.data(), value.size());
+
+        if (data_block_hash_index_builder_.Valid())
+        {
+            data_block_hash_index_builder_.Add(ExtractUserKey(key),
+                                               restarts_.size() - 1);
+        }
+
+        if (use_delta_encoding_)
+        {
+            last_key_.assign(key.data(), key.size());
+        }
+        counter_++;
+        estimate_ += buffer_.size() - buffer_size;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "table/block_based/data_block_hash_index.h"
+#include "xiaodb/slice.h"
+#include "xiaodb/table.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // BlockBuilder generates blocks where keys are prefix-compressed:
+    //
+    // When we store a key, we drop the prefix shared with the previous
+    // string.  This helps reduce the space requirement significantly.
+    // Furthermore, once every K keys, we do not apply the prefix
+    // compression and store the entire key.  We call this a "restart
+    // point".  The tail end of the block stores the offsets of all of the
+    // restart points, and can be used to do a binary search when looking
+    // for a particular key.  Values are stored as-is (without compression)
+    // immediately following the corresponding key.
+    //
+    // An entry for a particular key-value pair has the form:
+    //     shared_bytes: varint32
+    //     unshared_bytes: varint32
+    //     value_length: varint32
+    //     key_delta: char[unshared_bytes]
+    //     value: char[value_length]
+    // shared_bytes == 0 for restart points.
+    //
+    // The trailer of the block has the form:
+    //     restarts: uint32[num_restarts]
+    //     num_restarts: uint32
+    // restarts[i] contains the offset within the block of the ith restart point.
+    //
+    // Data blocks of internal keys may carry a DataBlockHashIndex and a
+    // restart key prefix array between the restart array and num_restarts,
+    // whose high bits then flag them (see data_block_footer.h).
+    class BlockBuilder
+    {
+    public:
+        BlockBuilder(const BlockBuilder &) = delete;
+        void operator=(const BlockBuilder &) = delete;
+
+        // index_type, data_block_hash_table_util_ratio and restart_key_prefixes
+        // only apply to blocks of internal keys. restart_key_prefixes
+        // requires a bytewise user comparator.
+        explicit BlockBuilder(
+            int block_restart_interval, bool use_delta_encoding = true,
+            BlockBasedTableOptions::DataBlockIndexType index_type =
+                BlockBasedTableOptions::kDataBlockBinarySearch,
+            double data_block_hash_table_util_ratio = 0.75,
+            bool restart_key_prefixes = false);
+
+        // Reset the contents as if the BlockBuilder was just constructed.
+        void Reset();
+
+        // REQUIRES: Finish() has not been called since the last call to Reset().
+        // REQUIRES: key is larger than any previously added key
+        void Add(const Slice &key, const Slice &value);
+
+        // Finish building the block and return a slice that refers to the
+        // block contents.  The returned slice will remain valid for the
+        // lifetime of this builder or until Reset() is called.
+        Slice Finish();
+
+        // Returns an estimate of the current (uncompressed) size of the block
+        // we are building.
+        inline size_t CurrentSizeEstimate() const
+        {
+            return estimate_ + (data_block_hash_index_builder_.Valid()
+                                    ? data_block_hash_index_builder_.EstimateSize()
+                                    : 0);
+        }
+
+        // Returns an estimated block size after appending key and value.
+        size_t EstimateSizeAfterKV(const Slice &key, const Slice &value) const;
+
+        // Return true iff no entries have been added since the last Reset()
+        bool empty() const { return buffer_.empty(); }
+
+    private:
+        // Appends the restart key prefix array and its prefix offset. Returns
+        // false, appending nothing, if the block is empty.
+        bool AppendRestartKeyPrefixes();
+
+        const int block_restart_interval_;
+        const bool use_delta_encoding_;
+        const bool restart_key_prefixes_;
+
+        std::string buffer_;             // Destination buffer
+        std::vector<uint32_t> restarts_; // Restart points
+        size_t estimate_;
+        int counter_;   // Number of entries emitted since restart
+        bool finished_; // Has Finish() been called?
+        std::string last_key_;
+        DataBlockHashIndexBuilder data_block_hash_index_builder_;
+    };
+}
@@ -0,0 +1,52 @@
+#include "table/block_based/cached_data_block.h"
+
+#include <cassert>
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        void DeleteCachedDataBlock(Cache::ObjectPtr obj,
+                                   MemoryAllocator * /*allocator*/)
+        {
+            delete static_cast<CachedDataBlock *>(obj);
+        }
+    }
+
+    const Cache::CacheItemHelper CachedDataBlock::kHelper{
+        CacheEntryRole::kDataBlock, &DeleteCachedDataBlock};
+
+    ScratchAllocator *ScratchAllocator::ThisThread()
+    {
+        static thread_local ScratchAllocator allocator;
+        return &allocator;
+    }
+
+    void *ScratchAllocator::Allocate(size_t size)
+    {
+        if (in_use_ || size > kMaxScratchSize)
+        {
+            return new char[size];
+        }
+        if (size > capacity_)
+        {
+            buf_.reset(new char[size]);
+            capacity_ = size;
+        }
+        in_use_ = true;
+        return buf_.get();
+    }
+
+    void ScratchAllocator::Deallocate(void *p)
+    {
+        if (p == buf_.get())
+        {
+            assert(in_use_);
+            in_use_ = false;
+        }
+        else
+        {
+            delete[] static_cast<char *>(p);
+        }
+    }
+}
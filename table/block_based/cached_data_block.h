@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "table/format.h"
+#include "xiaodb/advanced_cache.h"
+#include "xiaodb/compression_type.h"
+#include "xiaodb/memory_allocator.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // A data block in the block cache, with
+    // BlockBasedTableOptions::cache_compressed_blocks: the payload of the
+    // block as read from the file, compressed or not, until a compressed
+    // block has been hit often enough to be promoted to its uncompressed
+    // contents. Either way it is charged at the size of what it holds.
+    class CachedDataBlock
+    {
+    public:
+        static const Cache::CacheItemHelper kHelper;
+
+        // type is the compression of contents, kNoCompression once promoted.
+        CachedDataBlock(BlockContents &&contents, CompressionType type)
+            : contents_(std::move(contents)), type_(type) {}
+
+        CachedDataBlock(const CachedDataBlock &) = delete;
+        void operator=(const CachedDataBlock &) = delete;
+
+        const Slice &data() const { return contents_.data; }
+        CompressionType compression_type() const { return type_; }
+
+        size_t ApproximateMemoryUsage() const
+        {
+            return contents_.ApproximateMemoryUsage() + sizeof(*this) -
+                   sizeof(contents_);
+        }
+
+        // Counts a hit on the compressed block. Returns true for the
+        // promotion_hits-th one, so that a single reader promotes it; never
+        // if promotion_hits is 0.
+        bool CountHit(uint32_t promotion_hits)
+        {
+            return promotion_hits > 0 &&
+                   hits_.fetch_add(1, std::memory_order_relaxed) + 1 ==
+                       promotion_hits;
+        }
+
+        // For an entry that could not be inserted.
+        BlockContents TakeContents() { return std::move(contents_); }
+
+    private:
+        BlockContents contents_;
+        const CompressionType type_;
+        std::atomic<uint32_t> hits_{0};
+    };
+
+    // Hands out a single buffer, reused across calls, for the blocks a thread
+    // uncompresses out of the block cache only to search them once (see
+    // BlockBasedTable::ReadBlock()), rather than allocating and freeing one
+    // per point lookup. A block still holding the buffer when the next one
+    // is uncompressed, or too large to keep one for, gets memory of its own.
+    class ScratchAllocator : public MemoryAllocator
+    {
+    public:
+        // Larger buffers are not kept around.
+        static constexpr size_t kMaxScratchSize = 1 << 20;
+
+        // The allocator of the calling thread, which only that thread may use.
+        static ScratchAllocator *ThisThread();
+
+        const char *Name() const override { return "ScratchAllocator"; }
+
+        void *Allocate(size_t size) override;
+        void Deallocate(void *p) override;
+
+    private:
+        std::unique_ptr<char[]> buf_;
+        size_t capacity_ = 0;
+        bool in_use_ = false;
+    };
+}
@@ -0,0 +1,461 @@
+#include "table/block_based/columnar_block.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "db/wide/wide_column_serialization.h"
+#include "util/coding.h"
+#include "util/math.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        // Row kinds, the first byte of the value of a key in the keys block.
+        constexpr char kPlainRow = 0;
+        constexpr char kEntityRow = 1;
+
+        constexpr size_t kColumnarBlockFooterSize = 4 * sizeof(uint32_t);
+    }
+
+    ColumnarBlockBuilder::ColumnarBlockBuilder(
+        int block_restart_interval, CompressionType compression_type,
+        const CompressionOptions &compression_opts)
+        : compression_type_(compression_type),
+          compression_opts_(compression_opts),
+          compression_ctx_(compression_type, compression_opts),
+          keys_(block_restart_interval) {}
+
+    void ColumnarBlockBuilder::Reset()
+    {
+        keys_.Reset();
+        columns_.clear();
+        num_rows_ = 0;
+        values_size_ = 0;
+        buffer_.clear();
+    }
+
+    void ColumnarBlockBuilder::AddToColumn(const Slice &name, const Slice &value)
+    {
+        Column &column = columns_[name.ToString()];
+        column.rows.push_back(num_rows_);
+        PutVarint32(&column.sizes, static_cast<uint32_t>(value.size()));
+        column.values.append(value.data(), value.size());
+        values_size_ += VarintLength(value.size()) + value.size();
+    }
+
+    Status ColumnarBlockBuilder::Add(const Slice &key, const Slice &value)
+    {
+        assert(key.size() >= kNumInternalBytes);
+
+        char row_kind = kPlainRow;
+        if (ExtractValueType(key) == kTypeWideColumnEntity)
+        {
+            Slice input = value;
+            WideColumns columns;
+            const Status s = WideColumnSerialization::Deserialize(input, columns);
+            if (!s.ok())
+            {
+                return s;
+            }
+            for (const WideColumn &column : columns)
+            {
+                AddToColumn(column.name(), column.value());
+            }
+            row_kind = kEntityRow;
+        }
+        else
+        {
+            AddToColumn(kDefaultWideColumnName, value);
+        }
+
+        char row[1 + kMaxVarint64Length];
+        row[0] = row_kind;
+        char *end = EncodeVarint32(row + 1, num_rows_);
+        keys_.Add(key, Slice(row, static_cast<size_t>(end - row)));
+        ++num_rows_;
+        return Status::OK();
+    }
+
+    void ColumnarBlockBuilder::AppendColumnVector(const Column &column)
+    {
+        std::string raw((num_rows_ + 7) / 8, '\0');
+        for (uint32_t row : column.rows)
+        {
+            raw[row / 8] |= static_cast<char>(1 << (row % 8));
+        }
+        raw.append(column.sizes);
+        raw.append(column.values);
+
+        if (compression_type_ != kNoCompression)
+        {
+            compressed_.clear();
+            CompressionInfo info(compression_opts_, compression_ctx_,
+                                 CompressionDict::GetEmptyDict(), compression_type_,
+                                 0 /* sample_for_compression */);
+            // Same as the data blocks of a table: keep the vector
+            // uncompressed unless compression saves at least 12.5%.
+            if (CompressData(raw, info, 2 /* compress_format_version */,
+                             &compressed_) &&
+                compressed_.size() < raw.size() - (raw.size() / 8u))
+            {
+                buffer_.append(compressed_);
+                buffer_.push_back(static_cast<char>(compression_type_));
+                return;
+            }
+        }
+        buffer_.append(raw);
+        buffer_.push_back(static_cast<char>(kNoCompression));
+    }
+
+    Slice ColumnarBlockBuilder::Finish()
+    {
+        buffer_.clear();
+        const Slice keys = keys_.Finish();
+        buffer_.append(keys.data(), keys.size());
+
+        std::string directory;
+        PutVarint32(&directory, static_cast<uint32_t>(columns_.size()));
+        for (const auto &name_and_column : columns_)
+        {
+            const uint64_t offset = buffer_.size();
+            AppendColumnVector(name_and_column.second);
+            PutLengthPrefixedSlice(&directory, name_and_column.first);
+            PutVarint64(&directory, offset);
+            PutVarint64(&directory, buffer_.size() - offset);
+        }
+
+        const uint32_t directory_offset = static_cast<uint32_t>(buffer_.size());
+        buffer_.append(directory);
+        PutFixed32(&buffer_, static_cast<uint32_t>(keys.size()));
+        PutFixed32(&buffer_, directory_offset);
+        PutFixed32(&buffer_, num_rows_);
+        PutFixed32(&buffer_, kColumnarBlockMagic);
+        return Slice(buffer_);
+    }
+
+    size_t ColumnarBlockBuilder::CurrentSizeEstimate() const
+    {
+        // Each column vector takes a bitmap and a compression type, and a
+        // directory entry of up to the name and two varint64.
+        size_t estimate = keys_.CurrentSizeEstimate() + values_size_ +
+                          kMaxVarint64Length + kColumnarBlockFooterSize;
+        for (const auto &name_and_column : columns_)
+        {
+            estimate += (num_rows_ + 7) / 8 + 1 + kMaxVarint64Length +
+                        name_and_column.first.size() + 2 * kMaxVarint64Length;
+        }
+        return estimate;
+    }
+
+    ColumnarBlock::ColumnarBlock(BlockContents &&contents)
+        : contents_(std::move(contents))
+    {
+        const char *data = contents_.data.data();
+        const size_t size = contents_.data.size();
+        if (size < kColumnarBlockFooterSize)
+        {
+            status_ = Status::Corruption("Columnar block too small");
+            return;
+        }
+        const char *footer = data + size - kColumnarBlockFooterSize;
+        uint32_t fields[4];
+        DecodeFixed32Array(footer, fields, 4);
+        const uint32_t keys_size = fields[0];
+        const uint32_t directory_offset = fields[1];
+        const uint32_t num_rows = fields[2];
+        if (fields[3] != kColumnarBlockMagic)
+        {
+            status_ = Status::Corruption("Bad columnar block magic number");
+            return;
+        }
+        if (keys_size > directory_offset ||
+            directory_offset > size - kColumnarBlockFooterSize)
+        {
+            status_ = Status::Corruption("Bad columnar block footer");
+            return;
+        }
+
+        Slice directory(data + directory_offset,
+                        size - kColumnarBlockFooterSize - directory_offset);
+        uint32_t num_columns = 0;
+        if (!GetVarint32(&directory, &num_columns))
+        {
+            status_ = Status::Corruption("Bad columnar block directory");
+            return;
+        }
+        columns_.reserve(std::min<size_t>(num_columns, directory.size()));
+        for (uint32_t i = 0; i < num_columns; ++i)
+        {
+            ColumnHandle handle;
+            if (!GetLengthPrefixedSlice(&directory, &handle.name) ||
+                !GetVarint64(&directory, &handle.offset) ||
+                !GetVarint64(&directory, &handle.size) ||
+                handle.offset < keys_size || handle.size == 0 ||
+                handle.offset > directory_offset ||
+                handle.size > directory_offset - handle.offset ||
+                (!columns_.empty() && columns_.back().name.compare(handle.name) >= 0))
+            {
+                columns_.clear();
+                status_ = Status::Corruption("Bad columnar block directory");
+                return;
+            }
+            columns_.push_back(handle);
+        }
+
+        num_rows_ = num_rows;
+        keys_.reset(new Block(BlockContents(Slice(data, keys_size))));
+    }
+
+    Status ColumnarBlock::DecodeColumn(const Slice &name, ColumnVector *vector) const
+    {
+        assert(status_.ok());
+        auto it = std::lower_bound(
+            columns_.begin(), columns_.end(), name,
+            [](const ColumnHandle &handle, const Slice &target)
+            { return handle.name.compare(target) < 0; });
+        if (it == columns_.end() || it->name != name)
+        {
+            return Status::NotFound();
+        }
+
+        // The handle covers the vector and its compression type.
+        const char *data = contents_.data.data() + it->offset;
+        const size_t size = static_cast<size_t>(it->size) - 1;
+        const CompressionType type = static_cast<CompressionType>(data[size]);
+        if (type == kNoCompression)
+        {
+            vector->contents_ = BlockContents(Slice(data, size));
+        }
+        else
+        {
+            const Status s = UncompressSerializedBlock(
+                data, size, type, &vector->contents_, 2 /* format_version */);
+            if (!s.ok())
+            {
+                return s;
+            }
+        }
+
+        Slice input = vector->contents_.data;
+        const char *bitmap = input.data();
+        const size_t bitmap_size = (num_rows_ + 7) / 8;
+        if (input.size() < bitmap_size)
+        {
+            return Status::Corruption("Bad columnar block column vector");
+        }
+        input.remove_prefix(bitmap_size);
+
+        vector->present_.assign(num_rows_, false);
+        vector->values_.assign(num_rows_, Slice());
+        // The sizes first, then the values they delimit. The sizes are all
+        // decoded in one go, so count them first.
+        size_t num_present = 0;
+        for (size_t i = 0; i < bitmap_size; ++i)
+        {
+            unsigned char bits = static_cast<unsigned char>(bitmap[i]);
+            if (i == bitmap_size - 1 && num_rows_ % 8 != 0)
+            {
+                // Past the last row
+                bits &= static_cast<unsigned char>((1u << (num_rows_ % 8)) - 1);
+            }
+            num_present += BitsSetToOne(bits);
+        }
+        if (num_present > input.size())
+        {
+            // Every size takes a byte at least.
+            return Status::Corruption("Bad columnar block column vector");
+        }
+        std::vector<uint32_t> sizes(num_present);
+        const char *sizes_end = GetVarint32Array(
+            input.data(), input.data() + input.size(), sizes.data(), num_present);
+        if (sizes_end == nullptr)
+        {
+            return Status::Corruption("Bad columnar block column vector");
+        }
+        input.remove_prefix(static_cast<size_t>(sizes_end - input.data()));
+        size_t next_size = 0;
+        for (uint32_t row = 0; row < num_rows_; ++row)
+        {
+            if ((bitmap[row / 8] >> (row % 8)) & 1)
+            {
+                vector->present_[row] = true;
+                vector->values_[row] = Slice(nullptr, sizes[next_size++]);
+            }
+        }
+        for (uint32_t row = 0; row < num_rows_; ++row)
+        {
+            if (vector->present_[row])
+            {
+                const size_t value_size = vector->values_[row].size();
+                if (value_size > input.size())
+                {
+                    return Status::Corruption("Bad columnar block column vector");
+                }
+                vector->values_[row] = Slice(input.data(), value_size);
+                input.remove_prefix(value_size);
+            }
+        }
+        if (!input.empty())
+        {
+            return Status::Corruption("Bad columnar block column vector");
+        }
+        return Status::OK();
+    }
+
+    void ColumnarBlock::InitIter(const InternalKeyComparator *icmp,
+                                 const std::vector<std::string> *projection,
+                                 ColumnarBlockIter *iter) const
+    {
+        iter->Initialize(this, icmp, projection);
+    }
+
+    void ColumnarBlockIter::Initialize(const ColumnarBlock *block,
+                                       const InternalKeyComparator *icmp,
+                                       const std::vector<std::string> *projection)
+    {
+        block_ = block;
+        projection_ = projection;
+        status_ = block->status();
+        if (status_.ok())
+        {
+            block->keys_->InitIter(icmp, &keys_iter_);
+        }
+        else
+        {
+            keys_iter_.Invalidate(status_);
+        }
+        columns_loaded_ = false;
+        vectors_.clear();
+        row_decoded_ = false;
+        columns_.clear();
+    }
+
+    bool ColumnarBlockIter::LoadColumns()
+    {
+        if (columns_loaded_)
+        {
+            return status_.ok();
+        }
+        columns_loaded_ = true;
+        for (const ColumnarBlock::ColumnHandle &handle : block_->columns_)
+        {
+            if (projection_ != nullptr &&
+                std::find(projection_->begin(), projection_->end(), handle.name) ==
+                    projection_->end())
+            {
+                continue;
+            }
+            ColumnVector vector;
+            const Status s = block_->DecodeColumn(handle.name, &vector);
+            if (!s.ok())
+            {
+                status_ = s;
+                vectors_.clear();
+                return false;
+            }
+            vectors_.emplace_back(handle.name, std::move(vector));
+        }
+        return true;
+    }
+
+    void ColumnarBlockIter::ParseRow()
+    {
+        row_decoded_ = false;
+        if (!keys_iter_.Valid())
+        {
+            return;
+        }
+        Slice row = keys_iter_.value();
+        if (row.empty() || (row[0] != kPlainRow && row[0] != kEntityRow))
+        {
+            status_ = Status::Corruption("Bad columnar block row");
+            return;
+        }
+        entity_ = row[0] == kEntityRow;
+        row.remove_prefix(1);
+        if (!GetVarint32(&row, &row_) || row_ >= block_->NumRows())
+        {
+            status_ = Status::Corruption("Bad columnar block row");
+        }
+    }
+
+    const WideColumns &ColumnarBlockIter::columns()
+    {
+        assert(Valid());
+        if (!row_decoded_)
+        {
+            columns_.clear();
+            if (LoadColumns())
+            {
+                for (const auto &name_and_vector : vectors_)
+                {
+                    if (name_and_vector.second.Present(row_))
+                    {
+                        columns_.emplace_back(name_and_vector.first,
+                                              name_and_vector.second.Get(row_));
+                    }
+                }
+            }
+            row_decoded_ = true;
+        }
+        return columns_;
+    }
+
+    Slice ColumnarBlockIter::value()
+    {
+        const WideColumns &row_columns = columns();
+        if (!entity_)
+        {
+            // Only the default column can be present.
+            return row_columns.empty() ? Slice() : row_columns[0].value();
+        }
+        value_buf_.clear();
+        const Status s = WideColumnSerialization::Serialize(row_columns, value_buf_);
+        if (!s.ok())
+        {
+            status_ = s;
+            return Slice();
+        }
+        return Slice(value_buf_);
+    }
+
+    void ColumnarBlockIter::SeekToFirst()
+    {
+        keys_iter_.SeekToFirst();
+        ParseRow();
+    }
+
+    void ColumnarBlockIter::SeekToLast()
+    {
+        keys_iter_.SeekToLast();
+        ParseRow();
+    }
+
+    void ColumnarBlockIter::Seek(const Slice &target)
+    {
+        keys_iter_.Seek(target);
+        ParseRow();
+    }
+
+    void ColumnarBlockIter::SeekForPrev(const Slice &target)
+    {
+        keys_iter_.SeekForPrev(target);
+        ParseRow();
+    }
+
+    void ColumnarBlockIter::Next()
+    {
+        assert(Valid());
+        keys_iter_.Next();
+        ParseRow();
+    }
+
+    void ColumnarBlockIter::Prev()
+    {
+        assert(Valid());
+        keys_iter_.Prev();
+        ParseRow();
+    }
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "table/block_based/block.h"
+#include "table/block_based/block_builder.h"
+#include "table/format.h"
+#include "util/compression.h"
+#include "xiaodb/slice.h"
+#include "xiaodb/status.h"
+#include "xiaodb/wide_columns.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Columnar (PAX) layout of a data block: the keys of the block are
+    // stored apart from the values, and the values are split by column, each
+    // column of the block in its own independently compressed vector. Scans
+    // that only read a few columns of wide-column entities then only
+    // decompress and decode those.
+    //
+    //   keys block      a BlockBuilder block of the internal keys; the value
+    //                   of a key is its row kind (1 byte) and row number
+    //                   (varint32)
+    //   column vectors  per column, the vector (see below), followed by its
+    //                   compression type (1 byte)
+    //   directory       varint32 num_columns, then per column, in name
+    //                   order: length-prefixed name, varint64 offset and
+    //                   varint64 size (with the compression type) of its
+    //                   vector
+    //   footer          fixed32 keys block size, fixed32 directory offset,
+    //                   fixed32 num_rows, fixed32 kColumnarBlockMagic
+    //
+    // An uncompressed column vector holds a presence bitmap of
+    // ceil(num_rows / 8) bytes, then the varint32 sizes of the values of the
+    // rows that have the column, then those values back to back.
+    //
+    // The value of a wide-column entity (kTypeWideColumnEntity) is split into
+    // its columns; any other value is stored in the default column (the one
+    // with the empty name), and its row kind tells it apart.
+    constexpr uint32_t kColumnarBlockMagic = 0x636f6c62; // "colb"
+
+    class ColumnarBlockBuilder
+    {
+    public:
+        ColumnarBlockBuilder(const ColumnarBlockBuilder &) = delete;
+        void operator=(const ColumnarBlockBuilder &) = delete;
+
+        // Column vectors are compressed with compression_type when that
+        // saves at least 1/8 of their size.
+        ColumnarBlockBuilder(int block_restart_interval,
+                             CompressionType compression_type,
+                             const CompressionOptions &compression_opts);
+
+        // Reset the contents as if the builder was just constructed.
+        void Reset();
+
+        // key is an internal key, and value is the value of the entry as the
+        // row layout stores it.
+        // REQUIRES: Finish() has not been called since the last call to Reset().
+        // REQUIRES: key is larger than any previously added key
+        Status Add(const Slice &key, const Slice &value);
+
+        // Finish building the block and return a slice that refers to the
+        // block contents, valid until Reset() or the destruction of the
+        // builder.
+        Slice Finish();
+
+        // Returns an estimate of the current (uncompressed) size of the block
+        // we are building.
+        size_t CurrentSizeEstimate() const;
+
+        // Return true iff no entries have been added since the last Reset()
+        bool empty() const { return num_rows_ == 0; }
+
+    private:
+        struct Column
+        {
+            std::vector<uint32_t> rows;
+            std::string sizes;
+            std::string values;
+        };
+
+        void AddToColumn(const Slice &name, const Slice &value);
+
+        // Appends the vector of column to buffer_, compressed if worthwhile.
+        void AppendColumnVector(const Column &column);
+
+        const CompressionType compression_type_;
+        const CompressionOptions compression_opts_;
+        CompressionContext compression_ctx_;
+
+        BlockBuilder keys_;
+        // In name order, as the directory.
+        std::map<std::string, Column> columns_;
+        uint32_t num_rows_ = 0;
+        size_t values_size_ = 0;
+        std::string buffer_;
+        std::string compressed_;
+    };
+
+    class ColumnarBlockIter;
+
+    // The values of one column of a ColumnarBlock, by row.
+    class ColumnVector
+    {
+    public:
+        bool Present(uint32_t row) const { return present_[row]; }
+
+        // REQUIRES: Present(row)
+        Slice Get(uint32_t row) const { return values_[row]; }
+
+    private:
+        friend class ColumnarBlock;
+
+        // Refers to the block, unless decompressed.
+        BlockContents contents_;
+        std::vector<bool> present_;
+        std::vector<Slice> values_;
+    };
+
+    // A read-only view of an uncompressed block in the ColumnarBlockBuilder
+    // format. It owns the block contents it was created with, unless they
+    // refer to memory that outlives it.
+    class ColumnarBlock
+    {
+    public:
+        explicit ColumnarBlock(BlockContents &&contents);
+
+        ColumnarBlock(const ColumnarBlock &) = delete;
+        void operator=(const ColumnarBlock &) = delete;
+
+        // Corruption if the block is malformed.
+        const Status &status() const { return status_; }
+
+        size_t size() const { return contents_.data.size(); }
+        uint32_t NumRows() const { return num_rows_; }
+        size_t NumColumns() const { return columns_.size(); }
+
+        // Decodes the vector of the column of the given name. Returns
+        // NotFound if no row of the block has the column.
+        Status DecodeColumn(const Slice &name, ColumnVector *vector) const;
+
+        // Points iter at this block; iter must not outlive it, nor
+        // projection, the names of the columns to read (all of them if
+        // nullptr).
+        void InitIter(const InternalKeyComparator *icmp,
+                      const std::vector<std::string> *projection,
+                      ColumnarBlockIter *iter) const;
+
+    private:
+        friend class ColumnarBlockIter;
+
+        struct ColumnHandle
+        {
+            Slice name;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        BlockContents contents_;
+        Status status_;
+        std::unique_ptr<Block> keys_;
+        std::vector<ColumnHandle> columns_;
+        uint32_t num_rows_ = 0;
+    };
+
+    // An iterator over the entries of a ColumnarBlock, with the interface of
+    // BlockIter. The column vectors of the projection are only decoded on
+    // the first access to a value, so that key-only scans decode none.
+    class ColumnarBlockIter
+    {
+    public:
+        ColumnarBlockIter() = default;
+
+        ColumnarBlockIter(const ColumnarBlockIter &) = delete;
+        void operator=(const ColumnarBlockIter &) = delete;
+
+        bool Valid() const { return status_.ok() && keys_iter_.Valid(); }
+        Status status() const { return status_.ok() ? keys_iter_.status() : status_; }
+
+        Slice key() const
+        {
+            assert(Valid());
+            return keys_iter_.key();
+        }
+
+        // The projected columns of the entry. A plain value is the default
+        // column, if projected.
+        const WideColumns &columns();
+
+        // The value of the entry as the row layout stores it: the plain
+        // value (empty unless the default column is projected), or the
+        // entity of the projected columns, serialized.
+        Slice value();
+
+        void SeekToFirst();
+        void SeekToLast();
+        // Positions at the first entry with key >= target.
+        void Seek(const Slice &target);
+        // Positions at the last entry with key <= target.
+        void SeekForPrev(const Slice &target);
+        void Next();
+        void Prev();
+
+    private:
+        friend class ColumnarBlock;
+
+        void Initialize(const ColumnarBlock *block, const InternalKeyComparator *icmp,
+                        const std::vector<std::string> *projection);
+
+        // Decodes the projected column vectors, once.
+        bool LoadColumns();
+
+        // Sets row_ and entity_ from the position of keys_iter_, and drops
+        // the columns of the previous entry.
+        void ParseRow();
+
+        const ColumnarBlock *block_ = nullptr;
+        const std::vector<std::string> *projection_ = nullptr;
+        BlockIter keys_iter_;
+        Status status_;
+
+        bool columns_loaded_ = false;
+        // The decoded vectors of the projected columns the block has, in
+        // name order.
+        std::vector<std::pair<Slice, ColumnVector>> vectors_;
+
+        uint32_t row_ = 0;
+        bool entity_ = false;
+        bool row_decoded_ = false;
+        WideColumns columns_;
+        std::string value_buf_;
+    };
+}
@@ -0,0 +1,61 @@
+#include "table/block_based/data_block_footer.h"
+
+#include <cassert>
+
+namespace XIAODB_NAMESPACE
+{
+    uint32_t PackIndexTypeAndNumRestarts(
+        BlockBasedTableOptions::DataBlockIndexType index_type,
+        bool restart_key_prefixes, uint32_t num_restarts)
+    {
+        if (num_restarts > kMaxNumRestarts)
+        {
+            assert(0); // mute travis "unused" warning
+        }
+
+        uint32_t block_footer = num_restarts;
+        if (index_type == BlockBasedTableOptions::kDataBlockBinaryAndHash)
+        {
+            block_footer |= 1u << kDataBlockIndexTypeBitShift;
+        }
+        else if (index_type != BlockBasedTableOptions::kDataBlockBinarySearch)
+        {
+            assert(0);
+        }
+        if (restart_key_prefixes)
+        {
+            block_footer |= 1u << kRestartKeyPrefixesBitShift;
+        }
+
+        return block_footer;
+    }
+
+    void UnPackIndexTypeAndNumRestarts(
+        uint32_t block_footer,
+        BlockBasedTableOptions::DataBlockIndexType *index_type,
+        bool *restart_key_prefixes, uint32_t *num_restarts)
+    {
+        if (index_type)
+        {
+            if (block_footer & 1u << kDataBlockIndexTypeBitShift)
+            {
+                *index_type = BlockBasedTableOptions::kDataBlockBinaryAndHash;
+            }
+            else
+            {
+                *index_type = BlockBasedTableOptions::kDataBlockBinarySearch;
+            }
+        }
+        if (restart_key_prefixes)
+        {
+            *restart_key_prefixes =
+                (block_footer & 1u << kRestartKeyPrefixesBitShift) != 0;
+        }
+
+        if (num_restarts)
+        {
+            *num_restarts = block_footer & kNumRestartsMask;
+            assert(*num_restarts <= kMaxNumRestarts);
+        }
+    }
+}
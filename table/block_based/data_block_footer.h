@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+#include "xiaodb/table.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // The last 32 bits of a data block pack the number of restarts with flags
+    // describing the optional indexes stored between the restart array and
+    // the footer:
+    //
+    //   bit 31: the block has a DataBlockHashIndex
+    //   bit 30: the block has a restart key prefix array
+    //   bits 0..29: number of restarts
+    //
+    // Blocks written without either index have both bits clear and so keep
+    // the legacy format.
+    const int kDataBlockIndexTypeBitShift = 31;
+
+    const int kRestartKeyPrefixesBitShift = 30;
+
+    // 0x3FFFFFFF
+    const uint32_t kMaxNumRestarts = (1u << kRestartKeyPrefixesBitShift) - 1u;
+
+    // 0x3FFFFFFF
+    const uint32_t kNumRestartsMask = (1u << kRestartKeyPrefixesBitShift) - 1u;
+
+    uint32_t PackIndexTypeAndNumRestarts(
+        BlockBasedTableOptions::DataBlockIndexType index_type,
+        bool restart_key_prefixes, uint32_t num_restarts);
+
+    void UnPackIndexTypeAndNumRestarts(
+        uint32_t block_footer,
+        BlockBasedTableOptions::DataBlockIndexType *index_type,
+        bool *restart_key_prefixes, uint32_t *num_restarts);
+}
@@ -0,0 +1,642 @@
+#include "xiaodb/filter_policy.h"
+
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#include "port/port.h"
+#include "table/block_based/filter_policy_internal.h"
+#include "util/bloom_impl.h"
+#include "util/hash.h"
+#include "util/math.h"
+#include "util/ribbon_impl.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        constexpr size_t kMetadataLen = BuiltinFilterPolicy::kMetadataLen;
+
+        // Metadata trailer markers
+        constexpr char kNewBloomMarker = static_cast<char>(-1);
+        constexpr char kRibbonMarker = static_cast<char>(-2);
+        // Sub-implementation of kNewBloomMarker
+        constexpr char kFastLocalBloomSubImpl = 0;
+
+        // Ribbon construction retries with a new seed this many times before
+        // falling back on a Bloom filter.
+        constexpr uint32_t kMaxRibbonSeeds = 16;
+
+        // Base class for filter builders using the 64-bit XXPH3 hash of each
+        // entry, which keeps the hashes of the added entries and builds the
+        // filter from them in Finish().
+        class XXPH3FilterBitsBuilder : public FilterBitsBuilder
+        {
+        public:
+            void AddKey(const Slice &key) override
+            {
+                uint64_t hash = GetSliceHash64(key);
+                // Especially with prefixes, it is common to have repetition,
+                // though only adjacent repetition, which we want to immediately
+                // recognize and collapse for estimating true filter space
+                // requirements.
+                if (hash_entries_.empty() || hash != hash_entries_.back())
+                {
+                    hash_entries_.push_back(hash);
+                }
+            }
+
+            void AddKeyAndAlt(const Slice &key, const Slice &alt) override
+            {
+                uint64_t key_hash = GetSliceHash64(key);
+                uint64_t alt_hash = GetSliceHash64(alt);
+                bool has_prev_key = !hash_entries_.empty();
+                uint64_t prev_key_hash = has_prev_key ? hash_entries_.back() : 0;
+                // Add alt first, so that hash_entries_.back() always contains the
+                // previous key, assuming a change from one alt to the next
+                // implies a change to the corresponding key.
+                if (!(has_prev_alt_ && alt_hash == prev_alt_hash_) &&
+                    alt_hash != key_hash &&
+                    !(has_prev_key && alt_hash == prev_key_hash))
+                {
+                    hash_entries_.push_back(alt_hash);
+                }
+                if (!(has_prev_key && key_hash == prev_key_hash))
+                {
+                    hash_entries_.push_back(key_hash);
+                }
+                has_prev_alt_ = true;
+                prev_alt_hash_ = alt_hash;
+            }
+
+            size_t EstimateEntriesAdded() override { return hash_entries_.size(); }
+
+        protected:
+            // Allocates a zeroed buffer for len bytes of filter data followed by
+            // the metadata.
+            static char *AllocateFilter(size_t len,
+                                        std::unique_ptr<char[]> *mutable_buf)
+            {
+                mutable_buf->reset(new char[len + kMetadataLen]());
+                return mutable_buf->get();
+            }
+
+            static Slice FinishFilter(size_t len, char marker, char b1, char b2,
+                                      std::unique_ptr<char[]> *mutable_buf,
+                                      std::unique_ptr<const char[]> *buf)
+            {
+                char *data = mutable_buf->get();
+                data[len] = marker;
+                data[len + 1] = b1;
+                data[len + 2] = b2;
+                data[len + 3] = 0;
+                data[len + 4] = 0;
+                Slice rv(data, len + kMetadataLen);
+                buf->reset(mutable_buf->release());
+                return rv;
+            }
+
+            std::vector<uint64_t> hash_entries_;
+            bool has_prev_alt_ = false;
+            uint64_t prev_alt_hash_ = 0;
+        };
+
+        class FastLocalBloomBitsBuilder : public XXPH3FilterBitsBuilder
+        {
+        public:
+            explicit FastLocalBloomBitsBuilder(int millibits_per_key)
+                : millibits_per_key_(millibits_per_key)
+            {
+                assert(millibits_per_key_ >= 1000);
+            }
+
+            // Takes over the entries of a builder that could not build its own
+            // kind of filter.
+            void TakeEntries(std::vector<uint64_t> *hash_entries)
+            {
+                hash_entries_.swap(*hash_entries);
+            }
+
+            Slice Finish(std::unique_ptr<const char[]> *buf) override
+            {
+                size_t len = CalculateSpace(hash_entries_.size());
+                std::unique_ptr<char[]> mutable_buf;
+                char *data = AllocateFilter(len, &mutable_buf);
+
+                int num_probes = FastLocalBloomImpl::ChooseNumProbes(millibits_per_key_);
+                if (len > 0)
+                {
+                    AddAllEntries(data, static_cast<uint32_t>(len), num_probes);
+                }
+                hash_entries_.clear();
+                return FinishFilter(len, kNewBloomMarker, kFastLocalBloomSubImpl,
+                                    static_cast<char>(num_probes), &mutable_buf, buf);
+            }
+
+            size_t ApproximateNumEntries(size_t bytes) override
+            {
+                size_t bytes_no_meta = bytes >= kMetadataLen ? bytes - kMetadataLen : 0;
+                return static_cast<size_t>(uint64_t{8000} * bytes_no_meta /
+                                           millibits_per_key_);
+            }
+
+        private:
+            size_t CalculateSpace(size_t num_entries) const
+            {
+                if (num_entries == 0)
+                {
+                    // Filter of only metadata, which matches nothing
+                    return 0;
+                }
+                constexpr size_t kLine = FastLocalBloomImpl::kCacheLineBytes;
+                uint64_t bytes = (uint64_t{num_entries} * millibits_per_key_ + 7999) / 8000;
+                // Round up to a whole number of cache lines, at least one, and
+                // stay within the 32-bit length the hash-to-line mapping uses.
+                bytes = std::max<uint64_t>((bytes + kLine - 1) / kLine * kLine, kLine);
+                return static_cast<size_t>(
+                    std::min<uint64_t>(bytes, uint64_t{0xffffffff} / kLine * kLine));
+            }
+
+            void AddAllEntries(char *data, uint32_t len, int num_probes)
+            {
+                // Keep a ring of prepared entries, so that the cache line of an
+                // entry is being fetched while earlier entries are added.
+                constexpr size_t kBufferMask = 7;
+                std::array<uint32_t, kBufferMask + 1> hashes;
+                std::array<uint32_t, kBufferMask + 1> byte_offsets;
+
+                const size_t num_entries = hash_entries_.size();
+                for (size_t i = 0; i < num_entries; ++i)
+                {
+                    size_t slot = i & kBufferMask;
+                    if (i > kBufferMask)
+                    {
+                        FastLocalBloomImpl::AddHashPrepared(hashes[slot], num_probes,
+                                                            data + byte_offsets[slot]);
+                    }
+                    uint64_t h = hash_entries_[i];
+                    FastLocalBloomImpl::PrepareHash(Lower32of64(h), len, data,
+                                                    &byte_offsets[slot]);
+                    hashes[slot] = Upper32of64(h);
+                }
+                for (size_t i = num_entries > kBufferMask ? num_entries - kBufferMask - 1 : 0;
+                     i < num_entries; ++i)
+                {
+                    size_t slot = i & kBufferMask;
+                    FastLocalBloomImpl::AddHashPrepared(hashes[slot], num_probes,
+                                                        data + byte_offsets[slot]);
+                }
+            }
+
+            int millibits_per_key_;
+        };
+
+        class StandardRibbonBitsBuilder : public XXPH3FilterBitsBuilder
+        {
+        public:
+            explicit StandardRibbonBitsBuilder(int bloom_millibits_per_key)
+                : result_bits_(ChooseResultBits(bloom_millibits_per_key)),
+                  bloom_fallback_(bloom_millibits_per_key) {}
+
+            Slice Finish(std::unique_ptr<const char[]> *buf) override
+            {
+                const size_t num_entries = hash_entries_.size();
+                std::unique_ptr<char[]> mutable_buf;
+                if (num_entries == 0)
+                {
+                    AllocateFilter(0, &mutable_buf);
+                    return FinishFilter(0, kRibbonMarker, 0,
+                                        static_cast<char>(result_bits_), &mutable_buf,
+                                        buf);
+                }
+
+                uint64_t num_slots = NumSlots(num_entries);
+                if (num_slots <= uint64_t{0xffffffff})
+                {
+                    for (uint32_t seed = 0; seed < kMaxRibbonSeeds; ++seed)
+                    {
+                        StandardRibbonImpl::Banding banding(
+                            static_cast<uint32_t>(num_slots));
+                        if (!BandAll(seed, &banding))
+                        {
+                            continue;
+                        }
+                        size_t num_words = static_cast<size_t>(
+                            num_slots / StandardRibbonImpl::kCoeffBits * result_bits_);
+                        std::unique_ptr<uint64_t[]> segments(new uint64_t[num_words]());
+                        banding.BackSubstitute(result_bits_, segments.get());
+
+                        size_t len = num_words * sizeof(uint64_t);
+                        char *data = AllocateFilter(len, &mutable_buf);
+                        memcpy(data, segments.get(), len);
+                        hash_entries_.clear();
+                        return FinishFilter(len, kRibbonMarker, static_cast<char>(seed),
+                                            static_cast<char>(result_bits_),
+                                            &mutable_buf, buf);
+                    }
+                }
+                // Extremely unlikely or oversized: build a Bloom filter instead
+                bloom_fallback_.TakeEntries(&hash_entries_);
+                return bloom_fallback_.Finish(buf);
+            }
+
+            size_t ApproximateNumEntries(size_t bytes) override
+            {
+                size_t bytes_no_meta = bytes >= kMetadataLen ? bytes - kMetadataLen : 0;
+                // Inverse of NumSlots(), ignoring its logarithmic term beyond the
+                // overhead at a million entries.
+                double slots = 8.0 * bytes_no_meta / result_bits_;
+                double entries = (slots - StandardRibbonImpl::kCoeffBits) /
+                                 OverheadFactor(1000000);
+                return entries > 0 ? static_cast<size_t>(entries) : 0;
+            }
+
+        private:
+            // Match the FP rate of a cache-local Bloom filter with the given
+            // bits per key, about 2^(-0.69 * bits_per_key) in the usual range.
+            static int ChooseResultBits(int bloom_millibits_per_key)
+            {
+                int bits = static_cast<int>(bloom_millibits_per_key * 0.00069 + 0.5);
+                return std::min(std::max(bits, 1), StandardRibbonImpl::kMaxResultBits);
+            }
+
+            // Standard Ribbon with 64-bit coefficients needs an overhead that
+            // grows with log(n) for construction to succeed with high
+            // probability.
+            static double OverheadFactor(size_t num_entries)
+            {
+                return 1.0 + 0.4 * std::log2(std::max<double>(num_entries, 2)) /
+                                 StandardRibbonImpl::kCoeffBits;
+            }
+
+            static uint64_t NumSlots(size_t num_entries)
+            {
+                constexpr uint64_t kCoeffBits = StandardRibbonImpl::kCoeffBits;
+                uint64_t slots = static_cast<uint64_t>(num_entries *
+                                                       OverheadFactor(num_entries)) +
+                                 kCoeffBits;
+                return (slots + kCoeffBits - 1) / kCoeffBits * kCoeffBits;
+            }
+
+            bool BandAll(uint32_t seed, StandardRibbonImpl::Banding *banding) const
+            {
+                const uint32_t num_slots = banding->NumSlots();
+                for (uint64_t h : hash_entries_)
+                {
+                    if (!banding->Add(StandardRibbonImpl::Derive(h, seed, num_slots,
+                                                                 result_bits_)))
+                    {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            const int result_bits_;
+            FastLocalBloomBitsBuilder bloom_fallback_;
+        };
+
+        class AlwaysTrueFilter : public FilterBitsReader
+        {
+        public:
+            bool MayMatch(const Slice &) override { return true; }
+            using FilterBitsReader::MayMatch; // inherit overload
+        };
+
+        class AlwaysFalseFilter : public FilterBitsReader
+        {
+        public:
+            bool MayMatch(const Slice &) override { return false; }
+            using FilterBitsReader::MayMatch; // inherit overload
+        };
+
+        class FastLocalBloomBitsReader : public FilterBitsReader
+        {
+        public:
+            FastLocalBloomBitsReader(const char *data, int num_probes, uint32_t len_bytes)
+                : data_(data), num_probes_(num_probes), len_bytes_(len_bytes) {}
+
+            // No Copy allowed
+            FastLocalBloomBitsReader(const FastLocalBloomBitsReader &) = delete;
+            void operator=(const FastLocalBloomBitsReader &) = delete;
+
+            bool MayMatch(const Slice &key) override
+            {
+                uint64_t h = GetSliceHash64(key);
+                return FastLocalBloomImpl::HashMayMatch(Lower32of64(h), Upper32of64(h),
+                                                        len_bytes_, num_probes_, data_);
+            }
+
+            void MayMatch(int num_keys, Slice **keys, bool *may_match) override
+            {
+                std::array<uint64_t, MultiGetContext::MAX_BATCH_SIZE> key_hashes;
+                for (int base = 0; base < num_keys; base += MultiGetContext::MAX_BATCH_SIZE)
+                {
+                    int n = std::min(num_keys - base, MultiGetContext::MAX_BATCH_SIZE);
+                    GetSliceHash64Batch(keys + base, n, key_hashes.data());
+                    HashesMayMatch(n, key_hashes.data(), may_match + base);
+                }
+            }
+
+            void MayMatch(int num_keys, Slice ** /*keys*/, const uint64_t *key_hashes,
+                          bool *may_match) override
+            {
+                for (int base = 0; base < num_keys; base += MultiGetContext::MAX_BATCH_SIZE)
+                {
+                    int n = std::min(num_keys - base, MultiGetContext::MAX_BATCH_SIZE);
+                    HashesMayMatch(n, key_hashes + base, may_match + base);
+                }
+            }
+
+        private:
+            // Probes up to MAX_BATCH_SIZE keys, by their GetSliceHash64().
+            void HashesMayMatch(int n, const uint64_t *key_hashes, bool *may_match)
+            {
+                std::array<uint32_t, MultiGetContext::MAX_BATCH_SIZE> hashes;
+                std::array<uint32_t, MultiGetContext::MAX_BATCH_SIZE> byte_offsets;
+                // Start fetching the cache line of every key...
+                for (int i = 0; i < n; ++i)
+                {
+                    uint64_t h = key_hashes[i];
+                    FastLocalBloomImpl::PrepareHash(Lower32of64(h), len_bytes_, data_,
+                                                    &byte_offsets[i]);
+                    hashes[i] = Upper32of64(h);
+                }
+                // ...then probe them, the lines hopefully having arrived.
+                for (int i = 0; i < n; ++i)
+                {
+                    may_match[i] = FastLocalBloomImpl::HashMayMatchPrepared(
+                        hashes[i], num_probes_, data_ + byte_offsets[i]);
+                }
+            }
+
+            const char *data_;
+            const int num_probes_;
+            const uint32_t len_bytes_;
+        };
+
+        class StandardRibbonBitsReader : public FilterBitsReader
+        {
+        public:
+            StandardRibbonBitsReader(const char *data, uint32_t seed, int result_bits,
+                                     uint32_t num_slots)
+                : data_(data),
+                  seed_(seed),
+                  result_bits_(result_bits),
+                  num_slots_(num_slots) {}
+
+            // No Copy allowed
+            StandardRibbonBitsReader(const StandardRibbonBitsReader &) = delete;
+            void operator=(const StandardRibbonBitsReader &) = delete;
+
+            bool MayMatch(const Slice &key) override
+            {
+                return StandardRibbonImpl::MayMatch(Derive(key), result_bits_, data_);
+            }
+
+            void MayMatch(int num_keys, Slice **keys, bool *may_match) override
+            {
+                std::array<uint64_t, MultiGetContext::MAX_BATCH_SIZE> key_hashes;
+                for (int base = 0; base < num_keys; base += MultiGetContext::MAX_BATCH_SIZE)
+                {
+                    int n = std::min(num_keys - base, MultiGetContext::MAX_BATCH_SIZE);
+                    GetSliceHash64Batch(keys + base, n, key_hashes.data());
+                    HashesMayMatch(n, key_hashes.data(), may_match + base);
+                }
+            }
+
+            void MayMatch(int num_keys, Slice ** /*keys*/, const uint64_t *key_hashes,
+                          bool *may_match) override
+            {
+                for (int base = 0; base < num_keys; base += MultiGetContext::MAX_BATCH_SIZE)
+                {
+                    int n = std::min(num_keys - base, MultiGetContext::MAX_BATCH_SIZE);
+                    HashesMayMatch(n, key_hashes + base, may_match + base);
+                }
+            }
+
+        private:
+            StandardRibbonImpl::Hashed Derive(const Slice &key) const
+            {
+                return Derive(GetSliceHash64(key));
+            }
+
+            StandardRibbonImpl::Hashed Derive(uint64_t key_hash) const
+            {
+                return StandardRibbonImpl::Derive(key_hash, seed_, num_slots_,
+                                                  result_bits_);
+            }
+
+            // Probes up to MAX_BATCH_SIZE keys, by their GetSliceHash64().
+            void HashesMayMatch(int n, const uint64_t *key_hashes, bool *may_match)
+            {
+                std::array<StandardRibbonImpl::Hashed, MultiGetContext::MAX_BATCH_SIZE>
+                    hashed;
+                for (int i = 0; i < n; ++i)
+                {
+                    hashed[i] = Derive(key_hashes[i]);
+                    StandardRibbonImpl::Prefetch(hashed[i], result_bits_, data_);
+                }
+                for (int i = 0; i < n; ++i)
+                {
+                    may_match[i] = StandardRibbonImpl::MayMatch(hashed[i], result_bits_, data_);
+                }
+            }
+
+            const char *data_;
+            const uint32_t seed_;
+            const int result_bits_;
+            const uint32_t num_slots_;
+        };
+    } // namespace
+
+    void FilterBitsReader::MayMatch(MultiGetContext::Range *range)
+    {
+        std::array<Slice *, MultiGetContext::MAX_BATCH_SIZE> keys;
+        std::array<uint64_t, MultiGetContext::MAX_BATCH_SIZE> key_hashes;
+        std::array<bool, MultiGetContext::MAX_BATCH_SIZE> may_match;
+        assert(range->KeysLeft() <= MultiGetContext::MAX_BATCH_SIZE);
+        int num_keys = 0;
+        for (auto iter = range->begin(); iter != range->end(); ++iter)
+        {
+            keys[num_keys] = &(*iter).ukey_without_ts;
+            key_hashes[num_keys++] = iter->key_hash;
+        }
+        MayMatch(num_keys, keys.data(), key_hashes.data(), may_match.data());
+        int i = 0;
+        for (auto iter = range->begin(); iter != range->end(); ++iter)
+        {
+            if (!may_match[i])
+            {
+                range->SkipKey(iter);
+            }
+            ++i;
+        }
+    }
+
+    FilterBitsReader *BuiltinFilterPolicy::GetFilterBitsReader(
+        const Slice &contents) const
+    {
+        return GetBuiltinFilterBitsReader(contents);
+    }
+
+    FilterBitsReader *BuiltinFilterPolicy::GetBuiltinFilterBitsReader(
+        const Slice &contents)
+    {
+        const size_t len_with_meta = contents.size();
+        if (len_with_meta <= kMetadataLen)
+        {
+            // Filter of no entries
+            return new AlwaysFalseFilter();
+        }
+        const size_t len = len_with_meta - kMetadataLen;
+        const char *data = contents.data();
+        const char marker = data[len];
+        if (marker == kNewBloomMarker && data[len + 1] == kFastLocalBloomSubImpl)
+        {
+            int num_probes = data[len + 2];
+            if (num_probes < 1 || num_probes > 30 ||
+                len % FastLocalBloomImpl::kCacheLineBytes != 0 ||
+                len > uint64_t{0xffffffff})
+            {
+                // Reserved / future safe
+                return new AlwaysTrueFilter();
+            }
+            return new FastLocalBloomBitsReader(data, num_probes,
+                                                static_cast<uint32_t>(len));
+        }
+        if (marker == kRibbonMarker)
+        {
+            uint32_t seed = static_cast<unsigned char>(data[len + 1]);
+            int result_bits = data[len + 2];
+            if (result_bits < 1 || result_bits > StandardRibbonImpl::kMaxResultBits ||
+                len % (result_bits * sizeof(uint64_t)) != 0)
+            {
+                // Reserved / future safe
+                return new AlwaysTrueFilter();
+            }
+            uint64_t num_slots = len / (result_bits * sizeof(uint64_t)) *
+                                 StandardRibbonImpl::kCoeffBits;
+            if (num_slots > uint64_t{0xffffffff})
+            {
+                return new AlwaysTrueFilter();
+            }
+            return new StandardRibbonBitsReader(data, seed, result_bits,
+                                                static_cast<uint32_t>(num_slots));
+        }
+        // Legacy or unknown filter formats are not read; treat as "no filter".
+        return new AlwaysTrueFilter();
+    }
+
+    BloomFilterPolicy::BloomFilterPolicy(double bits_per_key)
+    {
+        // Sanitize bits_per_key
+        if (bits_per_key < 0.5)
+        {
+            // Round down to no filter
+            bits_per_key = 0;
+        }
+        else if (bits_per_key < 1.0)
+        {
+            // Minimum 1 bit per key (~= 2 probes)
+            bits_per_key = 1.0;
+        }
+        else if (!(bits_per_key < 100.0))
+        { // including NaN
+            bits_per_key = 100.0;
+        }
+
+        // Includes a nudge toward rounding up, to ensure on all platforms
+        // that doubles specified with three decimal digits after the decimal
+        // point are interpreted accurately.
+        millibits_per_key_ = static_cast<int>(bits_per_key * 1000.0 + 0.500001);
+    }
+
+    FilterBitsBuilder *BloomFilterPolicy::GetFastLocalBloomBuilder() const
+    {
+        if (millibits_per_key_ == 0)
+        {
+            // "No filter" special case
+            return nullptr;
+        }
+        return new FastLocalBloomBitsBuilder(millibits_per_key_);
+    }
+
+    FilterBitsBuilder *BloomFilterPolicy::GetBuilderWithContext(
+        const FilterBuildingContext & /*context*/) const
+    {
+        // Only the format_version >= 5 Bloom filter is built.
+        return GetFastLocalBloomBuilder();
+    }
+
+    RibbonFilterPolicy::RibbonFilterPolicy(double bloom_equivalent_bits_per_key,
+                                           int bloom_before_level)
+        : BloomFilterPolicy(bloom_equivalent_bits_per_key),
+          bloom_before_level_(bloom_before_level) {}
+
+    FilterBitsBuilder *RibbonFilterPolicy::GetBuilderWithContext(
+        const FilterBuildingContext &context) const
+    {
+        if (millibits_per_key_ == 0)
+        {
+            // "No filter" special case
+            return nullptr;
+        }
+        // Treat unknown same as bottommost
+        int levelish = INT_MAX;
+
+        switch (context.compaction_style)
+        {
+        case kCompactionStyleLevel:
+        case kCompactionStyleUniversal:
+        {
+            if (context.reason == TableFileCreationReason::kFlush)
+            {
+                // Treat flush as level -1
+                assert(context.level_at_creation == 0);
+                levelish = -1;
+            }
+            else if (context.level_at_creation == -1)
+            {
+                // Unknown level
+                assert(levelish == INT_MAX);
+            }
+            else
+            {
+                levelish = context.level_at_creation;
+            }
+            break;
+        }
+        default:
+            // FIFO, or no compaction: treat as bottommost.
+            assert(levelish == INT_MAX);
+            break;
+        }
+        int bloom_before_level = GetBloomBeforeLevel();
+        if (bloom_before_level == INT_MAX || levelish < bloom_before_level)
+        {
+            return GetFastLocalBloomBuilder();
+        }
+        return new StandardRibbonBitsBuilder(millibits_per_key_);
+    }
+
+    FilterBuildingContext::FilterBuildingContext(
+        const BlockBasedTableOptions &_table_options)
+        : table_options(_table_options) {}
+
+    FilterPolicy::~FilterPolicy() = default;
+
+    const FilterPolicy *NewBloomFilterPolicy(double bits_per_key,
+                                             bool /*use_block_based_builder*/)
+    {
+        return new BloomFilterPolicy(bits_per_key);
+    }
+
+    FilterPolicy *NewRibbonFilterPolicy(double bloom_equivalent_bits_per_key,
+                                        int bloom_before_level)
+    {
+        return new RibbonFilterPolicy(bloom_equivalent_bits_per_key,
+                                      bloom_before_level);
+    }
+}
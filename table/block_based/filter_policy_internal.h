@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xiaodb/filter_policy.h"
+#include "xiaodb/slice.h"
+#include "xiaodb/status.h"
+#include "table/multiget_context.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // A class that takes a bunch of keys, then generates filter
+    class FilterBitsBuilder
+    {
+    public:
+        virtual ~FilterBitsBuilder() {}
+
+        // Add a key (or prefix) to the filter. Typically, a builder will keep
+        // a set of 64-bit key hashes and only build the filter in Finish
+        // when the final number of keys is known. Keys are added in sorted order
+        // and duplicated keys are possible, so typically, the builder will
+        // only add this key if its hash is different from the most recently
+        // added.
+        virtual void AddKey(const Slice &key) = 0;
+
+        // Add two entries to the filter, typically a key and, as the alternate,
+        // its prefix. This differs from AddKey(key); AddKey(alt); in that there
+        // is extra state for de-duplicating successive `alt` entries, as well
+        // as successive `key` entries. And there is de-duplication between `key`
+        // and `alt` entries, even in adjacent calls, because a whole key might
+        // be its own prefix.
+        virtual void AddKeyAndAlt(const Slice &key, const Slice &alt) = 0;
+
+        // Estimate of the number of entries added so far, after
+        // de-duplication. Used e.g. to decide when to cut a filter partition.
+        virtual size_t EstimateEntriesAdded() = 0;
+
+        // Generate the filter using the keys that are added
+        // The return value of this function would be the filter bits,
+        // The ownership of actual data is set to buf
+        virtual Slice Finish(std::unique_ptr<const char[]> *buf) = 0;
+
+        // Approximate the number of keys that can be added and generate a filter
+        // <= the specified number of bytes. Callers (including XiaoDB) should
+        // only use this result for optimizing performance and not as a guarantee.
+        virtual size_t ApproximateNumEntries(size_t bytes) = 0;
+    };
+
+    // A class that checks if a key can be in filter
+    // It should be initialized by Slice generated by BitsBuilder
+    class FilterBitsReader
+    {
+    public:
+        virtual ~FilterBitsReader() {}
+
+        // Check if the entry match the bits in filter
+        virtual bool MayMatch(const Slice &entry) = 0;
+
+        // Check if an array of entries match the bits in filter. The built-in
+        // readers hash every entry and prefetch its part of the filter before
+        // probing any, so that the cache misses of the batch overlap.
+        virtual void MayMatch(int num_keys, Slice **keys, bool *may_match)
+        {
+            for (int i = 0; i < num_keys; ++i)
+            {
+                may_match[i] = MayMatch(*keys[i]);
+            }
+        }
+
+        // Same as MayMatch(num_keys, keys, may_match), given the keys'
+        // key_hashes[i] == GetSliceHash64(*keys[i]), computed once for all the
+        // filters a batch is checked against (see KeyContext::key_hash). The
+        // built-in readers probe with the hashes alone.
+        virtual void MayMatch(int num_keys, Slice **keys, const uint64_t *key_hashes,
+                              bool *may_match)
+        {
+            (void)key_hashes;
+            MayMatch(num_keys, keys, may_match);
+        }
+
+        // Probe the filter, as a whole-key filter, with the user key (without
+        // timestamp) of every key in range that is neither skipped nor already
+        // found, as one batch, and skip the keys that definitely do not match.
+        // The keys are not hashed again (see KeyContext::key_hash).
+        void MayMatch(MultiGetContext::Range *range);
+    };
+
+    // Base class for the built-in filter policies. They can all read each
+    // other's filters: the kind of filter is recorded in its trailing metadata.
+    //
+    // Filter formats, each followed by kMetadataLen bytes of metadata:
+    //   Cache-local Bloom (format_version >= 5):
+    //     [data: multiple of 64 bytes][-1][0][num_probes][0][0]
+    //   Standard Ribbon:
+    //     [data: segments of result_bits 64-bit words][-2][seed][result_bits][0][0]
+    // A filter of only metadata matches nothing; unrecognized metadata matches
+    // everything, so that filters from newer versions degrade gracefully.
+    class BuiltinFilterPolicy : public FilterPolicy
+    {
+    public:
+        static constexpr size_t kMetadataLen = 5;
+
+        static const char *kClassName() { return "xiaodb.internal.BuiltinFilter"; }
+        static const char *kCompatibilityName() { return "xiaodb.BuiltinBloomFilter"; }
+
+        // All built-in filters share the same compatibility name.
+        const char *CompatibilityName() const override
+        {
+            return kCompatibilityName();
+        }
+
+        // Read metadata to determine what kind of FilterBitsReader is needed
+        // and return a new one.
+        FilterBitsReader *GetFilterBitsReader(const Slice &contents) const override;
+
+        static FilterBitsReader *GetBuiltinFilterBitsReader(const Slice &contents);
+    };
+
+    // Cache-local Bloom filter, see NewBloomFilterPolicy().
+    class BloomFilterPolicy : public BuiltinFilterPolicy
+    {
+    public:
+        explicit BloomFilterPolicy(double bits_per_key);
+
+        static const char *kClassName() { return "bloomfilter"; }
+        const char *Name() const override { return kClassName(); }
+
+        FilterBitsBuilder *GetBuilderWithContext(
+            const FilterBuildingContext &context) const override;
+
+        // Essentially for testing only: configured millibits/key
+        int GetMillibitsPerKey() const { return millibits_per_key_; }
+
+    protected:
+        // Returns nullptr for "no filter" (bits_per_key rounded to 0).
+        FilterBitsBuilder *GetFastLocalBloomBuilder() const;
+
+        // Newer filters support fractional bits per key. For predictable
+        // behavior of 0.001-precision values across floating point
+        // implementations, we round to thousandths of a bit (on average) per key.
+        int millibits_per_key_;
+    };
+
+    // Standard Ribbon filter, see NewRibbonFilterPolicy().
+    class RibbonFilterPolicy : public BloomFilterPolicy
+    {
+    public:
+        RibbonFilterPolicy(double bloom_equivalent_bits_per_key,
+                           int bloom_before_level);
+
+        static const char *kClassName() { return "ribbonfilter"; }
+        const char *Name() const override { return kClassName(); }
+
+        FilterBitsBuilder *GetBuilderWithContext(
+            const FilterBuildingContext &context) const override;
+
+        int GetBloomBeforeLevel() const
+        {
+            return bloom_before_level_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<int> bloom_before_level_;
+    };
+}
@@ -0,0 +1,127 @@
+#include "table/block_based/index_iterator.h"
+
+#include "table/block_based/block_based_table_reader.h"
+#include "table/block_based/partitioned_index_reader.h"
+
+namespace XIAODB_NAMESPACE
+{
+    void IndexIterator::Initialize(const BlockBasedTable *table,
+                                   const ReadOptions *read_options)
+    {
+        partition_index_ = table->partition_index();
+        read_options_ = read_options;
+        icmp_ = &table->internal_comparator();
+        table->index_block().InitIter(icmp_, &index_iter_);
+        partition_ = nullptr;
+        partition_holder_.reset();
+    }
+
+    void IndexIterator::InitPartition()
+    {
+        if (!index_iter_.Valid())
+        {
+            partition_iter_.Invalidate(index_iter_.status());
+            return;
+        }
+        BlockHandle handle;
+        Status s = BlockBasedTable::DecodeIndexValue(index_iter_.value(), &handle);
+        if (s.ok() && (partition_ == nullptr || handle != partition_handle_))
+        {
+            partition_ = nullptr;
+            partition_holder_.reset();
+            s = partition_index_->GetPartitions(*read_options_, &handle, 1,
+                                                &partition_holder_, &partition_);
+        }
+        if (!s.ok())
+        {
+            partition_ = nullptr;
+            partition_holder_.reset();
+            partition_iter_.Invalidate(s);
+            return;
+        }
+        partition_handle_ = handle;
+        partition_->InitIter(icmp_, &partition_iter_);
+    }
+
+    void IndexIterator::FindKeyForward()
+    {
+        while (!partition_iter_.Valid() && partition_iter_.status().ok() &&
+               index_iter_.Valid())
+        {
+            index_iter_.Next();
+            InitPartition();
+            partition_iter_.SeekToFirst();
+        }
+    }
+
+    void IndexIterator::FindKeyBackward()
+    {
+        while (!partition_iter_.Valid() && partition_iter_.status().ok() &&
+               index_iter_.Valid())
+        {
+            index_iter_.Prev();
+            InitPartition();
+            partition_iter_.SeekToLast();
+        }
+    }
+
+    void IndexIterator::Seek(const Slice &target)
+    {
+        index_iter_.Seek(target);
+        if (partition_index_ == nullptr)
+        {
+            return;
+        }
+        InitPartition();
+        partition_iter_.Seek(target);
+        FindKeyForward();
+    }
+
+    void IndexIterator::SeekToFirst()
+    {
+        index_iter_.SeekToFirst();
+        if (partition_index_ == nullptr)
+        {
+            return;
+        }
+        InitPartition();
+        partition_iter_.SeekToFirst();
+        FindKeyForward();
+    }
+
+    void IndexIterator::SeekToLast()
+    {
+        index_iter_.SeekToLast();
+        if (partition_index_ == nullptr)
+        {
+            return;
+        }
+        InitPartition();
+        partition_iter_.SeekToLast();
+        FindKeyBackward();
+    }
+
+    void IndexIterator::Next()
+    {
+        assert(Valid());
+        if (partition_index_ == nullptr)
+        {
+            index_iter_.Next();
+            return;
+        }
+        partition_iter_.Next();
+        FindKeyForward();
+    }
+
+    void IndexIterator::Prev()
+    {
+        assert(Valid());
+        if (partition_index_ == nullptr)
+        {
+            index_iter_.Prev();
+            return;
+        }
+        partition_iter_.Prev();
+        FindKeyBackward();
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+
+#include "table/block_based/block.h"
+#include "table/format.h"
+#include "xiaodb/options.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class BlockBasedTable;
+    class PartitionIndexReader;
+
+    // Iterates over the index entries of a BlockBasedTable, which map the
+    // separator of every data block to its handle. With a two-level index,
+    // this is a two-level iterator over the top-level index and the index
+    // partition the top-level index points at, which it gets on demand from
+    // the table's PartitionIndexReader; otherwise it is a plain iterator over
+    // the index block.
+    class IndexIterator
+    {
+    public:
+        IndexIterator() = default;
+
+        IndexIterator(const IndexIterator &) = delete;
+        void operator=(const IndexIterator &) = delete;
+
+        // read_options is used to read partitions, and must outlive the
+        // iterator, as must table.
+        void Initialize(const BlockBasedTable *table,
+                        const ReadOptions *read_options);
+
+        bool Valid() const
+        {
+            return partition_index_ == nullptr ? index_iter_.Valid()
+                                               : partition_iter_.Valid();
+        }
+        Slice key() const
+        {
+            assert(Valid());
+            return partition_index_ == nullptr ? index_iter_.key()
+                                               : partition_iter_.key();
+        }
+        Slice value() const
+        {
+            assert(Valid());
+            return partition_index_ == nullptr ? index_iter_.value()
+                                               : partition_iter_.value();
+        }
+        Status status() const
+        {
+            if (!index_iter_.status().ok() || partition_index_ == nullptr)
+            {
+                return index_iter_.status();
+            }
+            return partition_iter_.status();
+        }
+
+        void Seek(const Slice &target);
+        void SeekToFirst();
+        void SeekToLast();
+        void Next();
+        void Prev();
+
+    private:
+        // Points partition_iter_ at the partition index_iter_ points at,
+        // getting it unless it is the current one. Leaves partition_iter_
+        // invalid, with the error if any, when index_iter_ is invalid or the
+        // partition cannot be read.
+        void InitPartition();
+
+        // Moves to the next (previous) partition while partition_iter_ is
+        // exhausted without error.
+        void FindKeyForward();
+        void FindKeyBackward();
+
+        // nullptr unless the index is two-level
+        const PartitionIndexReader *partition_index_ = nullptr;
+        const ReadOptions *read_options_ = nullptr;
+        const InternalKeyComparator *icmp_ = nullptr;
+        BlockIter index_iter_; // the index block, or the top-level index
+        const Block *partition_ = nullptr;
+        std::unique_ptr<Block> partition_holder_; // unless pinned
+        BlockHandle partition_handle_;
+        BlockIter partition_iter_;
+    };
+}
@@ -0,0 +1,131 @@
+#include "table/block_based/parallel_checksum.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+#include "table/block_based/reader_common.h"
+
+namespace XIAODB_NAMESPACE
+{
+    struct ParallelChecksumVerifier::Batch
+    {
+        const Footer *footer;
+        const std::string *file_name;
+        size_t n;
+        const char *const *data;
+        const BlockHandle *handles;
+        Status *statuses;
+
+        // The next block to verify, claimed by whichever thread gets it.
+        std::atomic<size_t> next{0};
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        // Under mutex.
+        size_t verified = 0;
+    };
+
+    ParallelChecksumVerifier::ParallelChecksumVerifier(uint32_t num_threads)
+    {
+        assert(num_threads > 0);
+        threads_.reserve(num_threads);
+        for (uint32_t i = 0; i < num_threads; ++i)
+        {
+            threads_.emplace_back([this]
+                                  { Worker(); });
+        }
+    }
+
+    ParallelChecksumVerifier::~ParallelChecksumVerifier()
+    {
+        queue_.finish();
+        for (auto &thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    ParallelChecksumVerifier *ParallelChecksumVerifier::Shared(uint32_t num_threads)
+    {
+        static std::mutex mutex;
+        static std::map<uint32_t, std::unique_ptr<ParallelChecksumVerifier>> pools;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &pool = pools[num_threads];
+        if (pool == nullptr)
+        {
+            pool.reset(new ParallelChecksumVerifier(num_threads));
+        }
+        return pool.get();
+    }
+
+    void ParallelChecksumVerifier::VerifyBlocks(const Footer &footer,
+                                                const std::string &file_name,
+                                                size_t n, const char *const *data,
+                                                const BlockHandle *handles,
+                                                Status *statuses)
+    {
+        if (n == 0)
+        {
+            return;
+        }
+        auto batch = std::make_shared<Batch>();
+        batch->footer = &footer;
+        batch->file_name = &file_name;
+        batch->n = n;
+        batch->data = data;
+        batch->handles = handles;
+        batch->statuses = statuses;
+
+        // This thread verifies blocks too, so the pool needs to provide no
+        // more than the other n - 1.
+        const size_t helpers = std::min(threads_.size(), n - 1);
+        for (size_t i = 0; i < helpers; ++i)
+        {
+            queue_.push(batch);
+        }
+        Run(batch.get());
+
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->cv.wait(lock, [&]
+                       { return batch->verified == n; });
+    }
+
+    void ParallelChecksumVerifier::Run(Batch *batch)
+    {
+        size_t verified = 0;
+        for (size_t i = batch->next.fetch_add(1, std::memory_order_relaxed);
+             i < batch->n; i = batch->next.fetch_add(1, std::memory_order_relaxed))
+        {
+            const BlockHandle &handle = batch->handles[i];
+            batch->statuses[i] = VerifyBlockCheckSum(
+                *batch->footer, batch->data[i], static_cast<size_t>(handle.size()),
+                *batch->file_name, handle.offset());
+            ++verified;
+        }
+        if (verified > 0)
+        {
+            // The caller may return, and free the blocks, as soon as the
+            // count is complete: nothing of the batch but its own members is
+            // touched past this point.
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->verified += verified;
+            if (batch->verified == batch->n)
+            {
+                batch->cv.notify_all();
+            }
+        }
+    }
+
+    void ParallelChecksumVerifier::Worker()
+    {
+        std::shared_ptr<Batch> batch;
+        while (queue_.pop(batch))
+        {
+            Run(batch.get());
+            batch.reset();
+        }
+    }
+}
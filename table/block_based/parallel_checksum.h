@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "port/port.h"
+#include "table/format.h"
+#include "util/work_queue.h"
+#include "xiaodb/status.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Verifies the checksums of the blocks of a multi-block read on a pool of
+    // threads, so that large reads are not capped by the checksum speed of
+    // the thread reading. The thread calling VerifyBlocks() takes its share
+    // of the blocks too, and returns once they are all verified: the blocks
+    // are then decoded without verifying them again.
+    //
+    // A pool is shared by all the tables configured with the same number of
+    // threads (see BlockBasedTableOptions::checksum_verification_threads),
+    // and by concurrent reads, which queue their batches on it.
+    class ParallelChecksumVerifier
+    {
+    public:
+        // Below this many bytes in a batch, waking up the pool costs more
+        // than it saves, and the blocks are better verified inline.
+        static constexpr size_t kMinParallelBytes = 256 << 10;
+
+        explicit ParallelChecksumVerifier(uint32_t num_threads);
+
+        ParallelChecksumVerifier(const ParallelChecksumVerifier &) = delete;
+        void operator=(const ParallelChecksumVerifier &) = delete;
+
+        // Waits for the batches in flight and joins the threads.
+        ~ParallelChecksumVerifier();
+
+        // The pool of num_threads threads shared by the process, created on
+        // first use and never freed before exit.
+        // REQUIRES: num_threads > 0
+        static ParallelChecksumVerifier *Shared(uint32_t num_threads);
+
+        // Sets statuses[i] to VerifyBlockCheckSum() of the block of handles[i]
+        // read at data[i], for i in [0, n). Thread safe.
+        void VerifyBlocks(const Footer &footer, const std::string &file_name,
+                          size_t n, const char *const *data,
+                          const BlockHandle *handles, Status *statuses);
+
+    private:
+        struct Batch;
+
+        // Verifies blocks of batch until none is left.
+        static void Run(Batch *batch);
+
+        void Worker();
+
+        // A batch is queued once per thread it may use; the threads that
+        // find it done just drop it.
+        WorkQueue<std::shared_ptr<Batch>> queue_;
+        std::vector<port::Thread> threads_;
+    };
+}
@@ -0,0 +1,212 @@
+#include "table/block_based/parallel_compression.h"
+
+#include <algorithm>
+
+#include "util/coding.h"
+
+namespace XIAODB_NAMESPACE
+{
+    ParallelBlockCompressor::ParallelBlockCompressor(
+        FSWritableFile *file, uint64_t offset, CompressionType compression_type,
+        const CompressionOptions &compression_opts, ChecksumType checksum_type,
+        const CompressionDict &dict, CompressionDictSampler *sampler)
+        : file_(file),
+          compression_type_(compression_type),
+          compression_opts_(compression_opts),
+          checksum_type_(checksum_type),
+          dict_(dict),
+          sampler_(sampler),
+          start_offset_(offset),
+          offset_(offset),
+          file_size_(offset)
+    {
+        const uint32_t num_threads = std::max(compression_opts.parallel_threads, 1u);
+        const size_t num_reps = 2 * static_cast<size_t>(num_threads);
+        block_rep_buf_.reset(new BlockRep[num_reps]);
+        block_rep_pool_.setMaxSize(num_reps);
+        compress_queue_.setMaxSize(num_reps);
+        write_queue_.setMaxSize(num_reps);
+        for (size_t i = 0; i < num_reps; ++i)
+        {
+            block_rep_pool_.push(&block_rep_buf_[i]);
+        }
+
+        compress_threads_.reserve(num_threads);
+        for (uint32_t i = 0; i < num_threads; ++i)
+        {
+            compress_threads_.emplace_back([this]
+                                           { CompressWorker(); });
+        }
+        write_thread_ = port::Thread([this]
+                                     { WriteWorker(); });
+    }
+
+    ParallelBlockCompressor::~ParallelBlockCompressor()
+    {
+        if (!finished_)
+        {
+            Shutdown();
+        }
+    }
+
+    void ParallelBlockCompressor::Shutdown()
+    {
+        assert(!finished_);
+        finished_ = true;
+        // The workers fill the slots of all the queued blocks before they
+        // exit, so the writer cannot be left waiting on one.
+        compress_queue_.finish();
+        for (auto &thread : compress_threads_)
+        {
+            thread.join();
+        }
+        write_queue_.finish();
+        write_thread_.join();
+    }
+
+    IOStatus ParallelBlockCompressor::EmitBlock(const Slice &raw_block)
+    {
+        assert(!finished_);
+        if (!ok_.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(status_mutex_);
+            return io_status_;
+        }
+
+        // Waits for a block to be written if all of them are in flight.
+        BlockRep *rep = nullptr;
+        block_rep_pool_.pop(rep);
+        rep->raw.assign(raw_block.data(), raw_block.size());
+        ++num_blocks_;
+        if (sampler_ != nullptr)
+        {
+            sampler_->AddBlock(raw_block);
+        }
+        raw_bytes_emitted_.fetch_add(raw_block.size(), std::memory_order_relaxed);
+
+        // Neither queue can be full, as they hold no more than the BlockReps.
+        compress_queue_.push(rep);
+        write_queue_.push(&rep->slot);
+        return IOStatus::OK();
+    }
+
+    IOStatus ParallelBlockCompressor::Finish(std::vector<BlockHandle> *handles,
+                                             uint64_t *offset)
+    {
+        Shutdown();
+        *handles = std::move(handles_);
+        *offset = offset_;
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        return io_status_;
+    }
+
+    uint64_t ParallelBlockCompressor::EstimatedFileSize() const
+    {
+        const uint64_t file_size = file_size_.load(std::memory_order_relaxed);
+        const uint64_t raw_written = raw_bytes_written_.load(std::memory_order_relaxed);
+        const uint64_t raw_emitted = raw_bytes_emitted_.load(std::memory_order_relaxed);
+        if (raw_emitted <= raw_written)
+        {
+            return file_size;
+        }
+        const uint64_t in_flight = raw_emitted - raw_written;
+        if (raw_written == 0)
+        {
+            return file_size + in_flight;
+        }
+        const double ratio = static_cast<double>(file_size - start_offset_) /
+                             static_cast<double>(raw_written);
+        return file_size + static_cast<uint64_t>(static_cast<double>(in_flight) * ratio);
+    }
+
+    void ParallelBlockCompressor::CompressAndChecksum(CompressionContext *ctx,
+                                                      BlockRep *rep) const
+    {
+        const Slice raw(rep->raw);
+        rep->contents = raw;
+        CompressionType type = kNoCompression;
+        if (compression_type_ != kNoCompression &&
+            ok_.load(std::memory_order_relaxed))
+        {
+            rep->compressed.clear();
+            CompressionInfo info(compression_opts_, *ctx, dict_, compression_type_,
+                                 0 /* sample_for_compression */);
+            // Keep the block uncompressed unless compression saves enough.
+            const uint64_t max_compressed_size =
+                raw.size() *
+                static_cast<uint64_t>(std::max(compression_opts_.max_compressed_bytes_per_kb, 0)) /
+                1024;
+            if (CompressData(raw, info, 2 /* compress_format_version */,
+                             &rep->compressed) &&
+                rep->compressed.size() <= max_compressed_size)
+            {
+                rep->contents = Slice(rep->compressed);
+                type = compression_type_;
+            }
+        }
+
+        rep->trailer[0] = static_cast<char>(type);
+        EncodeFixed32(rep->trailer + 1,
+                      ComputeBuiltinChecksumWithLastByte(
+                          checksum_type_, rep->contents.data(),
+                          rep->contents.size(), rep->trailer[0]));
+    }
+
+    void ParallelBlockCompressor::CompressWorker()
+    {
+        // One context per worker, for all the blocks it compresses.
+        CompressionContext ctx(compression_type_, compression_opts_);
+        BlockRep *rep = nullptr;
+        while (compress_queue_.pop(rep))
+        {
+            CompressAndChecksum(&ctx, rep);
+            rep->slot.push(rep);
+        }
+    }
+
+    void ParallelBlockCompressor::WriteWorker()
+    {
+        BlockRepSlot *slot = nullptr;
+        while (write_queue_.pop(slot))
+        {
+            BlockRep *rep = nullptr;
+            slot->pop(rep);
+            if (ok_.load(std::memory_order_relaxed))
+            {
+                IOStatus s = file_->Append(rep->contents, IOOptions(), nullptr);
+                if (s.ok())
+                {
+                    s = file_->Append(Slice(rep->trailer, kBlockTrailerSize),
+                                      IOOptions(), nullptr);
+                }
+                if (s.ok())
+                {
+                    handles_.emplace_back(offset_, rep->contents.size());
+                    offset_ += rep->contents.size() + kBlockTrailerSize;
+                    file_size_.store(offset_, std::memory_order_relaxed);
+                    raw_bytes_written_.fetch_add(rep->raw.size(),
+                                                 std::memory_order_relaxed);
+                    if (rep->trailer[0] != static_cast<char>(kNoCompression))
+                    {
+                        compressed_blocks_.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                else
+                {
+                    SetIOStatus(s);
+                }
+            }
+            block_rep_pool_.push(rep);
+        }
+    }
+
+    void ParallelBlockCompressor::SetIOStatus(const IOStatus &s)
+    {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        if (io_status_.ok())
+        {
+            io_status_ = s;
+        }
+        ok_.store(false, std::memory_order_release);
+    }
+}
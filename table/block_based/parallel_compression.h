@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "port/port.h"
+#include "table/format.h"
+#include "util/compression.h"
+#include "util/compression_dict_trainer.h"
+#include "util/work_queue.h"
+#include "xiaodb/file_system.h"
+#include "xiaodb/io_status.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Compresses and writes the data blocks of a table file off the thread
+    // that builds them. The builder hands each finished block to
+    // EmitBlock() and carries on with the next one; a pool of
+    // compression_opts.parallel_threads workers compresses the blocks and
+    // computes their trailers, each with its own CompressionContext (and so
+    // its own ZSTD context, reused across blocks), and a writer thread
+    // appends them to the file in emission order.
+    //
+    // At most 2 * parallel_threads blocks are in flight: EmitBlock() blocks
+    // until one of them has been written, which bounds the memory used and
+    // keeps the builder from running ahead of the file.
+    //
+    //  EmitBlock() --> compress_queue_ --> workers (compress, checksum)
+    //       |                                   | fill the block's slot
+    //       +--------> write_queue_ (slots) --> writer (append in order)
+    class ParallelBlockCompressor
+    {
+    public:
+        // Blocks are written to file starting at offset, which is the size
+        // of what the file holds already. file must outlive the compressor.
+        // Blocks are kept uncompressed unless compression_type saves enough
+        // (see CompressionOptions::max_compressed_bytes_per_kb).
+        //
+        // Blocks are compressed with dict, which must outlive the compressor
+        // (e.g. the CompressionDictTrainer::Current() version in use), and
+        // fed to sampler, if any, to train the dictionaries of the next
+        // tables. sampler must not be used before Finish().
+        ParallelBlockCompressor(FSWritableFile *file, uint64_t offset,
+                                CompressionType compression_type,
+                                const CompressionOptions &compression_opts,
+                                ChecksumType checksum_type,
+                                const CompressionDict &dict = CompressionDict::GetEmptyDict(),
+                                CompressionDictSampler *sampler = nullptr);
+
+        ParallelBlockCompressor(const ParallelBlockCompressor &) = delete;
+        void operator=(const ParallelBlockCompressor &) = delete;
+
+        // Finishes the pipeline if Finish() has not been called.
+        ~ParallelBlockCompressor();
+
+        // Queues the (uncompressed) contents of the next data block. Returns
+        // the first error of the pipeline, after which further blocks are
+        // dropped.
+        // REQUIRES: Finish() has not been called.
+        IOStatus EmitBlock(const Slice &raw_block);
+
+        // Waits for all the blocks to be written, and returns their handles,
+        // in emission order, and the offset in the file past the last one.
+        IOStatus Finish(std::vector<BlockHandle> *handles, uint64_t *offset);
+
+        // The size the file will have once the blocks in flight are written,
+        // assuming they compress at the ratio of the blocks written so far.
+        // Table builders cut files at a target size with it, as the file
+        // size lags behind.
+        uint64_t EstimatedFileSize() const;
+
+        uint64_t NumBlocks() const { return num_blocks_; }
+        // Of the blocks written so far.
+        uint64_t RawBytes() const
+        {
+            return raw_bytes_written_.load(std::memory_order_relaxed);
+        }
+        uint64_t CompressedBlocks() const
+        {
+            return compressed_blocks_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct BlockRep;
+        // A block is handed from its worker to the writer through its slot,
+        // which the writer waits on in emission order.
+        using BlockRepSlot = WorkQueue<BlockRep *>;
+
+        struct BlockRep
+        {
+            std::string raw;
+            std::string compressed;
+            // Either raw or compressed.
+            Slice contents;
+            char trailer[kBlockTrailerSize];
+            BlockRepSlot slot{1};
+        };
+
+        void CompressWorker();
+        void WriteWorker();
+
+        // Drains the pipeline and joins its threads.
+        void Shutdown();
+
+        // Compresses rep->raw into rep->contents (or keeps it as is) and
+        // fills the trailer.
+        void CompressAndChecksum(CompressionContext *ctx, BlockRep *rep) const;
+
+        void SetIOStatus(const IOStatus &s);
+
+        FSWritableFile *const file_;
+        const CompressionType compression_type_;
+        const CompressionOptions compression_opts_;
+        const ChecksumType checksum_type_;
+        const CompressionDict &dict_;
+        CompressionDictSampler *const sampler_;
+
+        std::unique_ptr<BlockRep[]> block_rep_buf_;
+        // The BlockReps not in flight.
+        WorkQueue<BlockRep *> block_rep_pool_;
+        WorkQueue<BlockRep *> compress_queue_;
+        WorkQueue<BlockRepSlot *> write_queue_;
+        std::vector<port::Thread> compress_threads_;
+        port::Thread write_thread_;
+        bool finished_ = false;
+
+        // Set by the writer only, read by EmitBlock() and Finish().
+        std::atomic<bool> ok_{true};
+        mutable std::mutex status_mutex_;
+        IOStatus io_status_;
+
+        // Producer side.
+        uint64_t num_blocks_ = 0;
+        std::atomic<uint64_t> raw_bytes_emitted_{0};
+
+        // Writer side.
+        const uint64_t start_offset_;
+        uint64_t offset_;
+        std::vector<BlockHandle> handles_;
+        std::atomic<uint64_t> file_size_;
+        std::atomic<uint64_t> raw_bytes_written_{0};
+        std::atomic<uint64_t> compressed_blocks_{0};
+    };
+}
@@ -0,0 +1,257 @@
+#include "table/block_based/partitioned_filter_block.h"
+
+#include <algorithm>
+#include <array>
+
+#include "table/block_based/block_based_table_reader.h"
+#include "util/autovector.h"
+#include "xiaodb/filter_policy.h"
+
+namespace XIAODB_NAMESPACE
+{
+    Status PartitionedFilterBlockReader::Create(
+        const BlockBasedTable *table, const ReadOptions &ro,
+        const FilterPolicy *policy, const BlockHandle &handle, bool pin_partitions,
+        std::unique_ptr<PartitionedFilterBlockReader> *reader)
+    {
+        std::unique_ptr<PartitionedFilterBlockReader> new_reader(
+            new PartitionedFilterBlockReader(table, policy));
+        Status s = table->ReadBlock(ro, handle, &new_reader->index_block_,
+                                    nullptr /* prefetch_buffer */,
+                                    BlockType::kFilterPartitionIndex);
+        if (!s.ok())
+        {
+            return s;
+        }
+        if (new_reader->index_block_->size() == 0)
+        {
+            return Status::Corruption("bad partitioned filter index block");
+        }
+
+        if (pin_partitions)
+        {
+            std::vector<BlockHandle> handles;
+            BlockIter biter;
+            new_reader->index_block_->InitIter(&table->internal_comparator(), &biter);
+            for (biter.SeekToFirst(); biter.Valid(); biter.Next())
+            {
+                BlockHandle partition_handle;
+                s = BlockBasedTable::DecodeIndexValue(biter.value(), &partition_handle);
+                if (!s.ok())
+                {
+                    return s;
+                }
+                handles.push_back(partition_handle);
+            }
+            if (!biter.status().ok())
+            {
+                return biter.status();
+            }
+
+            std::vector<BlockContents> contents(handles.size());
+            s = table->RetrieveBlocks(ro, handles.data(), handles.size(),
+                                      contents.data());
+            if (!s.ok())
+            {
+                return s;
+            }
+            new_reader->partition_offsets_.reserve(handles.size());
+            new_reader->partitions_.reserve(handles.size());
+            for (size_t i = 0; i < handles.size(); ++i)
+            {
+                std::unique_ptr<Partition> partition;
+                s = new_reader->CreatePartition(std::move(contents[i]), &partition);
+                if (!s.ok())
+                {
+                    return s;
+                }
+                new_reader->partition_offsets_.push_back(handles[i].offset());
+                new_reader->partitions_.push_back(std::move(partition));
+            }
+        }
+        *reader = std::move(new_reader);
+        return Status::OK();
+    }
+
+    Status PartitionedFilterBlockReader::CreatePartition(
+        BlockContents &&contents, std::unique_ptr<Partition> *partition) const
+    {
+        std::unique_ptr<Partition> new_partition(new Partition);
+        new_partition->contents = std::move(contents);
+        new_partition->filter.reset(
+            policy_->GetFilterBitsReader(new_partition->contents.data));
+        if (new_partition->filter == nullptr)
+        {
+            return Status::Corruption("bad filter partition");
+        }
+        *partition = std::move(new_partition);
+        return Status::OK();
+    }
+
+    Status PartitionedFilterBlockReader::GetPartitionHandle(
+        const Slice &internal_key, BlockHandle *handle) const
+    {
+        BlockIter biter;
+        index_block_->InitIter(&table_->internal_comparator(), &biter);
+        biter.Seek(internal_key);
+        if (!biter.Valid())
+        {
+            if (!biter.status().ok())
+            {
+                return biter.status();
+            }
+            // The key is larger than all the keys, so it is not in the table
+            // unless the last partition's boundary key is not an upper bound
+            // of the user keys it covers. Checking the last partition is
+            // unnecessary but safe, and unlikely to happen for a key that
+            // made it past the table's key range checks.
+            biter.SeekToLast();
+            if (!biter.Valid())
+            {
+                return biter.status().ok()
+                           ? Status::Corruption("empty partitioned filter index")
+                           : biter.status();
+            }
+        }
+        return BlockBasedTable::DecodeIndexValue(biter.value(), handle);
+    }
+
+    Status PartitionedFilterBlockReader::GetPartitions(
+        const ReadOptions &ro, const BlockHandle *handles, size_t n,
+        std::unique_ptr<Partition> *holders, const Partition **partitions) const
+    {
+        autovector<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> to_read;
+        autovector<size_t, MultiGetContext::MAX_BATCH_SIZE> to_read_index;
+        for (size_t i = 0; i < n; ++i)
+        {
+            partitions[i] = nullptr;
+            auto it = std::lower_bound(partition_offsets_.begin(),
+                                       partition_offsets_.end(), handles[i].offset());
+            if (it != partition_offsets_.end() && *it == handles[i].offset())
+            {
+                partitions[i] = partitions_[it - partition_offsets_.begin()].get();
+            }
+            else
+            {
+                to_read.push_back(handles[i]);
+                to_read_index.push_back(i);
+            }
+        }
+        if (to_read.empty())
+        {
+            return Status::OK();
+        }
+
+        std::vector<BlockContents> contents(to_read.size());
+        Status s = table_->RetrieveBlocks(ro, &to_read[0], to_read.size(),
+                                          contents.data());
+        for (size_t j = 0; s.ok() && j < to_read.size(); ++j)
+        {
+            const size_t i = to_read_index[j];
+            s = CreatePartition(std::move(contents[j]), &holders[i]);
+            partitions[i] = holders[i].get();
+        }
+        return s;
+    }
+
+    bool PartitionedFilterBlockReader::KeyMayMatch(const ReadOptions &ro,
+                                                   const Slice &internal_key) const
+    {
+        BlockHandle handle;
+        std::unique_ptr<Partition> holder;
+        const Partition *partition = nullptr;
+        Status s = GetPartitionHandle(internal_key, &handle);
+        if (s.ok())
+        {
+            s = GetPartitions(ro, &handle, 1, &holder, &partition);
+        }
+        if (!s.ok())
+        {
+            // Without the filter, the key may be anywhere.
+            s.PermitUncheckedError();
+            return true;
+        }
+        return partition->filter->MayMatch(ExtractUserKey(internal_key));
+    }
+
+    void PartitionedFilterBlockReader::KeysMayMatch(
+        const ReadOptions &ro, MultiGetContext::Range *range) const
+    {
+        // The keys are sorted, so the keys sharing a partition are adjacent.
+        autovector<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> handles;
+        std::array<size_t, MultiGetContext::MAX_BATCH_SIZE> key_partition;
+        std::array<bool, MultiGetContext::MAX_BATCH_SIZE> has_partition;
+        for (auto iter = range->begin(); iter != range->end(); ++iter)
+        {
+            BlockHandle handle;
+            has_partition[iter.index()] = GetPartitionHandle(iter->ikey, &handle).ok();
+            if (!has_partition[iter.index()])
+            {
+                continue;
+            }
+            if (handles.empty() || handles.back() != handle)
+            {
+                handles.push_back(handle);
+            }
+            key_partition[iter.index()] = handles.size() - 1;
+        }
+        if (handles.empty())
+        {
+            return;
+        }
+
+        std::array<std::unique_ptr<Partition>, MultiGetContext::MAX_BATCH_SIZE> holders;
+        std::array<const Partition *, MultiGetContext::MAX_BATCH_SIZE> partitions;
+        Status s = GetPartitions(ro, &handles[0], handles.size(), holders.data(),
+                                 partitions.data());
+        if (!s.ok())
+        {
+            // Without the filter, the keys may be anywhere.
+            s.PermitUncheckedError();
+            return;
+        }
+
+        // Probe every partition with its run of keys as one batch.
+        auto start = range->end();
+        size_t current = 0;
+        auto probe = [&](const MultiGetContext::Range::Iterator &end)
+        {
+            if (start == range->end())
+            {
+                return;
+            }
+            MultiGetContext::Range subrange(*range, start, end);
+            partitions[current]->filter->MayMatch(&subrange);
+            range->AddSkipsFrom(subrange);
+        };
+        for (auto iter = range->begin(); iter != range->end(); ++iter)
+        {
+            if (!has_partition[iter.index()])
+            {
+                // Left unfiltered, and not part of any run.
+                probe(iter);
+                start = range->end();
+                continue;
+            }
+            if (start == range->end() || key_partition[iter.index()] != current)
+            {
+                probe(iter);
+                start = iter;
+                current = key_partition[iter.index()];
+            }
+        }
+        probe(range->end());
+    }
+
+    size_t PartitionedFilterBlockReader::ApproximateMemoryUsage() const
+    {
+        size_t usage = sizeof(*this) + index_block_->ApproximateMemoryUsage() +
+                       partition_offsets_.capacity() * sizeof(uint64_t) +
+                       partitions_.capacity() * sizeof(std::unique_ptr<Partition>);
+        for (const auto &partition : partitions_)
+        {
+            usage += sizeof(Partition) + partition->contents.ApproximateMemoryUsage();
+        }
+        return usage;
+    }
+}
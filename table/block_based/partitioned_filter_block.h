@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "table/block_based/block.h"
+#include "table/block_based/filter_policy_internal.h"
+#include "table/format.h"
+#include "table/multiget_context.h"
+#include "xiaodb/options.h"
+#include "xiaodb/status.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class BlockBasedTable;
+
+    // Reader of a partitioned whole-key filter (partition_filters). The filter
+    // block in the metaindex is then a top-level index with one entry per
+    // filter partition, keyed by an internal key at or after the last key the
+    // partition covers and mapping to its handle, and every partition is a
+    // full filter over its keys.
+    //
+    // The reader holds the top-level index. Like index partitions (see
+    // PartitionIndexReader), filter partitions are read on demand unless they
+    // are to be pinned, in which case they are all read at Create() with a
+    // single coalesced read.
+    class PartitionedFilterBlockReader
+    {
+    public:
+        // table and policy must outlive the reader.
+        static Status Create(const BlockBasedTable *table, const ReadOptions &ro,
+                             const FilterPolicy *policy, const BlockHandle &handle,
+                             bool pin_partitions,
+                             std::unique_ptr<PartitionedFilterBlockReader> *reader);
+
+        // Returns false if the user key of internal_key is definitely not in
+        // the table. A partition that cannot be read matches everything.
+        bool KeyMayMatch(const ReadOptions &ro, const Slice &internal_key) const;
+
+        // Skips the keys of range that are definitely not in the table, reading
+        // the partitions the batch needs together.
+        void KeysMayMatch(const ReadOptions &ro, MultiGetContext::Range *range) const;
+
+        size_t ApproximateMemoryUsage() const;
+
+    private:
+        struct Partition
+        {
+            // The filter bits reader points into contents.
+            BlockContents contents;
+            std::unique_ptr<FilterBitsReader> filter;
+        };
+
+        PartitionedFilterBlockReader(const BlockBasedTable *table,
+                                     const FilterPolicy *policy)
+            : table_(table), policy_(policy) {}
+
+        // Returns the handle of the partition that covers internal_key.
+        Status GetPartitionHandle(const Slice &internal_key,
+                                  BlockHandle *handle) const;
+
+        // Sets partitions[i] to the partition at handles[i], which must be in
+        // file order: the pinned partition, or one read into holders[i]. The
+        // partitions that are not pinned are read together.
+        Status GetPartitions(const ReadOptions &ro, const BlockHandle *handles,
+                             size_t n, std::unique_ptr<Partition> *holders,
+                             const Partition **partitions) const;
+
+        Status CreatePartition(BlockContents &&contents,
+                               std::unique_ptr<Partition> *partition) const;
+
+        const BlockBasedTable *table_;
+        const FilterPolicy *policy_;
+        std::unique_ptr<Block> index_block_; // top-level index
+        // The pinned partitions, in file order, and their offsets.
+        std::vector<uint64_t> partition_offsets_;
+        std::vector<std::unique_ptr<Partition>> partitions_;
+    };
+}
@@ -0,0 +1,123 @@
+#include "table/block_based/partitioned_index_reader.h"
+
+#include <algorithm>
+
+#include "table/block_based/block_based_table_reader.h"
+#include "util/autovector.h"
+
+namespace XIAODB_NAMESPACE
+{
+    Status PartitionIndexReader::Create(
+        const BlockBasedTable *table, const ReadOptions &ro, bool pin_partitions,
+        std::unique_ptr<PartitionIndexReader> *index_reader)
+    {
+        std::unique_ptr<PartitionIndexReader> reader(new PartitionIndexReader(table));
+        if (pin_partitions)
+        {
+            std::vector<BlockHandle> handles;
+            BlockIter biter;
+            table->index_block().InitIter(&table->internal_comparator(), &biter);
+            for (biter.SeekToFirst(); biter.Valid(); biter.Next())
+            {
+                BlockHandle handle;
+                Status s = BlockBasedTable::DecodeIndexValue(biter.value(), &handle);
+                if (!s.ok())
+                {
+                    return s;
+                }
+                handles.push_back(handle);
+            }
+            if (!biter.status().ok())
+            {
+                return biter.status();
+            }
+
+            std::vector<BlockContents> contents(handles.size());
+            Status s = table->RetrieveBlocks(ro, handles.data(), handles.size(),
+                                             contents.data());
+            if (!s.ok())
+            {
+                return s;
+            }
+            reader->partition_offsets_.reserve(handles.size());
+            reader->partitions_.reserve(handles.size());
+            for (size_t i = 0; i < handles.size(); ++i)
+            {
+                std::unique_ptr<Block> partition(new Block(std::move(contents[i])));
+                if (partition->size() == 0)
+                {
+                    return Status::Corruption("bad index partition");
+                }
+                reader->partition_offsets_.push_back(handles[i].offset());
+                reader->partitions_.push_back(std::move(partition));
+            }
+        }
+        *index_reader = std::move(reader);
+        return Status::OK();
+    }
+
+    const Block *PartitionIndexReader::GetPinnedPartition(
+        const BlockHandle &handle) const
+    {
+        auto it = std::lower_bound(partition_offsets_.begin(),
+                                   partition_offsets_.end(), handle.offset());
+        if (it == partition_offsets_.end() || *it != handle.offset())
+        {
+            return nullptr;
+        }
+        return partitions_[it - partition_offsets_.begin()].get();
+    }
+
+    Status PartitionIndexReader::GetPartitions(const ReadOptions &ro,
+                                               const BlockHandle *handles, size_t n,
+                                               std::unique_ptr<Block> *holders,
+                                               const Block **partitions) const
+    {
+        autovector<BlockHandle, MultiGetContext::MAX_BATCH_SIZE> to_read;
+        autovector<size_t, MultiGetContext::MAX_BATCH_SIZE> to_read_index;
+        for (size_t i = 0; i < n; ++i)
+        {
+            partitions[i] = GetPinnedPartition(handles[i]);
+            if (partitions[i] == nullptr)
+            {
+                to_read.push_back(handles[i]);
+                to_read_index.push_back(i);
+            }
+        }
+        if (to_read.empty())
+        {
+            return Status::OK();
+        }
+
+        std::vector<BlockContents> contents(to_read.size());
+        Status s = table_->RetrieveBlocks(ro, &to_read[0], to_read.size(),
+                                          contents.data());
+        if (!s.ok())
+        {
+            return s;
+        }
+        for (size_t j = 0; j < to_read.size(); ++j)
+        {
+            const size_t i = to_read_index[j];
+            holders[i].reset(new Block(std::move(contents[j])));
+            if (holders[i]->size() == 0)
+            {
+                return Status::Corruption("bad index partition");
+            }
+            partitions[i] = holders[i].get();
+        }
+        return Status::OK();
+    }
+
+    size_t PartitionIndexReader::ApproximateMemoryUsage() const
+    {
+        size_t usage = sizeof(*this) +
+                       partition_offsets_.capacity() * sizeof(uint64_t) +
+                       partitions_.capacity() * sizeof(std::unique_ptr<Block>);
+        for (const auto &partition : partitions_)
+        {
+            usage += partition->ApproximateMemoryUsage();
+        }
+        return usage;
+    }
+}
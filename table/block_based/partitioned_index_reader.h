@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "table/block_based/block.h"
+#include "table/format.h"
+#include "xiaodb/options.h"
+#include "xiaodb/status.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class BlockBasedTable;
+
+    // Index partitions of a two-level index (kTwoLevelIndexSearch). The index
+    // block the footer points at is then a top-level index with one entry per
+    // partition, keyed by the last key of the partition and mapping to its
+    // handle, and the partitions are ordinary index blocks over the data
+    // blocks. The table holds the top-level index; this reader hands out the
+    // partitions.
+    //
+    // Partitions are read on demand, unless they are to be pinned, in which
+    // case all of them are read at Create() with a single coalesced read, as
+    // partitions are adjacent in the file.
+    class PartitionIndexReader
+    {
+    public:
+        // table must outlive the reader, and have its top-level index read.
+        static Status Create(const BlockBasedTable *table, const ReadOptions &ro,
+                             bool pin_partitions,
+                             std::unique_ptr<PartitionIndexReader> *index_reader);
+
+        // Sets partitions[i] to the partition at handles[i], which must be in
+        // file order: the pinned partition, or one read into holders[i]. The
+        // partitions that are not pinned are read together.
+        Status GetPartitions(const ReadOptions &ro, const BlockHandle *handles,
+                             size_t n, std::unique_ptr<Block> *holders,
+                             const Block **partitions) const;
+
+        size_t ApproximateMemoryUsage() const;
+
+    private:
+        explicit PartitionIndexReader(const BlockBasedTable *table)
+            : table_(table) {}
+
+        // Returns the pinned partition at handle, or nullptr if it is not
+        // pinned.
+        const Block *GetPinnedPartition(const BlockHandle &handle) const;
+
+        const BlockBasedTable *table_;
+        // The pinned partitions, in file order, and their offsets.
+        std::vector<uint64_t> partition_offsets_;
+        std::vector<std::unique_ptr<Block>> partitions_;
+    };
+}
@@ -27,4 +27,13 @@ namespace XIAODB_NAMESPACE
     Status VerifyBlockCheckSum(const Footer &footer, const char *data,
                                size_t block_size, const std::string &file_name,
                                uint64_t offset);
+
+    // Same as VerifyBlockCheckSum(), also copying the block_size bytes of
+    // payload at `data` to `dst` in the same pass over them, for a block that
+    // must be copied out of its read buffer anyway. On mismatch, `dst` is
+    // left with the copy, which the caller should discard.
+    Status VerifyBlockCheckSumAndCopy(const Footer &footer, char *dst,
+                                      const char *data, size_t block_size,
+                                      const std::string &file_name,
+                                      uint64_t offset);
 }
\ No newline at end of file
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "util/coding.h"
+#include "xiaodb/slice.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // A data block may store, next to its restart array, a fixed-width prefix
+    // of the user key at every restart point, so that the restart binary search
+    // of BlockIter::Seek() can narrow down the restart interval without
+    // decoding a single entry:
+    //
+    //     restarts: uint32[num_restarts]
+    //     hash index (optional, see data_block_hash_index.h)
+    //     prefixes: uint64[num_restarts]
+    //     prefix_offset: uint32
+    //     footer: uint32 (see data_block_footer.h)
+    //
+    // All restart user keys of a block share the bytes [0, prefix_offset) of
+    // the first one (prefix_offset is the common prefix length of the first
+    // and the last restart user keys). prefixes[i] is the next 8 bytes of the
+    // ith restart user key, zero padded and read as a big-endian integer, so
+    // that comparing prefixes as integers orders keys bytewise. Only blocks of
+    // internal keys with a bytewise user comparator get a prefix array.
+    const size_t kRestartKeyPrefixSize = sizeof(uint64_t);
+
+    // Restart arrays up to this length are counted with a linear (SIMD) scan,
+    // longer ones with a binary search.
+    const uint32_t kMaxRestartKeyPrefixLinearScan = 64;
+
+    inline uint64_t EncodeRestartKeyPrefix(const Slice &user_key, size_t offset)
+    {
+        uint64_t prefix = 0;
+        for (size_t i = 0; i < kRestartKeyPrefixSize; ++i)
+        {
+            prefix <<= 8;
+            if (offset + i < user_key.size())
+            {
+                prefix |= static_cast<unsigned char>(user_key[offset + i]);
+            }
+        }
+        return prefix;
+    }
+
+    // Sets *lt (*le) to the number of prefixes in the sorted array of n
+    // fixed64 prefixes that are < (<=) target.
+    inline void CountRestartKeyPrefixes(const char *prefixes, uint32_t n,
+                                        uint64_t target, uint32_t *lt,
+                                        uint32_t *le)
+    {
+        if (n > kMaxRestartKeyPrefixLinearScan)
+        {
+            uint32_t lo = 0;
+            uint32_t hi = n;
+            while (lo < hi)
+            {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (DecodeFixed64(prefixes + mid * kRestartKeyPrefixSize) < target)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            *lt = lo;
+            hi = n;
+            while (lo < hi)
+            {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (DecodeFixed64(prefixes + mid * kRestartKeyPrefixSize) <= target)
+                {
+                    lo = mid + 1;
+                }
+                else
+                {
+                    hi = mid;
+                }
+            }
+            *le = lo;
+            return;
+        }
+
+        uint32_t num_lt = 0;
+        uint32_t num_gt = 0;
+        uint32_t i = 0;
+#ifdef __AVX2__
+        // x86 is little-endian, so the fixed64 prefixes load as they are.
+        // There is no unsigned 64-bit compare, so flip the sign bits and use
+        // the signed one. Matching lanes are -1, so subtracting the masks
+        // counts them per lane.
+        const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(1ull << 63));
+        const __m256i t = _mm256_xor_si256(
+            _mm256_set1_epi64x(static_cast<long long>(target)), sign);
+        __m256i lt_counts = _mm256_setzero_si256();
+        __m256i gt_counts = _mm256_setzero_si256();
+        for (; i + 4 <= n; i += 4)
+        {
+            __m256i p = _mm256_xor_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+                    prefixes + i * kRestartKeyPrefixSize)),
+                sign);
+            lt_counts = _mm256_sub_epi64(lt_counts, _mm256_cmpgt_epi64(t, p));
+            gt_counts = _mm256_sub_epi64(gt_counts, _mm256_cmpgt_epi64(p, t));
+        }
+        alignas(32) uint64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), lt_counts);
+        num_lt = static_cast<uint32_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), gt_counts);
+        num_gt = static_cast<uint32_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+#endif
+        for (; i < n; ++i)
+        {
+            uint64_t p = DecodeFixed64(prefixes + i * kRestartKeyPrefixSize);
+            num_lt += p < target;
+            num_gt += p > target;
+        }
+        *lt = num_lt;
+        *le = n - num_gt;
+    }
+}
@@ -0,0 +1,484 @@
+#include "table/cuckoo/cuckoo_table_builder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "db/dbformat.h"
+#include "table/block_based/block_builder.h"
+
+namespace XIAODB_NAMESPACE
+{
+    const std::string CuckooTablePropertyNames::kEmptyKey = "xiaodb.cuckoo.bucket.empty.key";
+    const std::string CuckooTablePropertyNames::kValueLength =
+        "xiaodb.cuckoo.value.length";
+    const std::string CuckooTablePropertyNames::kNumHashFunc =
+        "xiaodb.cuckoo.hash.num";
+    const std::string CuckooTablePropertyNames::kHashTableSize =
+        "xiaodb.cuckoo.hash.size";
+    const std::string CuckooTablePropertyNames::kIsLastLevel =
+        "xiaodb.cuckoo.file.islastlevel";
+    const std::string CuckooTablePropertyNames::kCuckooBlockSize =
+        "xiaodb.cuckoo.hash.cuckooblocksize";
+    const std::string CuckooTablePropertyNames::kIdentityAsFirstHash =
+        "xiaodb.cuckoo.hash.identityfirst";
+    const std::string CuckooTablePropertyNames::kUseModuleHash =
+        "xiaodb.cuckoo.hash.usemodule";
+    const std::string CuckooTablePropertyNames::kUserKeyLength =
+        "xiaodb.cuckoo.hash.userkeylength";
+
+    const std::string CuckooTableFormat::kPropertiesBlockName = "xiaodb.properties";
+    const std::string CuckooTableFormat::kNumEntries = "xiaodb.num.entries";
+    const std::string CuckooTableFormat::kRawKeySize = "xiaodb.raw.key.size";
+    const std::string CuckooTableFormat::kRawValueSize = "xiaodb.raw.value.size";
+    const std::string CuckooTableFormat::kDataSize = "xiaodb.data.size";
+
+    namespace
+    {
+        std::string EncodeVarint64Property(uint64_t value)
+        {
+            std::string encoded;
+            PutVarint64(&encoded, value);
+            return encoded;
+        }
+
+        // Flush the buckets to the file in chunks of this size.
+        constexpr size_t kWriteBufferSize = 1 << 20;
+    }
+
+    CuckooTableBuilder::CuckooTableBuilder(const CuckooTableOptions &table_options,
+                                           const Comparator *user_comparator,
+                                           FSWritableFile *file)
+        : table_options_(table_options),
+          user_comparator_(user_comparator),
+          file_(file),
+          cuckoo_block_size_(std::max<uint32_t>(table_options.cuckoo_block_size, 1))
+    {
+        if (table_options_.hash_table_ratio <= 0 || table_options_.hash_table_ratio > 1)
+        {
+            status_ = Status::InvalidArgument("hash_table_ratio must be in (0, 1]");
+        }
+        properties_.format_version = CuckooTableFormat::kFormatVersion;
+    }
+
+    CuckooTableBuilder::~CuckooTableBuilder() = default;
+
+    void CuckooTableBuilder::Add(const Slice &key, const Slice &value)
+    {
+        assert(!closed_);
+        if (!status_.ok())
+        {
+            return;
+        }
+        ParsedInternalKey ikey;
+        status_ = ParseInternalKey(key, &ikey, false /* log_err_key */);
+        if (!status_.ok())
+        {
+            return;
+        }
+        if (ikey.type != kTypeValue)
+        {
+            status_ = Status::NotSupported("cuckoo table only supports kTypeValue entries");
+            return;
+        }
+        if (num_entries_ == 0)
+        {
+            user_key_len_ = ikey.user_key.size();
+            value_len_ = value.size();
+            entry_size_ = key.size() + value.size();
+            if (user_key_len_ == 0)
+            {
+                status_ = Status::NotSupported("cuckoo table does not support empty keys");
+                return;
+            }
+            if (table_options_.identity_as_first_hash && user_key_len_ != sizeof(uint64_t))
+            {
+                status_ = Status::InvalidArgument(
+                    "identity_as_first_hash requires user keys of 8 bytes");
+                return;
+            }
+        }
+        else
+        {
+            if (ikey.user_key.size() != user_key_len_ || value.size() != value_len_)
+            {
+                status_ = Status::NotSupported(
+                    "cuckoo table keys and values must have fixed lengths");
+                return;
+            }
+            if (user_comparator_->Compare(ikey.user_key, largest_user_key_) <= 0)
+            {
+                status_ = Status::NotSupported(
+                    "cuckoo table keys must be added in increasing order, "
+                    "one entry per user key");
+                return;
+            }
+        }
+        if (num_entries_ >= kEmptyBucket)
+        {
+            status_ = Status::NotSupported("too many entries for a cuckoo table");
+            return;
+        }
+        if (ikey.sequence != 0)
+        {
+            is_last_level_ = false;
+        }
+        largest_user_key_.assign(ikey.user_key.data(), ikey.user_key.size());
+        kvs_.append(key.data(), key.size());
+        kvs_.append(value.data(), value.size());
+        num_entries_++;
+        properties_.num_entries++;
+        properties_.raw_key_size += key.size();
+        properties_.raw_value_size += value.size();
+    }
+
+    uint64_t CuckooTableBuilder::FileSize() const
+    {
+        if (closed_)
+        {
+            return offset_;
+        }
+        // The size of the hash table to come.
+        return static_cast<uint64_t>(static_cast<double>(kvs_.size()) /
+                                     table_options_.hash_table_ratio);
+    }
+
+    Status CuckooTableBuilder::MakeHashTable()
+    {
+        const uint64_t min_size = static_cast<uint64_t>(
+            std::ceil(static_cast<double>(num_entries_) / table_options_.hash_table_ratio));
+        if (table_options_.use_module_hash)
+        {
+            hash_table_size_ = std::max<uint64_t>(min_size, 1);
+        }
+        else
+        {
+            hash_table_size_ = 1;
+            while (hash_table_size_ < min_size)
+            {
+                hash_table_size_ <<= 1;
+            }
+        }
+        const uint64_t num_buckets = hash_table_size_ + cuckoo_block_size_ - 1;
+        if (num_buckets > kEmptyBucket)
+        {
+            return Status::NotSupported("cuckoo hash table too large");
+        }
+        buckets_.assign(num_buckets, CuckooBucket());
+        num_hash_func_ = CuckooTableFormat::kInitialNumHashFunc;
+
+        uint32_t make_space_call_id = 0;
+        for (uint32_t entry = 0; entry < num_entries_; ++entry)
+        {
+            const Slice user_key = GetUserKey(entry);
+            bool placed = false;
+            for (uint32_t hash_cnt = 0; hash_cnt < num_hash_func_ && !placed; ++hash_cnt)
+            {
+                const uint64_t start = Hash(user_key, hash_cnt);
+                for (uint32_t i = 0; i < cuckoo_block_size_; ++i)
+                {
+                    if (buckets_[start + i].entry == kEmptyBucket)
+                    {
+                        buckets_[start + i].entry = entry;
+                        placed = true;
+                        break;
+                    }
+                }
+            }
+            while (!placed)
+            {
+                uint64_t bucket_id = 0;
+                if (MakeSpaceForKey(entry, ++make_space_call_id, &bucket_id))
+                {
+                    buckets_[bucket_id].entry = entry;
+                    placed = true;
+                    continue;
+                }
+                if (num_hash_func_ == CuckooTableFormat::kMaxNumHashFunc)
+                {
+                    return Status::NotSupported("cannot build the cuckoo hash table; "
+                                                "lower hash_table_ratio");
+                }
+                // The keys placed so far stay in the blocks of the hash
+                // functions they were placed with.
+                const uint64_t start = Hash(user_key, num_hash_func_++);
+                for (uint32_t i = 0; i < cuckoo_block_size_; ++i)
+                {
+                    if (buckets_[start + i].entry == kEmptyBucket)
+                    {
+                        buckets_[start + i].entry = entry;
+                        placed = true;
+                        break;
+                    }
+                }
+            }
+        }
+        return Status::OK();
+    }
+
+    bool CuckooTableBuilder::MakeSpaceForKey(uint32_t entry, uint32_t call_id,
+                                             uint64_t *bucket_id)
+    {
+        struct CuckooNode
+        {
+            uint64_t bucket_id;
+            uint32_t depth;
+            // Position of the node whose key would move into this bucket.
+            size_t parent_pos;
+        };
+        constexpr size_t kNoParent = SIZE_MAX;
+
+        // Breadth first search over the moves, from the (all full) cuckoo
+        // blocks of the entry, for an empty bucket.
+        std::vector<CuckooNode> tree;
+        const Slice user_key = GetUserKey(entry);
+        for (uint32_t hash_cnt = 0; hash_cnt < num_hash_func_; ++hash_cnt)
+        {
+            const uint64_t start = Hash(user_key, hash_cnt);
+            for (uint32_t i = 0; i < cuckoo_block_size_; ++i)
+            {
+                CuckooBucket &bucket = buckets_[start + i];
+                if (bucket.make_space_call_id != call_id)
+                {
+                    bucket.make_space_call_id = call_id;
+                    tree.push_back({start + i, 0, kNoParent});
+                }
+            }
+        }
+        for (size_t pos = 0; pos < tree.size(); ++pos)
+        {
+            const CuckooNode node = tree[pos];
+            if (node.depth >= table_options_.max_search_depth)
+            {
+                // The nodes are in depth order.
+                break;
+            }
+            const Slice moved_key = GetUserKey(buckets_[node.bucket_id].entry);
+            for (uint32_t hash_cnt = 0; hash_cnt < num_hash_func_; ++hash_cnt)
+            {
+                const uint64_t start = Hash(moved_key, hash_cnt);
+                for (uint32_t i = 0; i < cuckoo_block_size_; ++i)
+                {
+                    CuckooBucket &bucket = buckets_[start + i];
+                    if (bucket.make_space_call_id == call_id)
+                    {
+                        continue;
+                    }
+                    bucket.make_space_call_id = call_id;
+                    tree.push_back({start + i, node.depth + 1, pos});
+                    if (bucket.entry != kEmptyBucket)
+                    {
+                        continue;
+                    }
+                    // Move the keys along the path, from the empty bucket up
+                    // to a bucket of the entry, which is left free.
+                    size_t child = tree.size() - 1;
+                    while (tree[child].parent_pos != kNoParent)
+                    {
+                        const size_t parent = tree[child].parent_pos;
+                        buckets_[tree[child].bucket_id].entry =
+                            buckets_[tree[parent].bucket_id].entry;
+                        child = parent;
+                    }
+                    *bucket_id = tree[child].bucket_id;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool CuckooTableBuilder::Contains(const Slice &user_key) const
+    {
+        for (uint32_t hash_cnt = 0; hash_cnt < num_hash_func_; ++hash_cnt)
+        {
+            const uint64_t start = Hash(user_key, hash_cnt);
+            for (uint32_t i = 0; i < cuckoo_block_size_; ++i)
+            {
+                const uint32_t entry = buckets_[start + i].entry;
+                if (entry == kEmptyBucket)
+                {
+                    return false;
+                }
+                if (user_comparator_->Equal(GetUserKey(entry), user_key))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    Status CuckooTableBuilder::GetUnusedUserKey(std::string *unused_user_key) const
+    {
+        // Count up from the largest key, as a big-endian number, wrapping
+        // around. Among num_entries + 1 distinct keys, one is unused.
+        std::string candidate = largest_user_key_;
+        for (uint64_t attempt = 0; attempt <= num_entries_; ++attempt)
+        {
+            size_t i = candidate.size();
+            while (i > 0 && static_cast<unsigned char>(candidate[i - 1]) == 0xff)
+            {
+                candidate[--i] = 0;
+            }
+            if (i > 0)
+            {
+                candidate[i - 1]++;
+            }
+            if (!Contains(candidate))
+            {
+                *unused_user_key = std::move(candidate);
+                return Status::OK();
+            }
+        }
+        return Status::NotSupported("no unused key left for the empty buckets");
+    }
+
+    IOStatus CuckooTableBuilder::Append(const Slice &data)
+    {
+        IOStatus s = file_->Append(data, IOOptions(), nullptr);
+        if (s.ok())
+        {
+            offset_ += data.size();
+        }
+        return s;
+    }
+
+    IOStatus CuckooTableBuilder::WriteMetaBlock(const Slice &contents,
+                                                BlockHandle *handle)
+    {
+        handle->set_offset(offset_);
+        handle->set_size(contents.size());
+        char trailer[kBlockTrailerSize];
+        trailer[0] = kNoCompression;
+        EncodeFixed32(trailer + 1,
+                      ComputeBuiltinChecksumWithLastByte(kCRC32c, contents.data(),
+                                                         contents.size(), trailer[0]));
+        IOStatus s = Append(contents);
+        if (s.ok())
+        {
+            s = Append(Slice(trailer, kBlockTrailerSize));
+        }
+        return s;
+    }
+
+    Status CuckooTableBuilder::Finish()
+    {
+        assert(!closed_);
+        closed_ = true;
+        if (!status_.ok())
+        {
+            return status_;
+        }
+
+        std::string unused_user_key;
+        if (num_entries_ > 0)
+        {
+            status_ = MakeHashTable();
+            if (status_.ok())
+            {
+                status_ = GetUnusedUserKey(&unused_user_key);
+            }
+            if (!status_.ok())
+            {
+                return status_;
+            }
+        }
+
+        // The buckets, in chunks.
+        const size_t ikey_len = user_key_len_ + kNumInternalBytes;
+        const size_t key_len = is_last_level_ ? user_key_len_ : ikey_len;
+        std::string empty_bucket = unused_user_key;
+        if (!is_last_level_)
+        {
+            PutFixed64(&empty_bucket, PackSequenceAndType(0, kTypeValue));
+        }
+        empty_bucket.append(value_len_, '\0');
+        std::string buffer;
+        buffer.reserve(kWriteBufferSize + entry_size_);
+        for (const CuckooBucket &bucket : buckets_)
+        {
+            if (bucket.entry == kEmptyBucket)
+            {
+                buffer.append(empty_bucket);
+            }
+            else
+            {
+                const char *kv = kvs_.data() + uint64_t{bucket.entry} * entry_size_;
+                buffer.append(kv, key_len);
+                buffer.append(kv + ikey_len, value_len_);
+            }
+            if (buffer.size() >= kWriteBufferSize)
+            {
+                io_status_ = Append(buffer);
+                if (!io_status_.ok())
+                {
+                    status_ = io_status_;
+                    return status_;
+                }
+                buffer.clear();
+            }
+        }
+        io_status_ = Append(buffer);
+        properties_.data_size = offset_;
+        properties_.fixed_key_len = user_key_len_;
+
+        BlockHandle properties_handle;
+        if (io_status_.ok())
+        {
+            std::map<std::string, std::string> props;
+            props[CuckooTableFormat::kNumEntries] =
+                EncodeVarint64Property(properties_.num_entries);
+            props[CuckooTableFormat::kRawKeySize] =
+                EncodeVarint64Property(properties_.raw_key_size);
+            props[CuckooTableFormat::kRawValueSize] =
+                EncodeVarint64Property(properties_.raw_value_size);
+            props[CuckooTableFormat::kDataSize] =
+                EncodeVarint64Property(properties_.data_size);
+            props[CuckooTablePropertyNames::kEmptyKey] = unused_user_key;
+            props[CuckooTablePropertyNames::kValueLength] =
+                EncodeVarint64Property(value_len_);
+            props[CuckooTablePropertyNames::kNumHashFunc] =
+                EncodeVarint64Property(num_hash_func_);
+            props[CuckooTablePropertyNames::kHashTableSize] =
+                EncodeVarint64Property(hash_table_size_);
+            props[CuckooTablePropertyNames::kIsLastLevel] =
+                EncodeVarint64Property(is_last_level_);
+            props[CuckooTablePropertyNames::kCuckooBlockSize] =
+                EncodeVarint64Property(cuckoo_block_size_);
+            props[CuckooTablePropertyNames::kIdentityAsFirstHash] =
+                EncodeVarint64Property(table_options_.identity_as_first_hash);
+            props[CuckooTablePropertyNames::kUseModuleHash] =
+                EncodeVarint64Property(table_options_.use_module_hash);
+            props[CuckooTablePropertyNames::kUserKeyLength] =
+                EncodeVarint64Property(user_key_len_);
+            BlockBuilder props_block(1 /* block_restart_interval */);
+            for (const auto &prop : props)
+            {
+                props_block.Add(prop.first, prop.second);
+            }
+            io_status_ = WriteMetaBlock(props_block.Finish(), &properties_handle);
+        }
+
+        BlockHandle metaindex_handle;
+        if (io_status_.ok())
+        {
+            BlockBuilder metaindex_block(1 /* block_restart_interval */);
+            std::string encoded_handle;
+            properties_handle.EncodeTo(&encoded_handle);
+            metaindex_block.Add(CuckooTableFormat::kPropertiesBlockName, encoded_handle);
+            io_status_ = WriteMetaBlock(metaindex_block.Finish(), &metaindex_handle);
+        }
+        if (io_status_.ok())
+        {
+            FooterBuilder footer;
+            footer.Build(kCuckooTableMagicNumber, CuckooTableFormat::kFormatVersion,
+                         kCRC32c, metaindex_handle, BlockHandle::NullBlockHandle());
+            io_status_ = Append(footer.GetSlice());
+        }
+        status_ = io_status_;
+        return status_;
+    }
+
+    void CuckooTableBuilder::Abandon() { closed_ = true; }
+}
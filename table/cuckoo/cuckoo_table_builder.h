@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "table/cuckoo/cuckoo_table_format.h"
+#include "table/format.h"
+#include "table/table_builder.h"
+#include "xiaodb/comparator.h"
+#include "xiaodb/file_checksum.h"
+#include "xiaodb/file_system.h"
+#include "xiaodb/table.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Builds a cuckoo table (see cuckoo_table_format.h) for point lookups
+    // into an immutable data set. The entries are buffered in memory until
+    // Finish(), which places them into the hash table and writes it out.
+    //
+    // All the user keys must have the same length, and so must all the
+    // values. Only kTypeValue entries are supported, one per user key.
+    class CuckooTableBuilder : public TableBuilder
+    {
+    public:
+        // user_comparator and file must outlive the builder.
+        CuckooTableBuilder(const CuckooTableOptions &table_options,
+                           const Comparator *user_comparator, FSWritableFile *file);
+
+        CuckooTableBuilder(const CuckooTableBuilder &) = delete;
+        void operator=(const CuckooTableBuilder &) = delete;
+
+        ~CuckooTableBuilder() override;
+
+        void Add(const Slice &key, const Slice &value) override;
+
+        Status status() const override { return status_; }
+        IOStatus io_status() const override { return io_status_; }
+
+        Status Finish() override;
+        void Abandon() override;
+
+        uint64_t NumEntries() const override { return num_entries_; }
+        uint64_t FileSize() const override;
+
+        TableProperties GetTableProperties() const override { return properties_; }
+
+        std::string GetFileChecksum() const override { return kUnknownFileChecksum; }
+        const char *GetFileChecksumFuncName() const override
+        {
+            return kUnknownFileChecksumFuncName;
+        }
+
+    private:
+        static constexpr uint32_t kEmptyBucket = UINT32_MAX;
+
+        struct CuckooBucket
+        {
+            // Index of the entry, or kEmptyBucket.
+            uint32_t entry = kEmptyBucket;
+            // The last MakeSpaceForKey() call that visited the bucket.
+            uint32_t make_space_call_id = 0;
+        };
+
+        Slice GetUserKey(uint32_t entry) const
+        {
+            return Slice(kvs_.data() + uint64_t{entry} * entry_size_, user_key_len_);
+        }
+
+        uint64_t Hash(const Slice &user_key, uint32_t hash_cnt) const
+        {
+            return CuckooHash(user_key, hash_cnt, table_options_.use_module_hash,
+                              hash_table_size_, table_options_.identity_as_first_hash);
+        }
+
+        // Places all the entries into buckets_, adding hash functions as
+        // needed.
+        Status MakeHashTable();
+
+        // Tries to free a bucket in the cuckoo blocks of entry by moving the
+        // keys in the way to other buckets of theirs, breadth first, looking
+        // at most max_search_depth moves deep. On success, sets *bucket_id to
+        // the freed bucket.
+        bool MakeSpaceForKey(uint32_t entry, uint32_t call_id, uint64_t *bucket_id);
+
+        // Whether user_key is in the hash table.
+        bool Contains(const Slice &user_key) const;
+
+        // Finds a user key that is not in the table, to fill the empty
+        // buckets with.
+        Status GetUnusedUserKey(std::string *unused_user_key) const;
+
+        IOStatus Append(const Slice &data);
+        IOStatus WriteMetaBlock(const Slice &contents, BlockHandle *handle);
+
+        const CuckooTableOptions table_options_;
+        const Comparator *user_comparator_;
+        FSWritableFile *file_;
+
+        // The entries, each the internal key followed by the value.
+        std::string kvs_;
+        uint64_t num_entries_ = 0;
+        size_t user_key_len_ = 0;
+        size_t value_len_ = 0;
+        size_t entry_size_ = 0;
+        // Whether all the entries have sequence number 0, in which case the
+        // buckets only hold user keys.
+        bool is_last_level_ = true;
+        std::string largest_user_key_;
+
+        uint32_t num_hash_func_ = 0;
+        uint32_t cuckoo_block_size_ = 1;
+        uint64_t hash_table_size_ = 0;
+        std::vector<CuckooBucket> buckets_;
+
+        uint64_t offset_ = 0;
+        TableProperties properties_;
+        Status status_;
+        IOStatus io_status_;
+        bool closed_ = false;
+    };
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "util/coding.h"
+#include "util/hash.h"
+#include "xiaodb/slice.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // A cuckoo table file is laid out as
+    //
+    //   buckets[hash_table_size + cuckoo_block_size - 1]
+    //   properties block
+    //   metaindex block
+    //   footer             (magic number kCuckooTableMagicNumber)
+    //
+    // Every bucket is a key of fixed length followed by a value of fixed
+    // length. The keys are user keys if the table only holds entries of
+    // sequence number 0 (CuckooTablePropertyNames::kIsLastLevel), internal
+    // keys otherwise. Empty buckets hold kEmptyKey, a user key that is not in
+    // the table, and a zeroed value.
+    //
+    // A key is in the cuckoo block (cuckoo_block_size consecutive buckets)
+    // starting at the bucket of one of its num_hash_func hash functions (see
+    // CuckooHash()), in the first bucket, in probe order, that was empty when
+    // it was inserted. Buckets never get emptied, so a lookup stops at the
+    // first empty bucket.
+    //
+    // The meta blocks have the usual block trailer (compression type and
+    // checksum) and are never compressed. The properties and metaindex blocks
+    // are in the BlockBuilder format; integer properties, including those of
+    // CuckooTablePropertyNames, are varint64 encoded.
+    struct CuckooTableFormat
+    {
+        static const std::string kPropertiesBlockName;
+
+        static const std::string kNumEntries;
+        static const std::string kRawKeySize;
+        static const std::string kRawValueSize;
+        static const std::string kDataSize;
+
+        static constexpr uint32_t kFormatVersion = 1;
+
+        // The builder starts with two hash functions, so that a lookup probes
+        // at most two cuckoo blocks, and adds more only if the keys cannot be
+        // placed otherwise.
+        static constexpr uint32_t kInitialNumHashFunc = 2;
+        static constexpr uint32_t kMaxNumHashFunc = 64;
+    };
+
+    // The first bucket of the cuckoo block of user_key for its hash_cnt-th
+    // hash function, in a table of table_size buckets (excluding the
+    // cuckoo_block_size - 1 trailing ones). Without use_module_hash,
+    // table_size is a power of two.
+    inline uint64_t CuckooHash(const Slice &user_key, uint32_t hash_cnt,
+                               bool use_module_hash, uint64_t table_size,
+                               bool identity_as_first_hash)
+    {
+        constexpr uint64_t kCuckooMurmurSeedMultiplier = 816922183;
+        uint64_t value = 0;
+        if (hash_cnt == 0 && identity_as_first_hash)
+        {
+            // The user key is 8 bytes long.
+            value = DecodeFixed64(user_key.data());
+        }
+        else
+        {
+            value = Hash64(user_key.data(), user_key.size(),
+                           kCuckooMurmurSeedMultiplier * hash_cnt);
+        }
+        return use_module_hash ? value % table_size : value & (table_size - 1);
+    }
+}
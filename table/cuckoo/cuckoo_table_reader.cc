@@ -0,0 +1,487 @@
+#include "table/cuckoo/cuckoo_table_reader.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "memory/arena.h"
+#include "port/port.h"
+#include "table/block_based/block.h"
+#include "xiaodb/cleanable.h"
+#include "xiaodb/table.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        // Cleanup of the values Get() pins in the mapping of the file.
+        void ReleaseMapping(void *arg1, void * /*arg2*/)
+        {
+            delete static_cast<std::shared_ptr<const MemMapping> *>(arg1);
+        }
+    }
+
+    // Iterates over the entries of a CuckooTableReader in key order, which
+    // it sets up on its first seek by sorting the non-empty buckets.
+    class CuckooTableIterator : public InternalIterator
+    {
+    public:
+        explicit CuckooTableIterator(const CuckooTableReader *table) : table_(table) {}
+
+        bool Valid() const override { return curr_ < sorted_bucket_ids_.size(); }
+
+        void SeekToFirst() override
+        {
+            InitIfNeeded();
+            curr_ = 0;
+            PrepareKey();
+        }
+
+        void SeekToLast() override
+        {
+            InitIfNeeded();
+            curr_ = sorted_bucket_ids_.empty() ? 0 : sorted_bucket_ids_.size() - 1;
+            PrepareKey();
+        }
+
+        void Seek(const Slice &target) override;
+
+        void SeekForPrev(const Slice &target) override
+        {
+            Seek(target);
+            if (!Valid())
+            {
+                SeekToLast();
+            }
+            else if (table_->internal_comparator_.Compare(key(), target) > 0)
+            {
+                Prev();
+            }
+        }
+
+        void Next() override
+        {
+            assert(Valid());
+            ++curr_;
+            PrepareKey();
+        }
+
+        void Prev() override
+        {
+            assert(Valid());
+            curr_ = curr_ == 0 ? sorted_bucket_ids_.size() : curr_ - 1;
+            PrepareKey();
+        }
+
+        Slice key() const override
+        {
+            assert(Valid());
+            return curr_key_;
+        }
+
+        Slice value() const override
+        {
+            assert(Valid());
+            return curr_value_;
+        }
+
+        Status status() const override { return Status::OK(); }
+
+    private:
+        void InitIfNeeded();
+
+        // Points curr_key_ and curr_value_ at the entry at curr_, if valid.
+        void PrepareKey();
+
+        const CuckooTableReader *table_;
+        bool initialized_ = false;
+        // The ids of the non-empty buckets, in key order.
+        std::vector<uint32_t> sorted_bucket_ids_;
+        size_t curr_ = 0;
+        // With user keys only in the buckets, the internal key is rebuilt in
+        // key_buf_.
+        std::string key_buf_;
+        Slice curr_key_;
+        Slice curr_value_;
+    };
+
+    void CuckooTableIterator::InitIfNeeded()
+    {
+        if (initialized_)
+        {
+            return;
+        }
+        initialized_ = true;
+        sorted_bucket_ids_.reserve(table_->table_properties_->num_entries);
+        for (uint64_t id = 0; id < table_->num_buckets_; ++id)
+        {
+            const Slice user_key = table_->GetUserKey(table_->GetBucket(id));
+            if (!table_->user_comparator_->Equal(user_key, table_->unused_user_key_))
+            {
+                sorted_bucket_ids_.push_back(static_cast<uint32_t>(id));
+            }
+        }
+        // The table has one entry per user key.
+        const Comparator *ucmp = table_->user_comparator_;
+        std::sort(sorted_bucket_ids_.begin(), sorted_bucket_ids_.end(),
+                  [this, ucmp](uint32_t a, uint32_t b)
+                  {
+                      return ucmp->Compare(table_->GetUserKey(table_->GetBucket(a)),
+                                           table_->GetUserKey(table_->GetBucket(b))) < 0;
+                  });
+        curr_ = sorted_bucket_ids_.size();
+    }
+
+    void CuckooTableIterator::Seek(const Slice &target)
+    {
+        InitIfNeeded();
+        const Slice target_user_key = ExtractUserKey(target);
+        const uint64_t target_packed = ExtractInternalKeyFooter(target);
+        const Comparator *ucmp = table_->user_comparator_;
+        // Internal keys of the same user key are in decreasing order of their
+        // packed sequence number and type.
+        auto it = std::lower_bound(
+            sorted_bucket_ids_.begin(), sorted_bucket_ids_.end(), target,
+            [&](uint32_t id, const Slice & /*target*/)
+            {
+                const char *bucket = table_->GetBucket(id);
+                const int r = ucmp->Compare(table_->GetUserKey(bucket), target_user_key);
+                return r < 0 ||
+                       (r == 0 && table_->GetPackedSequenceAndType(bucket) > target_packed);
+            });
+        curr_ = static_cast<size_t>(it - sorted_bucket_ids_.begin());
+        PrepareKey();
+    }
+
+    void CuckooTableIterator::PrepareKey()
+    {
+        if (!Valid())
+        {
+            return;
+        }
+        const char *bucket = table_->GetBucket(sorted_bucket_ids_[curr_]);
+        if (table_->is_last_level_)
+        {
+            key_buf_.assign(bucket, table_->user_key_len_);
+            PutFixed64(&key_buf_, PackSequenceAndType(0, kTypeValue));
+            curr_key_ = key_buf_;
+        }
+        else
+        {
+            curr_key_ = Slice(bucket, table_->key_len_);
+        }
+        curr_value_ = Slice(bucket + table_->key_len_, table_->value_len_);
+    }
+
+    CuckooTableReader::CuckooTableReader(const InternalKeyComparator &internal_comparator,
+                                         std::unique_ptr<RandomAccessFileReader> &&file)
+        : internal_comparator_(internal_comparator),
+          user_comparator_(internal_comparator.user_comparator()),
+          file_(std::move(file)) {}
+
+    CuckooTableReader::~CuckooTableReader() = default;
+
+    Status CuckooTableReader::Open(const ReadOptions &ro,
+                                   const InternalKeyComparator &internal_comparator,
+                                   std::unique_ptr<RandomAccessFileReader> &&file,
+                                   uint64_t file_size,
+                                   std::unique_ptr<TableReader> *table_reader)
+    {
+        table_reader->reset();
+
+        IOOptions opts;
+        Status s = file->PrepareIOOptions(ro, opts);
+        if (!s.ok())
+        {
+            return s;
+        }
+        std::unique_ptr<CuckooTableReader> new_table(
+            new CuckooTableReader(internal_comparator, std::move(file)));
+        CuckooTableReader *rep = new_table.get();
+
+        MemMapping mapping = MemMapping::MapFileReadOnly(rep->file_->file_name());
+        if (mapping.Get() != nullptr && mapping.Length() >= file_size)
+        {
+            // The buckets are probed at random.
+            mapping.Advise(MemMapping::Advice::kRandom);
+            rep->mmap_ = std::make_shared<const MemMapping>(std::move(mapping));
+            rep->file_data_ =
+                Slice(static_cast<const char *>(rep->mmap_->Get()), file_size);
+        }
+        else
+        {
+            rep->file_copy_.reset(new char[file_size]);
+            s = rep->file_->Read(opts, 0, file_size, &rep->file_data_,
+                                 rep->file_copy_.get(), nullptr /* aligned_buf */);
+            if (!s.ok())
+            {
+                return s;
+            }
+            if (rep->file_data_.size() != file_size)
+            {
+                return Status::Corruption("truncated cuckoo table " +
+                                          rep->file_->file_name());
+            }
+        }
+
+        if (file_size < Footer::kEncodedLength)
+        {
+            return Status::Corruption("file is too short to be a cuckoo table: " +
+                                      rep->file_->file_name());
+        }
+        const uint64_t footer_offset = file_size - Footer::kEncodedLength;
+        s = rep->footer_.DecodeFrom(
+            Slice(rep->file_data_.data() + footer_offset, Footer::kEncodedLength),
+            footer_offset);
+        if (!s.ok())
+        {
+            return s;
+        }
+        if (rep->footer_.table_magic_number() != kCuckooTableMagicNumber)
+        {
+            return Status::Corruption("not a cuckoo table: " + rep->file_->file_name());
+        }
+        s = rep->ReadProperties(ro);
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        *table_reader = std::move(new_table);
+        return Status::OK();
+    }
+
+    Status CuckooTableReader::ReadMetaBlock(const ReadOptions &ro,
+                                            const BlockHandle &handle,
+                                            BlockContents *contents) const
+    {
+        if (handle.offset() > file_data_.size() ||
+            file_data_.size() - handle.offset() < handle.size() + kBlockTrailerSize)
+        {
+            return Status::Corruption("cuckoo table meta block out of bounds in " +
+                                      file_->file_name());
+        }
+        // The file data outlives the reader's use of the block.
+        return DecodeSerializedBlock(footer_, CacheAllocationPtr(),
+                                     file_data_.data() + handle.offset(), handle,
+                                     ro.verify_checksums, file_->file_name(), contents,
+                                     nullptr /* allocator */, true /* data_is_pinned */);
+    }
+
+    Status CuckooTableReader::ReadProperties(const ReadOptions &ro)
+    {
+        BlockContents metaindex_contents;
+        Status s = ReadMetaBlock(ro, footer_.metaindex_handle(), &metaindex_contents);
+        if (!s.ok())
+        {
+            return s;
+        }
+        Block metaindex(std::move(metaindex_contents));
+        BlockIter meta_iter;
+        metaindex.InitIter(nullptr /* bytewise */, &meta_iter);
+        meta_iter.Seek(CuckooTableFormat::kPropertiesBlockName);
+        if (!meta_iter.Valid() ||
+            meta_iter.key() != Slice(CuckooTableFormat::kPropertiesBlockName))
+        {
+            s = meta_iter.status();
+            return s.ok() ? Status::Corruption("cuckoo table without properties: " +
+                                               file_->file_name())
+                          : s;
+        }
+        BlockHandle properties_handle;
+        Slice handle_input = meta_iter.value();
+        s = properties_handle.DecodeFrom(&handle_input);
+        BlockContents properties_contents;
+        if (s.ok())
+        {
+            s = ReadMetaBlock(ro, properties_handle, &properties_contents);
+        }
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        auto props = std::make_shared<TableProperties>();
+        props->format_version = footer_.format_version();
+        uint64_t value_len = 0;
+        uint64_t num_hash_func = 0;
+        uint64_t cuckoo_block_size = 0;
+        uint64_t is_last_level = 0;
+        uint64_t identity_as_first_hash = 0;
+        uint64_t use_module_hash = 0;
+        bool has_empty_key = false;
+        const std::pair<const std::string *, uint64_t *> varint_props[] = {
+            {&CuckooTableFormat::kNumEntries, &props->num_entries},
+            {&CuckooTableFormat::kRawKeySize, &props->raw_key_size},
+            {&CuckooTableFormat::kRawValueSize, &props->raw_value_size},
+            {&CuckooTableFormat::kDataSize, &props->data_size},
+            {&CuckooTablePropertyNames::kValueLength, &value_len},
+            {&CuckooTablePropertyNames::kNumHashFunc, &num_hash_func},
+            {&CuckooTablePropertyNames::kHashTableSize, &hash_table_size_},
+            {&CuckooTablePropertyNames::kIsLastLevel, &is_last_level},
+            {&CuckooTablePropertyNames::kCuckooBlockSize, &cuckoo_block_size},
+            {&CuckooTablePropertyNames::kIdentityAsFirstHash, &identity_as_first_hash},
+            {&CuckooTablePropertyNames::kUseModuleHash, &use_module_hash},
+            {&CuckooTablePropertyNames::kUserKeyLength, &props->fixed_key_len},
+        };
+        Block properties(std::move(properties_contents));
+        BlockIter props_iter;
+        properties.InitIter(nullptr /* bytewise */, &props_iter);
+        for (props_iter.SeekToFirst(); props_iter.Valid() && s.ok(); props_iter.Next())
+        {
+            const Slice name = props_iter.key();
+            if (name == Slice(CuckooTablePropertyNames::kEmptyKey))
+            {
+                unused_user_key_ = props_iter.value().ToString();
+                has_empty_key = true;
+                continue;
+            }
+            for (const auto &prop : varint_props)
+            {
+                if (name == Slice(*prop.first))
+                {
+                    Slice input = props_iter.value();
+                    if (!GetVarint64(&input, prop.second))
+                    {
+                        s = Status::Corruption("bad cuckoo table property");
+                    }
+                    break;
+                }
+            }
+        }
+        if (s.ok())
+        {
+            s = props_iter.status();
+        }
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        user_key_len_ = static_cast<size_t>(props->fixed_key_len);
+        is_last_level_ = is_last_level != 0;
+        key_len_ = user_key_len_ + (is_last_level_ ? 0 : kNumInternalBytes);
+        value_len_ = static_cast<size_t>(value_len);
+        bucket_len_ = key_len_ + value_len_;
+        num_hash_func_ = static_cast<uint32_t>(num_hash_func);
+        cuckoo_block_size_ = static_cast<uint32_t>(cuckoo_block_size);
+        identity_as_first_hash_ = identity_as_first_hash != 0;
+        use_module_hash_ = use_module_hash != 0;
+        if (props->num_entries > 0)
+        {
+            num_buckets_ = hash_table_size_ + cuckoo_block_size_ - 1;
+            if (!has_empty_key || unused_user_key_.size() != user_key_len_ ||
+                user_key_len_ == 0 || num_hash_func_ == 0 ||
+                num_hash_func_ > CuckooTableFormat::kMaxNumHashFunc ||
+                cuckoo_block_size_ == 0 || hash_table_size_ == 0 ||
+                (!use_module_hash_ && (hash_table_size_ & (hash_table_size_ - 1)) != 0) ||
+                (identity_as_first_hash_ && user_key_len_ != sizeof(uint64_t)) ||
+                num_buckets_ > UINT32_MAX ||
+                props->data_size != num_buckets_ * bucket_len_ ||
+                props->data_size > footer_.metaindex_handle().offset())
+            {
+                return Status::Corruption("bad cuckoo table properties in " +
+                                          file_->file_name());
+            }
+        }
+        buckets_ = file_data_.data();
+        table_properties_ = std::move(props);
+        return Status::OK();
+    }
+
+    InternalIterator *CuckooTableReader::NewIterator(
+        const ReadOptions & /*read_options*/, const SliceTransform * /*prefix_extractor*/,
+        Arena *arena, bool /*skip_filters*/, TableReaderCaller /*caller*/,
+        size_t /*compaction_readahead_size*/, bool /*allow_unprepared_value*/)
+    {
+        if (arena == nullptr)
+        {
+            return new CuckooTableIterator(this);
+        }
+        auto *mem = arena->AllocateAligned(sizeof(CuckooTableIterator));
+        return new (mem) CuckooTableIterator(this);
+    }
+
+    Status CuckooTableReader::Get(const ReadOptions & /*readOptions*/, const Slice &key,
+                                  GetContext *get_context,
+                                  const SliceTransform * /*prefix_extractor*/,
+                                  bool /*skip_filters*/)
+    {
+        const Slice user_key = ExtractUserKey(key);
+        if (num_buckets_ == 0 || user_key.size() != user_key_len_)
+        {
+            return Status::OK();
+        }
+        // Prefetch the cuckoo blocks of the first two hash functions, which
+        // hold nearly all the keys, so that their cache misses overlap.
+        const uint32_t num_prefetched = std::min<uint32_t>(num_hash_func_, 2);
+        uint64_t starts[2];
+        for (uint32_t hash_cnt = 0; hash_cnt < num_prefetched; ++hash_cnt)
+        {
+            starts[hash_cnt] = Hash(user_key, hash_cnt);
+            PREFETCH(GetBucket(starts[hash_cnt]), 0, 3);
+        }
+
+        for (uint32_t hash_cnt = 0; hash_cnt < num_hash_func_; ++hash_cnt)
+        {
+            const uint64_t start =
+                hash_cnt < num_prefetched ? starts[hash_cnt] : Hash(user_key, hash_cnt);
+            const char *bucket = GetBucket(start);
+            for (uint32_t i = 0; i < cuckoo_block_size_; ++i, bucket += bucket_len_)
+            {
+                const Slice bucket_user_key = GetUserKey(bucket);
+                if (user_comparator_->Equal(bucket_user_key, user_key))
+                {
+                    const uint64_t packed = GetPackedSequenceAndType(bucket);
+                    // The only entry of the user key may be newer than the
+                    // lookup.
+                    if (packed > ExtractInternalKeyFooter(key))
+                    {
+                        return Status::OK();
+                    }
+                    ParsedInternalKey parsed_key;
+                    parsed_key.user_key = bucket_user_key;
+                    UnPackSequenceAndType(packed, &parsed_key.sequence, &parsed_key.type);
+
+                    // Values are returned without a copy out of the mapping,
+                    // pinning it.
+                    const bool pin_values = mmap_ != nullptr;
+                    Cleanable value_pinner;
+                    if (pin_values)
+                    {
+                        value_pinner.RegisterCleanup(
+                            &ReleaseMapping, new std::shared_ptr<const MemMapping>(mmap_),
+                            nullptr);
+                    }
+                    bool matched = false;
+                    Status s;
+                    get_context->SaveValue(parsed_key,
+                                           Slice(bucket + key_len_, value_len_),
+                                           &matched, &s,
+                                           pin_values ? &value_pinner : nullptr);
+                    return s;
+                }
+                if (user_comparator_->Equal(bucket_user_key, unused_user_key_))
+                {
+                    // The buckets of a key before it in probe order are never
+                    // empty.
+                    return Status::OK();
+                }
+            }
+        }
+        return Status::OK();
+    }
+
+    void CuckooTableReader::Prepare(const Slice &target)
+    {
+        const Slice user_key = ExtractUserKey(target);
+        if (num_buckets_ > 0 && user_key.size() == user_key_len_)
+        {
+            PREFETCH(GetBucket(Hash(user_key, 0)), 0, 3);
+        }
+    }
+
+    size_t CuckooTableReader::ApproximateMemoryUsage() const
+    {
+        return file_copy_ != nullptr ? file_data_.size() : 0;
+    }
+}
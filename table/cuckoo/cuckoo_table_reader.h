@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "db/dbformat.h"
+#include "file/random_access_file_reader.h"
+#include "port/mmap.h"
+#include "table/cuckoo/cuckoo_table_format.h"
+#include "table/format.h"
+#include "table/table_reader.h"
+#include "xiaodb/table_properties.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class CuckooTableIterator;
+
+    // Reader for the cuckoo table format (see cuckoo_table_format.h), for
+    // point lookups: a key is looked up in the cuckoo blocks of its hash
+    // functions, in place, out of a read-only mapping of the file (or a copy
+    // of the file read at Open() if it cannot be mapped). The builder uses
+    // two hash functions unless the keys could not be placed with them, so a
+    // lookup usually probes two cuckoo blocks, which are prefetched together
+    // to overlap their cache misses.
+    //
+    // Iteration is supported, but costly: every iterator sorts the buckets
+    // on its first seek.
+    class CuckooTableReader : public TableReader
+    {
+    public:
+        // Attempt to open the table that is stored in bytes [0..file_size)
+        // of "file". The hashing options are taken from the table
+        // properties. internal_comparator must outlive the reader.
+        static Status Open(const ReadOptions &ro,
+                           const InternalKeyComparator &internal_comparator,
+                           std::unique_ptr<RandomAccessFileReader> &&file,
+                           uint64_t file_size,
+                           std::unique_ptr<TableReader> *table_reader);
+
+        ~CuckooTableReader() override;
+
+        InternalIterator *NewIterator(const ReadOptions &,
+                                      const SliceTransform *prefix_extractor,
+                                      Arena *arena, bool skip_filters,
+                                      TableReaderCaller caller,
+                                      size_t compaction_readahead_size = 0,
+                                      bool allow_unprepared_value = false) override;
+
+        Status Get(const ReadOptions &readOptions, const Slice &key,
+                   GetContext *get_context, const SliceTransform *prefix_extractor,
+                   bool skip_filters = false) override;
+
+        // The keys are laid out in hash order.
+        uint64_t ApproximateOffsetOf(const ReadOptions & /*read_options*/,
+                                     const Slice & /*key*/,
+                                     TableReaderCaller /*caller*/) override
+        {
+            return 0;
+        }
+
+        uint64_t ApproximateSize(const ReadOptions & /*read_options*/,
+                                 const Slice & /*start*/, const Slice & /*end*/,
+                                 TableReaderCaller /*caller*/) override
+        {
+            return 0;
+        }
+
+        void SetupForCompaction() override {}
+
+        std::shared_ptr<const TableProperties> GetTableProperties() const override
+        {
+            return table_properties_;
+        }
+
+        // Prefetches the first cuckoo block of target.
+        void Prepare(const Slice &target) override;
+
+        size_t ApproximateMemoryUsage() const override;
+
+    private:
+        friend class CuckooTableIterator;
+
+        CuckooTableReader(const InternalKeyComparator &internal_comparator,
+                          std::unique_ptr<RandomAccessFileReader> &&file);
+
+        // Reads the table properties, with the file data set up.
+        Status ReadProperties(const ReadOptions &ro);
+
+        // Decodes the meta block at handle in place out of the file data.
+        Status ReadMetaBlock(const ReadOptions &ro, const BlockHandle &handle,
+                             BlockContents *contents) const;
+
+        const char *GetBucket(uint64_t bucket_id) const
+        {
+            return buckets_ + bucket_id * bucket_len_;
+        }
+
+        Slice GetUserKey(const char *bucket) const
+        {
+            return Slice(bucket, user_key_len_);
+        }
+
+        // The packed sequence number and type of the entry of a bucket.
+        uint64_t GetPackedSequenceAndType(const char *bucket) const
+        {
+            return is_last_level_ ? PackSequenceAndType(0, kTypeValue)
+                                  : DecodeFixed64(bucket + user_key_len_);
+        }
+
+        uint64_t Hash(const Slice &user_key, uint32_t hash_cnt) const
+        {
+            return CuckooHash(user_key, hash_cnt, use_module_hash_, hash_table_size_,
+                              identity_as_first_hash_);
+        }
+
+        const InternalKeyComparator &internal_comparator_;
+        const Comparator *user_comparator_;
+        std::unique_ptr<RandomAccessFileReader> file_;
+        // The whole file: mapped read-only, shared with the values Get()
+        // pins in it, or read into file_copy_.
+        std::shared_ptr<const MemMapping> mmap_;
+        std::unique_ptr<char[]> file_copy_;
+        Slice file_data_;
+        Footer footer_;
+
+        const char *buckets_ = nullptr;
+        uint64_t num_buckets_ = 0;
+        uint64_t hash_table_size_ = 0;
+        uint32_t num_hash_func_ = 0;
+        uint32_t cuckoo_block_size_ = 0;
+        bool is_last_level_ = false;
+        bool identity_as_first_hash_ = false;
+        bool use_module_hash_ = false;
+        std::string unused_user_key_;
+        size_t user_key_len_ = 0;
+        // user_key_len_, plus the internal key footer unless is_last_level_.
+        size_t key_len_ = 0;
+        size_t value_len_ = 0;
+        size_t bucket_len_ = 0;
+        std::shared_ptr<const TableProperties> table_properties_;
+    };
+}
@@ -0,0 +1,557 @@
+#include "table/format.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+#include "file/random_access_file_reader.h"
+#include "table/block_based/reader_common.h"
+#include "util/coding.h"
+#include "util/compression.h"
+#include "util/crc32c.h"
+#include "util/hash.h"
+#include "util/string_util.h"
+#include "util/xxhash.h"
+
+namespace XIAODB_NAMESPACE
+{
+    const BlockHandle BlockHandle::kNullBlockHandle(0, 0);
+
+    void BlockHandle::EncodeTo(std::string *dst) const
+    {
+        // Sanity check that all fields have been set
+        assert(offset_ != ~uint64_t{0});
+        assert(size_ != ~uint64_t{0});
+        PutVarint64Varint64(dst, offset_, size_);
+    }
+
+    char *BlockHandle::EncodeTo(char *dst) const
+    {
+        // Sanity check that all fields have been set
+        assert(offset_ != ~uint64_t{0});
+        assert(size_ != ~uint64_t{0});
+        char *cur = EncodeVarint64(dst, offset_);
+        cur = EncodeVarint64(cur, size_);
+        return cur;
+    }
+
+    Status BlockHandle::DecodeFrom(Slice *input)
+    {
+        if (GetVarint64(input, &offset_) && GetVarint64(input, &size_))
+        {
+            return Status::OK();
+        }
+        else
+        {
+            // reset in case failure after partially decoding
+            offset_ = 0;
+            size_ = 0;
+            return Status::Corruption("bad block handle");
+        }
+    }
+
+    // Return a string that contains the copy of handle.
+    std::string BlockHandle::ToString(bool hex) const
+    {
+        std::string handle_str;
+        EncodeTo(&handle_str);
+        if (hex)
+        {
+            return Slice(handle_str).ToString(true);
+        }
+        else
+        {
+            return handle_str;
+        }
+    }
+
+    void FooterBuilder::Build(uint64_t magic_number, uint32_t format_version,
+                              ChecksumType checksum_type,
+                              const BlockHandle &metaindex_handle,
+                              const BlockHandle &index_handle)
+    {
+        assert(IsSupportedFormatVersion(format_version));
+        char *buf = data_.data();
+        memset(buf, 0, Footer::kEncodedLength);
+        buf[0] = static_cast<char>(checksum_type);
+        char *cur = metaindex_handle.EncodeTo(buf + 1);
+        cur = index_handle.EncodeTo(cur);
+        assert(cur <= buf + 1 + 2 * BlockHandle::kMaxEncodedLength);
+        (void)cur;
+        char *part3 = buf + 1 + 2 * BlockHandle::kMaxEncodedLength;
+        EncodeFixed32(part3, format_version);
+        EncodeFixed64(part3 + 4, magic_number);
+        slice_ = Slice(buf, Footer::kEncodedLength);
+    }
+
+    Status Footer::DecodeFrom(Slice input, uint64_t input_offset)
+    {
+        (void)input_offset;
+        assert(table_magic_number_ == 0);
+        assert(input.data() != nullptr);
+        if (input.size() < kEncodedLength)
+        {
+            return Status::Corruption("Input is too short to be an SST file");
+        }
+        // Only the trailing kEncodedLength bytes are the footer.
+        input.remove_prefix(input.size() - kEncodedLength);
+        const char *magic_ptr = input.data() + kEncodedLength - 8;
+        table_magic_number_ = DecodeFixed64(magic_ptr);
+        format_version_ = DecodeFixed32(magic_ptr - 4);
+        if (!IsSupportedFormatVersion(format_version_))
+        {
+            return Status::Corruption("Corrupt or unsupported format_version " +
+                                      std::to_string(format_version_) +
+                                      " in footer at offset " +
+                                      std::to_string(input_offset));
+        }
+
+        checksum_type_ = static_cast<unsigned char>(input.data()[0]);
+        if (checksum_type_ > kXXH3)
+        {
+            return Status::Corruption("Corrupt or unsupported checksum type: " +
+                                      std::to_string(checksum_type_));
+        }
+        block_trailer_size_ = static_cast<uint32_t>(kBlockTrailerSize);
+
+        Slice handles(input.data() + 1, 2 * BlockHandle::kMaxEncodedLength);
+        Status s = metaindex_handle_.DecodeFrom(&handles);
+        if (s.ok())
+        {
+            s = index_handle_.DecodeFrom(&handles);
+        }
+        return s;
+    }
+
+    std::string Footer::ToString() const
+    {
+        std::string result;
+        result.reserve(1024);
+        result.append("metaindex handle: " + metaindex_handle_.ToString() + "\n  ");
+        result.append("index handle: " + index_handle_.ToString() + "\n  ");
+        result.append("table_magic_number: " + std::to_string(table_magic_number_) +
+                      "\n  ");
+        result.append("format version: " + std::to_string(format_version_) + "\n");
+        return result;
+    }
+
+    Status ReadFooterFromFile(const IOOptions &opts, RandomAccessFileReader *file,
+                              uint64_t file_size, Footer *footer,
+                              uint64_t enforce_table_magic_number)
+    {
+        if (file_size < Footer::kMinEncodedLength)
+        {
+            return Status::Corruption("file is too short (" +
+                                      std::to_string(file_size) +
+                                      " bytes) to be an "
+                                      "sstable: " +
+                                      file->file_name());
+        }
+
+        std::array<char, Footer::kMaxEncodedLength + 1> footer_buf;
+        Slice footer_input;
+        uint64_t read_offset = file_size - Footer::kEncodedLength;
+        IOStatus io_s = file->Read(opts, read_offset, Footer::kEncodedLength,
+                                   &footer_input, footer_buf.data(),
+                                   nullptr /* aligned_buf */);
+        if (!io_s.ok())
+        {
+            return io_s;
+        }
+
+        // Check that we actually read the whole footer from the file. It may be
+        // that size isn't correct.
+        if (footer_input.size() < Footer::kMinEncodedLength)
+        {
+            return Status::Corruption("The number of bytes read from " +
+                                      file->file_name() + " is too short (" +
+                                      std::to_string(footer_input.size()) +
+                                      " bytes) to be an sstable");
+        }
+
+        Status s = footer->DecodeFrom(footer_input, read_offset);
+        if (!s.ok())
+        {
+            return s;
+        }
+        if (enforce_table_magic_number != 0 &&
+            enforce_table_magic_number != footer->table_magic_number())
+        {
+            return Status::Corruption("Bad table magic number: expected " +
+                                      std::to_string(enforce_table_magic_number) +
+                                      ", found " +
+                                      std::to_string(footer->table_magic_number()) +
+                                      " in " + file->file_name());
+        }
+        return Status::OK();
+    }
+
+    namespace
+    {
+        // Perturbs a 32-bit checksum with one more input byte, for the hash
+        // functions that cannot be cheaply extended. Any change to last_byte
+        // changes the result.
+        inline uint32_t ModifyChecksumForLastByte(uint32_t checksum, char last_byte)
+        {
+            // This strategy bears some resemblance to extending a CRC checksum by one
+            // more byte, except we don't need to re-mix the input checksum as long as
+            // we do this step only once (per checksum).
+            const uint32_t kRandomPrime = 0x6b9083d9;
+            return checksum ^ static_cast<uint8_t>(last_byte) * kRandomPrime;
+        }
+    }
+
+    uint32_t ComputeBuiltinChecksum(ChecksumType type, const char *data,
+                                    size_t data_size)
+    {
+        switch (type)
+        {
+        case kCRC32c:
+            return crc32c::Mask(crc32c::Value(data, data_size));
+        case kxxHash:
+            return XXH32(data, data_size, /*seed*/ 0);
+        case kxxHash64:
+            return Lower32of64(XXH64(data, data_size, /*seed*/ 0));
+        case kXXH3:
+        {
+            if (data_size == 0)
+            {
+                // Special case because of special handling for last byte, not
+                // present in this case. Can be any value different from other
+                // small input size checksums.
+                return 0;
+            }
+            else
+            {
+                // See corresponding code in ComputeBuiltinChecksumWithLastByte
+                uint32_t v = Lower32of64(XXH3_64bits(data, data_size - 1));
+                return ModifyChecksumForLastByte(v, data[data_size - 1]);
+            }
+        }
+        default: // including kNoChecksum
+            return 0;
+        }
+    }
+
+    uint32_t ComputeBuiltinChecksumWithLastByte(ChecksumType type, const char *data,
+                                                size_t data_size, char last_byte)
+    {
+        switch (type)
+        {
+        case kCRC32c:
+        {
+            uint32_t crc = crc32c::Value(data, data_size);
+            // Extend to cover last byte (compression type)
+            crc = crc32c::Extend(crc, &last_byte, 1);
+            return crc32c::Mask(crc);
+        }
+        case kxxHash:
+        {
+            XXH32_state_t *const state = XXH32_createState();
+            XXH32_reset(state, 0);
+            XXH32_update(state, data, data_size);
+            // Extend to cover last byte (compression type)
+            XXH32_update(state, &last_byte, 1);
+            uint32_t v = XXH32_digest(state);
+            XXH32_freeState(state);
+            return v;
+        }
+        case kxxHash64:
+        {
+            XXH64_state_t *const state = XXH64_createState();
+            XXH64_reset(state, 0);
+            XXH64_update(state, data, data_size);
+            // Extend to cover last byte (compression type)
+            XXH64_update(state, &last_byte, 1);
+            uint32_t v = Lower32of64(XXH64_digest(state));
+            XXH64_freeState(state);
+            return v;
+        }
+        case kXXH3:
+        {
+            // XXH3 is a complicated hash function that is extremely fast on
+            // contiguous input, but that makes its streaming support rather
+            // complex. It is worth custom handling of the last byte (`type`)
+            // in order to avoid allocating a large state object and bringing
+            // that code complexity into CPU working set.
+            uint32_t v = Lower32of64(XXH3_64bits(data, data_size));
+            return ModifyChecksumForLastByte(v, last_byte);
+        }
+        default: // including kNoChecksum
+            return 0;
+        }
+    }
+
+    namespace
+    {
+        // The copy proceeds in pieces that fit in L1 along with the hash
+        // state, each hashed right after its copy, from the destination.
+        constexpr size_t kCopyChecksumChunkSize = 4096;
+
+        template <typename UpdateFn>
+        void CopyInChunks(char *dst, const char *src, size_t size,
+                          const UpdateFn &update)
+        {
+            while (size > 0)
+            {
+                const size_t n = std::min(size, kCopyChecksumChunkSize);
+                memcpy(dst, src, n);
+                update(dst, n);
+                dst += n;
+                src += n;
+                size -= n;
+            }
+        }
+    }
+
+    uint32_t CopyAndComputeBuiltinChecksumWithLastByte(ChecksumType type, char *dst,
+                                                       const char *src, size_t size,
+                                                       char last_byte)
+    {
+        if (type == kCRC32c)
+        {
+            uint32_t crc = crc32c::ExtendCopy(0, dst, src, size);
+            // Extend to cover last byte (compression type)
+            crc = crc32c::Extend(crc, &last_byte, 1);
+            return crc32c::Mask(crc);
+        }
+        if (size <= kCopyChecksumChunkSize)
+        {
+            // The copy is still in L1 for the hash, without the cost of a
+            // streaming state.
+            memcpy(dst, src, size);
+            return ComputeBuiltinChecksumWithLastByte(type, dst, size, last_byte);
+        }
+        switch (type)
+        {
+        case kxxHash:
+        {
+            XXH32_state_t *const state = XXH32_createState();
+            XXH32_reset(state, 0);
+            CopyInChunks(dst, src, size, [state](const char *p, size_t n)
+                         { XXH32_update(state, p, n); });
+            // Extend to cover last byte (compression type)
+            XXH32_update(state, &last_byte, 1);
+            uint32_t v = XXH32_digest(state);
+            XXH32_freeState(state);
+            return v;
+        }
+        case kxxHash64:
+        {
+            XXH64_state_t *const state = XXH64_createState();
+            XXH64_reset(state, 0);
+            CopyInChunks(dst, src, size, [state](const char *p, size_t n)
+                         { XXH64_update(state, p, n); });
+            // Extend to cover last byte (compression type)
+            XXH64_update(state, &last_byte, 1);
+            uint32_t v = Lower32of64(XXH64_digest(state));
+            XXH64_freeState(state);
+            return v;
+        }
+        case kXXH3:
+        {
+            // The streaming form gives the same hash as XXH3_64bits(); see
+            // ComputeBuiltinChecksumWithLastByte for the last byte.
+            XXH3_state_t *const state = XXH3_createState();
+            XXH3_64bits_reset(state);
+            CopyInChunks(dst, src, size, [state](const char *p, size_t n)
+                         { XXH3_64bits_update(state, p, n); });
+            uint32_t v = Lower32of64(XXH3_64bits_digest(state));
+            XXH3_freeState(state);
+            return ModifyChecksumForLastByte(v, last_byte);
+        }
+        default: // including kNoChecksum
+            memcpy(dst, src, size);
+            return 0;
+        }
+    }
+
+    namespace
+    {
+        Status BlockChecksumMismatch(const Footer &footer, uint32_t stored,
+                                     uint32_t computed, size_t block_size,
+                                     const std::string &file_name, uint64_t offset)
+        {
+            return Status::Corruption(
+                "block checksum mismatch: stored = " + std::to_string(stored) +
+                ", computed = " + std::to_string(computed) +
+                ", type = " + std::to_string(footer.checksum_type()) + "  in " +
+                file_name + " offset " + std::to_string(offset) + " size " +
+                std::to_string(block_size));
+        }
+    }
+
+    Status VerifyBlockCheckSum(const Footer &footer, const char *data,
+                               size_t block_size, const std::string &file_name,
+                               uint64_t offset)
+    {
+        // After block_size bytes is compression type (1 byte), which is part of
+        // the checksummed section.
+        size_t len = block_size + 1;
+        // And then the stored checksum value (4 bytes).
+        uint32_t stored = DecodeFixed32(data + len);
+
+        uint32_t computed = ComputeBuiltinChecksum(footer.checksum_type(), data, len);
+        if (stored == computed)
+        {
+            return Status::OK();
+        }
+        else
+        {
+            return BlockChecksumMismatch(footer, stored, computed, block_size,
+                                         file_name, offset);
+        }
+    }
+
+    Status VerifyBlockCheckSumAndCopy(const Footer &footer, char *dst,
+                                      const char *data, size_t block_size,
+                                      const std::string &file_name,
+                                      uint64_t offset)
+    {
+        // The stored checksum follows the compression type byte, which is
+        // checksummed but not copied.
+        uint32_t stored = DecodeFixed32(data + block_size + 1);
+
+        uint32_t computed = CopyAndComputeBuiltinChecksumWithLastByte(
+            footer.checksum_type(), dst, data, block_size, data[block_size]);
+        if (stored == computed)
+        {
+            return Status::OK();
+        }
+        else
+        {
+            return BlockChecksumMismatch(footer, stored, computed, block_size,
+                                         file_name, offset);
+        }
+    }
+
+    Status UncompressSerializedBlock(const char *data, size_t size,
+                                     CompressionType type,
+                                     BlockContents *out_contents,
+                                     uint32_t format_version,
+                                     MemoryAllocator *allocator,
+                                     const UncompressionDict *dict)
+    {
+        assert(type != kNoCompression);
+        UncompressionContext context(type);
+        UncompressionInfo info(
+            context, dict != nullptr ? *dict : UncompressionDict::GetEmptyDict(), type);
+
+        const char *error_msg = nullptr;
+        size_t uncompressed_size = 0;
+        // format_version 2 and later prefix the compressed payload of every
+        // algorithm but Snappy with its uncompressed size.
+        CacheAllocationPtr ubuf = UncompressData(
+            info, data, size, &uncompressed_size,
+            format_version >= 2 ? 2 : 1, allocator, &error_msg);
+        if (!ubuf)
+        {
+            if (!CompressionTypeSupported(type))
+            {
+                return Status::NotSupported(
+                    "Unsupported compression method for this build",
+                    CompressionTypeToString(type));
+            }
+            return Status::Corruption(
+                "Corrupted compressed block contents",
+                error_msg != nullptr ? error_msg : CompressionTypeToString(type));
+        }
+        *out_contents = BlockContents(std::move(ubuf), uncompressed_size);
+        return Status::OK();
+    }
+
+    Status DecodeSerializedBlock(const Footer &footer, CacheAllocationPtr &&buf,
+                                 const char *data, const BlockHandle &handle,
+                                 bool verify_checksums,
+                                 const std::string &file_name,
+                                 BlockContents *out_contents,
+                                 MemoryAllocator *allocator, bool data_is_pinned,
+                                 const UncompressionDict *dict)
+    {
+        const size_t block_size = static_cast<size_t>(handle.size());
+        CompressionType type = GetBlockCompressionType(data, block_size);
+        if (verify_checksums && type == kNoCompression &&
+            !(buf && buf.get() == data) && !data_is_pinned)
+        {
+            // The block is copied out of a buffer it cannot keep (e.g. a
+            // merged read or the prefetch buffer): verify it on the way.
+            CacheAllocationPtr ubuf = AllocateBlock(block_size, allocator);
+            Status s = VerifyBlockCheckSumAndCopy(footer, ubuf.get(), data,
+                                                  block_size, file_name,
+                                                  handle.offset());
+            if (!s.ok())
+            {
+                return s;
+            }
+            *out_contents = BlockContents(std::move(ubuf), block_size);
+            return Status::OK();
+        }
+        if (verify_checksums)
+        {
+            Status s = VerifyBlockCheckSum(footer, data, block_size, file_name,
+                                           handle.offset());
+            if (!s.ok())
+            {
+                return s;
+            }
+        }
+
+        if (type != kNoCompression)
+        {
+            return UncompressSerializedBlock(data, block_size, type, out_contents,
+                                             footer.format_version(), allocator,
+                                             dict);
+        }
+        if (buf && buf.get() == data)
+        {
+            // Hand over the read buffer; the trailer past block_size is dead
+            // weight but not worth a copy.
+            *out_contents = BlockContents(std::move(buf), block_size);
+        }
+        else if (data_is_pinned)
+        {
+            *out_contents = BlockContents(Slice(data, block_size));
+        }
+        else
+        {
+            *out_contents = BlockContents(
+                AllocateAndCopyBlock(Slice(data, block_size), allocator), block_size);
+        }
+        return Status::OK();
+    }
+
+    Status ReadBlockContents(const IOOptions &opts, RandomAccessFileReader *file,
+                             const Footer &footer, const BlockHandle &handle,
+                             bool verify_checksums, BlockContents *out_contents,
+                             MemoryAllocator *allocator,
+                             const UncompressionDict *dict)
+    {
+        const size_t read_size = static_cast<size_t>(BlockSizeWithTrailer(handle));
+        CacheAllocationPtr buf = AllocateBlock(read_size, allocator);
+        Slice result;
+        IOStatus io_s = file->Read(opts, handle.offset(), read_size, &result,
+                                   buf.get(), nullptr /* aligned_buf */);
+        if (!io_s.ok())
+        {
+            return io_s;
+        }
+        if (result.size() != read_size)
+        {
+            return Status::Corruption("truncated block read from " +
+                                      file->file_name() + " offset " +
+                                      std::to_string(handle.offset()) +
+                                      ", expected " + std::to_string(read_size) +
+                                      " bytes, got " +
+                                      std::to_string(result.size()));
+        }
+        if (result.data() != buf.get())
+        {
+            // The file returned its own buffer (e.g. mmap); decode from there.
+            buf.reset();
+        }
+        return DecodeSerializedBlock(footer, std::move(buf), result.data(), handle,
+                                     verify_checksums, file->file_name(),
+                                     out_contents, allocator,
+                                     false /* data_is_pinned */, dict);
+    }
+}
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "memory/memory_allocator_impl.h"
+#include "xiaodb/compression_type.h"
+#include "xiaodb/options.h"
+#include "xiaodb/slice.h"
+#include "xiaodb/status.h"
+#include "xiaodb/table.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class RandomAccessFileReader;
+    struct UncompressionDict;
+
+    // BlockHandle is a pointer to the extent of a file that stores a data
+    // block or a meta block.
+    class BlockHandle
+    {
+    public:
+        // Creates a block handle with special values indicating "uninitialized,"
+        // distinct from the "null" block handle.
+        BlockHandle();
+        BlockHandle(uint64_t offset, uint64_t size);
+
+        // The offset of the block in the file.
+        uint64_t offset() const { return offset_; }
+        void set_offset(uint64_t _offset) { offset_ = _offset; }
+
+        // The size of the stored block, not including the block trailer.
+        uint64_t size() const { return size_; }
+        void set_size(uint64_t _size) { size_ = _size; }
+
+        void EncodeTo(std::string *dst) const;
+        char *EncodeTo(char *dst) const;
+        Status DecodeFrom(Slice *input);
+
+        // Return a string that contains the copy of handle.
+        std::string ToString(bool hex = true) const;
+
+        // if the block handle's offset and size are both "0", we will view it
+        // as a null block handle that points to no where.
+        bool IsNull() const { return offset_ == 0 && size_ == 0; }
+
+        static const BlockHandle &NullBlockHandle() { return kNullBlockHandle; }
+
+        // Maximum encoding length of a BlockHandle
+        static constexpr uint32_t kMaxEncodedLength = 2 * 10;
+
+        inline bool operator==(const BlockHandle &rhs) const
+        {
+            return offset_ == rhs.offset_ && size_ == rhs.size_;
+        }
+        inline bool operator!=(const BlockHandle &rhs) const
+        {
+            return !(*this == rhs);
+        }
+
+    private:
+        uint64_t offset_;
+        uint64_t size_;
+
+        static const BlockHandle kNullBlockHandle;
+    };
+
+    constexpr uint64_t kBlockBasedTableMagicNumber = 0x88e241b785f4cff7ull;
+    constexpr uint64_t kPlainTableMagicNumber = 0x8242229663bf9564ull;
+    constexpr uint64_t kCuckooTableMagicNumber = 0x926789d0c5f17873ull;
+
+    // Oldest and newest table format_version that the footer code can read.
+    // format_version 6 moved the index handle into the metaindex block and
+    // added a footer checksum, which is not supported yet.
+    constexpr uint32_t kMinSupportedFormatVersion = 1;
+    constexpr uint32_t kMaxSupportedFormatVersion = 5;
+
+    inline bool IsSupportedFormatVersion(uint32_t version)
+    {
+        return version >= kMinSupportedFormatVersion &&
+               version <= kMaxSupportedFormatVersion;
+    }
+
+    // Footer encapsulates the fixed information stored at the tail end of every
+    // SST file:
+    //    checksum type (char, 1 byte)
+    //    metaindex handle (varint64 offset, varint64 size)
+    //    index handle     (varint64 offset, varint64 size)
+    //    <zero padding> to make the above total 2 * BlockHandle::kMaxEncodedLength + 1
+    //    footer version (4 bytes)
+    //    table_magic_number (8 bytes)
+    class Footer
+    {
+    public:
+        // Create empty. Populate using DecodeFrom.
+        Footer() {}
+
+        // Deserialize a footer (populate fields) from `input` and check for various
+        // corruptions. `input_offset` is the offset within the target file of
+        // `input` buffer, which is used for error messages.
+        Status DecodeFrom(Slice input, uint64_t input_offset);
+
+        // Table magic number identifies file as RocksDB SST file and which kind of
+        // SST format is use.
+        uint64_t table_magic_number() const { return table_magic_number_; }
+
+        // A version (footer and more) within a kind of SST.
+        uint32_t format_version() const { return format_version_; }
+
+        // Block handle for metaindex block.
+        const BlockHandle &metaindex_handle() const { return metaindex_handle_; }
+
+        // Block handle for (top-level) index block.
+        const BlockHandle &index_handle() const { return index_handle_; }
+
+        // Checksum type used in the file.
+        ChecksumType checksum_type() const
+        {
+            return static_cast<ChecksumType>(checksum_type_);
+        }
+
+        // Block trailer size used by file with this footer (e.g. 5 for block-based
+        // table).
+        uint32_t GetBlockTrailerSize() const { return block_trailer_size_; }
+
+        // Convert this object to a human readable form
+        std::string ToString() const;
+
+        // Encoded lengths of Footers. Bytes for serialized Footer will always be
+        // >= kMinEncodedLength and <= kMaxEncodedLength.
+        static constexpr uint32_t kEncodedLength = 2 * BlockHandle::kMaxEncodedLength + 1 + 4 + 8;
+        static constexpr uint32_t kMinEncodedLength = kEncodedLength;
+        static constexpr uint32_t kMaxEncodedLength = kEncodedLength;
+
+    protected:
+        friend class FooterBuilder;
+
+        uint64_t table_magic_number_ = 0;
+        uint32_t format_version_ = 0;
+        uint32_t block_trailer_size_ = 0;
+        BlockHandle metaindex_handle_;
+        BlockHandle index_handle_;
+        int checksum_type_ = kNoChecksum;
+    };
+
+    // Builder for Footer
+    class FooterBuilder
+    {
+    public:
+        // Create a Footer with the given fields.
+        void Build(uint64_t table_magic_number, uint32_t format_version,
+                   ChecksumType checksum_type, const BlockHandle &metaindex_handle,
+                   const BlockHandle &index_handle);
+
+        // After Builder, get a Slice for the serialized Footer, backed by this
+        // FooterBuilder.
+        const Slice &GetSlice() const
+        {
+            assert(slice_.size());
+            return slice_;
+        }
+
+    private:
+        Slice slice_;
+        std::array<char, Footer::kMaxEncodedLength> data_;
+    };
+
+    // Read the footer from file
+    // If enforce_table_magic_number != 0, ReadFooterFromFile() will return
+    // corruption if table_magic number is not equal to enforce_table_magic_number
+    Status ReadFooterFromFile(const IOOptions &opts, RandomAccessFileReader *file,
+                              uint64_t file_size, Footer *footer,
+                              uint64_t enforce_table_magic_number = 0);
+
+    // Computes a checksum using the given ChecksumType. Sometimes we need to
+    // include one more input byte logically at the end but not part of the main
+    // data buffer. If data_size >= 1, then
+    // ComputeBuiltinChecksum(type, data, size)
+    // ==
+    // ComputeBuiltinChecksumWithLastByte(type, data, size - 1, data[size - 1])
+    uint32_t ComputeBuiltinChecksum(ChecksumType type, const char *data,
+                                    size_t size);
+    uint32_t ComputeBuiltinChecksumWithLastByte(ChecksumType type, const char *data,
+                                                size_t size, char last_byte);
+
+    // Copies src[0, size) to dst, which must not overlap it, and returns
+    // ComputeBuiltinChecksumWithLastByte(type, src, size, last_byte), reading
+    // the data once for both: a buffer that is both copied and checksummed
+    // is otherwise brought into the CPU caches twice.
+    uint32_t CopyAndComputeBuiltinChecksumWithLastByte(ChecksumType type, char *dst,
+                                                       const char *src, size_t size,
+                                                       char last_byte);
+
+    // Represents the contents of a block read from an SST file. Depending on how
+    // it's created, it may or may not own the actual block bytes. As an example,
+    // BlockContents objects representing data read from mmapped files only point
+    // into the mmapped region. Depending on context, it might be a serialized
+    // (potentially compressed) block, including a trailer beyond `size`, or an
+    // uncompressed block.
+    struct BlockContents
+    {
+        // Points to block payload (without trailer)
+        Slice data;
+        CacheAllocationPtr allocation;
+
+        BlockContents() {}
+
+        // Does not take ownership of the underlying data bytes.
+        BlockContents(const Slice &_data) : data(_data) {}
+
+        // Takes ownership of the underlying data bytes.
+        BlockContents(CacheAllocationPtr &&_data, size_t _size)
+            : data(_data.get(), _size), allocation(std::move(_data)) {}
+
+        // Takes ownership of the underlying data bytes.
+        BlockContents(std::unique_ptr<char[]> &&_data, size_t _size)
+            : data(_data.get(), _size)
+        {
+            allocation.reset(_data.release());
+        }
+
+        // Returns whether the object has ownership of the underlying data bytes.
+        bool own_bytes() const { return allocation.get() != nullptr; }
+
+        // The additional memory space taken by the block data.
+        size_t usable_size() const
+        {
+            if (allocation.get() != nullptr)
+            {
+                auto allocator = allocation.get_deleter().allocator;
+                if (allocator)
+                {
+                    return allocator->UsableSize(allocation.get(), data.size());
+                }
+                return data.size();
+            }
+            else
+            {
+                return 0; // no extra memory is occupied by the data
+            }
+        }
+
+        size_t ApproximateMemoryUsage() const
+        {
+            return usable_size() + sizeof(*this);
+        }
+
+        BlockContents(BlockContents &&other) noexcept { *this = std::move(other); }
+
+        BlockContents &operator=(BlockContents &&other)
+        {
+            data = std::move(other.data);
+            allocation = std::move(other.allocation);
+            return *this;
+        }
+    };
+
+    // The `data` points to serialized block contents read in from file, which
+    // must be compressed and include a trailer beyond `size`. A new buffer is
+    // allocated with the given allocator (or default) and the uncompressed
+    // contents are returned in `out_contents`.
+    // format_version is as defined in include/xiaodb/table.h, which is
+    // used to determine compression format version. dict is the dictionary
+    // the block was compressed with, if any.
+    Status UncompressSerializedBlock(const char *data, size_t size,
+                                     CompressionType type,
+                                     BlockContents *out_contents,
+                                     uint32_t format_version,
+                                     MemoryAllocator *allocator = nullptr,
+                                     const UncompressionDict *dict = nullptr);
+
+    // Turns a block read from file, `block_size` bytes of payload followed by
+    // the trailer, into usable contents: verifies the checksum (unless
+    // verify_checksums is false) and uncompresses the payload if needed. An
+    // uncompressed block takes over `buf` without copying; `buf` is left
+    // empty in that case. If data_is_pinned, `data` outlives the contents
+    // (e.g. it points into an mmap'ed file) and an uncompressed block refers
+    // to it in place.
+    Status DecodeSerializedBlock(const Footer &footer, CacheAllocationPtr &&buf,
+                                 const char *data, const BlockHandle &handle,
+                                 bool verify_checksums,
+                                 const std::string &file_name,
+                                 BlockContents *out_contents,
+                                 MemoryAllocator *allocator = nullptr,
+                                 bool data_is_pinned = false,
+                                 const UncompressionDict *dict = nullptr);
+
+    // Reads the block identified by handle from file, synchronously, and
+    // decodes it as DecodeSerializedBlock() does.
+    Status ReadBlockContents(const IOOptions &opts, RandomAccessFileReader *file,
+                             const Footer &footer, const BlockHandle &handle,
+                             bool verify_checksums, BlockContents *out_contents,
+                             MemoryAllocator *allocator = nullptr,
+                             const UncompressionDict *dict = nullptr);
+
+    // Get the compression type and checksum of a block in file, starting at
+    // `block_data` and of `block_size` bytes.
+    inline CompressionType GetBlockCompressionType(const char *block_data,
+                                                   size_t block_size)
+    {
+        return static_cast<CompressionType>(block_data[block_size]);
+    }
+
+    // Represents the size of a block trailer: one byte for the compression
+    // type and a fixed32 checksum.
+    static constexpr size_t kBlockTrailerSize = 5;
+
+    // Returns the size of the block, including its trailer, located at handle
+    inline uint64_t BlockSizeWithTrailer(const BlockHandle &handle)
+    {
+        return handle.size() + kBlockTrailerSize;
+    }
+
+    // Implementation details follow.  Clients should ignore,
+
+    // TODO(andrewkr): we should prefer one way of representing a null/uninitialized
+    // BlockHandle. Currently we use zeros for null and use negation-of-zeros for
+    // uninitialized.
+    inline BlockHandle::BlockHandle() : BlockHandle(~uint64_t{0}, ~uint64_t{0}) {}
+
+    inline BlockHandle::BlockHandle(uint64_t _offset, uint64_t _size)
+        : offset_(_offset), size_(_size) {}
+}
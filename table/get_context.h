@@ -74,7 +74,57 @@ namespace XIAODB_NAMESPACE
 
         GetContextStats get_context_stats_;
 
-        private:
+        // Records this key, value, and any meta-data (such as sequence number and
+        // state) into this GetContext.
+        //
+        // If the parsed_key matches the user key that we are looking for, sets
+        // matched to true.
+        //
+        // Returns True if more keys need to be read (due to merges) or
+        //         False if the complete value has been found.
+        bool SaveValue(const ParsedInternalKey &parsed_key, const Slice &value,
+                       bool *matched, Status *read_status,
+                       Cleanable *value_pinner = nullptr);
+
+        // Simplified version of the previous function. Should only be used when we
+        // know that the operation is a Put.
+        void SaveValue(const Slice &value, SequenceNumber seq);
+
+        GetState State() const { return state_; }
+
+        SequenceNumber *max_covering_tombstone_seq()
+        {
+            return max_covering_tombstone_seq_;
+        }
+
+        PinnedIteratorsManager *pinned_iters_mgr() { return pinned_iters_mgr_; }
+
+        // If a non-null string is passed, all the SaveValue calls will be
+        // logged into the string. The operations can then be replayed on
+        // another GetContext with replayGetContextLog.
+        void SetReplayLog(std::string *replay_log) { replay_log_ = replay_log; }
+
+        // Do we need to fetch the SequenceNumber for this key?
+        bool NeedToReadSequence() const { return (seq_ != nullptr); }
+
+        bool sample() const { return sample_; }
+
+        bool CheckCallback(SequenceNumber seq)
+        {
+            if (callback_)
+            {
+                return callback_->IsVisible(seq);
+            }
+            return true;
+        }
+
+        // Marks the key as possibly existing, for lookups that cannot read
+        // the table (e.g. block cache only reads missing the cache).
+        void MarkKeyMayExist();
+
+        uint64_t get_tracing_get_id() const { return tracing_get_id_; }
+
+    private:
         // Helper method that postprocesses the results of merge operations, e.g. it
         // sets the state correctly upon merge errors.
         void PostprocessMerge(const Status &merge_status);
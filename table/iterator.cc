@@ -0,0 +1,50 @@
+#include "table/internal_iterator.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        template <class TValue = Slice>
+        class EmptyInternalIterator : public InternalIteratorBase<TValue>
+        {
+        public:
+            explicit EmptyInternalIterator(const Status &s) : status_(s) {}
+            bool Valid() const override { return false; }
+            void Seek(const Slice & /*target*/) override {}
+            void SeekForPrev(const Slice & /*target*/) override {}
+            void SeekToFirst() override {}
+            void SeekToLast() override {}
+            void Next() override { assert(false); }
+            void Prev() override { assert(false); }
+            Slice key() const override
+            {
+                assert(false);
+                return Slice();
+            }
+            TValue value() const override
+            {
+                assert(false);
+                return TValue();
+            }
+            Status status() const override { return status_; }
+
+        private:
+            Status status_;
+        };
+    }
+
+    template <class TValue>
+    InternalIteratorBase<TValue> *NewErrorInternalIterator(const Status &status)
+    {
+        return new EmptyInternalIterator<TValue>(status);
+    }
+    template InternalIteratorBase<Slice> *NewErrorInternalIterator(
+        const Status &status);
+
+    template <class TValue>
+    InternalIteratorBase<TValue> *NewEmptyInternalIterator()
+    {
+        return new EmptyInternalIterator<TValue>(Status::OK());
+    }
+    template InternalIteratorBase<Slice> *NewEmptyInternalIterator();
+}
@@ -11,8 +11,9 @@
 #include "xiaodb/options.h"
 #include "xiaodb/statistics.h"
 #include "xiaodb/types.h"
-#include "util/aync_file_reader.h"
+#include "util/async_file_reader.h"
 #include "util/autovector.h"
+#include "util/hash.h"
 #include "util/math.h"
 #include "util/single_thread_executor.h"
 
@@ -28,6 +29,9 @@ namespace XIAODB_NAMESPACE
         Slice ukey_with_ts;
         Slice ukey_without_ts;
         Slice ikey;
+        // GetSliceHash64(ukey_without_ts), computed once for the batch and
+        // used by the whole-key filters of every table and memtable checked.
+        uint64_t key_hash;
         ColumnFamilyHandle *column_family;
         Status *s;
         MergeContext merge_context;
@@ -45,6 +49,7 @@ namespace XIAODB_NAMESPACE
                    Status *stat)
             : key(&user_key),
               lkey(nullptr),
+              key_hash(0),
               column_family(col_family),
               s(stat),
               max_covering_tombstone_seq(0),
@@ -144,6 +149,19 @@ namespace XIAODB_NAMESPACE
                 sorted_keys_[iter]->get_context =
                     (*sorted_keys)[begin + iter]->get_context;
             }
+
+            // Hash all the keys together, once for all the filters
+            std::array<const Slice *, MAX_BATCH_SIZE> user_keys;
+            std::array<uint64_t, MAX_BATCH_SIZE> key_hashes;
+            for (size_t iter = 0; iter != num_keys_; ++iter)
+            {
+                user_keys[iter] = &sorted_keys_[iter]->ukey_without_ts;
+            }
+            GetSliceHash64Batch(user_keys.data(), num_keys_, key_hashes.data());
+            for (size_t iter = 0; iter != num_keys_; ++iter)
+            {
+                sorted_keys_[iter]->key_hash = key_hashes[iter];
+            }
         }
 
         ~MultiGetContext()
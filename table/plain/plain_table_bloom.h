@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "memory/allocator.h"
+#include "port/port.h"
+#include "util/fastrange.h"
+#include "util/hash.h"
+#include "xiaodb/slice.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // The Bloom filter of a plain table, over the key prefixes (the whole user
+    // keys without a prefix extractor). All the probes of a hash fall into one
+    // cache line, so that a negative lookup costs a single cache miss.
+    //
+    // Unlike DynamicBloom, the bits can be stored in the file and used in place
+    // (see SetRawData()); the layout is that of kBloomVersion.
+    class PlainTableBloom
+    {
+    public:
+        // Version of the layout, stored in the table properties.
+        static constexpr uint32_t kBloomVersion = 1;
+        static constexpr uint32_t kNumProbes = 6;
+        static constexpr uint32_t kBlockBytes = CACHE_LINE_SIZE;
+        static constexpr uint32_t kBlockBits = kBlockBytes * 8;
+
+        PlainTableBloom() {}
+
+        // Allocates a filter of about total_bits bits, rounded up to whole
+        // cache lines, out of allocator.
+        void SetTotalBits(Allocator *allocator, uint32_t total_bits,
+                          size_t huge_page_tlb_size)
+        {
+            num_blocks_ = (total_bits + kBlockBits - 1) / kBlockBits;
+            if (num_blocks_ == 0)
+            {
+                num_blocks_ = 1;
+            }
+            const size_t bytes = static_cast<size_t>(num_blocks_) * kBlockBytes;
+            char *raw = allocator->AllocateAligned(bytes + kBlockBytes,
+                                                   huge_page_tlb_size);
+            // Align the blocks to cache lines.
+            const uintptr_t misalign =
+                reinterpret_cast<uintptr_t>(raw) % kBlockBytes;
+            if (misalign != 0)
+            {
+                raw += kBlockBytes - misalign;
+            }
+            memset(raw, 0, bytes);
+            data_ = raw;
+        }
+
+        // Uses the bits of a stored filter in place.
+        void SetRawData(const char *raw_data, uint32_t num_blocks)
+        {
+            data_ = const_cast<char *>(raw_data);
+            num_blocks_ = num_blocks;
+        }
+
+        bool IsInitialized() const { return data_ != nullptr; }
+
+        uint32_t GetNumBlocks() const { return num_blocks_; }
+
+        Slice GetRawData() const
+        {
+            return Slice(data_, static_cast<size_t>(num_blocks_) * kBlockBytes);
+        }
+
+        void AddHash(uint32_t hash)
+        {
+            char *block = data_ + BlockOffset(hash);
+            uint32_t h = hash;
+            const uint32_t delta = (h >> 17) | (h << 15);
+            for (uint32_t i = 0; i < kNumProbes; ++i)
+            {
+                const uint32_t bit = h % kBlockBits;
+                block[bit / 8] |= static_cast<char>(1 << (bit % 8));
+                h += delta;
+            }
+        }
+
+        bool MayContainHash(uint32_t hash) const
+        {
+            const char *block = data_ + BlockOffset(hash);
+            uint32_t h = hash;
+            const uint32_t delta = (h >> 17) | (h << 15);
+            for (uint32_t i = 0; i < kNumProbes; ++i)
+            {
+                const uint32_t bit = h % kBlockBits;
+                if ((block[bit / 8] & static_cast<char>(1 << (bit % 8))) == 0)
+                {
+                    return false;
+                }
+                h += delta;
+            }
+            return true;
+        }
+
+        void Prefetch(uint32_t hash) const
+        {
+            PREFETCH(data_ + BlockOffset(hash), 0, 3);
+        }
+
+    private:
+        size_t BlockOffset(uint32_t hash) const
+        {
+            // The block is chosen from the upper bits of a remix of the hash,
+            // so that it is independent of the bits the probes use.
+            return static_cast<size_t>(FastRange32(hash * 0x9e3779b9u, num_blocks_)) *
+                   kBlockBytes;
+        }
+
+        char *data_ = nullptr;
+        uint32_t num_blocks_ = 0;
+    };
+}
@@ -0,0 +1,224 @@
+#include "table/plain/plain_table_builder.h"
+
+#include <map>
+
+#include "table/block_based/block_builder.h"
+#include "table/plain/plain_table_bloom.h"
+#include "table/plain/plain_table_format.h"
+#include "util/coding.h"
+
+namespace XIAODB_NAMESPACE
+{
+    const std::string PlainTablePropertyNames::kEncodingType =
+        "xiaodb.plain.table.encoding.type";
+    const std::string PlainTablePropertyNames::kBloomVersion =
+        "xiaodb.plain.table.bloom.version";
+    const std::string PlainTablePropertyNames::kNumBloomBlocks =
+        "xiaodb.plain.table.bloom.numblocks";
+
+    const std::string PlainTableFormat::kIndexBlockName = "PlainTableIndexBlock";
+    const std::string PlainTableFormat::kBloomBlockName = "PlainTableBloomBlock";
+    const std::string PlainTableFormat::kPropertiesBlockName = "xiaodb.properties";
+    const std::string PlainTableFormat::kNumEntries = "xiaodb.num.entries";
+    const std::string PlainTableFormat::kRawKeySize = "xiaodb.raw.key.size";
+    const std::string PlainTableFormat::kRawValueSize = "xiaodb.raw.value.size";
+    const std::string PlainTableFormat::kDataSize = "xiaodb.data.size";
+    const std::string PlainTableFormat::kFixedKeyLen = "xiaodb.fixed.key.length";
+    const std::string PlainTableFormat::kPrefixExtractorName =
+        "xiaodb.prefix.extractor.name";
+    const std::string PlainTableFormat::kIndexSparseness =
+        "xiaodb.plain.table.index.sparseness";
+
+    namespace
+    {
+        std::string EncodeVarint64Property(uint64_t value)
+        {
+            std::string encoded;
+            PutVarint64(&encoded, value);
+            return encoded;
+        }
+    }
+
+    PlainTableBuilder::PlainTableBuilder(const PlainTableOptions &table_options,
+                                         const SliceTransform *prefix_extractor,
+                                         FSWritableFile *file)
+        : table_options_(table_options),
+          prefix_extractor_(prefix_extractor),
+          file_(file),
+          encoder_(table_options.user_key_len)
+    {
+        if (table_options_.encoding_type != kPlain)
+        {
+            status_ = Status::NotSupported("plain table only supports kPlain encoding");
+        }
+        if (table_options_.store_index_in_file)
+        {
+            index_builder_.reset(new PlainTableIndexBuilder(
+                &arena_, prefix_extractor_, table_options_.index_sparseness,
+                table_options_.hash_table_ratio, 0 /* huge_page_tlb_size */));
+        }
+        properties_.format_version = PlainTableFormat::kFormatVersion;
+        properties_.fixed_key_len = table_options_.user_key_len;
+        properties_.prefix_extractor_name =
+            prefix_extractor_ != nullptr ? prefix_extractor_->Name() : "nullptr";
+    }
+
+    PlainTableBuilder::~PlainTableBuilder() = default;
+
+    IOStatus PlainTableBuilder::Append(const Slice &data)
+    {
+        IOStatus s = file_->Append(data, IOOptions(), nullptr);
+        if (s.ok())
+        {
+            offset_ += data.size();
+        }
+        return s;
+    }
+
+    void PlainTableBuilder::Add(const Slice &key, const Slice &value)
+    {
+        assert(!closed_);
+        if (!status_.ok())
+        {
+            return;
+        }
+        if (offset_ > PlainTableIndex::kMaxFileSize)
+        {
+            status_ = Status::NotSupported("plain table data exceeds the maximum size");
+            return;
+        }
+        record_.clear();
+        status_ = encoder_.AppendRecord(key, value, &record_);
+        if (!status_.ok())
+        {
+            return;
+        }
+        if (index_builder_ != nullptr)
+        {
+            index_builder_->AddKey(ExtractUserKey(key), static_cast<uint32_t>(offset_));
+        }
+        io_status_ = Append(record_);
+        if (!io_status_.ok())
+        {
+            status_ = io_status_;
+            return;
+        }
+        properties_.num_entries++;
+        properties_.raw_key_size += key.size();
+        properties_.raw_value_size += value.size();
+    }
+
+    IOStatus PlainTableBuilder::WriteMetaBlock(const Slice &contents,
+                                               BlockHandle *handle)
+    {
+        handle->set_offset(offset_);
+        handle->set_size(contents.size());
+        char trailer[kBlockTrailerSize];
+        trailer[0] = kNoCompression;
+        EncodeFixed32(trailer + 1,
+                      ComputeBuiltinChecksumWithLastByte(kCRC32c, contents.data(),
+                                                         contents.size(), trailer[0]));
+        IOStatus s = Append(contents);
+        if (s.ok())
+        {
+            s = Append(Slice(trailer, kBlockTrailerSize));
+        }
+        return s;
+    }
+
+    Status PlainTableBuilder::Finish()
+    {
+        assert(!closed_);
+        closed_ = true;
+        if (!status_.ok())
+        {
+            return status_;
+        }
+        properties_.data_size = offset_;
+
+        // Meta block name -> encoded handle, in the order of the metaindex.
+        std::map<std::string, std::string> meta_handles;
+        BlockHandle handle;
+        uint32_t num_bloom_blocks = 0;
+        if (index_builder_ != nullptr)
+        {
+            const Slice index = index_builder_->Finish();
+            io_status_ = WriteMetaBlock(index, &handle);
+            handle.EncodeTo(&meta_handles[PlainTableFormat::kIndexBlockName]);
+            properties_.index_size = index.size();
+
+            const std::vector<uint32_t> &hashes = index_builder_->bloom_hashes();
+            if (io_status_.ok() && table_options_.bloom_bits_per_key > 0 &&
+                !hashes.empty())
+            {
+                PlainTableBloom bloom;
+                bloom.SetTotalBits(&arena_,
+                                   static_cast<uint32_t>(
+                                       hashes.size() * table_options_.bloom_bits_per_key),
+                                   0 /* huge_page_tlb_size */);
+                for (uint32_t hash : hashes)
+                {
+                    bloom.AddHash(hash);
+                }
+                num_bloom_blocks = bloom.GetNumBlocks();
+                io_status_ = WriteMetaBlock(bloom.GetRawData(), &handle);
+                handle.EncodeTo(&meta_handles[PlainTableFormat::kBloomBlockName]);
+                properties_.filter_size = bloom.GetRawData().size();
+            }
+        }
+
+        if (io_status_.ok())
+        {
+            std::map<std::string, std::string> props;
+            props[PlainTableFormat::kNumEntries] =
+                EncodeVarint64Property(properties_.num_entries);
+            props[PlainTableFormat::kRawKeySize] =
+                EncodeVarint64Property(properties_.raw_key_size);
+            props[PlainTableFormat::kRawValueSize] =
+                EncodeVarint64Property(properties_.raw_value_size);
+            props[PlainTableFormat::kDataSize] =
+                EncodeVarint64Property(properties_.data_size);
+            props[PlainTableFormat::kFixedKeyLen] =
+                EncodeVarint64Property(properties_.fixed_key_len);
+            props[PlainTableFormat::kIndexSparseness] =
+                EncodeVarint64Property(table_options_.index_sparseness);
+            props[PlainTableFormat::kPrefixExtractorName] =
+                properties_.prefix_extractor_name;
+            props[PlainTablePropertyNames::kEncodingType] =
+                EncodeVarint64Property(table_options_.encoding_type);
+            props[PlainTablePropertyNames::kBloomVersion] =
+                EncodeVarint64Property(PlainTableBloom::kBloomVersion);
+            props[PlainTablePropertyNames::kNumBloomBlocks] =
+                EncodeVarint64Property(num_bloom_blocks);
+            BlockBuilder props_block(1 /* block_restart_interval */);
+            for (const auto &prop : props)
+            {
+                props_block.Add(prop.first, prop.second);
+            }
+            io_status_ = WriteMetaBlock(props_block.Finish(), &handle);
+            handle.EncodeTo(&meta_handles[PlainTableFormat::kPropertiesBlockName]);
+        }
+
+        BlockHandle metaindex_handle;
+        if (io_status_.ok())
+        {
+            BlockBuilder metaindex_block(1 /* block_restart_interval */);
+            for (const auto &meta : meta_handles)
+            {
+                metaindex_block.Add(meta.first, meta.second);
+            }
+            io_status_ = WriteMetaBlock(metaindex_block.Finish(), &metaindex_handle);
+        }
+        if (io_status_.ok())
+        {
+            FooterBuilder footer;
+            footer.Build(kPlainTableMagicNumber, PlainTableFormat::kFormatVersion,
+                         kCRC32c, metaindex_handle, BlockHandle::NullBlockHandle());
+            io_status_ = Append(footer.GetSlice());
+        }
+        status_ = io_status_;
+        return status_;
+    }
+
+    void PlainTableBuilder::Abandon() { closed_ = true; }
+}
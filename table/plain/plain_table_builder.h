@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "memory/arena.h"
+#include "table/format.h"
+#include "table/plain/plain_table_index.h"
+#include "table/plain/plain_table_key_coding.h"
+#include "table/table_builder.h"
+#include "xiaodb/file_checksum.h"
+#include "xiaodb/file_system.h"
+#include "xiaodb/slice_transform.h"
+#include "xiaodb/table.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Builds a plain table (see plain_table_format.h). The records are
+    // appended to the file as they are added; with store_index_in_file, the
+    // index and the bloom filter are computed along the way and written
+    // after them, so that readers can map them instead of scanning the file
+    // at open.
+    class PlainTableBuilder : public TableBuilder
+    {
+    public:
+        // prefix_extractor is nullptr for a table in total order mode; it and
+        // file must outlive the builder.
+        PlainTableBuilder(const PlainTableOptions &table_options,
+                          const SliceTransform *prefix_extractor,
+                          FSWritableFile *file);
+
+        PlainTableBuilder(const PlainTableBuilder &) = delete;
+        void operator=(const PlainTableBuilder &) = delete;
+
+        ~PlainTableBuilder() override;
+
+        void Add(const Slice &key, const Slice &value) override;
+
+        Status status() const override { return status_; }
+        IOStatus io_status() const override { return io_status_; }
+
+        Status Finish() override;
+        void Abandon() override;
+
+        uint64_t NumEntries() const override { return properties_.num_entries; }
+        uint64_t FileSize() const override { return offset_; }
+
+        TableProperties GetTableProperties() const override { return properties_; }
+
+        std::string GetFileChecksum() const override { return kUnknownFileChecksum; }
+        const char *GetFileChecksumFuncName() const override
+        {
+            return kUnknownFileChecksumFuncName;
+        }
+
+    private:
+        IOStatus Append(const Slice &data);
+
+        // Writes contents as an uncompressed meta block, with its trailer.
+        IOStatus WriteMetaBlock(const Slice &contents, BlockHandle *handle);
+
+        const PlainTableOptions table_options_;
+        const SliceTransform *prefix_extractor_;
+        FSWritableFile *file_;
+        PlainTableKeyEncoder encoder_;
+
+        Arena arena_;
+        // Only with store_index_in_file.
+        std::unique_ptr<PlainTableIndexBuilder> index_builder_;
+
+        std::string record_;
+        uint64_t offset_ = 0;
+        TableProperties properties_;
+        Status status_;
+        IOStatus io_status_;
+        bool closed_ = false;
+    };
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "xiaodb/xiaodb_namespace.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // A plain table file is laid out as
+    //
+    //   records (see plain_table_key_coding.h)
+    //   [index block]      if PlainTableOptions::store_index_in_file
+    //   [bloom block]      if store_index_in_file and bloom_bits_per_key > 0
+    //   properties block
+    //   metaindex block
+    //   footer             (magic number kPlainTableMagicNumber)
+    //
+    // The meta blocks have the usual block trailer (compression type and
+    // checksum) and are never compressed. The properties and metaindex blocks
+    // are in the BlockBuilder format; the metaindex maps the names below to
+    // block handles. The index and bloom blocks hold the in-memory layouts of
+    // PlainTableIndex and PlainTableBloom, so that they are used in place.
+    struct PlainTableFormat
+    {
+        static const std::string kIndexBlockName;
+        static const std::string kBloomBlockName;
+        static const std::string kPropertiesBlockName;
+
+        // Properties, besides those of PlainTablePropertyNames. Integers are
+        // varint64 encoded.
+        static const std::string kNumEntries;
+        static const std::string kRawKeySize;
+        static const std::string kRawValueSize;
+        static const std::string kDataSize;
+        static const std::string kFixedKeyLen;
+        static const std::string kPrefixExtractorName;
+        static const std::string kIndexSparseness;
+
+        static constexpr uint32_t kFormatVersion = 1;
+    };
+}
@@ -0,0 +1,151 @@
+#include "table/plain/plain_table_index.h"
+
+#include <algorithm>
+
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace XIAODB_NAMESPACE
+{
+    Status PlainTableIndex::InitFromRawData(const Slice &data)
+    {
+        if (data.size() < kHeaderSize)
+        {
+            return Status::Corruption("plain table index too short");
+        }
+        num_buckets_ = DecodeFixed32(data.data());
+        num_prefixes_ = DecodeFixed32(data.data() + 4);
+        sub_index_size_ = DecodeFixed32(data.data() + 8);
+        if (num_buckets_ == 0 ||
+            data.size() != kHeaderSize + uint64_t{num_buckets_} * 4 + sub_index_size_)
+        {
+            return Status::Corruption("bad plain table index size");
+        }
+        buckets_ = data.data() + kHeaderSize;
+        sub_index_ = buckets_ + num_buckets_ * 4;
+        return Status::OK();
+    }
+
+    PlainTableIndex::IndexSearchResult PlainTableIndex::GetOffset(
+        uint32_t prefix_hash, uint32_t *bucket_value) const
+    {
+        const uint32_t bucket = PlainTableBucket(prefix_hash, num_buckets_);
+        *bucket_value = DecodeFixed32(buckets_ + bucket * 4);
+        if (*bucket_value == kMaxFileSize)
+        {
+            return kNoPrefixForBucket;
+        }
+        if ((*bucket_value & kSubIndexMask) == kSubIndexMask)
+        {
+            *bucket_value &= ~kSubIndexMask;
+            return kSubindex;
+        }
+        return kDirectToFile;
+    }
+
+    const char *PlainTableIndex::GetSubIndexBasePtrAndUpperBound(
+        uint32_t bucket_value, uint32_t *upper_bound) const
+    {
+        const char *p = sub_index_ + bucket_value;
+        return GetVarint32Ptr(p, sub_index_ + sub_index_size_, upper_bound);
+    }
+
+    PlainTableIndexBuilder::PlainTableIndexBuilder(
+        Arena *arena, const SliceTransform *prefix_extractor, size_t index_sparseness,
+        double hash_table_ratio, size_t huge_page_tlb_size)
+        : arena_(arena),
+          prefix_extractor_(prefix_extractor),
+          index_sparseness_(std::max<size_t>(index_sparseness, 1)),
+          hash_table_ratio_(hash_table_ratio),
+          huge_page_tlb_size_(huge_page_tlb_size) {}
+
+    void PlainTableIndexBuilder::AddKey(const Slice &user_key, uint32_t key_offset)
+    {
+        const Slice prefix = PlainTableKeyPrefix(prefix_extractor_, user_key);
+        if (num_prefixes_ == 0 || prefix != Slice(prev_prefix_))
+        {
+            prev_prefix_.assign(prefix.data(), prefix.size());
+            prev_prefix_hash_ = GetSliceHash(prefix);
+            ++num_prefixes_;
+            keys_in_prefix_ = 0;
+            if (prefix_extractor_ != nullptr)
+            {
+                bloom_hashes_.push_back(prev_prefix_hash_);
+            }
+        }
+        if (prefix_extractor_ == nullptr)
+        {
+            bloom_hashes_.push_back(GetSliceHash(user_key));
+        }
+        if (keys_in_prefix_ % index_sparseness_ == 0)
+        {
+            records_.push_back({prev_prefix_hash_, key_offset});
+        }
+        ++keys_in_prefix_;
+    }
+
+    Slice PlainTableIndexBuilder::Finish()
+    {
+        uint32_t num_buckets = 1;
+        if (prefix_extractor_ != nullptr && hash_table_ratio_ > 0)
+        {
+            num_buckets = std::max<uint32_t>(
+                1, static_cast<uint32_t>(num_prefixes_ / hash_table_ratio_));
+        }
+
+        // Count the keys of every bucket to lay out the sub-index.
+        std::vector<uint32_t> bucket_keys(num_buckets, 0);
+        for (const IndexRecord &record : records_)
+        {
+            ++bucket_keys[PlainTableBucket(record.hash, num_buckets)];
+        }
+        std::vector<uint32_t> bucket_values(num_buckets, PlainTableIndex::kMaxFileSize);
+        uint32_t sub_index_size = 0;
+        for (uint32_t b = 0; b < num_buckets; ++b)
+        {
+            if (bucket_keys[b] > 1)
+            {
+                bucket_values[b] = PlainTableIndex::kSubIndexMask | sub_index_size;
+                sub_index_size += VarintLength(bucket_keys[b]) + bucket_keys[b] * 4;
+            }
+        }
+
+        const size_t total = PlainTableIndex::kHeaderSize +
+                             size_t{num_buckets} * 4 + sub_index_size;
+        char *data = arena_->AllocateAligned(total, huge_page_tlb_size_);
+        EncodeFixed32(data, num_buckets);
+        EncodeFixed32(data + 4, num_prefixes_);
+        EncodeFixed32(data + 8, sub_index_size);
+        char *sub_index = data + PlainTableIndex::kHeaderSize + num_buckets * 4;
+
+        // Start every sub-index list with its length, and fill the lists in
+        // file order.
+        std::vector<char *> next_offset(num_buckets, nullptr);
+        for (uint32_t b = 0; b < num_buckets; ++b)
+        {
+            if (bucket_keys[b] > 1)
+            {
+                char *p = sub_index + (bucket_values[b] & ~PlainTableIndex::kSubIndexMask);
+                next_offset[b] = EncodeVarint32(p, bucket_keys[b]);
+            }
+        }
+        for (const IndexRecord &record : records_)
+        {
+            const uint32_t b = PlainTableBucket(record.hash, num_buckets);
+            if (bucket_keys[b] == 1)
+            {
+                bucket_values[b] = record.offset;
+            }
+            else
+            {
+                EncodeFixed32(next_offset[b], record.offset);
+                next_offset[b] += 4;
+            }
+        }
+        for (uint32_t b = 0; b < num_buckets; ++b)
+        {
+            EncodeFixed32(data + PlainTableIndex::kHeaderSize + b * 4, bucket_values[b]);
+        }
+        return Slice(data, total);
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "memory/arena.h"
+#include "xiaodb/slice.h"
+#include "xiaodb/slice_transform.h"
+#include "xiaodb/status.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // The index of a plain table: a hash table from key prefixes to the file
+    // offsets of the records to start searching from. In total order mode
+    // (no prefix extractor), all the keys share the empty prefix, and the
+    // index is a single bucket.
+    //
+    // Within every prefix, the first key and every index_sparseness-th key
+    // after it are indexed. A bucket indexing a single key holds its file
+    // offset; a bucket indexing more keys, of one or several prefixes, points
+    // into the sub-index, where the offsets of its keys are listed in file
+    // order for a binary search over the keys.
+    //
+    // Serialized layout, used in place both in memory and in the file:
+    //
+    //   fixed32 num_buckets
+    //   fixed32 num_prefixes
+    //   fixed32 sub_index_size
+    //   fixed32 buckets[num_buckets]
+    //   sub_index[sub_index_size]: per bucket, varint32 num_keys followed by
+    //                              num_keys fixed32 file offsets
+    //
+    // A bucket is kMaxFileSize if empty, the offset in the sub-index with
+    // kSubIndexMask set, or a file offset.
+    class PlainTableIndex
+    {
+    public:
+        enum IndexSearchResult
+        {
+            kNoPrefixForBucket = 0,
+            kDirectToFile = 1,
+            kSubindex = 2,
+        };
+
+        // The data of a plain table must fit in 31 bits of offset.
+        static constexpr uint32_t kMaxFileSize = (1u << 31) - 1;
+        static constexpr uint32_t kSubIndexMask = 0x80000000;
+        static constexpr size_t kHeaderSize = 3 * sizeof(uint32_t);
+
+        PlainTableIndex() {}
+
+        // Uses the serialized index at data in place; data must outlive it.
+        Status InitFromRawData(const Slice &data);
+
+        IndexSearchResult GetOffset(uint32_t prefix_hash, uint32_t *bucket_value) const;
+
+        // For a kSubindex bucket_value, returns the file offsets of the keys
+        // of the bucket (fixed32 each) and sets *upper_bound to their number.
+        const char *GetSubIndexBasePtrAndUpperBound(uint32_t bucket_value,
+                                                    uint32_t *upper_bound) const;
+
+        uint32_t GetNumBuckets() const { return num_buckets_; }
+        uint32_t GetNumPrefixes() const { return num_prefixes_; }
+        uint32_t GetSubIndexSize() const { return sub_index_size_; }
+
+    private:
+        uint32_t num_buckets_ = 0;
+        uint32_t num_prefixes_ = 0;
+        uint32_t sub_index_size_ = 0;
+        const char *buckets_ = nullptr;
+        const char *sub_index_ = nullptr;
+    };
+
+    // Builds a PlainTableIndex, out of an arena, from the keys of a table.
+    // Also collects the hashes to add to the bloom filter of the table: those
+    // of the prefixes, or of every user key in total order mode.
+    class PlainTableIndexBuilder
+    {
+    public:
+        // prefix_extractor is nullptr for total order mode. The index is
+        // allocated out of arena, from huge pages if huge_page_tlb_size > 0.
+        PlainTableIndexBuilder(Arena *arena, const SliceTransform *prefix_extractor,
+                               size_t index_sparseness, double hash_table_ratio,
+                               size_t huge_page_tlb_size);
+
+        PlainTableIndexBuilder(const PlainTableIndexBuilder &) = delete;
+        void operator=(const PlainTableIndexBuilder &) = delete;
+
+        // Called for every key of the table, in order.
+        void AddKey(const Slice &user_key, uint32_t key_offset);
+
+        // Builds the index and returns its serialized form, in the arena.
+        Slice Finish();
+
+        uint32_t NumPrefixes() const { return num_prefixes_; }
+
+        const std::vector<uint32_t> &bloom_hashes() const { return bloom_hashes_; }
+
+    private:
+        struct IndexRecord
+        {
+            uint32_t hash;
+            uint32_t offset;
+        };
+
+        Arena *arena_;
+        const SliceTransform *prefix_extractor_;
+        const size_t index_sparseness_;
+        const double hash_table_ratio_;
+        const size_t huge_page_tlb_size_;
+
+        // In file order.
+        std::vector<IndexRecord> records_;
+        std::vector<uint32_t> bloom_hashes_;
+        std::string prev_prefix_;
+        uint32_t prev_prefix_hash_ = 0;
+        uint32_t num_prefixes_ = 0;
+        // Keys of the current prefix so far.
+        size_t keys_in_prefix_ = 0;
+    };
+
+    // The prefix a key is indexed under: its prefix, or the whole key if it
+    // is out of the domain of the prefix extractor; the empty prefix in total
+    // order mode.
+    inline Slice PlainTableKeyPrefix(const SliceTransform *prefix_extractor,
+                                     const Slice &user_key)
+    {
+        if (prefix_extractor == nullptr)
+        {
+            return Slice();
+        }
+        return prefix_extractor->InDomain(user_key)
+                   ? prefix_extractor->Transform(user_key)
+                   : user_key;
+    }
+
+    // The bucket of a prefix hash.
+    inline uint32_t PlainTableBucket(uint32_t prefix_hash, uint32_t num_buckets)
+    {
+        return num_buckets == 1 ? 0 : prefix_hash % num_buckets;
+    }
+}
@@ -0,0 +1,82 @@
+#include "table/plain/plain_table_key_coding.h"
+
+#include "util/coding.h"
+
+namespace XIAODB_NAMESPACE
+{
+    Status PlainTableKeyEncoder::AppendRecord(const Slice &internal_key,
+                                              const Slice &value,
+                                              std::string *out) const
+    {
+        if (internal_key.size() < kNumInternalBytes)
+        {
+            return Status::Corruption("internal key too short for a plain table");
+        }
+        if (user_key_len_ != kPlainTableVariableLength)
+        {
+            if (internal_key.size() != user_key_len_ + kNumInternalBytes)
+            {
+                return Status::InvalidArgument(
+                    "user key length differs from PlainTableOptions::user_key_len");
+            }
+        }
+        else
+        {
+            PutVarint32(out, static_cast<uint32_t>(internal_key.size()));
+        }
+        out->append(internal_key.data(), internal_key.size());
+        PutLengthPrefixedSlice(out, value);
+        return Status::OK();
+    }
+
+    const char *PlainTableKeyDecoder::DecodeKey(const char *start,
+                                                const char *limit,
+                                                Slice *internal_key) const
+    {
+        uint32_t key_len = user_key_len_ + static_cast<uint32_t>(kNumInternalBytes);
+        const char *p = start;
+        if (user_key_len_ == kPlainTableVariableLength)
+        {
+            p = GetVarint32Ptr(p, limit, &key_len);
+            if (p == nullptr || key_len < kNumInternalBytes)
+            {
+                return nullptr;
+            }
+        }
+        if (static_cast<size_t>(limit - p) < key_len)
+        {
+            return nullptr;
+        }
+        *internal_key = Slice(p, key_len);
+        return p + key_len;
+    }
+
+    Status PlainTableKeyDecoder::NextRecord(const char *start, const char *limit,
+                                            Slice *internal_key, Slice *value,
+                                            uint32_t *bytes_read) const
+    {
+        const char *p = DecodeKey(start, limit, internal_key);
+        uint32_t value_len = 0;
+        if (p != nullptr)
+        {
+            p = GetVarint32Ptr(p, limit, &value_len);
+        }
+        if (p == nullptr || static_cast<size_t>(limit - p) < value_len)
+        {
+            return Status::Corruption("bad record in plain table");
+        }
+        *value = Slice(p, value_len);
+        *bytes_read = static_cast<uint32_t>(p + value_len - start);
+        return Status::OK();
+    }
+
+    Status PlainTableKeyDecoder::NextKey(const char *start, const char *limit,
+                                         Slice *internal_key) const
+    {
+        if (DecodeKey(start, limit, internal_key) == nullptr)
+        {
+            return Status::Corruption("bad key in plain table");
+        }
+        return Status::OK();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "db/dbformat.h"
+#include "xiaodb/slice.h"
+#include "xiaodb/status.h"
+#include "xiaodb/table.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // The records of a plain table follow each other with no block structure:
+    //
+    //   record: key value
+    //   value:  varint32 length, bytes
+    //   key:    with a fixed user key length (PlainTableOptions::user_key_len),
+    //             user key (user_key_len bytes), fixed64 packed sequence/type
+    //           with variable length user keys,
+    //             varint32 internal key length, internal key
+    //
+    // Only kPlain encoding is supported; kPrefix is rejected when building
+    // and reading.
+    class PlainTableKeyEncoder
+    {
+    public:
+        explicit PlainTableKeyEncoder(uint32_t user_key_len)
+            : user_key_len_(user_key_len) {}
+
+        // Appends the encoding of internal_key and value to out. Fails if the
+        // user key does not have the fixed length.
+        Status AppendRecord(const Slice &internal_key, const Slice &value,
+                            std::string *out) const;
+
+    private:
+        const uint32_t user_key_len_;
+    };
+
+    class PlainTableKeyDecoder
+    {
+    public:
+        explicit PlainTableKeyDecoder(uint32_t user_key_len)
+            : user_key_len_(user_key_len) {}
+
+        // Decodes the record at [start, limit), setting *internal_key and
+        // *value, which point into it, and *bytes_read to its length.
+        Status NextRecord(const char *start, const char *limit, Slice *internal_key,
+                          Slice *value, uint32_t *bytes_read) const;
+
+        // Decodes the key only, for the binary search of the index.
+        Status NextKey(const char *start, const char *limit,
+                       Slice *internal_key) const;
+
+    private:
+        // Returns the end of the key, or nullptr if it is malformed.
+        const char *DecodeKey(const char *start, const char *limit,
+                              Slice *internal_key) const;
+
+        uint32_t user_key_len_;
+    };
+}
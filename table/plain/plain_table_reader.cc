@@ -0,0 +1,667 @@
+#include "table/plain/plain_table_reader.h"
+
+#include "table/block_based/block.h"
+#include "table/plain/plain_table_format.h"
+#include "util/coding.h"
+#include "xiaodb/cleanable.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        // Cleanup of the values Get() pins in the mapping of the file.
+        void ReleaseMapping(void *arg1, void * /*arg2*/)
+        {
+            delete static_cast<std::shared_ptr<const MemMapping> *>(arg1);
+        }
+
+        Status DecodeVarint64Property(const Slice &value, uint64_t *result)
+        {
+            Slice input = value;
+            if (!GetVarint64(&input, result))
+            {
+                return Status::Corruption("bad plain table property");
+            }
+            return Status::OK();
+        }
+    }
+
+    // Iterates over the records of a PlainTableReader, in file order, which is
+    // key order. Keys and values point into the file data.
+    class PlainTableIterator : public InternalIterator
+    {
+    public:
+        // use_prefix_seek: whether the seeks are within the prefix of the
+        // target; required for a table in prefix mode.
+        PlainTableIterator(const PlainTableReader *table, bool use_prefix_seek)
+            : table_(table), use_prefix_seek_(use_prefix_seek) {}
+
+        bool Valid() const override { return valid_; }
+
+        void SeekToFirst() override
+        {
+            status_ = Status::OK();
+            next_offset_ = 0;
+            Advance();
+        }
+
+        void SeekToLast() override
+        {
+            valid_ = false;
+            status_ = Status::NotSupported("SeekToLast() is not supported in PlainTable");
+        }
+
+        void Seek(const Slice &target) override;
+
+        void SeekForPrev(const Slice & /*target*/) override
+        {
+            valid_ = false;
+            status_ = Status::NotSupported("SeekForPrev() is not supported in PlainTable");
+        }
+
+        void Next() override
+        {
+            assert(Valid());
+            Advance();
+        }
+
+        void Prev() override
+        {
+            valid_ = false;
+            status_ = Status::NotSupported("Prev() is not supported in PlainTable");
+        }
+
+        Slice key() const override
+        {
+            assert(Valid());
+            return key_;
+        }
+
+        Slice value() const override
+        {
+            assert(Valid());
+            return value_;
+        }
+
+        Status status() const override { return status_; }
+
+    private:
+        // Moves to the record at next_offset_, if any.
+        void Advance()
+        {
+            if (next_offset_ >= table_->data_end_)
+            {
+                valid_ = false;
+                return;
+            }
+            status_ = table_->ReadRecord(next_offset_, &key_, &value_, &next_offset_);
+            valid_ = status_.ok();
+        }
+
+        const PlainTableReader *table_;
+        const bool use_prefix_seek_;
+        bool valid_ = false;
+        uint32_t next_offset_ = 0;
+        Slice key_;
+        Slice value_;
+        Status status_;
+    };
+
+    void PlainTableIterator::Seek(const Slice &target)
+    {
+        valid_ = false;
+        if (table_->table_options_.full_scan_mode)
+        {
+            status_ = Status::NotSupported("Seek() is not supported in full scan mode");
+            return;
+        }
+        if (!table_->total_order() && !use_prefix_seek_)
+        {
+            status_ = Status::NotSupported(
+                "total order seek is not supported on a PlainTable in prefix mode");
+            return;
+        }
+        status_ = Status::OK();
+
+        const Slice user_key = ExtractUserKey(target);
+        const Slice prefix = PlainTableKeyPrefix(table_->prefix_extractor_, user_key);
+        const uint32_t prefix_hash = GetSliceHash(prefix);
+        // In total order mode, the bloom filter holds whole keys, which a seek
+        // cannot rule out.
+        if (!table_->total_order() && table_->bloom_.IsInitialized() &&
+            !table_->bloom_.MayContainHash(prefix_hash))
+        {
+            return;
+        }
+        if (!table_->GetOffset(target, prefix, prefix_hash, &next_offset_, &status_))
+        {
+            return;
+        }
+        for (Advance(); valid_; Advance())
+        {
+            if (table_->internal_comparator_.Compare(key_, target) >= 0)
+            {
+                break;
+            }
+        }
+        if (valid_ && !table_->total_order() &&
+            PlainTableKeyPrefix(table_->prefix_extractor_, ExtractUserKey(key_)) != prefix)
+        {
+            valid_ = false;
+        }
+    }
+
+    PlainTableReader::PlainTableReader(const PlainTableOptions &table_options,
+                                       const InternalKeyComparator &internal_comparator,
+                                       const SliceTransform *prefix_extractor,
+                                       std::unique_ptr<RandomAccessFileReader> &&file)
+        : table_options_(table_options),
+          internal_comparator_(internal_comparator),
+          prefix_extractor_(prefix_extractor),
+          file_(std::move(file)),
+          decoder_(table_options.user_key_len),
+          arena_(Arena::kMinBlockSize, nullptr /* tracker */,
+                 table_options.huge_page_tlb_size) {}
+
+    PlainTableReader::~PlainTableReader() = default;
+
+    Status PlainTableReader::Open(const ReadOptions &ro,
+                                  const PlainTableOptions &table_options,
+                                  const InternalKeyComparator &internal_comparator,
+                                  const SliceTransform *prefix_extractor,
+                                  std::unique_ptr<RandomAccessFileReader> &&file,
+                                  uint64_t file_size,
+                                  std::unique_ptr<TableReader> *table_reader)
+    {
+        table_reader->reset();
+
+        IOOptions opts;
+        Status s = file->PrepareIOOptions(ro, opts);
+        if (!s.ok())
+        {
+            return s;
+        }
+        std::unique_ptr<PlainTableReader> new_table(new PlainTableReader(
+            table_options, internal_comparator, prefix_extractor, std::move(file)));
+        PlainTableReader *rep = new_table.get();
+
+        MemMapping mapping = MemMapping::MapFileReadOnly(rep->file_->file_name());
+        if (mapping.Get() != nullptr && mapping.Length() >= file_size)
+        {
+            // A lookup touches a few records here and there.
+            mapping.Advise(MemMapping::Advice::kRandom);
+            rep->mmap_ = std::make_shared<const MemMapping>(std::move(mapping));
+            rep->file_data_ =
+                Slice(static_cast<const char *>(rep->mmap_->Get()), file_size);
+        }
+        else
+        {
+            rep->file_copy_.reset(new char[file_size]);
+            s = rep->file_->Read(opts, 0, file_size, &rep->file_data_,
+                                 rep->file_copy_.get(), nullptr /* aligned_buf */);
+            if (!s.ok())
+            {
+                return s;
+            }
+            if (rep->file_data_.size() != file_size)
+            {
+                return Status::Corruption("truncated plain table " +
+                                          rep->file_->file_name());
+            }
+        }
+
+        if (file_size < Footer::kEncodedLength)
+        {
+            return Status::Corruption("file is too short to be a plain table: " +
+                                      rep->file_->file_name());
+        }
+        const uint64_t footer_offset = file_size - Footer::kEncodedLength;
+        s = rep->footer_.DecodeFrom(
+            Slice(rep->file_data_.data() + footer_offset, Footer::kEncodedLength),
+            footer_offset);
+        if (!s.ok())
+        {
+            return s;
+        }
+        if (rep->footer_.table_magic_number() != kPlainTableMagicNumber)
+        {
+            return Status::Corruption("not a plain table: " + rep->file_->file_name());
+        }
+
+        BlockHandle index_handle = BlockHandle::NullBlockHandle();
+        BlockHandle bloom_handle = BlockHandle::NullBlockHandle();
+        uint32_t num_bloom_blocks = 0;
+        uint64_t bloom_version = 0;
+        s = rep->ReadMetaBlocks(ro, &index_handle, &bloom_handle, &num_bloom_blocks,
+                                &bloom_version);
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        if (!table_options.full_scan_mode)
+        {
+            // The stored index is only valid for the prefix extractor it was
+            // built for.
+            const std::string prefix_extractor_name =
+                prefix_extractor != nullptr ? prefix_extractor->Name() : "nullptr";
+            if (!index_handle.IsNull() &&
+                rep->table_properties_->prefix_extractor_name == prefix_extractor_name)
+            {
+                BlockContents index_contents;
+                s = rep->ReadMetaBlock(ro, index_handle, &index_contents);
+                if (s.ok())
+                {
+                    s = rep->index_.InitFromRawData(index_contents.data);
+                }
+                if (s.ok() && !bloom_handle.IsNull() &&
+                    bloom_version == PlainTableBloom::kBloomVersion &&
+                    table_options.bloom_bits_per_key > 0)
+                {
+                    BlockContents bloom_contents;
+                    s = rep->ReadMetaBlock(ro, bloom_handle, &bloom_contents);
+                    if (s.ok() && (num_bloom_blocks == 0 ||
+                                   bloom_contents.data.size() !=
+                                       uint64_t{num_bloom_blocks} *
+                                           PlainTableBloom::kBlockBytes))
+                    {
+                        s = Status::Corruption("bad plain table bloom block in " +
+                                               rep->file_->file_name());
+                    }
+                    if (s.ok())
+                    {
+                        rep->bloom_.SetRawData(bloom_contents.data.data(),
+                                               num_bloom_blocks);
+                    }
+                }
+            }
+            else
+            {
+                s = rep->PopulateIndex();
+            }
+            if (!s.ok())
+            {
+                return s;
+            }
+        }
+
+        *table_reader = std::move(new_table);
+        return Status::OK();
+    }
+
+    Status PlainTableReader::ReadMetaBlock(const ReadOptions &ro,
+                                           const BlockHandle &handle,
+                                           BlockContents *contents) const
+    {
+        if (handle.offset() > file_data_.size() ||
+            file_data_.size() - handle.offset() < handle.size() + kBlockTrailerSize)
+        {
+            return Status::Corruption("plain table meta block out of bounds in " +
+                                      file_->file_name());
+        }
+        // The file data outlives the reader's use of the block.
+        return DecodeSerializedBlock(footer_, CacheAllocationPtr(),
+                                     file_data_.data() + handle.offset(), handle,
+                                     ro.verify_checksums, file_->file_name(), contents,
+                                     nullptr /* allocator */, true /* data_is_pinned */);
+    }
+
+    Status PlainTableReader::ReadMetaBlocks(const ReadOptions &ro,
+                                            BlockHandle *index_handle,
+                                            BlockHandle *bloom_handle,
+                                            uint32_t *num_bloom_blocks,
+                                            uint64_t *bloom_version)
+    {
+        BlockContents metaindex_contents;
+        Status s = ReadMetaBlock(ro, footer_.metaindex_handle(), &metaindex_contents);
+        if (!s.ok())
+        {
+            return s;
+        }
+        BlockHandle properties_handle = BlockHandle::NullBlockHandle();
+        Block metaindex(std::move(metaindex_contents));
+        BlockIter meta_iter;
+        metaindex.InitIter(nullptr /* bytewise */, &meta_iter);
+        for (meta_iter.SeekToFirst(); meta_iter.Valid() && s.ok(); meta_iter.Next())
+        {
+            const Slice name = meta_iter.key();
+            BlockHandle *handle = nullptr;
+            if (name == Slice(PlainTableFormat::kIndexBlockName))
+            {
+                handle = index_handle;
+            }
+            else if (name == Slice(PlainTableFormat::kBloomBlockName))
+            {
+                handle = bloom_handle;
+            }
+            else if (name == Slice(PlainTableFormat::kPropertiesBlockName))
+            {
+                handle = &properties_handle;
+            }
+            if (handle != nullptr)
+            {
+                Slice input = meta_iter.value();
+                s = handle->DecodeFrom(&input);
+            }
+        }
+        if (s.ok())
+        {
+            s = meta_iter.status();
+        }
+        if (!s.ok())
+        {
+            return s;
+        }
+        if (properties_handle.IsNull())
+        {
+            return Status::Corruption("plain table without properties: " +
+                                      file_->file_name());
+        }
+
+        BlockContents properties_contents;
+        s = ReadMetaBlock(ro, properties_handle, &properties_contents);
+        if (!s.ok())
+        {
+            return s;
+        }
+        auto props = std::make_shared<TableProperties>();
+        props->format_version = footer_.format_version();
+        uint64_t encoding_type = kPlain;
+        uint64_t bloom_blocks = 0;
+        const std::pair<const std::string *, uint64_t *> varint_props[] = {
+            {&PlainTableFormat::kNumEntries, &props->num_entries},
+            {&PlainTableFormat::kRawKeySize, &props->raw_key_size},
+            {&PlainTableFormat::kRawValueSize, &props->raw_value_size},
+            {&PlainTableFormat::kDataSize, &props->data_size},
+            {&PlainTableFormat::kFixedKeyLen, &props->fixed_key_len},
+            {&PlainTablePropertyNames::kEncodingType, &encoding_type},
+            {&PlainTablePropertyNames::kBloomVersion, bloom_version},
+            {&PlainTablePropertyNames::kNumBloomBlocks, &bloom_blocks},
+        };
+        Block properties(std::move(properties_contents));
+        BlockIter props_iter;
+        properties.InitIter(nullptr /* bytewise */, &props_iter);
+        for (props_iter.SeekToFirst(); props_iter.Valid() && s.ok(); props_iter.Next())
+        {
+            const Slice name = props_iter.key();
+            if (name == Slice(PlainTableFormat::kPrefixExtractorName))
+            {
+                props->prefix_extractor_name = props_iter.value().ToString();
+                continue;
+            }
+            for (const auto &prop : varint_props)
+            {
+                if (name == Slice(*prop.first))
+                {
+                    s = DecodeVarint64Property(props_iter.value(), prop.second);
+                    break;
+                }
+            }
+        }
+        if (s.ok())
+        {
+            s = props_iter.status();
+        }
+        if (!s.ok())
+        {
+            return s;
+        }
+        if (encoding_type != kPlain)
+        {
+            return Status::NotSupported("plain table only supports kPlain encoding");
+        }
+        if (props->data_size > footer_.metaindex_handle().offset() ||
+            props->data_size > PlainTableIndex::kMaxFileSize ||
+            props->fixed_key_len > PlainTableIndex::kMaxFileSize)
+        {
+            return Status::Corruption("bad plain table properties in " +
+                                      file_->file_name());
+        }
+        props->index_size = index_handle->IsNull() ? 0 : index_handle->size();
+        props->filter_size = bloom_handle->IsNull() ? 0 : bloom_handle->size();
+
+        data_end_ = static_cast<uint32_t>(props->data_size);
+        decoder_ = PlainTableKeyDecoder(static_cast<uint32_t>(props->fixed_key_len));
+        *num_bloom_blocks = static_cast<uint32_t>(bloom_blocks);
+        table_properties_ = std::move(props);
+        return Status::OK();
+    }
+
+    Status PlainTableReader::PopulateIndex()
+    {
+        PlainTableIndexBuilder builder(&arena_, prefix_extractor_,
+                                       table_options_.index_sparseness,
+                                       table_options_.hash_table_ratio,
+                                       table_options_.huge_page_tlb_size);
+        Status s;
+        for (uint32_t offset = 0; offset < data_end_;)
+        {
+            Slice internal_key;
+            Slice value;
+            uint32_t next_offset = 0;
+            s = ReadRecord(offset, &internal_key, &value, &next_offset);
+            if (!s.ok())
+            {
+                return s;
+            }
+            builder.AddKey(ExtractUserKey(internal_key), offset);
+            offset = next_offset;
+        }
+        s = index_.InitFromRawData(builder.Finish());
+        if (!s.ok())
+        {
+            return s;
+        }
+
+        const std::vector<uint32_t> &hashes = builder.bloom_hashes();
+        if (table_options_.bloom_bits_per_key > 0 && !hashes.empty())
+        {
+            bloom_.SetTotalBits(
+                &arena_,
+                static_cast<uint32_t>(hashes.size() * table_options_.bloom_bits_per_key),
+                table_options_.huge_page_tlb_size);
+            for (uint32_t hash : hashes)
+            {
+                bloom_.AddHash(hash);
+            }
+        }
+        return Status::OK();
+    }
+
+    Status PlainTableReader::ReadRecord(uint32_t offset, Slice *internal_key,
+                                        Slice *value, uint32_t *next_offset) const
+    {
+        if (offset >= data_end_)
+        {
+            return Status::Corruption("plain table offset out of bounds");
+        }
+        uint32_t bytes_read = 0;
+        Status s = decoder_.NextRecord(file_data_.data() + offset,
+                                       file_data_.data() + data_end_, internal_key,
+                                       value, &bytes_read);
+        *next_offset = offset + bytes_read;
+        return s;
+    }
+
+    Status PlainTableReader::ReadKey(uint32_t offset, Slice *internal_key) const
+    {
+        if (offset >= data_end_)
+        {
+            return Status::Corruption("plain table offset out of bounds");
+        }
+        return decoder_.NextKey(file_data_.data() + offset,
+                                file_data_.data() + data_end_, internal_key);
+    }
+
+    bool PlainTableReader::GetOffset(const Slice &target, const Slice &prefix,
+                                     uint32_t prefix_hash, uint32_t *offset,
+                                     Status *s) const
+    {
+        uint32_t bucket_value = 0;
+        switch (index_.GetOffset(prefix_hash, &bucket_value))
+        {
+        case PlainTableIndex::kNoPrefixForBucket:
+            return false;
+        case PlainTableIndex::kDirectToFile:
+            // The only key of the bucket is the first of its prefix.
+            *offset = bucket_value;
+            return true;
+        case PlainTableIndex::kSubindex:
+            break;
+        }
+
+        uint32_t num_keys = 0;
+        const char *offsets =
+            index_.GetSubIndexBasePtrAndUpperBound(bucket_value, &num_keys);
+        if (offsets == nullptr)
+        {
+            *s = Status::Corruption("bad plain table sub-index");
+            return false;
+        }
+        // The indexed keys of the bucket are in key order, and include the
+        // first key of every prefix in it. Find the first one >= target.
+        uint32_t low = 0;
+        uint32_t high = num_keys;
+        Slice key;
+        while (low < high)
+        {
+            const uint32_t mid = low + (high - low) / 2;
+            *s = ReadKey(DecodeFixed32(offsets + mid * 4), &key);
+            if (!s->ok())
+            {
+                return false;
+            }
+            if (internal_comparator_.Compare(key, target) < 0)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        // Keys of the prefix < target may be followed by target itself, so
+        // scan from the indexed key before it, if it is of the prefix.
+        if (low > 0)
+        {
+            const uint32_t before = DecodeFixed32(offsets + (low - 1) * 4);
+            *s = ReadKey(before, &key);
+            if (!s->ok())
+            {
+                return false;
+            }
+            if (total_order() ||
+                PlainTableKeyPrefix(prefix_extractor_, ExtractUserKey(key)) == prefix)
+            {
+                *offset = before;
+                return true;
+            }
+        }
+        if (low == num_keys)
+        {
+            return false;
+        }
+        *offset = DecodeFixed32(offsets + low * 4);
+        return true;
+    }
+
+    InternalIterator *PlainTableReader::NewIterator(
+        const ReadOptions &read_options, const SliceTransform * /*prefix_extractor*/,
+        Arena *arena, bool /*skip_filters*/, TableReaderCaller /*caller*/,
+        size_t /*compaction_readahead_size*/, bool /*allow_unprepared_value*/)
+    {
+        const bool use_prefix_seek = !total_order() && !read_options.total_order_seek &&
+                                     !read_options.auto_prefix_mode;
+        if (arena == nullptr)
+        {
+            return new PlainTableIterator(this, use_prefix_seek);
+        }
+        auto *mem = arena->AllocateAligned(sizeof(PlainTableIterator));
+        return new (mem) PlainTableIterator(this, use_prefix_seek);
+    }
+
+    Status PlainTableReader::Get(const ReadOptions & /*readOptions*/, const Slice &key,
+                                 GetContext *get_context,
+                                 const SliceTransform * /*prefix_extractor*/,
+                                 bool skip_filters)
+    {
+        if (table_options_.full_scan_mode)
+        {
+            return Status::NotSupported("Get() is not supported in full scan mode");
+        }
+        const Slice user_key = ExtractUserKey(key);
+        if (!skip_filters && bloom_.IsInitialized() &&
+            !bloom_.MayContainHash(BloomHash(user_key)))
+        {
+            return Status::OK();
+        }
+        const Slice prefix = PlainTableKeyPrefix(prefix_extractor_, user_key);
+        uint32_t offset = 0;
+        Status s;
+        if (!GetOffset(key, prefix, GetSliceHash(prefix), &offset, &s))
+        {
+            return s;
+        }
+
+        // Values are returned without a copy out of the mapping, pinning it.
+        const bool pin_values = mmap_ != nullptr;
+        while (offset < data_end_)
+        {
+            Slice internal_key;
+            Slice value;
+            s = ReadRecord(offset, &internal_key, &value, &offset);
+            if (!s.ok())
+            {
+                return s;
+            }
+            ParsedInternalKey parsed_key;
+            s = ParseInternalKey(internal_key, &parsed_key, false /* log_err_key */);
+            if (!s.ok())
+            {
+                return s;
+            }
+            if (!total_order() &&
+                PlainTableKeyPrefix(prefix_extractor_, parsed_key.user_key) != prefix)
+            {
+                break;
+            }
+            if (internal_comparator_.Compare(internal_key, key) < 0)
+            {
+                continue;
+            }
+            bool matched = false;
+            Cleanable value_pinner;
+            if (pin_values)
+            {
+                value_pinner.RegisterCleanup(
+                    &ReleaseMapping, new std::shared_ptr<const MemMapping>(mmap_),
+                    nullptr);
+            }
+            if (!get_context->SaveValue(parsed_key, value, &matched, &s,
+                                        pin_values ? &value_pinner : nullptr))
+            {
+                // Either the value is complete, or the user key changed.
+                break;
+            }
+            if (!s.ok())
+            {
+                break;
+            }
+        }
+        return s;
+    }
+
+    void PlainTableReader::Prepare(const Slice &target)
+    {
+        if (bloom_.IsInitialized())
+        {
+            bloom_.Prefetch(BloomHash(ExtractUserKey(target)));
+        }
+    }
+
+    size_t PlainTableReader::ApproximateMemoryUsage() const
+    {
+        return arena_.MemoryAllocatedBytes() +
+               (file_copy_ != nullptr ? file_data_.size() : 0);
+    }
+}
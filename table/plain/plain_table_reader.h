@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "db/dbformat.h"
+#include "file/random_access_file_reader.h"
+#include "memory/arena.h"
+#include "port/mmap.h"
+#include "table/format.h"
+#include "table/plain/plain_table_bloom.h"
+#include "table/plain/plain_table_index.h"
+#include "table/plain/plain_table_key_coding.h"
+#include "table/table_reader.h"
+#include "util/hash.h"
+#include "xiaodb/slice_transform.h"
+#include "xiaodb/table.h"
+#include "xiaodb/table_properties.h"
+
+namespace XIAODB_NAMESPACE
+{
+    class PlainTableIterator;
+
+    // Reader for the plain table format (see plain_table_format.h), which is
+    // optimized for tables in memory or on a RAM disk: the records are
+    // decoded in place, out of a read-only mapping of the file, and a hash
+    // index from key prefixes to record offsets narrows a lookup down to a
+    // few records of the prefix.
+    //
+    // The index and the bloom filter are mapped in place when the file has
+    // them (PlainTableOptions::store_index_in_file) and was written for the
+    // same prefix extractor. Otherwise they are built at Open(), by a scan of
+    // the records, in an arena of the reader (of huge pages with
+    // huge_page_tlb_size). In full_scan_mode, no index is built and the
+    // table can only be iterated from the first key.
+    //
+    // If the file cannot be mapped, it is read into memory at Open().
+    //
+    // In prefix mode, the iterators only support seeks within a prefix, and
+    // none of the readers support reverse iteration.
+    class PlainTableReader : public TableReader
+    {
+    public:
+        // Attempt to open the table that is stored in bytes [0..file_size)
+        // of "file". prefix_extractor is nullptr for a table in total order
+        // mode; it and internal_comparator must outlive the reader.
+        static Status Open(const ReadOptions &ro,
+                           const PlainTableOptions &table_options,
+                           const InternalKeyComparator &internal_comparator,
+                           const SliceTransform *prefix_extractor,
+                           std::unique_ptr<RandomAccessFileReader> &&file,
+                           uint64_t file_size,
+                           std::unique_ptr<TableReader> *table_reader);
+
+        ~PlainTableReader() override;
+
+        InternalIterator *NewIterator(const ReadOptions &,
+                                      const SliceTransform *prefix_extractor,
+                                      Arena *arena, bool skip_filters,
+                                      TableReaderCaller caller,
+                                      size_t compaction_readahead_size = 0,
+                                      bool allow_unprepared_value = false) override;
+
+        Status Get(const ReadOptions &readOptions, const Slice &key,
+                   GetContext *get_context, const SliceTransform *prefix_extractor,
+                   bool skip_filters = false) override;
+
+        // The records are not laid out in blocks the sizes could be estimated
+        // from.
+        uint64_t ApproximateOffsetOf(const ReadOptions & /*read_options*/,
+                                     const Slice & /*key*/,
+                                     TableReaderCaller /*caller*/) override
+        {
+            return 0;
+        }
+
+        uint64_t ApproximateSize(const ReadOptions & /*read_options*/,
+                                 const Slice & /*start*/, const Slice & /*end*/,
+                                 TableReaderCaller /*caller*/) override
+        {
+            return 0;
+        }
+
+        void SetupForCompaction() override {}
+
+        std::shared_ptr<const TableProperties> GetTableProperties() const override
+        {
+            return table_properties_;
+        }
+
+        // Prefetches the bloom filter line of the prefix of target.
+        void Prepare(const Slice &target) override;
+
+        size_t ApproximateMemoryUsage() const override;
+
+    private:
+        friend class PlainTableIterator;
+
+        PlainTableReader(const PlainTableOptions &table_options,
+                         const InternalKeyComparator &internal_comparator,
+                         const SliceTransform *prefix_extractor,
+                         std::unique_ptr<RandomAccessFileReader> &&file);
+
+        // Reads the properties and the handles of the meta blocks, with the
+        // file data set up.
+        Status ReadMetaBlocks(const ReadOptions &ro, BlockHandle *index_handle,
+                              BlockHandle *bloom_handle, uint32_t *num_bloom_blocks,
+                              uint64_t *bloom_version);
+
+        // Decodes the meta block at handle in place out of the file data.
+        Status ReadMetaBlock(const ReadOptions &ro, const BlockHandle &handle,
+                             BlockContents *contents) const;
+
+        // Builds the index and the bloom filter out of the records.
+        Status PopulateIndex();
+
+        bool total_order() const { return prefix_extractor_ == nullptr; }
+
+        // The hash the bloom filter holds for user_key: that of its prefix,
+        // or of the whole key in total order mode.
+        uint32_t BloomHash(const Slice &user_key) const
+        {
+            return GetSliceHash(total_order()
+                                    ? user_key
+                                    : PlainTableKeyPrefix(prefix_extractor_, user_key));
+        }
+
+        // Sets *offset to the record to start scanning from for the internal
+        // key target of the given prefix. Returns false if there are no keys
+        // of the prefix.
+        bool GetOffset(const Slice &target, const Slice &prefix,
+                       uint32_t prefix_hash, uint32_t *offset, Status *s) const;
+
+        // Decodes the record at offset, which must be < data_end_.
+        Status ReadRecord(uint32_t offset, Slice *internal_key, Slice *value,
+                          uint32_t *next_offset) const;
+
+        // Decodes only the key of the record at offset.
+        Status ReadKey(uint32_t offset, Slice *internal_key) const;
+
+        const PlainTableOptions table_options_;
+        const InternalKeyComparator &internal_comparator_;
+        const SliceTransform *prefix_extractor_;
+        std::unique_ptr<RandomAccessFileReader> file_;
+        // The whole file: mapped read-only, shared with the values Get()
+        // pins in it, or read into file_copy_.
+        std::shared_ptr<const MemMapping> mmap_;
+        std::unique_ptr<char[]> file_copy_;
+        Slice file_data_;
+        Footer footer_;
+        // The records end at data_end_.
+        uint32_t data_end_ = 0;
+        PlainTableKeyDecoder decoder_;
+
+        // Holds the index and the bloom filter when they are built at Open().
+        Arena arena_;
+        PlainTableIndex index_;
+        PlainTableBloom bloom_;
+        std::shared_ptr<const TableProperties> table_properties_;
+    };
+}
@@ -0,0 +1,246 @@
+#include "util/adaptive_compression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "monitoring/statistics_impl.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        // Weight of the latest block in the moving averages of the cost
+        // model.
+        constexpr double kAverageWeight = 1.0 / 8;
+
+        // The probe of a large block is made of this many evenly spaced
+        // chunks, so that a block with a compressible header and an
+        // incompressible body (or the reverse) is judged on both.
+        constexpr size_t kProbeChunks = 4;
+
+        // Order-0 entropy of data, in bits per byte.
+        double ByteEntropy(const Slice &data)
+        {
+            std::array<uint32_t, 256> counts{};
+            for (size_t i = 0; i < data.size(); ++i)
+            {
+                ++counts[static_cast<unsigned char>(data[i])];
+            }
+            const double n = static_cast<double>(data.size());
+            double sum = 0;
+            for (uint32_t c : counts)
+            {
+                if (c != 0)
+                {
+                    sum += c * std::log2(static_cast<double>(c));
+                }
+            }
+            return std::log2(n) - sum / n;
+        }
+
+        // The effective level of ZSTD at level.
+        int ZSTDLevel(int level)
+        {
+            // NB: ZSTD_CLEVEL_DEFAULT is historically == 3
+            return level == CompressionOptions::kDefaultCompressionLevel ? 3 : level;
+        }
+    }
+
+    AdaptiveCompressor::AdaptiveCompressor(
+        CompressionType compression_type, const CompressionOptions &compression_opts,
+        const AdaptiveCompressionOptions &adaptive_opts, SystemClock *clock,
+        Statistics *statistics)
+        : compression_opts_(compression_opts),
+          adaptive_opts_(adaptive_opts),
+          clock_(clock),
+          statistics_(statistics)
+    {
+        if (compression_type == kNoCompression ||
+            !CompressionTypeSupported(compression_type))
+        {
+            return;
+        }
+        // The ladder, cheapest first. Only the candidates cheaper than the
+        // configured compression are added below it.
+        if (compression_type != kLZ4Compression &&
+            compression_type != kSnappyCompression && LZ4_Supported())
+        {
+            AddCandidate(kLZ4Compression, CompressionOptions::kDefaultCompressionLevel,
+                         ADAPTIVE_COMPRESSION_LZ4);
+        }
+        const bool slower_than_zstd_fast =
+            compression_type == kZlibCompression ||
+            compression_type == kBZip2Compression ||
+            compression_type == kLZ4HCCompression ||
+            (compression_type == kZSTD && ZSTDLevel(compression_opts.level) > 1);
+        if (slower_than_zstd_fast && ZSTD_Supported())
+        {
+            AddCandidate(kZSTD, 1, ADAPTIVE_COMPRESSION_ZSTD_FAST);
+        }
+        AddCandidate(compression_type, compression_opts.level,
+                     ADAPTIVE_COMPRESSION_CONFIGURED);
+
+        if (LZ4_Supported())
+        {
+            probe_ctx_.reset(new CompressionContext(kLZ4Compression, compression_opts_));
+        }
+    }
+
+    void AdaptiveCompressor::AddCandidate(CompressionType type, int level,
+                                          Tickers ticker)
+    {
+        Candidate candidate;
+        candidate.type = type;
+        candidate.opts = compression_opts_;
+        candidate.opts.level = level;
+        candidate.ctx.reset(new CompressionContext(type, candidate.opts));
+        candidate.ticker = ticker;
+        candidates_.push_back(std::move(candidate));
+    }
+
+    bool AdaptiveCompressor::LooksCompressible(const Slice &raw)
+    {
+        const size_t probe_bytes = adaptive_opts_.probe_bytes;
+        if (probe_bytes == 0)
+        {
+            return true;
+        }
+        Slice sample = raw;
+        if (raw.size() > probe_bytes)
+        {
+            const size_t chunk = std::max<size_t>(probe_bytes / kProbeChunks, 1);
+            const size_t stride = (raw.size() - chunk) / (kProbeChunks - 1);
+            probe_.clear();
+            for (size_t i = 0; i < kProbeChunks; ++i)
+            {
+                probe_.append(raw.data() + i * stride, chunk);
+            }
+            sample = Slice(probe_);
+        }
+        if (sample.empty() || ByteEntropy(sample) <= adaptive_opts_.max_entropy_bits)
+        {
+            return true;
+        }
+        if (probe_ctx_ == nullptr)
+        {
+            return false;
+        }
+        // Data with a flat byte histogram may still repeat itself (e.g.
+        // copies of random ids), which LZ4 finds quickly.
+        CompressionInfo info(compression_opts_, *probe_ctx_,
+                             CompressionDict::GetEmptyDict(), kLZ4Compression,
+                             0 /* sample_for_compression */);
+        probe_out_.clear();
+        const uint64_t max_per_kb =
+            static_cast<uint64_t>(std::max(compression_opts_.max_compressed_bytes_per_kb, 0));
+        return CompressData(sample, info, 2 /* compress_format_version */, &probe_out_) &&
+               probe_out_.size() <= sample.size() * max_per_kb / 1024;
+    }
+
+    size_t AdaptiveCompressor::PickCandidate() const
+    {
+        // Measure every candidate before comparing them.
+        for (size_t i = 0; i < candidates_.size(); ++i)
+        {
+            if (!candidates_[i].measured)
+            {
+                return i;
+            }
+        }
+        const uint64_t budget = adaptive_opts_.max_nanos_per_kb;
+        size_t cheapest = 0;
+        size_t best = candidates_.size();
+        for (size_t i = 0; i < candidates_.size(); ++i)
+        {
+            const Candidate &c = candidates_[i];
+            if (c.nanos_per_kb < candidates_[cheapest].nanos_per_kb)
+            {
+                cheapest = i;
+            }
+            if ((budget == 0 || c.nanos_per_kb <= static_cast<double>(budget)) &&
+                (best == candidates_.size() || c.bytes_per_kb < candidates_[best].bytes_per_kb))
+            {
+                best = i;
+            }
+        }
+        return best != candidates_.size() ? best : cheapest;
+    }
+
+    CompressionType AdaptiveCompressor::Compress(const Slice &raw,
+                                                 std::string *compressed)
+    {
+        ++num_blocks_;
+        if (candidates_.empty())
+        {
+            RecordTick(statistics_, NUMBER_BLOCK_COMPRESSION_BYPASSED);
+            RecordTick(statistics_, BYTES_COMPRESSION_BYPASSED, raw.size());
+            return kNoCompression;
+        }
+        if (!LooksCompressible(raw))
+        {
+            RecordTick(statistics_, ADAPTIVE_COMPRESSION_PROBE_SKIPPED);
+            RecordTick(statistics_, NUMBER_BLOCK_COMPRESSION_BYPASSED);
+            RecordTick(statistics_, BYTES_COMPRESSION_BYPASSED, raw.size());
+            return kNoCompression;
+        }
+
+        size_t idx = PickCandidate();
+        bool explored = false;
+        if (adaptive_opts_.explore_period > 0 && candidates_.size() > 1 &&
+            num_blocks_ % adaptive_opts_.explore_period == 0)
+        {
+            // Round robin over the candidates not picked.
+            if (next_explore_ == idx)
+            {
+                next_explore_ = (next_explore_ + 1) % candidates_.size();
+            }
+            idx = next_explore_;
+            next_explore_ = (next_explore_ + 1) % candidates_.size();
+            explored = true;
+        }
+
+        Candidate &c = candidates_[idx];
+        CompressionInfo info(c.opts, *c.ctx, CompressionDict::GetEmptyDict(), c.type,
+                             0 /* sample_for_compression */);
+        compressed->clear();
+        const uint64_t start = clock_->NowNanos();
+        const bool ok = CompressData(raw, info, 2 /* compress_format_version */,
+                                     compressed);
+        const uint64_t nanos = clock_->NowNanos() - start;
+        RecordTick(statistics_, NUMBER_BLOCK_COMPRESSED);
+
+        const double kb = static_cast<double>(std::max<size_t>(raw.size(), 1)) / 1024;
+        const double nanos_per_kb = static_cast<double>(nanos) / kb;
+        // A failure counts as no saving at all.
+        const double bytes_per_kb = ok ? static_cast<double>(compressed->size()) / kb : 1024;
+        if (c.measured)
+        {
+            c.nanos_per_kb += kAverageWeight * (nanos_per_kb - c.nanos_per_kb);
+            c.bytes_per_kb += kAverageWeight * (bytes_per_kb - c.bytes_per_kb);
+        }
+        else
+        {
+            c.nanos_per_kb = nanos_per_kb;
+            c.bytes_per_kb = bytes_per_kb;
+            c.measured = true;
+        }
+
+        const uint64_t max_per_kb =
+            static_cast<uint64_t>(std::max(compression_opts_.max_compressed_bytes_per_kb, 0));
+        if (!ok || compressed->size() > raw.size() * max_per_kb / 1024)
+        {
+            RecordTick(statistics_, NUMBER_BLOCK_COMPRESSION_REJECTED);
+            RecordTick(statistics_, BYTES_COMPRESSION_REJECTED, raw.size());
+            return kNoCompression;
+        }
+        RecordTick(statistics_, c.ticker);
+        if (explored)
+        {
+            RecordTick(statistics_, ADAPTIVE_COMPRESSION_EXPLORED);
+        }
+        RecordTick(statistics_, BYTES_COMPRESSED_FROM, raw.size());
+        RecordTick(statistics_, BYTES_COMPRESSED_TO, compressed->size());
+        return c.type;
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/compression.h"
+#include "xiaodb/statistics.h"
+#include "xiaodb/system_clock.h"
+
+namespace XIAODB_NAMESPACE
+{
+    struct AdaptiveCompressionOptions
+    {
+        // The compression CPU time to spend per KB of blocks, on average, in
+        // nanoseconds. The compressor picks the candidate that compresses
+        // best within the budget, or the cheapest if none fits it. 0 means
+        // no budget: the best compressing candidate is picked.
+        uint64_t max_nanos_per_kb = 0;
+
+        // Bytes of a block the compressibility probe looks at, in evenly
+        // spaced chunks. 0 disables the probe.
+        size_t probe_bytes = 4096;
+
+        // Blocks whose probe has an order-0 entropy above this many bits per
+        // byte are double checked with an LZ4 pass over the probe (or, in
+        // builds without LZ4, deemed incompressible). Compressed and
+        // encrypted data come close to 8.
+        double max_entropy_bits = 7.5;
+
+        // Every explore_period blocks, a candidate other than the one picked
+        // is run instead, to keep its cost and ratio estimates current as
+        // the data changes. 0 disables exploring.
+        uint32_t explore_period = 64;
+    };
+
+    // Compresses blocks with the compression algorithm and level that suit
+    // them, as opposed to the fixed CompressionType of CompressData():
+    //
+    // - Blocks that a cheap probe (byte entropy of a sample, then an LZ4
+    //   pass over it if it looks random) finds incompressible, e.g. already
+    //   compressed media, are stored as is without paying for compression.
+    // - The others are compressed with one of a ladder of candidates, from
+    //   LZ4 and ZSTD at its fastest level up to the configured compression,
+    //   picked by a cost model: a moving average of the CPU time per KB and
+    //   of the compressed size per KB of every candidate, measured on the
+    //   blocks it compresses.
+    //
+    // The block trailer records the algorithm, so readers need no change.
+    // The decisions are recorded in statistics (ADAPTIVE_COMPRESSION_*,
+    // along with the usual compression tickers).
+    //
+    // One compressor per thread; it keeps a compression context per
+    // candidate.
+    class AdaptiveCompressor
+    {
+    public:
+        // compression_type and compression_opts are the configured
+        // compression, the top of the ladder. clock times compression, and
+        // statistics, if any, must outlive the compressor.
+        AdaptiveCompressor(CompressionType compression_type,
+                           const CompressionOptions &compression_opts,
+                           const AdaptiveCompressionOptions &adaptive_opts,
+                           SystemClock *clock, Statistics *statistics = nullptr);
+
+        AdaptiveCompressor(const AdaptiveCompressor &) = delete;
+        void operator=(const AdaptiveCompressor &) = delete;
+
+        // Compresses raw into *compressed and returns the algorithm used, or
+        // returns kNoCompression if raw is to be stored uncompressed: if it
+        // is incompressible, or compression does not save enough (see
+        // CompressionOptions::max_compressed_bytes_per_kb).
+        CompressionType Compress(const Slice &raw, std::string *compressed);
+
+    private:
+        struct Candidate
+        {
+            CompressionType type;
+            CompressionOptions opts;
+            std::unique_ptr<CompressionContext> ctx;
+            Tickers ticker;
+            // Moving averages, valid once measured.
+            bool measured = false;
+            double nanos_per_kb = 0;
+            double bytes_per_kb = 0;
+        };
+
+        void AddCandidate(CompressionType type, int level, Tickers ticker);
+
+        // Whether the probe of raw suggests that it compresses.
+        bool LooksCompressible(const Slice &raw);
+
+        // The candidate the cost model picks.
+        size_t PickCandidate() const;
+
+        const CompressionOptions compression_opts_;
+        const AdaptiveCompressionOptions adaptive_opts_;
+        SystemClock *const clock_;
+        Statistics *const statistics_;
+        std::vector<Candidate> candidates_;
+        std::unique_ptr<CompressionContext> probe_ctx_;
+        uint64_t num_blocks_ = 0;
+        size_t next_explore_ = 0;
+        std::string probe_;
+        std::string probe_out_;
+    };
+}
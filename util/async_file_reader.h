@@ -4,8 +4,8 @@
 #include "file/random_access_file_reader.h"
 #include "folly/coro/ViaIfAsync.h"
 #include "port/port.h"
-#include "rocksdb/file_system.h"
-#include "rocksdb/statistics.h"
+#include "xiaodb/file_system.h"
+#include "xiaodb/statistics.h"
 #include "util/autovector.h"
 #include "util/stop_watch.h"
 
@@ -142,5 +142,5 @@ namespace XIAODB_NAMESPACE
         FileSystem *fs_;
         Statistics *stats_;
     };
-} // namespace ROCKSDB_NAMESPACE
+}
 #endif // USE_COROUTINES
@@ -50,11 +50,11 @@ namespace XIAODB_NAMESPACE
                 : vect_(vect), index_(index) {}
             iterator_impl(const iterator_impl &) = default;
             ~iterator_impl() {}
-            iterator_impl &opeartor = (const iterator_impl &) = default;
+            iterator_impl &operator=(const iterator_impl &) = default;
 
             self_type &operator++()
             {
-                ++index;
+                ++index_;
                 return *this;
             }
 
@@ -65,7 +65,7 @@ namespace XIAODB_NAMESPACE
                 return old;
             }
 
-            self_type &opeartor--()
+            self_type &operator--()
             {
                 --index_;
                 return *this;
@@ -215,7 +215,7 @@ namespace XIAODB_NAMESPACE
 
         void reserve(size_t cap)
         {
-            if (cap < kSize)
+            if (cap > kSize)
             {
                 vect_.reserve(cap - kSize);
             }
@@ -223,6 +223,16 @@ namespace XIAODB_NAMESPACE
             assert(cap <= capacity());
         }
 
+        reference operator[](size_type n)
+        {
+            assert(n < size());
+            if (n < kSize)
+            {
+                return values_[n];
+            }
+            return vect_[n - kSize];
+        }
+
         const_reference operator[](size_type n) const
         {
             assert(n < size());
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "port/port.h"
+#include "util/fastrange.h"
+#include "util/hash.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // A fast, flexible, and accurate cache-local Bloom implementation with
+    // SIMD-optimized query performance (currently using AVX2 on Intel). This is
+    // the implementation behind filters built with format_version >= 5.
+    //
+    // Each key is confined to one 64-byte cache line, chosen with the lower 32
+    // bits of a 64-bit key hash. The upper 32 bits seed num_probes probes
+    // within that line, each successive probe hash being the previous one
+    // multiplied by the golden ratio constant. Because probes never leave the
+    // line, a query costs at most one cache miss regardless of num_probes.
+    //
+    // With AVX2, eight probes are computed in parallel: the eight bit
+    // positions are derived with one vector multiply, the eight 32-bit words
+    // holding them are fetched from the line with a single gather, and all
+    // eight bits are tested with one instruction. Bit positions are addressed
+    // as bytes in the scalar path, which on little-endian hardware is the same
+    // bit as the one the 32-bit word addressing of the SIMD path picks, so the
+    // two paths are interchangeable on the same data.
+    //
+    // The data is not required to be cache-line aligned, but queries are
+    // faster when it is.
+    class FastLocalBloomImpl
+    {
+    public:
+        // Size of the block each key is confined to. Part of the filter format.
+        static constexpr uint32_t kCacheLineBytes = 64;
+
+        static inline int ChooseNumProbes(int millibits_per_key)
+        {
+            // Since this implementation can (with AVX2) make up to 8 probes
+            // for the same cost, we pick the most accurate num_probes, based
+            // on actual tests of the implementation. Note that for higher
+            // bits/key, the best choice for cache-local Bloom can be notably
+            // smaller than standard bloom, e.g. 9 instead of 11 @ 16 b/k.
+            if (millibits_per_key <= 2080)
+            {
+                return 1;
+            }
+            else if (millibits_per_key <= 3580)
+            {
+                return 2;
+            }
+            else if (millibits_per_key <= 5100)
+            {
+                return 3;
+            }
+            else if (millibits_per_key <= 6640)
+            {
+                return 4;
+            }
+            else if (millibits_per_key <= 8300)
+            {
+                return 5;
+            }
+            else if (millibits_per_key <= 10070)
+            {
+                return 6;
+            }
+            else if (millibits_per_key <= 11720)
+            {
+                return 7;
+            }
+            else if (millibits_per_key <= 14001)
+            {
+                // Would be something like <= 13800 but sacrificing *slightly* for
+                // more settings using <= 8 probes.
+                return 8;
+            }
+            else if (millibits_per_key <= 16050)
+            {
+                return 9;
+            }
+            else if (millibits_per_key <= 18300)
+            {
+                return 10;
+            }
+            else if (millibits_per_key <= 22001)
+            {
+                return 11;
+            }
+            else if (millibits_per_key <= 25501)
+            {
+                return 12;
+            }
+            else if (millibits_per_key > 50000)
+            {
+                // Top out at 24 probes (three sets of 8)
+                return 24;
+            }
+            else
+            {
+                // Roughly optimal choices for remaining range
+                // e.g.
+                // 28000 -> 12, 28001 -> 13
+                // 50000 -> 23, 50001 -> 24
+                return (millibits_per_key - 1) / 2000 - 1;
+            }
+        }
+
+        static inline void AddHash(uint32_t h1, uint32_t h2, uint32_t len_bytes,
+                                   int num_probes, char *data)
+        {
+            uint32_t bytes_to_cache_line = FastRange32(h1, len_bytes >> 6) << 6;
+            AddHashPrepared(h2, num_probes, data + bytes_to_cache_line);
+        }
+
+        static inline void AddHashPrepared(uint32_t h2, int num_probes,
+                                           char *data_at_cache_line)
+        {
+            uint32_t h = h2;
+            for (int i = 0; i < num_probes; ++i, h *= kGoldenRatio)
+            {
+                // 9-bit address within 512 bit cache line
+                int bitpos = h >> (32 - 9);
+                data_at_cache_line[bitpos >> 3] |= (uint8_t{1} << (bitpos & 7));
+            }
+        }
+
+        // Computes the cache line for h1 and prefetches it, for a later
+        // HashMayMatchPrepared(). Batched lookups call this for every key before
+        // probing any, so that the cache misses overlap.
+        static inline void PrepareHash(uint32_t h1, uint32_t len_bytes,
+                                       const char *data,
+                                       uint32_t *byte_offset)
+        {
+            uint32_t bytes_to_cache_line = FastRange32(h1, len_bytes >> 6) << 6;
+            PREFETCH(data + bytes_to_cache_line, 0 /* rw */, 1 /* locality */);
+            PREFETCH(data + bytes_to_cache_line + kCacheLineBytes - 1, 0 /* rw */,
+                     1 /* locality */);
+            *byte_offset = bytes_to_cache_line;
+        }
+
+        static inline bool HashMayMatch(uint32_t h1, uint32_t h2, uint32_t len_bytes,
+                                        int num_probes, const char *data)
+        {
+            uint32_t bytes_to_cache_line = FastRange32(h1, len_bytes >> 6) << 6;
+            return HashMayMatchPrepared(h2, num_probes, data + bytes_to_cache_line);
+        }
+
+        static inline bool HashMayMatchPrepared(uint32_t h2, int num_probes,
+                                                const char *data_at_cache_line)
+        {
+            uint32_t h = h2;
+#ifdef __AVX2__
+            // Powers of the golden ratio constant, so that lane i computes the
+            // hash of probe i of the current set of eight.
+            const __m256i multipliers = _mm256_setr_epi32(
+                static_cast<int>(GoldenPow(0)), static_cast<int>(GoldenPow(1)),
+                static_cast<int>(GoldenPow(2)), static_cast<int>(GoldenPow(3)),
+                static_cast<int>(GoldenPow(4)), static_cast<int>(GoldenPow(5)),
+                static_cast<int>(GoldenPow(6)), static_cast<int>(GoldenPow(7)));
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m256i ones = _mm256_set1_epi32(1);
+            const __m256i low5 = _mm256_set1_epi32(31);
+            const int *words = reinterpret_cast<const int *>(data_at_cache_line);
+            for (;;)
+            {
+                __m256i hash_vector =
+                    _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(h)), multipliers);
+                // 9-bit address within 512 bit cache line: upper 4 bits select
+                // the 32-bit word, lower 5 bits the bit within it.
+                __m256i bitpos = _mm256_srli_epi32(hash_vector, 32 - 9);
+                __m256i word_idx = _mm256_srli_epi32(bitpos, 5);
+                __m256i probed = _mm256_i32gather_epi32(words, word_idx, 4);
+                __m256i bit_mask =
+                    _mm256_sllv_epi32(ones, _mm256_and_si256(bitpos, low5));
+                if (num_probes < 8)
+                {
+                    // Ignore lanes past the last probe
+                    bit_mask = _mm256_and_si256(
+                        bit_mask,
+                        _mm256_cmpgt_epi32(_mm256_set1_epi32(num_probes), lanes));
+                }
+                // All bits of bit_mask also set in probed?
+                if (!_mm256_testc_si256(probed, bit_mask))
+                {
+                    return false;
+                }
+                num_probes -= 8;
+                if (num_probes <= 0)
+                {
+                    return true;
+                }
+                h *= GoldenPow(8);
+            }
+#else
+            for (int i = 0; i < num_probes; ++i, h *= kGoldenRatio)
+            {
+                // 9-bit address within 512 bit cache line
+                int bitpos = h >> (32 - 9);
+                if ((data_at_cache_line[bitpos >> 3] & (char(1) << (bitpos & 7))) == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+#endif
+        }
+
+    private:
+        static constexpr uint32_t kGoldenRatio = 0x9e3779b9;
+
+        static constexpr uint32_t GoldenPow(int n)
+        {
+            uint32_t r = 1;
+            for (int i = 0; i < n; ++i)
+            {
+                r *= kGoldenRatio;
+            }
+            return r;
+        }
+    };
+}
@@ -1,11 +1,20 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <string>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 #include "port/port.h"
 #include "xiaodb/slice.h"
 #include "util/coding_lean.h"
+#include "util/math.h"
 
 // some processors does not allow unaligned access to memory
 #if defined(__sparc)
@@ -92,6 +101,146 @@ namespace XIAODB_NAMESPACE
         return GetVarint32PtrFallback(p, limit, value);
     }
 
+    // Bulk varint decoding, in the spirit of masked VByte (Plaisance, Kurz and
+    // Lemire, "Vectorized VByte Decoding"): the bytes ending varints are those
+    // with the high bit clear, so one mask over a load locates all the varints
+    // ending in it. A run of 16 one-byte varints, by far the most common
+    // (lengths and sizes are mostly below 128), is widened in one SSE2 step.
+    // Otherwise the varints ending in an 8-byte word are decoded from the mask
+    // of the word, with no branch per byte. Only longer varints, and the last
+    // bytes before limit, are decoded a byte at a time.
+
+    // The payload of a varint of up to kMaxLen bytes, alone in bytes.
+    template <size_t kMaxLen>
+    inline uint64_t VarintPayload(uint64_t bytes)
+    {
+#ifdef __BMI2__
+        return _pext_u64(bytes, 0x7f7f7f7f7f7f7f7full);
+#else
+        uint64_t result = 0;
+        for (size_t i = 0; i < kMaxLen; ++i)
+        {
+            result |= (bytes >> i) & (uint64_t{0x7f} << (7 * i));
+        }
+        return result;
+#endif
+    }
+
+    inline const char *GetVarintPtr(const char *p, const char *limit,
+                                    uint32_t *value)
+    {
+        return GetVarint32Ptr(p, limit, value);
+    }
+
+    inline const char *GetVarintPtr(const char *p, const char *limit,
+                                    uint64_t *value)
+    {
+        return GetVarint64Ptr(p, limit, value);
+    }
+
+    template <typename T>
+    inline const char *GetVarintArray(const char *p, const char *limit,
+                                      T *values, size_t n)
+    {
+        static_assert(sizeof(T) == 4 || sizeof(T) == 8, "varint32 or varint64");
+        // The longest varints decoded from a word: a varint32 of 4 bytes has
+        // 28 bits, one of 5 bytes does not fit in the payload mask.
+        constexpr size_t kMaxWordVarintLen = sizeof(T) == 4 ? 4 : 8;
+        size_t i = 0;
+        if (port::kLittleEndian)
+        {
+            while (i < n && limit - p >= 8)
+            {
+#ifdef __SSE2__
+                if (n - i >= 16 && limit - p >= 16)
+                {
+                    const __m128i bytes =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                    if (_mm_movemask_epi8(bytes) == 0)
+                    {
+                        const __m128i zero = _mm_setzero_si128();
+                        const __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+                        const __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+                        const __m128i v32[4] = {
+                            _mm_unpacklo_epi16(lo16, zero), _mm_unpackhi_epi16(lo16, zero),
+                            _mm_unpacklo_epi16(hi16, zero), _mm_unpackhi_epi16(hi16, zero)};
+                        __m128i *out = reinterpret_cast<__m128i *>(values + i);
+                        for (size_t j = 0; j < 4; ++j)
+                        {
+                            if constexpr (sizeof(T) == 4)
+                            {
+                                _mm_storeu_si128(out + j, v32[j]);
+                            }
+                            else
+                            {
+                                _mm_storeu_si128(out + 2 * j, _mm_unpacklo_epi32(v32[j], zero));
+                                _mm_storeu_si128(out + 2 * j + 1,
+                                                 _mm_unpackhi_epi32(v32[j], zero));
+                            }
+                        }
+                        i += 16;
+                        p += 16;
+                        continue;
+                    }
+                }
+#endif
+                uint64_t word;
+                memcpy(&word, p, sizeof(word));
+                uint64_t ends = ~word & 0x8080808080808080ull;
+                // In bits, from the start of the word.
+                size_t start = 0;
+                while (ends != 0 && i < n)
+                {
+                    const size_t end = static_cast<size_t>(CountTrailingZeroBits(ends)) + 1;
+                    if (end - start > 8 * kMaxWordVarintLen)
+                    {
+                        break;
+                    }
+                    // The bits up to the end of the varint
+                    const uint64_t bytes = (word & (ends ^ (ends - 1))) >> start;
+                    values[i++] = static_cast<T>(VarintPayload<kMaxWordVarintLen>(bytes));
+                    start = end;
+                    ends &= ends - 1;
+                }
+                if (start == 0)
+                {
+                    // The varint at p is too long for the word.
+                    if ((p = GetVarintPtr(p, limit, &values[i])) == nullptr)
+                    {
+                        return nullptr;
+                    }
+                    ++i;
+                    continue;
+                }
+                p += start / 8;
+            }
+        }
+        for (; i < n; ++i)
+        {
+            if ((p = GetVarintPtr(p, limit, &values[i])) == nullptr)
+            {
+                return nullptr;
+            }
+        }
+        return p;
+    }
+
+    // Decodes the n varints stored back to back at p into values[0, n), as n
+    // calls to GetVarint32Ptr() (GetVarint64Ptr()) would. Returns a pointer
+    // just past the last one, or nullptr if one of them is corrupt or crosses
+    // limit, leaving values unspecified.
+    inline const char *GetVarint32Array(const char *p, const char *limit,
+                                        uint32_t *values, size_t n)
+    {
+        return GetVarintArray(p, limit, values, n);
+    }
+
+    inline const char *GetVarint64Array(const char *p, const char *limit,
+                                        uint64_t *values, size_t n)
+    {
+        return GetVarintArray(p, limit, values, n);
+    }
+
     inline void PutFixed16(std::string *dst, uint16_t value)
     {
         if (port::kLittleEndian)
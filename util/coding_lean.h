@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 
@@ -102,4 +103,37 @@ namespace XIAODB_NAMESPACE
             return (hi << 32) | lo;
         }
     }
-}
\ No newline at end of file
+
+    // Decodes the n fixed32 (fixed64) values of an array at ptr, as n calls to
+    // DecodeFixed32() (DecodeFixed64()) would, but with a single copy on
+    // little-endian platforms. ptr needs no alignment.
+    inline void DecodeFixed32Array(const char *ptr, uint32_t *values, size_t n)
+    {
+        if (port::kLittleEndian)
+        {
+            memcpy(values, ptr, n * sizeof(uint32_t));
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                values[i] = DecodeFixed32(ptr + i * sizeof(uint32_t));
+            }
+        }
+    }
+
+    inline void DecodeFixed64Array(const char *ptr, uint64_t *values, size_t n)
+    {
+        if (port::kLittleEndian)
+        {
+            memcpy(values, ptr, n * sizeof(uint64_t));
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                values[i] = DecodeFixed64(ptr + i * sizeof(uint64_t));
+            }
+        }
+    }
+}
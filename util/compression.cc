@@ -0,0 +1,339 @@
+#include "util/compression.h"
+
+namespace XIAODB_NAMESPACE
+{
+    StreamingCompress *StreamingCompress::Create(CompressionType compression_type,
+                                                 const CompressionOptions &opts,
+                                                 uint32_t compress_format_version,
+                                                 size_t max_output_len)
+    {
+        switch (compression_type)
+        {
+        case kZSTD:
+        {
+            if (!ZSTD_Streaming_Supported())
+            {
+                return nullptr;
+            }
+            return new ZSTDStreamingCompress(opts, compress_format_version,
+                                             max_output_len);
+        }
+        case kLZ4Compression:
+        {
+            if (!LZ4_Streaming_Supported())
+            {
+                return nullptr;
+            }
+            return new LZ4StreamingCompress(opts, compress_format_version,
+                                            max_output_len);
+        }
+        default:
+            return nullptr;
+        }
+    }
+
+    StreamingUncompress *StreamingUncompress::Create(
+        CompressionType compression_type, uint32_t compress_format_version,
+        size_t max_output_len)
+    {
+        switch (compression_type)
+        {
+        case kZSTD:
+        {
+            if (!ZSTD_Streaming_Supported())
+            {
+                return nullptr;
+            }
+            return new ZSTDStreamingUncompress(compress_format_version,
+                                               max_output_len);
+        }
+        case kLZ4Compression:
+        {
+            if (!LZ4_Streaming_Supported())
+            {
+                return nullptr;
+            }
+            return new LZ4StreamingUncompress(compress_format_version,
+                                              max_output_len);
+        }
+        default:
+            return nullptr;
+        }
+    }
+
+    int ZSTDStreamingCompress::Compress(const char *input, size_t input_size,
+                                        char *output, size_t *output_pos)
+    {
+        assert(input != nullptr && output != nullptr && output_pos != nullptr);
+        *output_pos = 0;
+        // Don't need to compress an empty input
+        if (input_size == 0)
+        {
+            return 0;
+        }
+#ifdef ZSTD
+        // A caller may reuse its buffer for the next input, so an input is
+        // new once the previous one is done with.
+        if (input_buffer_.src != input ||
+            (input_buffer_.pos == input_buffer_.size && !flush_pending_))
+        {
+            // New input
+            // Catch errors where the previous input was not fully compressed.
+            assert(input_buffer_.pos == input_buffer_.size && !flush_pending_);
+            input_buffer_ = {input, input_size, /*pos=*/0};
+        }
+        ZSTD_outBuffer output_buffer = {output, max_output_len_, /*pos=*/0};
+        // Flush rather than end the frame, so that the next inputs can refer
+        // to this one.
+        const size_t remaining =
+            ZSTD_compressStream2(cctx_, &output_buffer, &input_buffer_, ZSTD_e_flush);
+        if (ZSTD_isError(remaining))
+        {
+            // Failure
+            Reset();
+            return -1;
+        }
+        // Success
+        *output_pos = output_buffer.pos;
+        flush_pending_ = remaining > 0;
+        // The input may be consumed while the output is not flushed yet.
+        return static_cast<int>(remaining > 0 ? remaining
+                                              : input_buffer_.size - input_buffer_.pos);
+#else
+        (void)input;
+        (void)output;
+        return -1;
+#endif // ZSTD
+    }
+
+    void ZSTDStreamingCompress::Reset()
+    {
+#ifdef ZSTD
+        ZSTD_CCtx_reset(cctx_, ZSTD_ResetDirective::ZSTD_reset_session_only);
+        input_buffer_ = {/*src=*/nullptr, /*size=*/0, /*pos=*/0};
+        flush_pending_ = false;
+#endif // ZSTD
+    }
+
+    int ZSTDStreamingUncompress::Uncompress(const char *input, size_t input_size,
+                                            char *output, size_t *output_pos)
+    {
+        assert(output != nullptr && output_pos != nullptr);
+        *output_pos = 0;
+        // Don't need to uncompress an empty input
+        if (input_size == 0)
+        {
+            return 0;
+        }
+#ifdef ZSTD
+        if (input)
+        {
+            // New input
+            input_buffer_ = {input, input_size, /*pos=*/0};
+        }
+        ZSTD_outBuffer output_buffer = {output, max_output_len_, /*pos=*/0};
+        size_t ret = ZSTD_decompressStream(dctx_, &output_buffer, &input_buffer_);
+        if (ZSTD_isError(ret))
+        {
+            Reset();
+            return -1;
+        }
+        *output_pos = output_buffer.pos;
+        return static_cast<int>(input_buffer_.size - input_buffer_.pos);
+#else
+        (void)input;
+        (void)output;
+        return -1;
+#endif // ZSTD
+    }
+
+    void ZSTDStreamingUncompress::Reset()
+    {
+#ifdef ZSTD
+        ZSTD_DCtx_reset(dctx_, ZSTD_ResetDirective::ZSTD_reset_session_only);
+        input_buffer_ = {/*src=*/nullptr, /*size=*/0, /*pos=*/0};
+#endif // ZSTD
+    }
+
+    LZ4StreamingCompress::LZ4StreamingCompress(const CompressionOptions &opts,
+                                               uint32_t compress_format_version,
+                                               size_t max_output_len)
+        : StreamingCompress(kLZ4Compression, opts, compress_format_version,
+                            max_output_len)
+    {
+#ifdef XIAODB_LZ4_FRAME
+        LZ4F_errorCode_t err = LZ4F_createCompressionContext(&cctx_, LZ4F_VERSION);
+        assert(!LZ4F_isError(err));
+        (void)err;
+        prefs_ = LZ4F_preferences_t();
+        prefs_.frameInfo.blockMode = LZ4F_blockLinked;
+        prefs_.autoFlush = 1;
+        // LZ4 takes an acceleration, where higher is faster, as a negative
+        // level.
+        if (opts.level != CompressionOptions::kDefaultCompressionLevel &&
+            opts.level < 0)
+        {
+            prefs_.compressionLevel = opts.level;
+        }
+#endif // XIAODB_LZ4_FRAME
+    }
+
+    LZ4StreamingCompress::~LZ4StreamingCompress()
+    {
+#ifdef XIAODB_LZ4_FRAME
+        LZ4F_freeCompressionContext(cctx_);
+#endif // XIAODB_LZ4_FRAME
+    }
+
+    int LZ4StreamingCompress::Compress(const char *input, size_t input_size,
+                                       char *output, size_t *output_pos)
+    {
+        assert(input != nullptr && output != nullptr && output_pos != nullptr);
+        *output_pos = 0;
+        // Don't need to compress an empty input
+        if (input_size == 0)
+        {
+            return 0;
+        }
+#ifdef XIAODB_LZ4_FRAME
+        // A caller may reuse its buffer for the next input, so an input is
+        // new once the previous one is done with.
+        if (input_ != input || input_pos_ == input_size_)
+        {
+            // New input
+            // Catch errors where the previous input was not fully compressed.
+            assert(input_pos_ == input_size_);
+            input_ = input;
+            input_size_ = input_size;
+            input_pos_ = 0;
+        }
+        char *out = output;
+        size_t out_avail = max_output_len_;
+        if (!frame_started_)
+        {
+            size_t n = LZ4F_compressBegin(cctx_, out, out_avail, &prefs_);
+            if (LZ4F_isError(n))
+            {
+                Reset();
+                return -1;
+            }
+            out += n;
+            out_avail -= n;
+            frame_started_ = true;
+        }
+        // Feed the input in pieces whose worst case output fits the room
+        // left; with auto flush, LZ4F buffers nothing across calls.
+        while (input_pos_ < input_size_)
+        {
+            size_t piece = std::min<size_t>(input_size_ - input_pos_, 64 << 10);
+            while (piece > 0 && LZ4F_compressBound(piece, &prefs_) > out_avail)
+            {
+                piece /= 2;
+            }
+            if (piece == 0)
+            {
+                break;
+            }
+            size_t n = LZ4F_compressUpdate(cctx_, out, out_avail, input_ + input_pos_,
+                                           piece, nullptr /* options */);
+            if (LZ4F_isError(n))
+            {
+                Reset();
+                return -1;
+            }
+            out += n;
+            out_avail -= n;
+            input_pos_ += piece;
+        }
+        *output_pos = static_cast<size_t>(out - output);
+        if (*output_pos == 0 && input_pos_ < input_size_)
+        {
+            // max_output_len cannot hold any progress.
+            Reset();
+            return -1;
+        }
+        return static_cast<int>(input_size_ - input_pos_);
+#else
+        (void)input;
+        (void)output;
+        return -1;
+#endif // XIAODB_LZ4_FRAME
+    }
+
+    void LZ4StreamingCompress::Reset()
+    {
+#ifdef XIAODB_LZ4_FRAME
+        // The next Compress() begins a new frame, which resets the context.
+        frame_started_ = false;
+        input_ = nullptr;
+        input_size_ = 0;
+        input_pos_ = 0;
+#endif // XIAODB_LZ4_FRAME
+    }
+
+    LZ4StreamingUncompress::LZ4StreamingUncompress(uint32_t compress_format_version,
+                                                   size_t max_output_len)
+        : StreamingUncompress(kLZ4Compression, compress_format_version,
+                              max_output_len)
+    {
+#ifdef XIAODB_LZ4_FRAME
+        LZ4F_errorCode_t err = LZ4F_createDecompressionContext(&dctx_, LZ4F_VERSION);
+        assert(!LZ4F_isError(err));
+        (void)err;
+#endif // XIAODB_LZ4_FRAME
+    }
+
+    LZ4StreamingUncompress::~LZ4StreamingUncompress()
+    {
+#ifdef XIAODB_LZ4_FRAME
+        LZ4F_freeDecompressionContext(dctx_);
+#endif // XIAODB_LZ4_FRAME
+    }
+
+    int LZ4StreamingUncompress::Uncompress(const char *input, size_t input_size,
+                                           char *output, size_t *output_pos)
+    {
+        assert(output != nullptr && output_pos != nullptr);
+        *output_pos = 0;
+        // Don't need to uncompress an empty input
+        if (input_size == 0)
+        {
+            return 0;
+        }
+#ifdef XIAODB_LZ4_FRAME
+        if (input)
+        {
+            // New input
+            input_ = input;
+            input_size_ = input_size;
+            input_pos_ = 0;
+        }
+        size_t dst_size = max_output_len_;
+        size_t src_size = input_size_ - input_pos_;
+        size_t ret = LZ4F_decompress(dctx_, output, &dst_size, input_ + input_pos_,
+                                     &src_size, nullptr /* options */);
+        if (LZ4F_isError(ret))
+        {
+            Reset();
+            return -1;
+        }
+        input_pos_ += src_size;
+        *output_pos = dst_size;
+        return static_cast<int>(input_size_ - input_pos_);
+#else
+        (void)input;
+        (void)output;
+        return -1;
+#endif // XIAODB_LZ4_FRAME
+    }
+
+    void LZ4StreamingUncompress::Reset()
+    {
+#ifdef XIAODB_LZ4_FRAME
+        LZ4F_resetDecompressionContext(dctx_);
+        input_ = nullptr;
+        input_size_ = 0;
+        input_pos_ = 0;
+#endif // XIAODB_LZ4_FRAME
+    }
+}
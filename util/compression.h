@@ -35,6 +35,12 @@
 #if defined(LZ4)
 #include <lz4.h>
 #include <lz4hc.h>
+// Streaming compression uses the LZ4 frame format, whose API is stable, and
+// its decompression contexts resettable, since v1.8.0.
+#if LZ4_VERSION_NUMBER >= 10800
+#define XIAODB_LZ4_FRAME
+#include <lz4frame.h>
+#endif // LZ4_VERSION_NUMBER >= 10800
 #endif
 
 #ifdef ZSTD
@@ -46,12 +52,12 @@
 #if ZSTD_VERSION_NUMBER < 10400
 #error "ZSTD support requires version >= 1.4.0 (libzstd-devel)"
 #endif // ZSTD_VERSION_NUMBER
-// The above release also includes digested dictionary support, but some
-// required functions (ZSTD_createDDict_byReference) are still only exported
-// with ZSTD_STATIC_LINKING_ONLY defined.
-#if defined(ZSTD_STATIC_LINKING_ONLY)
+// The above release also includes digested dictionary support. The digested
+// decompression dictionaries are shared through CompressionContextCache and
+// so copy the dictionary (ZSTD_createDDict() rather than
+// ZSTD_createDDict_byReference(), which is only exported with
+// ZSTD_STATIC_LINKING_ONLY defined).
 #define ROCKSDB_ZSTD_DDICT
-#endif // defined(ZSTD_STATIC_LINKING_ONLY)
 //  For ZDICT_* functions
 #include <zdict.h>
 // ZDICT_finalizeDictionary API is exported and stable since v1.4.5
@@ -137,21 +143,83 @@ namespace XIAODB_NAMESPACE
         ZSTDNativeContext zstd_ctx_ = nullptr;
         int64_t cache_idx_ = -1; // -1 means this instance owns the context
     };
-} // namespace ROCKSDB_NAMESPACE
+
+    // Same as ZSTDUncompressCachedData, for compression contexts
+    class ZSTDCompressCachedData
+    {
+    public:
+#if defined(ZSTD)
+        using ZSTDNativeContext = ZSTD_CCtx *;
+#else
+        using ZSTDNativeContext = void *;
+#endif // ZSTD
+        ZSTDCompressCachedData() {}
+        ZSTDCompressCachedData(const ZSTDCompressCachedData &o) = delete;
+        ZSTDCompressCachedData &operator=(const ZSTDCompressCachedData &) = delete;
+        ZSTDCompressCachedData(ZSTDCompressCachedData &&o) noexcept
+            : ZSTDCompressCachedData()
+        {
+            *this = std::move(o);
+        }
+        ZSTDCompressCachedData &operator=(ZSTDCompressCachedData &&o) noexcept
+        {
+            assert(zstd_ctx_ == nullptr);
+            std::swap(zstd_ctx_, o.zstd_ctx_);
+            std::swap(cache_idx_, o.cache_idx_);
+            return *this;
+        }
+        ZSTDNativeContext Get() const { return zstd_ctx_; }
+        int64_t GetCacheIndex() const { return cache_idx_; }
+        void CreateIfNeeded()
+        {
+            if (zstd_ctx_ == nullptr)
+            {
+#if !defined(ZSTD)
+                zstd_ctx_ = nullptr;
+#elif defined(ROCKSDB_ZSTD_CUSTOM_MEM)
+                zstd_ctx_ =
+                    ZSTD_createCCtx_advanced(port::GetJeZstdAllocationOverrides());
+#else // ZSTD && !ROCKSDB_ZSTD_CUSTOM_MEM
+                zstd_ctx_ = ZSTD_createCCtx();
+#endif
+                cache_idx_ = -1;
+            }
+        }
+        void InitFromCache(const ZSTDCompressCachedData &o, int64_t idx)
+        {
+            zstd_ctx_ = o.zstd_ctx_;
+            cache_idx_ = idx;
+        }
+        ~ZSTDCompressCachedData()
+        {
+#if defined(ZSTD)
+            if (zstd_ctx_ != nullptr && cache_idx_ == -1)
+            {
+                ZSTD_freeCCtx(zstd_ctx_);
+            }
+#endif // ZSTD
+        }
+
+    private:
+        ZSTDNativeContext zstd_ctx_ = nullptr;
+        int64_t cache_idx_ = -1; // -1 means this instance owns the context
+    };
+}
 
 #if defined(XPRESS)
 #include "port/xpress.h"
 #endif
 
-namespace ROCKSDB_NAMESPACE
+namespace XIAODB_NAMESPACE
 {
 
     // Holds dictionary and related data, like ZSTD's digested compression
-    // dictionary.
+    // dictionary, which is shared with the other users of the same
+    // dictionary (see CompressionContextCache).
     struct CompressionDict
     {
 #ifdef ZSTD
-        ZSTD_CDict *zstd_cdict_ = nullptr;
+        std::shared_ptr<const ZSTD_CDict> zstd_cdict_;
 #endif // ZSTD
         std::string dict_;
 
@@ -160,7 +228,6 @@ namespace ROCKSDB_NAMESPACE
         {
             dict_ = std::move(dict);
 #ifdef ZSTD
-            zstd_cdict_ = nullptr;
             if (!dict_.empty() && type == kZSTD)
             {
                 if (level == CompressionOptions::kDefaultCompressionLevel)
@@ -170,7 +237,8 @@ namespace ROCKSDB_NAMESPACE
                 }
                 // Should be safe (but slower) if below call fails as we'll use the
                 // raw dictionary to compress.
-                zstd_cdict_ = ZSTD_createCDict(dict_.data(), dict_.size(), level);
+                zstd_cdict_ = CompressionContextCache::Instance()->GetDigestedZSTDCDict(
+                    dict_, level);
                 assert(zstd_cdict_ != nullptr);
             }
 #else
@@ -179,21 +247,8 @@ namespace ROCKSDB_NAMESPACE
 #endif // ZSTD
         }
 
-        ~CompressionDict()
-        {
-#ifdef ZSTD
-            size_t res = 0;
-            if (zstd_cdict_ != nullptr)
-            {
-                res = ZSTD_freeCDict(zstd_cdict_);
-            }
-            assert(res == 0); // Last I checked they can't fail
-            (void)res;        // prevent unused var warning
-#endif                        // ZSTD
-        }
-
 #ifdef ZSTD
-        const ZSTD_CDict *GetDigestedZstdCDict() const { return zstd_cdict_; }
+        const ZSTD_CDict *GetDigestedZstdCDict() const { return zstd_cdict_.get(); }
 #endif // ZSTD
 
         Slice GetRawDict() const { return dict_; }
@@ -231,8 +286,10 @@ namespace ROCKSDB_NAMESPACE
         Slice slice_;
 
 #ifdef ROCKSDB_ZSTD_DDICT
-        // Processed version of the contents of slice_ for ZSTD compression.
-        ZSTD_DDict *zstd_ddict_ = nullptr;
+        // Processed version of the contents of slice_ for ZSTD compression,
+        // shared with the other users of the same dictionary (see
+        // CompressionContextCache).
+        std::shared_ptr<const ZSTD_DDict> zstd_ddict_;
 #endif // ROCKSDB_ZSTD_DDICT
 
         UncompressionDict(std::string dict, bool using_zstd)
@@ -241,7 +298,8 @@ namespace ROCKSDB_NAMESPACE
 #ifdef ROCKSDB_ZSTD_DDICT
             if (!slice_.empty() && using_zstd)
             {
-                zstd_ddict_ = ZSTD_createDDict_byReference(slice_.data(), slice_.size());
+                zstd_ddict_ =
+                    CompressionContextCache::Instance()->GetDigestedZSTDDDict(slice_);
                 assert(zstd_ddict_ != nullptr);
             }
 #else
@@ -256,7 +314,8 @@ namespace ROCKSDB_NAMESPACE
 #ifdef ROCKSDB_ZSTD_DDICT
             if (!slice_.empty() && using_zstd)
             {
-                zstd_ddict_ = ZSTD_createDDict_byReference(slice_.data(), slice_.size());
+                zstd_ddict_ =
+                    CompressionContextCache::Instance()->GetDigestedZSTDDDict(slice_);
                 assert(zstd_ddict_ != nullptr);
             }
 #else
@@ -270,25 +329,9 @@ namespace ROCKSDB_NAMESPACE
               slice_(std::move(rhs.slice_))
 #ifdef ROCKSDB_ZSTD_DDICT
               ,
-              zstd_ddict_(rhs.zstd_ddict_)
+              zstd_ddict_(std::move(rhs.zstd_ddict_))
 #endif
         {
-#ifdef ROCKSDB_ZSTD_DDICT
-            rhs.zstd_ddict_ = nullptr;
-#endif
-        }
-
-        ~UncompressionDict()
-        {
-#ifdef ROCKSDB_ZSTD_DDICT
-            size_t res = 0;
-            if (zstd_ddict_ != nullptr)
-            {
-                res = ZSTD_freeDDict(zstd_ddict_);
-            }
-            assert(res == 0); // Last I checked they can't fail
-            (void)res;        // prevent unused var warning
-#endif                        // ROCKSDB_ZSTD_DDICT
         }
 
         UncompressionDict &operator=(UncompressionDict &&rhs)
@@ -303,8 +346,7 @@ namespace ROCKSDB_NAMESPACE
             slice_ = std::move(rhs.slice_);
 
 #ifdef ROCKSDB_ZSTD_DDICT
-            zstd_ddict_ = rhs.zstd_ddict_;
-            rhs.zstd_ddict_ = nullptr;
+            zstd_ddict_ = std::move(rhs.zstd_ddict_);
 #endif
 
             return *this;
@@ -324,7 +366,7 @@ namespace ROCKSDB_NAMESPACE
         static constexpr BlockType kBlockType = BlockType::kCompressionDictionary;
 
 #ifdef ROCKSDB_ZSTD_DDICT
-        const ZSTD_DDict *GetDigestedZstdDDict() const { return zstd_ddict_; }
+        const ZSTD_DDict *GetDigestedZstdDDict() const { return zstd_ddict_.get(); }
 #endif // ROCKSDB_ZSTD_DDICT
 
         static const UncompressionDict &GetEmptyDict()
@@ -350,7 +392,8 @@ namespace ROCKSDB_NAMESPACE
                 }
             }
 #ifdef ROCKSDB_ZSTD_DDICT
-            usage += ZSTD_sizeof_DDict(zstd_ddict_);
+            // Counted in full by each user, although shared.
+            usage += ZSTD_sizeof_DDict(zstd_ddict_.get());
 #endif // ROCKSDB_ZSTD_DDICT
             return usage;
         }
@@ -364,24 +407,19 @@ namespace ROCKSDB_NAMESPACE
     class CompressionContext
     {
     private:
-#ifdef ZSTD
-        ZSTD_CCtx *zstd_ctx_ = nullptr;
-
-        ZSTD_CCtx *CreateZSTDContext()
-        {
-#ifdef ROCKSDB_ZSTD_CUSTOM_MEM
-            return ZSTD_createCCtx_advanced(port::GetJeZstdAllocationOverrides());
-#else  // ROCKSDB_ZSTD_CUSTOM_MEM
-            return ZSTD_createCCtx();
-#endif // ROCKSDB_ZSTD_CUSTOM_MEM
-        }
+        // The ZSTD context comes from (and goes back to) the per-core cache of
+        // CompressionContextCache, so that a context per table file, or per
+        // worker, does not mean a ZSTD_CCtx setup each.
+        CompressionContextCache *ctx_cache_ = nullptr;
+        ZSTDCompressCachedData comp_cached_data_;
 
+#ifdef ZSTD
     public:
         // callable inside ZSTD_Compress
         ZSTD_CCtx *ZSTDPreallocCtx() const
         {
-            assert(zstd_ctx_ != nullptr);
-            return zstd_ctx_;
+            assert(comp_cached_data_.Get() != nullptr);
+            return comp_cached_data_.Get();
         }
 
     private:
@@ -392,28 +430,30 @@ namespace ROCKSDB_NAMESPACE
 #ifdef ZSTD
             if (type == kZSTD)
             {
-                zstd_ctx_ = CreateZSTDContext();
+                ctx_cache_ = CompressionContextCache::Instance();
+                comp_cached_data_ = ctx_cache_->GetCachedZSTDCompressData();
+                ZSTD_CCtx *zstd_ctx = comp_cached_data_.Get();
+                // Drop the parameters and dictionary of the previous user.
+                ZSTD_CCtx_reset(zstd_ctx, ZSTD_reset_session_and_parameters);
                 if (level == CompressionOptions::kDefaultCompressionLevel)
                 {
                     // NB: ZSTD_CLEVEL_DEFAULT is historically == 3
                     level = ZSTD_CLEVEL_DEFAULT;
                 }
                 size_t err =
-                    ZSTD_CCtx_setParameter(zstd_ctx_, ZSTD_c_compressionLevel, level);
+                    ZSTD_CCtx_setParameter(zstd_ctx, ZSTD_c_compressionLevel, level);
                 if (ZSTD_isError(err))
                 {
                     assert(false);
-                    ZSTD_freeCCtx(zstd_ctx_);
-                    zstd_ctx_ = CreateZSTDContext();
+                    ZSTD_CCtx_reset(zstd_ctx, ZSTD_reset_session_and_parameters);
                 }
                 if (checksum)
                 {
-                    err = ZSTD_CCtx_setParameter(zstd_ctx_, ZSTD_c_checksumFlag, 1);
+                    err = ZSTD_CCtx_setParameter(zstd_ctx, ZSTD_c_checksumFlag, 1);
                     if (ZSTD_isError(err))
                     {
                         assert(false);
-                        ZSTD_freeCCtx(zstd_ctx_);
-                        zstd_ctx_ = CreateZSTDContext();
+                        ZSTD_CCtx_reset(zstd_ctx, ZSTD_reset_session_and_parameters);
                     }
                 }
             }
@@ -425,12 +465,12 @@ namespace ROCKSDB_NAMESPACE
         }
         void DestroyNativeContext()
         {
-#ifdef ZSTD
-            if (zstd_ctx_ != nullptr)
+            if (comp_cached_data_.GetCacheIndex() != -1)
             {
-                ZSTD_freeCCtx(zstd_ctx_);
+                assert(ctx_cache_ != nullptr);
+                ctx_cache_->ReturnCachedZSTDCompressData(
+                    comp_cached_data_.GetCacheIndex());
             }
-#endif // ZSTD
         }
 
     public:
@@ -584,6 +624,15 @@ namespace ROCKSDB_NAMESPACE
 #endif
     }
 
+    inline bool LZ4_Streaming_Supported()
+    {
+#ifdef XIAODB_LZ4_FRAME
+        return true;
+#else
+        return false;
+#endif
+    }
+
     inline bool StreamingCompressionTypeSupported(
         CompressionType compression_type)
     {
@@ -593,6 +642,8 @@ namespace ROCKSDB_NAMESPACE
             return true;
         case kZSTD:
             return ZSTD_Streaming_Supported();
+        case kLZ4Compression:
+            return LZ4_Streaming_Supported();
         default:
             return false;
         }
@@ -1644,6 +1695,19 @@ namespace ROCKSDB_NAMESPACE
 #endif // ZSTD
     }
 
+    // The ID of a dictionary in the ZSTD format (see ZDICT_getDictID()), or 0
+    // for a raw content dictionary, including the dictionaries of the other
+    // algorithms.
+    inline uint32_t ZSTD_GetDictID(const Slice &dict)
+    {
+#ifdef ZSTD
+        return ZDICT_getDictID(dict.data(), dict.size());
+#else
+        (void)dict;
+        return 0;
+#endif // ZSTD
+    }
+
     inline bool ZSTD_FinalizeDictionarySupported()
     {
 #ifdef ROCKSDB_ZDICT_FINALIZE
@@ -1826,6 +1890,12 @@ namespace ROCKSDB_NAMESPACE
     // compression type and use Compress() repeatedly.
     // The output buffer needs to be at least max_output_len.
     // Call Reset() in between frame boundaries or in case of an error.
+    //
+    // The buffers are compressed as one stream: each buffer can refer to the
+    // ones before it in the same frame, which pays off for small similar
+    // buffers such as WAL records. The output of a buffer is complete (i.e.
+    // flushed) once Compress() returns 0, but uncompressing it needs the
+    // output of all the buffers before it since the last Reset().
     // NOTE: This class is not thread safe.
     class StreamingCompress
     {
@@ -1916,9 +1986,12 @@ namespace ROCKSDB_NAMESPACE
         {
 #ifdef ZSTD
             cctx_ = ZSTD_createCCtx();
-            // Each compressed frame will have a checksum
-            ZSTD_CCtx_setParameter(cctx_, ZSTD_c_checksumFlag, 1);
             assert(cctx_ != nullptr);
+            ZSTD_CCtx_setParameter(
+                cctx_, ZSTD_c_compressionLevel,
+                opts.level == CompressionOptions::kDefaultCompressionLevel
+                    ? ZSTD_CLEVEL_DEFAULT
+                    : opts.level);
             input_buffer_ = {/*src=*/nullptr, /*size=*/0, /*pos=*/0};
 #endif
         }
@@ -1934,6 +2007,8 @@ namespace ROCKSDB_NAMESPACE
 #ifdef ZSTD
         ZSTD_CCtx *cctx_;
         ZSTD_inBuffer input_buffer_;
+        // The output of the input is not all flushed yet.
+        bool flush_pending_ = false;
 #endif
     };
 
@@ -1967,4 +2042,48 @@ namespace ROCKSDB_NAMESPACE
 #endif
     };
 
-} // namespace ROCKSDB_NAMESPACE
\ No newline at end of file
+    // LZ4 frame format, with linked blocks so that buffers refer to the ones
+    // before them, and auto flush so that the output of a buffer is complete
+    // when Compress() returns.
+    class LZ4StreamingCompress final : public StreamingCompress
+    {
+    public:
+        explicit LZ4StreamingCompress(const CompressionOptions &opts,
+                                      uint32_t compress_format_version,
+                                      size_t max_output_len);
+        ~LZ4StreamingCompress() override;
+        int Compress(const char *input, size_t input_size, char *output,
+                     size_t *output_pos) override;
+        void Reset() override;
+
+    private:
+#ifdef XIAODB_LZ4_FRAME
+        LZ4F_cctx *cctx_ = nullptr;
+        LZ4F_preferences_t prefs_;
+        bool frame_started_ = false;
+        const char *input_ = nullptr;
+        size_t input_size_ = 0;
+        size_t input_pos_ = 0;
+#endif // XIAODB_LZ4_FRAME
+    };
+
+    class LZ4StreamingUncompress final : public StreamingUncompress
+    {
+    public:
+        explicit LZ4StreamingUncompress(uint32_t compress_format_version,
+                                        size_t max_output_len);
+        ~LZ4StreamingUncompress() override;
+        int Uncompress(const char *input, size_t input_size, char *output,
+                       size_t *output_size) override;
+        void Reset() override;
+
+    private:
+#ifdef XIAODB_LZ4_FRAME
+        LZ4F_dctx *dctx_ = nullptr;
+        const char *input_ = nullptr;
+        size_t input_size_ = 0;
+        size_t input_pos_ = 0;
+#endif // XIAODB_LZ4_FRAME
+    };
+
+}
@@ -1,6 +1,10 @@
 #include "util/compression_context_cache.h"
 
 #include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
 
 #include "util/compression.h"
 #include "util/core_local.h"
@@ -11,36 +15,35 @@ namespace XIAODB_NAMESPACE
     {
 
         void *const SentinelValue = nullptr;
-        // Cache ZSTD uncompression contexts for reads
-        // if needed we can add ZSTD compression context caching
-        // which is currently is not done since BlockBasedTableBuilder
-        // simply creates one compression context per new SST file.
+        // Cache ZSTD contexts, one per core for reads (ZSTDUncompressCachedData)
+        // and one per core for table building (ZSTDCompressCachedData), so
+        // that small blocks do not pay for the setup of a context each.
+        template <typename CachedData>
         struct ZSTDCachedData
         {
             // We choose to cache the below structure instead of a ptr
             // because we want to avoid a) native types leak b) make
             // cache use transparent for the user
-            ZSTDUncompressCachedData uncomp_cached_data_;
-            std::atomic<void *> zstd_uncomp_sentinel_;
+            CachedData cached_data_;
+            std::atomic<void *> zstd_sentinel_;
 
             char
                 padding[(CACHE_LINE_SIZE -
-                         (sizeof(ZSTDUncompressCachedData) + sizeof(std::atomic<void *>)) %
+                         (sizeof(CachedData) + sizeof(std::atomic<void *>)) %
                              CACHE_LINE_SIZE)]; // unused padding field
 
-            ZSTDCachedData() : zstd_uncomp_sentinel_(&uncomp_cached_data_) {}
+            ZSTDCachedData() : zstd_sentinel_(&cached_data_) {}
             ZSTDCachedData(const ZSTDCachedData &) = delete;
             ZSTDCachedData &operator=(const ZSTDCachedData &) = delete;
 
-            ZSTDUncompressCachedData GetUncompressData(int64_t idx)
+            CachedData Get(int64_t idx)
             {
-                ZSTDUncompressCachedData result;
-                void *expected = &uncomp_cached_data_;
-                if (zstd_uncomp_sentinel_.compare_exchange_strong(expected,
-                                                                  SentinelValue))
+                CachedData result;
+                void *expected = &cached_data_;
+                if (zstd_sentinel_.compare_exchange_strong(expected, SentinelValue))
                 {
-                    uncomp_cached_data_.CreateIfNeeded();
-                    result.InitFromCache(uncomp_cached_data_, idx);
+                    cached_data_.CreateIfNeeded();
+                    result.InitFromCache(cached_data_, idx);
                 }
                 else
                 {
@@ -52,17 +55,95 @@ namespace XIAODB_NAMESPACE
             // Return the entry back into circulation
             // This is executed only when we successfully obtained
             // in the first place
-            void ReturnUncompressData()
+            void Return()
             {
-                if (zstd_uncomp_sentinel_.exchange(&uncomp_cached_data_) != SentinelValue)
+                if (zstd_sentinel_.exchange(&cached_data_) != SentinelValue)
                 {
                     // Means we are returning while not having it acquired.
                     assert(false);
                 }
             }
         };
-        static_assert(sizeof(ZSTDCachedData) % CACHE_LINE_SIZE == 0,
+        static_assert(sizeof(ZSTDCachedData<ZSTDUncompressCachedData>) %
+                              CACHE_LINE_SIZE ==
+                          0,
                       "Expected CACHE_LINE_SIZE alignment");
+        static_assert(sizeof(ZSTDCachedData<ZSTDCompressCachedData>) %
+                              CACHE_LINE_SIZE ==
+                          0,
+                      "Expected CACHE_LINE_SIZE alignment");
+
+        // The digested dictionaries in use, of one kind (ZSTD_CDict or
+        // ZSTD_DDict). Entries only hold weak references, and the expired
+        // ones are dropped whenever a dictionary is digested.
+        template <typename Digested>
+        class DigestedDictRegistry
+        {
+        public:
+            // create(dict) digests dict, or returns nullptr.
+            template <typename CreateFunc>
+            std::shared_ptr<const Digested> GetOrCreate(const Slice &dict, int level,
+                                                        CreateFunc create)
+            {
+                const Key key(ZSTD_GetDictID(dict), level);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    std::shared_ptr<Digested> digested = Find(key, dict);
+                    if (digested != nullptr)
+                    {
+                        return digested;
+                    }
+                }
+
+                // Digesting takes a while, so it is done unlocked, at the
+                // risk of a redundant digest in a race.
+                std::shared_ptr<Digested> created = create(dict);
+                if (created == nullptr)
+                {
+                    return nullptr;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::shared_ptr<Digested> digested = Find(key, dict);
+                if (digested != nullptr)
+                {
+                    return digested;
+                }
+                for (auto it = entries_.begin(); it != entries_.end();)
+                {
+                    it = it->second.digested.expired() ? entries_.erase(it) : std::next(it);
+                }
+                entries_.emplace(key, Entry{dict.ToString(), created});
+                return created;
+            }
+
+        private:
+            // Dictionary ID and compression level.
+            using Key = std::pair<uint32_t, int>;
+
+            struct Entry
+            {
+                std::string dict;
+                std::weak_ptr<Digested> digested;
+            };
+
+            // REQUIRES: mutex_ held
+            std::shared_ptr<Digested> Find(const Key &key, const Slice &dict)
+            {
+                auto range = entries_.equal_range(key);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    if (Slice(it->second.dict) == dict)
+                    {
+                        return it->second.digested.lock();
+                    }
+                }
+                return nullptr;
+            }
+
+            std::mutex mutex_;
+            std::multimap<Key, Entry> entries_;
+        };
     }
 
     class CompressionContextCache::Rep
@@ -73,17 +154,35 @@ namespace XIAODB_NAMESPACE
         {
             auto p = per_core_uncompr_.AccessElementAndIndex();
             int64_t idx = static_cast<int64_t>(p.second);
-            return p.first->GetUncompressData(idx);
+            return p.first->Get(idx);
         }
         void ReturnZSTDUncompressData(int64_t idx)
         {
             assert(idx >= 0);
             auto *cn = per_core_uncompr_.AccessAtCore(static_cast<size_t>(idx));
-            cn->ReturnUncompressData();
+            cn->Return();
         }
+        ZSTDCompressCachedData GetZSTDCompressData()
+        {
+            auto p = per_core_compr_.AccessElementAndIndex();
+            int64_t idx = static_cast<int64_t>(p.second);
+            return p.first->Get(idx);
+        }
+        void ReturnZSTDCompressData(int64_t idx)
+        {
+            assert(idx >= 0);
+            auto *cn = per_core_compr_.AccessAtCore(static_cast<size_t>(idx));
+            cn->Return();
+        }
+
+        compression_cache::DigestedDictRegistry<ZSTD_CDict_s> cdicts_;
+        compression_cache::DigestedDictRegistry<ZSTD_DDict_s> ddicts_;
 
     private:
-        CoreLocalArray<compression_cache::ZSTDCachedData> per_core_uncomper_;
+        CoreLocalArray<compression_cache::ZSTDCachedData<ZSTDUncompressCachedData>>
+            per_core_uncompr_;
+        CoreLocalArray<compression_cache::ZSTDCachedData<ZSTDCompressCachedData>>
+            per_core_compr_;
     };
 
     CompressionContextCache::CompressionContextCache() : rep_(new Rep()) {}
@@ -107,5 +206,58 @@ namespace XIAODB_NAMESPACE
         rep_->ReturnZSTDUncompressData(idx);
     }
 
+    ZSTDCompressCachedData CompressionContextCache::GetCachedZSTDCompressData()
+    {
+        return rep_->GetZSTDCompressData();
+    }
+
+    void CompressionContextCache::ReturnCachedZSTDCompressData(int64_t idx)
+    {
+        rep_->ReturnZSTDCompressData(idx);
+    }
+
+    std::shared_ptr<const ZSTD_CDict_s>
+    CompressionContextCache::GetDigestedZSTDCDict(const Slice &dict, int level)
+    {
+        return rep_->cdicts_.GetOrCreate(
+            dict, level, [level](const Slice &d) -> std::shared_ptr<ZSTD_CDict_s>
+            {
+#ifdef ZSTD
+                ZSTD_CDict *cdict = ZSTD_createCDict(d.data(), d.size(), level);
+                if (cdict == nullptr)
+                {
+                    return nullptr;
+                }
+                return std::shared_ptr<ZSTD_CDict_s>(cdict, ZSTD_freeCDict);
+#else
+                (void)d;
+                (void)level;
+                return nullptr;
+#endif // ZSTD
+            });
+    }
+
+    std::shared_ptr<const ZSTD_DDict_s>
+    CompressionContextCache::GetDigestedZSTDDDict(const Slice &dict)
+    {
+        return rep_->ddicts_.GetOrCreate(
+            dict, 0 /* level */, [](const Slice &d) -> std::shared_ptr<ZSTD_DDict_s>
+            {
+#ifdef ZSTD
+                // Copies the dictionary, as the digest outlives the block
+                // it was read from when shared.
+                ZSTD_DDict *ddict = ZSTD_createDDict(d.data(), d.size());
+                if (ddict == nullptr)
+                {
+                    return nullptr;
+                }
+                return std::shared_ptr<ZSTD_DDict_s>(ddict, ZSTD_freeDDict);
+#else
+                (void)d;
+                return nullptr;
+#endif // ZSTD
+            });
+    }
+
     CompressionContextCache::~CompressionContextCache() { delete rep_; }
-}
\ No newline at end of file
+}
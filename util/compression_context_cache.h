@@ -2,11 +2,19 @@
 
 #include <stdint.h>
 
+#include <memory>
+
+#include "xiaodb/slice.h"
 #include "xiaodb/xiaodb_namespace.h"
 
+// Digested ZSTD dictionaries (ZSTD_CDict and ZSTD_DDict in zstd.h)
+struct ZSTD_CDict_s;
+struct ZSTD_DDict_s;
+
 namespace XIAODB_NAMESPACE
 {
-    class ZSTDUncompressCacheData;
+    class ZSTDUncompressCachedData;
+    class ZSTDCompressCachedData;
 
     class CompressionContextCache
     {
@@ -17,9 +25,24 @@ namespace XIAODB_NAMESPACE
         CompressionContextCache(const CompressionContextCache &) = delete;
         CompressionContextCache &operator=(const CompressionContextCache &) = delete;
 
-        ZSTDUncompressCacheData GetCachedZSTDUncompressData();
+        ZSTDUncompressCachedData GetCachedZSTDUncompressData();
         void ReturnCachedZSTDUncompressData(int64_t idx);
 
+        // The compression contexts are cached per core as well. A context
+        // comes back with the parameters its last user set, so it must be
+        // reset before use.
+        ZSTDCompressCachedData GetCachedZSTDCompressData();
+        void ReturnCachedZSTDCompressData(int64_t idx);
+
+        // Digested dictionaries are shared by all the users of the same
+        // dictionary, e.g. the table files compressed with it, and looked up
+        // by dictionary ID (0 for raw content dictionaries) and contents.
+        // They are freed with their last user. Return nullptr if the
+        // dictionary cannot be digested, or without ZSTD support.
+        std::shared_ptr<const ZSTD_CDict_s> GetDigestedZSTDCDict(const Slice &dict,
+                                                                 int level);
+        std::shared_ptr<const ZSTD_DDict_s> GetDigestedZSTDDDict(const Slice &dict);
+
     private:
         // Singleton
         CompressionContextCache();
@@ -28,4 +51,4 @@ namespace XIAODB_NAMESPACE
         class Rep;
         Rep *rep_;
     };
-}
\ No newline at end of file
+}
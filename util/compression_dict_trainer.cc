@@ -0,0 +1,164 @@
+#include "util/compression_dict_trainer.h"
+
+#include <algorithm>
+
+namespace XIAODB_NAMESPACE
+{
+    void CompressionDictSampler::AddBlock(const Slice &block)
+    {
+        if (max_sample_bytes_ == 0 || num_blocks_++ % stride_ != 0)
+        {
+            return;
+        }
+        const size_t len = std::min(block.size(), max_sample_bytes_);
+        if (len == 0)
+        {
+            return;
+        }
+        samples_.append(block.data(), len);
+        sample_lens_.push_back(len);
+        while (samples_.size() > max_sample_bytes_)
+        {
+            Decimate();
+        }
+    }
+
+    void CompressionDictSampler::Decimate()
+    {
+        // The samples kept are those of the blocks at multiples of the new
+        // stride, as the ones to come.
+        size_t from = 0;
+        size_t to = 0;
+        size_t kept = 0;
+        for (size_t i = 0; i < sample_lens_.size(); ++i)
+        {
+            const size_t len = sample_lens_[i];
+            if (i % 2 == 0)
+            {
+                samples_.replace(to, len, samples_, from, len);
+                to += len;
+                sample_lens_[kept++] = len;
+            }
+            from += len;
+        }
+        samples_.resize(to);
+        sample_lens_.resize(kept);
+        stride_ *= 2;
+    }
+
+    CompressionDictTrainer::CompressionDictTrainer(
+        CompressionType compression_type, const CompressionOptions &compression_opts)
+        : compression_type_(compression_type),
+          compression_opts_(compression_opts),
+          enabled_(compression_opts.max_dict_bytes > 0 &&
+                   DictCompressionTypeSupported(compression_type)),
+          max_sample_bytes_(
+              !enabled_ ? 0
+              : compression_opts.zstd_max_train_bytes > 0
+                  ? compression_opts.zstd_max_train_bytes
+                  : compression_opts.max_dict_bytes)
+    {
+        if (enabled_)
+        {
+            thread_ = port::Thread([this]
+                                   { BackgroundTrain(); });
+        }
+    }
+
+    CompressionDictTrainer::~CompressionDictTrainer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutting_down_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+    }
+
+    void CompressionDictTrainer::Submit(CompressionDictSampler &&sampler)
+    {
+        if (!enabled_ || sampler.empty())
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.reset(new CompressionDictSampler(std::move(sampler)));
+        }
+        cv_.notify_all();
+    }
+
+    std::shared_ptr<const CompressionDictVersion> CompressionDictTrainer::Current() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_;
+    }
+
+    void CompressionDictTrainer::WaitForPending()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]
+                 { return shutting_down_ || (pending_ == nullptr && !training_); });
+    }
+
+    std::string CompressionDictTrainer::Train(
+        const CompressionDictSampler &samples) const
+    {
+        const size_t max_dict_bytes = compression_opts_.max_dict_bytes;
+        if (compression_type_ == kZSTD && compression_opts_.zstd_max_train_bytes > 0)
+        {
+            if (compression_opts_.use_zstd_dict_trainer)
+            {
+                if (ZSTD_TrainDictionarySupported())
+                {
+                    return ZSTD_TrainDictionary(samples.samples(), samples.sample_lens(),
+                                                max_dict_bytes);
+                }
+            }
+            else if (ZSTD_FinalizeDictionarySupported())
+            {
+                return ZSTD_FinalizeDictionary(samples.samples(), samples.sample_lens(),
+                                               max_dict_bytes, compression_opts_.level);
+            }
+        }
+        // A raw content dictionary.
+        return samples.samples().substr(0, max_dict_bytes);
+    }
+
+    void CompressionDictTrainer::BackgroundTrain()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this]
+                     { return shutting_down_ || pending_ != nullptr; });
+            if (shutting_down_)
+            {
+                return;
+            }
+            std::unique_ptr<CompressionDictSampler> samples = std::move(pending_);
+            training_ = true;
+            lock.unlock();
+
+            std::string dict = Train(*samples);
+            samples.reset();
+
+            lock.lock();
+            training_ = false;
+            // Training fails on too few samples; the current dictionary
+            // stays then.
+            if (!dict.empty())
+            {
+                ++num_trained_;
+                const uint32_t dict_id = ZSTD_GetDictID(dict);
+                current_ = std::make_shared<const CompressionDictVersion>(
+                    dict_id != 0 ? dict_id : num_trained_, std::move(dict),
+                    compression_type_, compression_opts_.level);
+            }
+            cv_.notify_all();
+        }
+    }
+}
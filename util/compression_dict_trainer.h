@@ -0,0 +1,127 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "port/port.h"
+#include "util/compression.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // A compression dictionary trained by CompressionDictTrainer. Its version
+    // is the ZSTD dictionary ID, or else a sequence number, and is recorded
+    // in the properties of the tables compressed with it
+    // (TableProperties::compression_dict_version).
+    struct CompressionDictVersion
+    {
+        CompressionDictVersion(uint64_t _version, std::string &&dict,
+                               CompressionType type, int level)
+            : version(_version), dict(std::move(dict), type, level) {}
+
+        const uint64_t version;
+        // Digested for ZSTD, and shared with the other users of the same
+        // dictionary (see CompressionContextCache).
+        const CompressionDict dict;
+    };
+
+    // Samples the data blocks a table builder emits, uniformly over the
+    // whole file, within a budget: every stride-th block is kept, and the
+    // stride doubles (dropping every other sample kept so far) whenever the
+    // samples exceed the budget. Not thread-safe.
+    class CompressionDictSampler
+    {
+    public:
+        explicit CompressionDictSampler(size_t max_sample_bytes)
+            : max_sample_bytes_(max_sample_bytes) {}
+
+        // block is the uncompressed contents of a data block.
+        void AddBlock(const Slice &block);
+
+        bool empty() const { return sample_lens_.empty(); }
+        const std::string &samples() const { return samples_; }
+        const std::vector<size_t> &sample_lens() const { return sample_lens_; }
+
+    private:
+        // Drops every other sample and doubles the stride.
+        void Decimate();
+
+        const size_t max_sample_bytes_;
+        uint64_t stride_ = 1;
+        uint64_t num_blocks_ = 0;
+        std::string samples_;
+        std::vector<size_t> sample_lens_;
+    };
+
+    // Trains the compression dictionaries of a column family, in a background
+    // thread, out of the blocks sampled by its flushes and compactions:
+    //
+    //   CompressionDictSampler sampler = trainer.NewSampler();
+    //   ... compress the blocks of a table with trainer.Current(), if any,
+    //       and feed them to sampler ...
+    //   trainer.Submit(std::move(sampler));
+    //
+    // Each dictionary trained replaces the current one for the tables built
+    // afterwards; the tables built before keep theirs, which they store
+    // (see BlockBasedTable::kCompressionDictBlockName). Samples submitted
+    // while the thread is training replace those still pending, so that a
+    // burst of compactions trains once, on the latest data.
+    //
+    // Dictionaries of up to compression_opts.max_dict_bytes are trained with
+    // the ZSTD trainer (or finalized out of the samples without
+    // use_zstd_dict_trainer) out of up to zstd_max_train_bytes of samples.
+    // Without zstd_max_train_bytes, or for the algorithms other than ZSTD,
+    // the dictionary is the first max_dict_bytes of the samples.
+    class CompressionDictTrainer
+    {
+    public:
+        CompressionDictTrainer(CompressionType compression_type,
+                               const CompressionOptions &compression_opts);
+
+        CompressionDictTrainer(const CompressionDictTrainer &) = delete;
+        void operator=(const CompressionDictTrainer &) = delete;
+
+        // Stops the background thread, dropping the pending samples.
+        ~CompressionDictTrainer();
+
+        // False if the compression type or options do not call for a
+        // dictionary, in which case nothing is trained.
+        bool enabled() const { return enabled_; }
+
+        CompressionDictSampler NewSampler() const
+        {
+            return CompressionDictSampler(max_sample_bytes_);
+        }
+
+        void Submit(CompressionDictSampler &&sampler);
+
+        // The latest dictionary trained, or nullptr.
+        std::shared_ptr<const CompressionDictVersion> Current() const;
+
+        // Waits for the samples submitted so far to be trained on.
+        void WaitForPending();
+
+    private:
+        void BackgroundTrain();
+
+        // Returns the dictionary for samples, or empty.
+        std::string Train(const CompressionDictSampler &samples) const;
+
+        const CompressionType compression_type_;
+        const CompressionOptions compression_opts_;
+        const bool enabled_;
+        const size_t max_sample_bytes_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::unique_ptr<CompressionDictSampler> pending_;
+        bool training_ = false;
+        bool shutting_down_ = false;
+        std::shared_ptr<const CompressionDictVersion> current_;
+        uint64_t num_trained_ = 0;
+        port::Thread thread_;
+    };
+}
@@ -2,12 +2,12 @@
 #include "folly/coro/Coroutine.h"
 #include "folly/coro/Task.h"
 #endif
-#include "xiaodb/rocksdb_namespace.h"
+#include "xiaodb/xiaodb_namespace.h"
 
 // This file has two sctions. The first section applies to all instances of
 // header file inclusion and has an include guard. The second section is
 // meant for multiple inclusions in the same source file, and is idempotent.
-namespace ROCKSDB_NAMESPACE
+namespace XIAODB_NAMESPACE
 {
 
 #ifndef UTIL_CORO_UTILS_H_
@@ -104,4 +104,4 @@ namespace ROCKSDB_NAMESPACE
 #define CO_RETURN return
 
 #endif // DO_NOT_USE_COROUTINES
-} // namespace ROCKSDB_NAMESPACE
+} // namespace XIAODB_NAMESPACE
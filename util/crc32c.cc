@@ -1,12 +1,15 @@
 #include "util/crc32c.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <utility>
 
 #include "port/lang.h"
 #include "util/coding.h"
 #include "util/crc32c_arm64.h"
+#include "util/crc32c_avx512.h"
 #include "util/math.h"
 
 #ifdef __powerpc64__
@@ -400,6 +403,12 @@ namespace XIAODB_NAMESPACE::crc32c
 #ifdef __SSE4_2__
         has_fast_crc = true;
 #endif // __SSE4_2__
+#ifdef HAVE_AVX512_CRC32C
+        if (crc32c_avx512_runtime_check())
+        {
+            has_fast_crc = true;
+        }
+#endif // HAVE_AVX512_CRC32C
         arch = "x86";
 #endif
         if (has_fast_crc)
@@ -1131,7 +1140,13 @@ static inline Function Choose_Extend() {
     return ExtendImpl<DefaultCRC32>;
   }
 #elif defined(__SSE4_2__) && defined(__PCLMUL__) && !defined NO_THREEWAY_CRC32C
-  // NOTE: runtime detection no longer supported on x86
+  // NOTE: runtime detection no longer supported on x86, except for the
+  // AVX-512 kernel, which the baseline of the build does not cover
+#ifdef HAVE_AVX512_CRC32C
+  if (crc32c_avx512_runtime_check()) {
+    return crc32c_avx512;
+  }
+#endif
 #ifdef _MSC_VER
 #pragma warning(disable: 4551)
 #endif
@@ -1141,6 +1156,11 @@ static inline Function Choose_Extend() {
 #endif
   return crc32c_3way;
 #else
+#ifdef HAVE_AVX512_CRC32C
+  if (crc32c_avx512_runtime_check()) {
+    return crc32c_avx512;
+  }
+#endif
   return ExtendImpl<DefaultCRC32>;
 #endif
 }
@@ -1150,6 +1170,39 @@ uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
   return ChosenExtend(crc, buf, size);
 }
 
+using CopyFunction = uint32_t (*)(uint32_t, char*, const char*, size_t);
+
+// Copies in pieces small enough to stay in L1, each checksummed right after
+// its copy, so the data is only brought in from further away once.
+static uint32_t ExtendCopyChunked(uint32_t crc, char* dst, const char* src,
+                                  size_t size) {
+  static constexpr size_t kChunkSize = 4096;
+  while (size > 0) {
+    const size_t n = std::min(size, kChunkSize);
+    memcpy(dst, src, n);
+    crc = ChosenExtend(crc, dst, n);
+    dst += n;
+    src += n;
+    size -= n;
+  }
+  return crc;
+}
+
+static inline CopyFunction Choose_ExtendCopy() {
+#ifdef HAVE_AVX512_CRC32C
+  // The kernel copies through its own registers.
+  if (ChosenExtend == crc32c_avx512) {
+    return crc32c_avx512_copy;
+  }
+#endif
+  return ExtendCopyChunked;
+}
+
+static CopyFunction ChosenExtendCopy = Choose_ExtendCopy();
+uint32_t ExtendCopy(uint32_t crc, char* dst, const char* src, size_t size) {
+  return ChosenExtendCopy(crc, dst, src, size);
+}
+
 // The code for crc32c combine, copied with permission from folly
 
 // Standard galois-field multiply.  The only modification is that a,
@@ -19,6 +19,12 @@ namespace XIAODB_NAMESPACE
         // crc32c of a stream of data.
         uint32_t Extend(uint32_t init_crc, const char *data, size_t n);
 
+        // Same as Extend(init_crc, src, n), also copying src[0,n-1] to
+        // dst[0,n-1], for a buffer that needs both, e.g. a block copied out of
+        // a read buffer: the data is read once, rather than once for the copy
+        // and once again for the crc. The ranges must not overlap.
+        uint32_t ExtendCopy(uint32_t init_crc, char *dst, const char *src, size_t n);
+
         // Takes two unmasked crc32c values, and the length of the string from
         // which `crc2` was computed, and computes a crc32c value for the
         // concatenation of the original two input strings. Running time is
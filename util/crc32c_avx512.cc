@@ -0,0 +1,254 @@
+#include "util/crc32c_avx512.h"
+
+#ifdef HAVE_AVX512_CRC32C
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#include <cstring>
+
+// The functions using the kernel's instructions are compiled for them alone,
+// so that the rest of the build keeps its baseline.
+#define CRC32C_AVX512_TARGET \
+    __attribute__((target("avx512f,vpclmulqdq,pclmul,sse4.2")))
+
+namespace
+{
+    // Folding, in the bit-reflected domain of CRC32C (see the Intel white
+    // paper "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+    // Instruction"): the 128-bit lanes of the accumulators hold the data
+    // folded so far, and are carried D bits forward, onto the next data, by
+    // multiplying their two 64-bit halves with x^(D+63) and x^(D-1) mod P
+    // (the extra x^-1 makes up for the reflected carry-less product being
+    // one bit short). Once a single lane is left, the CRC32 instruction
+    // reduces it to 32 bits.
+
+    // x^n mod P, with P the CRC32C (Castagnoli) polynomial, bits in the
+    // normal order.
+    constexpr uint32_t XPowModP(uint32_t n)
+    {
+        uint32_t r = 1;
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            r = (r << 1) ^ ((r & 0x80000000u) ? 0x1edc6f41u : 0);
+        }
+        return r;
+    }
+
+    constexpr uint32_t Reflect32(uint32_t v)
+    {
+        uint32_t r = 0;
+        for (int i = 0; i < 32; ++i)
+        {
+            r |= ((v >> i) & 1u) << (31 - i);
+        }
+        return r;
+    }
+
+    // The multiplier of a lane half, as the reflected 64-bit operand of a
+    // carry-less product.
+    constexpr uint64_t FoldConstant(uint32_t bits)
+    {
+        return static_cast<uint64_t>(Reflect32(XPowModP(bits))) << 32;
+    }
+
+    struct FoldConstants
+    {
+        // For the low (earlier in the data) and high halves of a lane.
+        uint64_t lo;
+        uint64_t hi;
+    };
+
+    constexpr FoldConstants FoldBy(uint32_t bytes)
+    {
+        return FoldConstants{FoldConstant(8 * bytes + 63), FoldConstant(8 * bytes - 1)};
+    }
+
+    constexpr FoldConstants kFold256 = FoldBy(256);
+    constexpr FoldConstants kFold64 = FoldBy(64);
+    constexpr FoldConstants kFold16 = FoldBy(16);
+
+    // The kernel pays off past a few folds.
+    constexpr size_t kMinFoldLen = 256;
+
+    CRC32C_AVX512_TARGET inline __m512i Broadcast(const FoldConstants &k)
+    {
+        return _mm512_broadcast_i32x4(
+            _mm_set_epi64x(static_cast<long long>(k.hi), static_cast<long long>(k.lo)));
+    }
+
+    // Folds the 4 lanes of x forward onto data.
+    CRC32C_AVX512_TARGET inline __m512i Fold(__m512i x, __m512i k, __m512i data)
+    {
+        // 0x96 is a three-way xor.
+        return _mm512_ternarylogic_epi64(_mm512_clmulepi64_epi128(x, k, 0x00),
+                                         _mm512_clmulepi64_epi128(x, k, 0x11), data,
+                                         0x96);
+    }
+
+    CRC32C_AVX512_TARGET inline __m128i Fold(__m128i x, __m128i k, __m128i data)
+    {
+        return _mm_xor_si128(
+            _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)),
+            data);
+    }
+
+    // The loads of the kernel, which also store what they load to dst when
+    // copying, so that the data is copied on the way through the registers
+    // rather than read a second time.
+    template <bool kCopy>
+    CRC32C_AVX512_TARGET inline __m512i Load512(char *dst, const char *src,
+                                                size_t off = 0)
+    {
+        __m512i v = _mm512_loadu_si512(src + off);
+        if (kCopy)
+        {
+            _mm512_storeu_si512(dst + off, v);
+        }
+        return v;
+    }
+
+    template <bool kCopy>
+    CRC32C_AVX512_TARGET inline __m128i Load128(char *dst, const char *src)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        if (kCopy)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), v);
+        }
+        return v;
+    }
+
+    template <bool kCopy>
+    CRC32C_AVX512_TARGET inline uint64_t Tail(uint64_t crc, char *dst, const char *p,
+                                              size_t len)
+    {
+        for (; len >= 8; p += 8, len -= 8)
+        {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            if (kCopy)
+            {
+                memcpy(dst, &v, sizeof(v));
+                dst += 8;
+            }
+            crc = _mm_crc32_u64(crc, v);
+        }
+        for (; len > 0; ++p, --len)
+        {
+            if (kCopy)
+            {
+                *dst++ = *p;
+            }
+            crc = _mm_crc32_u8(static_cast<uint32_t>(crc), static_cast<uint8_t>(*p));
+        }
+        return crc;
+    }
+
+    // dst is only used, and advanced alongside data, when kCopy; it may be
+    // null otherwise.
+    template <bool kCopy>
+    CRC32C_AVX512_TARGET inline uint32_t Kernel(uint32_t crc, char *dst,
+                                                const char *data, size_t len)
+    {
+        // The CRC register is the complement of crc.
+        uint64_t reg = static_cast<uint32_t>(~crc);
+        if (len < kMinFoldLen)
+        {
+            return static_cast<uint32_t>(~Tail<kCopy>(reg, dst, data, len));
+        }
+
+        // Starting from reg is starting from zero with reg xor'ed into the
+        // first 4 bytes.
+        __m512i x0 = _mm512_xor_si512(
+            Load512<kCopy>(dst, data),
+            _mm512_set_epi64(0, 0, 0, 0, 0, 0, 0, static_cast<long long>(reg)));
+        __m512i x1 = Load512<kCopy>(dst, data, 64);
+        __m512i x2 = Load512<kCopy>(dst, data, 128);
+        __m512i x3 = Load512<kCopy>(dst, data, 192);
+        data += 256;
+        dst += kCopy ? 256 : 0;
+        len -= 256;
+
+        // 256 bytes per iteration, in 4 independent chains to hide the latency
+        // of the carry-less products.
+        const __m512i k256 = Broadcast(kFold256);
+        for (; len >= 256; data += 256, dst += kCopy ? 256 : 0, len -= 256)
+        {
+            x0 = Fold(x0, k256, Load512<kCopy>(dst, data));
+            x1 = Fold(x1, k256, Load512<kCopy>(dst, data, 64));
+            x2 = Fold(x2, k256, Load512<kCopy>(dst, data, 128));
+            x3 = Fold(x3, k256, Load512<kCopy>(dst, data, 192));
+        }
+
+        const __m512i k64 = Broadcast(kFold64);
+        x0 = Fold(x0, k64, x1);
+        x0 = Fold(x0, k64, x2);
+        x0 = Fold(x0, k64, x3);
+        for (; len >= 64; data += 64, dst += kCopy ? 64 : 0, len -= 64)
+        {
+            x0 = Fold(x0, k64, Load512<kCopy>(dst, data));
+        }
+
+        const __m128i k16 = _mm_set_epi64x(static_cast<long long>(kFold16.hi),
+                                           static_cast<long long>(kFold16.lo));
+        __m128i v = _mm512_extracti32x4_epi32(x0, 0);
+        v = Fold(v, k16, _mm512_extracti32x4_epi32(x0, 1));
+        v = Fold(v, k16, _mm512_extracti32x4_epi32(x0, 2));
+        v = Fold(v, k16, _mm512_extracti32x4_epi32(x0, 3));
+        for (; len >= 16; data += 16, dst += kCopy ? 16 : 0, len -= 16)
+        {
+            v = Fold(v, k16, Load128<kCopy>(dst, data));
+        }
+
+        // The CRC of the lane as data, from zero, is what is left of the
+        // register for all the data folded.
+        reg = _mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(v)));
+        reg = _mm_crc32_u64(reg, static_cast<uint64_t>(_mm_extract_epi64(v, 1)));
+        return static_cast<uint32_t>(~Tail<kCopy>(reg, dst, data, len));
+    }
+}
+
+CRC32C_AVX512_TARGET uint32_t crc32c_avx512(uint32_t crc, const char *data,
+                                            size_t len)
+{
+    return Kernel<false>(crc, nullptr, data, len);
+}
+
+CRC32C_AVX512_TARGET uint32_t crc32c_avx512_copy(uint32_t crc, char *dst,
+                                                 const char *src, size_t len)
+{
+    return Kernel<true>(crc, dst, src, len);
+}
+
+bool crc32c_avx512_runtime_check()
+{
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    const bool osxsave = (ecx & (1u << 27)) != 0;
+    const bool sse42 = (ecx & (1u << 20)) != 0;
+    const bool pclmul = (ecx & (1u << 1)) != 0;
+    if (!osxsave || !sse42 || !pclmul)
+    {
+        return false;
+    }
+    // The OS must save the SSE, AVX, opmask and ZMM states.
+    uint32_t xcr0_lo = 0, xcr0_hi = 0;
+    __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0xe6) != 0xe6)
+    {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    const bool avx512f = (ebx & (1u << 16)) != 0;
+    const bool vpclmulqdq = (ecx & (1u << 10)) != 0;
+    return avx512f && vpclmulqdq;
+}
+
+#endif // HAVE_AVX512_CRC32C
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C folded with VPCLMULQDQ over 512-bit registers, for x86-64 CPUs with
+// AVX-512 (Ice Lake and Zen 4 onwards). The kernel is compiled for its own
+// target whatever the baseline of the build, and picked at runtime (see
+// crc32c_avx512_runtime_check()), so generic binaries get it too.
+//
+// GCC 8 and Clang 6 are the first to know the VPCLMULQDQ intrinsics.
+#if defined(__x86_64__) && !defined(NO_AVX512_CRC32C) &&   \
+    ((defined(__clang__) && __clang_major__ >= 6) ||       \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8))
+#define HAVE_AVX512_CRC32C
+
+// Extends crc (unmasked, as crc32c::Extend() takes it) over data[0, len).
+uint32_t crc32c_avx512(uint32_t crc, const char *data, size_t len);
+
+// Same as crc32c_avx512(crc, src, len), copying src[0, len) to dst[0, len)
+// in the same pass. The ranges must not overlap.
+uint32_t crc32c_avx512_copy(uint32_t crc, char *dst, const char *src, size_t len);
+
+// Whether the CPU and OS support the kernel: AVX-512F and VPCLMULQDQ, with
+// the ZMM state enabled, along with SSE4.2 for the tail.
+bool crc32c_avx512_runtime_check();
+#endif
@@ -0,0 +1,100 @@
+#include "util/dynamic_bloom.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "memory/allocator.h"
+#include "port/port.h"
+#include "xiaodb/slice.h"
+#include "util/hash.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        uint32_t roundUpToPow2(uint32_t x)
+        {
+            uint32_t rv = 1;
+            while (rv < x)
+            {
+                rv <<= 1;
+            }
+            return rv;
+        }
+    }
+
+    DynamicBloom::DynamicBloom(Allocator *allocator, uint32_t total_bits,
+                               uint32_t num_probes, size_t huge_page_tlb_size,
+                               Logger *logger)
+        // Round down, except round up with 1
+        : kNumDoubleProbes((num_probes + (num_probes == 1)) / 2)
+    {
+        assert(num_probes % 2 == 0); // limitation of current implementation
+        assert(num_probes <= 10);    // limitation of current implementation
+        assert(kNumDoubleProbes > 0);
+
+        // Determine how much to round off + align by so that x ^ i (that's xor) is
+        // a valid u64 index if x is a valid u64 index and 0 <= i < kNumDoubleProbes.
+        uint32_t block_bytes = /*bytes/u64*/ 8 *
+                               /*align by*/ roundUpToPow2(kNumDoubleProbes);
+        uint32_t block_bits = block_bytes * 8;
+        uint32_t blocks = (total_bits + block_bits - 1) / block_bits;
+        uint32_t sz = blocks * block_bytes;
+        kLen = sz / /*bytes/u64*/ 8;
+        assert(kLen > 0);
+#ifndef NDEBUG
+        for (uint32_t i = 0; i < kNumDoubleProbes; ++i)
+        {
+            // Ensure probes starting at last word are in range
+            assert(((kLen - 1) ^ i) < kLen);
+        }
+#endif
+
+        // Padding to correct for allocation not originally aligned on block_bytes
+        // boundary
+        sz += block_bytes - 1;
+        assert(allocator);
+
+        char *raw = allocator->AllocateAligned(sz, huge_page_tlb_size, logger);
+        memset(raw, 0, sz);
+        auto block_offset = reinterpret_cast<uintptr_t>(raw) % block_bytes;
+        if (block_offset > 0)
+        {
+            // Align on block_bytes boundary
+            raw += block_bytes - block_offset;
+        }
+        static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+                      "Expecting zero-space-overhead atomic");
+        data_ = reinterpret_cast<std::atomic<uint64_t> *>(raw);
+    }
+
+    BlockedDynamicBloom::BlockedDynamicBloom(Allocator *allocator,
+                                             uint32_t total_bits,
+                                             size_t huge_page_tlb_size,
+                                             Logger *logger)
+    {
+        static_assert(CACHE_LINE_SIZE % kBlockBytes == 0,
+                      "A block must not straddle a cache line");
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                      "Expecting zero-space-overhead atomic");
+
+        uint32_t block_bits = kBlockBytes * 8;
+        kNumBlocks = std::max(1U, (total_bits + block_bits - 1) / block_bits);
+        size_t sz = static_cast<size_t>(kNumBlocks) * kBlockBytes;
+
+        // Padding to correct for allocation not originally aligned on a cache
+        // line boundary. Aligning on the cache line rather than just the block
+        // keeps adjacent blocks of one line together for the hardware prefetcher.
+        sz += CACHE_LINE_SIZE - 1;
+        assert(allocator);
+
+        char *raw = allocator->AllocateAligned(sz, huge_page_tlb_size, logger);
+        memset(raw, 0, sz);
+        auto line_offset = reinterpret_cast<uintptr_t>(raw) % CACHE_LINE_SIZE;
+        if (line_offset > 0)
+        {
+            raw += CACHE_LINE_SIZE - line_offset;
+        }
+        data_ = reinterpret_cast<std::atomic<uint32_t> *>(raw);
+    }
+}
@@ -49,11 +49,11 @@ namespace XIAODB_NAMESPACE
                 uint64_t range64 = range;
                 uint64_t tmp = uint64_t{range64 & 0xffffFFFF} * uint64_t{hash & 0xffffFFFF};
                 tmp >>= 32;
-                tmp += uint64_t{range64 & 0xffffFFFF} * uint64_t{hash & 0xffffFFFF};
-
+                tmp += uint64_t{range64 & 0xffffFFFF} * uint64_t{hash >> 32};
+                // Avoid overflow: first add lower 32 of tmp2, and later upper 32
                 uint64_t tmp2 = uint64_t{range64 >> 32} * uint64_t{hash & 0xffffFFFF};
                 tmp += static_cast<uint32_t>(tmp2);
-                tmp >> 32;
+                tmp >>= 32;
                 tmp += (tmp2 >> 32);
                 tmp += uint64_t{range64 >> 32} * uint64_t{hash >> 32};
                 return static_cast<Range>(tmp);
@@ -83,6 +83,19 @@ namespace XIAODB_NAMESPACE
         return XXPH3_64bits(data, n);
     }
 
+    void GetSliceHash64Batch(const Slice *const *keys, size_t n, uint64_t *hashes)
+    {
+        // XXH3 of a short key is a few dependent 64x64->128-bit multiplies,
+        // which vector units cannot do, and the keys of a batch are already
+        // in cache. Their chains are independent of one another, so the core
+        // overlaps them in a plain loop; interleaving them by hand measured
+        // no faster. The win is in not hashing again per filter.
+        for (size_t i = 0; i < n; ++i)
+        {
+            hashes[i] = XXPH3_64bits(keys[i]->data(), keys[i]->size());
+        }
+    }
+
     uint64_t GetSlicePartsNPHash64(const SliceParts &data, uint64_t seed)
     {
         // TODO(ajkr): use XXH3 streaming APIs to avoid the copy/allocation.
@@ -53,10 +53,12 @@ namespace XIAODB_NAMESPACE
 
     uint32_t Hash32(const char *data, size_t n, uint32_t seed);
 
-    inline uint32_t BloomHash32(const Slice &key)
+    // Useful for splitting up a 64-bit hash
+    inline uint32_t Upper32of64(uint64_t v)
     {
-        return Hash32(key.data(), key.size(), 0xbc9f1d34);
+        return static_cast<uint32_t>(v >> 32);
     }
+    inline uint32_t Lower32of64(uint64_t v) { return static_cast<uint32_t>(v); }
 
     inline uint64_t GetSliceHash64(const Slice &key)
     {
@@ -66,6 +68,25 @@ namespace XIAODB_NAMESPACE
     // specific overload needs to be used.
     extern uint64_t (*kGetSliceNPHash64UnseededFnPtr)(const Slice &);
 
+    // Computes hashes[i] = GetSliceHash64(*keys[i]) for i in [0, n), for the
+    // keys of a batched lookup (see KeyContext::key_hash), so that each key is
+    // hashed once for all the filters it is checked against rather than
+    // once per filter.
+    void GetSliceHash64Batch(const Slice *const *keys, size_t n, uint64_t *hashes);
+
+    // The hash of the in-memory Bloom filters (DynamicBloom), derived from
+    // GetSliceHash64() so that a batch hashed with GetSliceHash64Batch() can
+    // probe them too. They are never persisted, so this is free to change.
+    inline uint32_t BloomHash32FromSliceHash64(uint64_t slice_hash64)
+    {
+        return Lower32of64(slice_hash64);
+    }
+
+    inline uint32_t BloomHash32(const Slice &key)
+    {
+        return BloomHash32FromSliceHash64(GetSliceHash64(key));
+    }
+
     inline uint64_t GetSliceNPHash64(const Slice &s)
     {
         return NPHash64(s.data(), s.size());
@@ -91,13 +112,6 @@ namespace XIAODB_NAMESPACE
         return Hash32(s.data(), s.size(), 397);
     }
 
-    // Useful for splitting up a 64-bit hash
-    inline uint32_t Upper32of64(uint64_t v)
-    {
-        return static_cast<uint32_t>(v >> 32);
-    }
-    inline uint32_t Lower32of64(uint64_t v) { return static_cast<uint32_t>(v); }
-
     // std::hash-like interface.
     struct SliceHasher32
     {
@@ -0,0 +1,92 @@
+#include "util/record_stream_compression.h"
+
+namespace XIAODB_NAMESPACE
+{
+    namespace
+    {
+        // Format version of the compressed records. Streaming compression
+        // keeps no size prefix, unlike block compression.
+        constexpr uint32_t kStreamFormatVersion = 2;
+    }
+
+    Status RecordStreamCompressor::Create(
+        CompressionType compression_type, const CompressionOptions &opts,
+        size_t max_fragment_len, std::unique_ptr<RecordStreamCompressor> *result)
+    {
+        assert(max_fragment_len > 0);
+        std::unique_ptr<StreamingCompress> compress(StreamingCompress::Create(
+            compression_type, opts, kStreamFormatVersion, max_fragment_len));
+        if (compress == nullptr)
+        {
+            return Status::NotSupported("Streaming compression not supported",
+                                        CompressionTypeToString(compression_type));
+        }
+        result->reset(new RecordStreamCompressor(std::move(compress), max_fragment_len));
+        return Status::OK();
+    }
+
+    Status RecordStreamCompressor::CompressRecord(
+        const Slice &record, const std::function<Status(const Slice &)> &emit)
+    {
+        raw_bytes_ += record.size();
+        int remaining = 0;
+        do
+        {
+            size_t output_pos = 0;
+            remaining = compress_->Compress(record.data(), record.size(), buf_.get(),
+                                            &output_pos);
+            if (remaining < 0)
+            {
+                return Status::Corruption("Error compressing record");
+            }
+            if (output_pos > 0)
+            {
+                compressed_bytes_ += output_pos;
+                Status s = emit(Slice(buf_.get(), output_pos));
+                if (!s.ok())
+                {
+                    return s;
+                }
+            }
+        } while (remaining > 0);
+        return Status::OK();
+    }
+
+    Status RecordStreamUncompressor::Create(
+        CompressionType compression_type,
+        std::unique_ptr<RecordStreamUncompressor> *result)
+    {
+        std::unique_ptr<StreamingUncompress> uncompress(StreamingUncompress::Create(
+            compression_type, kStreamFormatVersion, kOutputSize));
+        if (uncompress == nullptr)
+        {
+            return Status::NotSupported("Streaming compression not supported",
+                                        CompressionTypeToString(compression_type));
+        }
+        result->reset(new RecordStreamUncompressor(std::move(uncompress)));
+        return Status::OK();
+    }
+
+    Status RecordStreamUncompressor::UncompressFragment(const Slice &fragment,
+                                                        std::string *record)
+    {
+        const char *input = fragment.data();
+        int remaining = 0;
+        size_t output_pos = 0;
+        // A full output buffer may leave output pending even once the input
+        // is consumed.
+        do
+        {
+            remaining = uncompress_->Uncompress(input, fragment.size(), buf_.get(),
+                                                &output_pos);
+            if (remaining < 0)
+            {
+                return Status::Corruption("Error uncompressing record");
+            }
+            record->append(buf_.get(), output_pos);
+            // Continue with the same input.
+            input = nullptr;
+        } while (remaining > 0 || output_pos == kOutputSize);
+        return Status::OK();
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "util/compression.h"
+#include "xiaodb/slice.h"
+#include "xiaodb/status.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Compresses a sequence of log records, such as WAL records or the
+    // records of a blob log file, as one stream (see StreamingCompress), so
+    // that a record is compressed with the records before it as context,
+    // rather than each on its own. The compressed form of a record is still
+    // complete when CompressRecord() returns: a crash loses no more than
+    // without compression, and the record can be fsync'ed on its own.
+    //
+    // Uncompressing a record takes all the compressed records before it
+    // since the start of the stream, in order, so the stream must be started
+    // over (Reset()) wherever a reader may start, e.g. at each new log file.
+    // The WAL records the type in its CompressionTypeRecord, and a blob log
+    // file in its header (BlobLogHeader::stream_compressed).
+    //
+    // NOTE: This class is not thread safe.
+    class RecordStreamCompressor
+    {
+    public:
+        // The compressed records are emitted in fragments of up to
+        // max_fragment_len bytes, e.g. so that a log writer can fit them in
+        // the space left in its block. Fails with NotSupported if the
+        // compression type does not support streaming in this build.
+        static Status Create(CompressionType compression_type,
+                             const CompressionOptions &opts,
+                             size_t max_fragment_len,
+                             std::unique_ptr<RecordStreamCompressor> *result);
+
+        // Compresses record as the next one of the stream, passing each
+        // fragment of the compressed record to emit, which must copy it.
+        // Stops at the first error emit returns. On failure, the stream is
+        // broken and must be Reset().
+        Status CompressRecord(const Slice &record,
+                              const std::function<Status(const Slice &)> &emit);
+
+        // Starts a new stream.
+        void Reset() { compress_->Reset(); }
+
+        uint64_t raw_bytes() const { return raw_bytes_; }
+        uint64_t compressed_bytes() const { return compressed_bytes_; }
+
+    private:
+        RecordStreamCompressor(std::unique_ptr<StreamingCompress> &&compress,
+                               size_t max_fragment_len)
+            : compress_(std::move(compress)), buf_(new char[max_fragment_len]) {}
+
+        std::unique_ptr<StreamingCompress> compress_;
+        std::unique_ptr<char[]> buf_;
+        uint64_t raw_bytes_ = 0;
+        uint64_t compressed_bytes_ = 0;
+    };
+
+    // Uncompresses the records of a stream compressed by a
+    // RecordStreamCompressor, fed their fragments in order.
+    //
+    // NOTE: This class is not thread safe.
+    class RecordStreamUncompressor
+    {
+    public:
+        static Status Create(CompressionType compression_type,
+                             std::unique_ptr<RecordStreamUncompressor> *result);
+
+        // Uncompresses the next fragment of the stream, appending its
+        // contents to *record. A record is complete once all of its
+        // fragments have been fed. Fails with Corruption, after which the
+        // stream must be Reset().
+        Status UncompressFragment(const Slice &fragment, std::string *record);
+
+        // Starts a new stream.
+        void Reset() { uncompress_->Reset(); }
+
+    private:
+        // The output is uncompressed in pieces of this size.
+        static constexpr size_t kOutputSize = 32 << 10;
+
+        explicit RecordStreamUncompressor(
+            std::unique_ptr<StreamingUncompress> &&uncompress)
+            : uncompress_(std::move(uncompress)), buf_(new char[kOutputSize]) {}
+
+        std::unique_ptr<StreamingUncompress> uncompress_;
+        std::unique_ptr<char[]> buf_;
+    };
+}
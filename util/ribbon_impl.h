@@ -0,0 +1,193 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "port/port.h"
+#include "util/fastrange.h"
+#include "util/hash.h"
+#include "util/math.h"
+
+namespace XIAODB_NAMESPACE
+{
+    // Standard Ribbon filter: a static function retrieval structure that, like
+    // an XOR filter, stores r fingerprint bits per key in roughly r * (1 + e)
+    // bits per key, for an FP rate of 2^-r. Compared with a Bloom filter of
+    // the same FP rate it saves about 30% space, at the cost of more CPU and
+    // temporary memory at construction time.
+    //
+    // Each key hashes to a start slot, a 64-bit coefficient row (whose low
+    // bit is always set) and an r-bit result. Construction finds a solution S,
+    // one r-bit value per slot, such that for every key, the XOR of the
+    // solution values at the slots selected by its coefficient bits (slots
+    // start .. start + 63) equals its result. A query recomputes that XOR and
+    // compares it with the result. Keys are added to a banded linear system
+    // on the fly, and the system is solved by back substitution.
+    //
+    // The solution is stored interleaved: the slots are grouped into 64-slot
+    // segments, and the r bit planes of a segment are stored as r consecutive
+    // 64-bit words. A query touches at most two adjacent segments, i.e. 2r
+    // consecutive words, which usually lie in one or two cache lines. Words
+    // are stored in native (little-endian) byte order.
+    //
+    // Construction can fail for an unlucky set of hashes; the builder then
+    // retries with another seed. See https://arxiv.org/abs/2103.02515.
+    class StandardRibbonImpl
+    {
+    public:
+        static constexpr uint32_t kCoeffBits = 64;
+        static constexpr int kMaxResultBits = 32;
+
+        struct Hashed
+        {
+            uint32_t start;
+            uint64_t coeff;
+            uint32_t result;
+        };
+
+        // num_slots: multiple of kCoeffBits, at least kCoeffBits.
+        // result_bits: in [1, kMaxResultBits].
+        static inline Hashed Derive(uint64_t key_hash, uint32_t seed,
+                                    uint32_t num_slots, int result_bits)
+        {
+            // Remix so that every derived value changes with the seed.
+            uint64_t h = key_hash ^ (uint64_t{seed} * 0x9E3779B97F4A7C15U);
+            h *= 0xd6e8feb86659fd93U;
+            h ^= h >> 32;
+            uint64_t c = h * 0xc2b2ae3d27d4eb4fU;
+            c ^= c >> 29;
+
+            Hashed hashed;
+            hashed.start = static_cast<uint32_t>(
+                FastRange64(h, num_slots - kCoeffBits + 1));
+            hashed.coeff = c | 1;
+            hashed.result = Upper32of64(c * 0x9E3779B97F4A7C15U) >> (32 - result_bits);
+            return hashed;
+        }
+
+        // The banded linear system, one row per slot. Row i has its lowest
+        // coefficient bit at slot i, or is empty.
+        class Banding
+        {
+        public:
+            explicit Banding(uint32_t num_slots)
+                : coeff_rows_(num_slots, 0), result_rows_(num_slots, 0) {}
+
+            // Returns false if the key makes the system unsolvable, in which case
+            // the Banding must be discarded.
+            bool Add(const Hashed &hashed)
+            {
+                uint32_t i = hashed.start;
+                uint64_t c = hashed.coeff;
+                uint32_t r = hashed.result;
+                for (;;)
+                {
+                    if (coeff_rows_[i] == 0)
+                    {
+                        coeff_rows_[i] = c;
+                        result_rows_[i] = r;
+                        return true;
+                    }
+                    c ^= coeff_rows_[i];
+                    r ^= result_rows_[i];
+                    if (c == 0)
+                    {
+                        // Linearly dependent on keys already added: fine if
+                        // consistent (e.g. a duplicate key), fatal otherwise.
+                        return r == 0;
+                    }
+                    int tz = CountTrailingZeroBits(c);
+                    i += static_cast<uint32_t>(tz);
+                    c >>= tz;
+                }
+            }
+
+            uint32_t NumSlots() const
+            {
+                return static_cast<uint32_t>(coeff_rows_.size());
+            }
+
+            // Writes the solution to segments, which must hold
+            // NumSlots() / kCoeffBits * result_bits zeroed words.
+            void BackSubstitute(int result_bits, uint64_t *segments) const
+            {
+                const uint32_t num_segments = NumSlots() / kCoeffBits;
+                for (uint32_t i = NumSlots(); i-- > 0;)
+                {
+                    const uint64_t c = coeff_rows_[i];
+                    if (c == 0)
+                    {
+                        // Free variable
+                        continue;
+                    }
+                    const uint32_t seg = i / kCoeffBits;
+                    const int off = static_cast<int>(i % kCoeffBits);
+                    for (int j = 0; j < result_bits; ++j)
+                    {
+                        uint64_t window = segments[seg * result_bits + j] >> off;
+                        if (off != 0 && seg + 1 < num_segments)
+                        {
+                            window |= segments[(seg + 1) * result_bits + j]
+                                      << (kCoeffBits - off);
+                        }
+                        // Bit i of the plane is still zero, so the parity only
+                        // covers the later slots.
+                        uint64_t bit = ((result_rows_[i] >> j) & 1) ^
+                                       static_cast<uint64_t>(BitParity(c & window));
+                        segments[seg * result_bits + j] |= bit << off;
+                    }
+                }
+            }
+
+        private:
+            std::vector<uint64_t> coeff_rows_;
+            std::vector<uint32_t> result_rows_;
+        };
+
+        static inline void Prefetch(const Hashed &hashed, int result_bits,
+                                    const char *data)
+        {
+            const char *first =
+                data + (hashed.start / kCoeffBits) * result_bits * sizeof(uint64_t);
+            PREFETCH(first, 0 /* rw */, 1 /* locality */);
+            PREFETCH(first + 2 * result_bits * sizeof(uint64_t) - 1, 0 /* rw */,
+                     1 /* locality */);
+        }
+
+        // data: the segments written by BackSubstitute(), with no alignment
+        // requirement.
+        static inline bool MayMatch(const Hashed &hashed, int result_bits,
+                                    const char *data)
+        {
+            const char *lo =
+                data + (hashed.start / kCoeffBits) * result_bits * sizeof(uint64_t);
+            const char *hi = lo + result_bits * sizeof(uint64_t);
+            const int off = static_cast<int>(hashed.start % kCoeffBits);
+            uint32_t computed = 0;
+            for (int j = 0; j < result_bits; ++j)
+            {
+                // The start is at most NumSlots() - kCoeffBits, so the next
+                // segment exists whenever off != 0.
+                uint64_t window = LoadWord(lo, j) >> off;
+                if (off != 0)
+                {
+                    window |= LoadWord(hi, j) << (kCoeffBits - off);
+                }
+                computed |= static_cast<uint32_t>(BitParity(hashed.coeff & window))
+                            << j;
+            }
+            return computed == hashed.result;
+        }
+
+    private:
+        static inline uint64_t LoadWord(const char *p, int i)
+        {
+            uint64_t word;
+            memcpy(&word, p + i * sizeof(uint64_t), sizeof(word));
+            return word;
+        }
+    };
+}
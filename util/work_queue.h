@@ -7,6 +7,7 @@
 #include <functional>
 #include <mutex>
 #include <queue>
+#include <utility>
 
 #include "xiaodb/xiaodb_namespace.h"
 
@@ -17,7 +18,7 @@ namespace XIAODB_NAMESPACE
     {
         std::mutex mutex_;
         std::condition_variable readerCv_;
-        std::condition_variable writeCv_;
+        std::condition_variable writerCv_;
         std::condition_variable finishCv_;
 
         std::queue<T> queue_;
@@ -44,7 +45,7 @@ namespace XIAODB_NAMESPACE
                 std::unique_lock<std::mutex> lock(mutex_);
                 while (full() && !done_)
                 {
-                    writeCv_.wait(lock);
+                    writerCv_.wait(lock);
                 }
                 if (done_)
                 {
@@ -78,7 +79,7 @@ namespace XIAODB_NAMESPACE
                     assert(done_);
                     return false;
                 }
-                item = queue_.front();
+                item = std::move(queue_.front());
                 queue_.pop();
             }
             writerCv_.notify_one();